@@ -0,0 +1,575 @@
+#include "core/file_io.h"
+#include "core/job_pool.h"
+#include "core/mutex.h"
+#include "core/time.h"
+#include "core/log.h"
+#include "core/profiler.h"
+#include "core/glm_headers.h"
+#include "engine/assets/model_data.h"
+#include "engine/assets/asset_file.h"
+#include "engine/assets/textures.h"
+#include "engine/assets/texture_compressor.h"
+#include "engine/assets/bake_cache.h"
+#include "engine/systems/job_system.h"
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Headless batch baker, bakes every model + texture under the data roots using all cores
+// Run from the data directory (the same working directory as the engine)
+// r3_bake [--only-stale] [--prune] [--threads N] [--texture-benchmark] [--texture-load-benchmark] [--model-load-benchmark] [--model-bake-benchmark] [paths to bake (files or directories, default = data root)]
+//	--only-stale			skip assets that already have an up-to-date baked file (otherwise everything is rebaked)
+//	--prune					delete baked files that are no longer referenced by the manifest, only when the whole data root was baked without failures
+//	--threads N				number of bake threads (default = all cores)
+//	--texture-benchmark		nothing is baked, instead reports texture compressor throughput (single core) + PSNR for the textures in paths
+//	--texture-load-benchmark	nothing is baked, instead loads the baked textures in paths into a staging buffer + reports load time and peak memory
+//	--model-load-benchmark	nothing is baked, instead loads the baked models in paths with + without blob codecs and reports file sizes + load times
+//	--model-bake-benchmark	rebakes the models in paths with parts optimised serially, then in parallel via a JobSystem, and reports bake times
+
+const std::vector<std::string> c_modelExtensions = { ".fbx", ".obj", ".gltf", ".glb", ".dae", ".3ds", ".blend" };
+const std::vector<std::string> c_textureExtensions = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd" };
+const std::string c_bakedDirectory = "baked";
+
+struct BakeArgs
+{
+	bool m_onlyStale = false;
+	bool m_prune = false;
+	bool m_textureBenchmark = false;
+	bool m_textureLoadBenchmark = false;
+	bool m_modelLoadBenchmark = false;
+	bool m_modelBakeBenchmark = false;
+	int m_threadCount = 0;
+	std::vector<std::string> m_paths;
+};
+
+struct BakeResult
+{
+	std::string m_path;
+	bool m_isModel = false;
+	bool m_succeeded = false;
+	bool m_wasStale = true;
+	double m_timeMs = 0.0;
+	uint64_t m_sourceSize = 0;
+	uint64_t m_bakedSize = 0;
+};
+
+bool HasExtension(const std::filesystem::path& p, const std::vector<std::string>& extensions)
+{
+	std::string ext = p.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+double GetTimeSeconds()
+{
+	return R3::Time::HighPerformanceCounterTicks() / (double)R3::Time::HighPerformanceCounterFrequency();
+}
+
+uint64_t GetPeakMemoryBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+	rusage usage = {};
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<uint64_t>(usage.ru_maxrss) * 1024 : 0;
+#endif
+}
+
+uint64_t GetFileSize(std::string_view path)
+{
+	std::error_code ec;
+	const uint64_t size = std::filesystem::file_size(path, ec);
+	return ec ? 0 : size;
+}
+
+bool ParseArgs(int argc, char** args, BakeArgs& result)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = args[i];
+		if (arg == "--only-stale")
+		{
+			result.m_onlyStale = true;
+		}
+		else if (arg == "--prune")
+		{
+			result.m_prune = true;
+		}
+		else if (arg == "--texture-benchmark")
+		{
+			result.m_textureBenchmark = true;
+		}
+		else if (arg == "--texture-load-benchmark")
+		{
+			result.m_textureLoadBenchmark = true;
+		}
+		else if (arg == "--model-load-benchmark")
+		{
+			result.m_modelLoadBenchmark = true;
+		}
+		else if (arg == "--model-bake-benchmark")
+		{
+			result.m_modelBakeBenchmark = true;
+		}
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			result.m_threadCount = std::max(1, atoi(args[++i]));
+		}
+		else if (arg.starts_with("--"))
+		{
+			R3::LogError("Unknown argument {}", arg);
+			return false;
+		}
+		else
+		{
+			result.m_paths.emplace_back(arg);
+		}
+	}
+	if (result.m_threadCount == 0)
+	{
+		result.m_threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (result.m_paths.empty())
+	{
+		result.m_paths.push_back(".");
+	}
+	return true;
+}
+
+// collect models + textures from files/directories, paths are relative to the data root
+void FindAssets(const BakeArgs& bakeArgs, std::vector<std::string>& models, std::vector<std::string>& textures)
+{
+	R3_PROF_EVENT();
+	auto addFile = [&](const std::filesystem::path& p) {
+		if (HasExtension(p, c_modelExtensions))
+		{
+			models.push_back(R3::FileIO::SanitisePath(p.string()));
+		}
+		else if (HasExtension(p, c_textureExtensions))
+		{
+			textures.push_back(R3::FileIO::SanitisePath(p.string()));
+		}
+	};
+	for (const auto& path : bakeArgs.m_paths)
+	{
+		std::error_code ec;
+		if (std::filesystem::is_directory(path, ec))
+		{
+			auto it = std::filesystem::recursive_directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec);
+			for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+			{
+				if (it->is_directory() && it->path().filename() == c_bakedDirectory)
+				{
+					it.disable_recursion_pending();		// never bake our own output
+				}
+				else if (it->is_regular_file())
+				{
+					addFile(it->path());
+				}
+			}
+		}
+		else if (std::filesystem::is_regular_file(path, ec))
+		{
+			addFile(path);
+		}
+		else
+		{
+			R3::LogWarn("{} not found", path);
+		}
+	}
+}
+
+// runs fn(i) for i in [0, count) on the pool, the calling thread helps out until everything is done
+void RunParallel(R3::JobPool& pool, size_t count, std::function<void(size_t)> fn)
+{
+	R3_PROF_EVENT();
+	std::atomic<size_t> jobsRemaining = count;
+	for (size_t i = 0; i < count; ++i)
+	{
+		pool.PushJob([i, &fn, &jobsRemaining]() {
+			fn(i);
+			jobsRemaining--;
+		});
+	}
+	while (jobsRemaining > 0)
+	{
+		if (!pool.RunJobImmediate())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+BakeResult BakeAsset(const std::string& path, bool isModel, bool onlyStale)
+{
+	R3_PROF_EVENT();
+	BakeResult result;
+	result.m_path = path;
+	result.m_isModel = isModel;
+	result.m_sourceSize = GetFileSize(path);
+	const std::string bakedPath = isModel ? R3::GetBakedModelPath(path) : R3::Textures::GetBakedTexturePath(path);
+	if (bakedPath.empty())
+	{
+		return result;
+	}
+	std::error_code ec;
+	if (std::filesystem::exists(bakedPath, ec))
+	{
+		if (onlyStale)
+		{
+			result.m_succeeded = true;
+			result.m_wasStale = false;
+			result.m_bakedSize = GetFileSize(bakedPath);
+			return result;
+		}
+		std::filesystem::remove(bakedPath, ec);		// force a rebake
+	}
+	const double startTime = GetTimeSeconds();
+	if (isModel)
+	{
+		result.m_succeeded = R3::BakeModel(path, [](int) {});
+	}
+	else
+	{
+		result.m_succeeded = R3::Textures::BakeTexture(path) && std::filesystem::exists(bakedPath, ec);
+	}
+	const double endTime = GetTimeSeconds();
+	result.m_timeMs = (endTime - startTime) * 1000.0;
+	result.m_bakedSize = GetFileSize(bakedPath);
+	return result;
+}
+
+// peak signal to noise ratio of the first channelCount channels
+double CalculatePSNR(const std::vector<uint8_t>& reference, const std::vector<uint8_t>& decoded, uint32_t channelCount)
+{
+	double totalErrorSq = 0.0;
+	for (size_t i = 0; i < reference.size(); i += 4)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			const double d = static_cast<double>(reference[i + c]) - decoded[i + c];
+			totalErrorSq += d * d;
+		}
+	}
+	const double mse = totalErrorSq / ((reference.size() / 4) * channelCount);
+	return mse == 0.0 ? 99.0 : 10.0 * std::log10((255.0 * 255.0) / mse);
+}
+
+// compresses each texture with every format + quality on the calling thread
+// no JobSystem exists in r3_bake so CompressImage runs serially, the results are per core
+int RunTextureBenchmark(const std::vector<std::string>& textures)
+{
+	R3_PROF_EVENT();
+	using namespace R3::Textures;
+	const std::pair<Format, uint32_t> c_formats[] = {	// format + channels used for PSNR
+		{ Format::RGBA_BC1, 3 }, { Format::RGBA_BC3, 4 }, { Format::R_BC4, 1 }, { Format::RG_BC5, 2 }, { Format::RGBA_BC7, 4 }
+	};
+	const CompressionQuality c_qualities[] = { CompressionQuality::Fast, CompressionQuality::Normal, CompressionQuality::High };
+	bool succeeded = true;
+	for (const auto& path : textures)
+	{
+		auto source = LoadTexture(path);
+		if (!source || source->m_format == Format::RGB_U8 || IsBlockCompressed(source->m_format))
+		{
+			R3::LogError("Failed to load {} as an uncompressed texture", path);
+			succeeded = false;
+			continue;
+		}
+		const uint32_t srcChannels = source->m_format == Format::R_U8 ? 1 : (source->m_format == Format::RG_U8 ? 2 : 4);
+		const size_t pixelCount = static_cast<size_t>(source->m_width) * source->m_height;
+		std::vector<uint8_t> rgba(pixelCount * 4, 0), decoded(pixelCount * 4);
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			for (uint32_t c = 0; c < srcChannels; ++c)
+			{
+				rgba[i * 4 + c] = source->m_imgData[i * srcChannels + c];
+			}
+			rgba[i * 4 + 3] = srcChannels == 4 ? rgba[i * 4 + 3] : 255;
+		}
+		R3::LogInfo("{} ({}x{})", path, source->m_width, source->m_height);
+		for (const auto& [format, psnrChannels] : c_formats)
+		{
+			std::vector<uint8_t> blocks(GetCompressedSizeBytes(source->m_width, source->m_height, format));
+			for (auto quality : c_qualities)
+			{
+				const double startTime = GetTimeSeconds();
+				if (!CompressImage(rgba.data(), source->m_width, source->m_height, format, quality, blocks))
+				{
+					succeeded = false;
+					continue;
+				}
+				const double endTime = GetTimeSeconds();
+				DecompressImage(blocks.data(), source->m_width, source->m_height, format, decoded);
+				R3::LogInfo("\t{}\t{}\t{:.2f} MPixels/s\t{:.2f} dB", FormatToString(format), QualityToString(quality),
+					(pixelCount / 1000000.0) / (endTime - startTime), CalculatePSNR(rgba, decoded, psnrChannels));
+			}
+		}
+	}
+	return succeeded ? 0 : 1;
+}
+
+// loads the baked file of each texture + copies its mips into a staging buffer the same way TextureSystem does (without a gpu)
+// textures that are not baked yet are skipped, peak memory is for the whole process
+int RunTextureLoadBenchmark(const std::vector<std::string>& textures)
+{
+	R3_PROF_EVENT();
+	std::vector<uint8_t> staging;
+	uint64_t totalBytes = 0;
+	uint32_t loadedCount = 0;
+	const uint64_t startMemory = GetPeakMemoryBytes();
+	const double startTime = GetTimeSeconds();
+	for (const auto& path : textures)
+	{
+		auto texture = R3::Textures::LoadTexture(R3::Textures::GetBakedTexturePath(path));
+		if (!texture)
+		{
+			continue;
+		}
+		const std::span<const uint8_t> imageData = texture->GetImageData();
+		size_t stagingOffset = 0;
+		for (const auto& mip : texture->m_mips)
+		{
+			stagingOffset = R3::AlignUpPow2(stagingOffset, (size_t)16);
+			if (staging.size() < stagingOffset + mip.m_sizeBytes)
+			{
+				staging.resize(stagingOffset + mip.m_sizeBytes);
+			}
+			memcpy(staging.data() + stagingOffset, imageData.data() + mip.m_offset, mip.m_sizeBytes);
+			stagingOffset += mip.m_sizeBytes;
+		}
+		totalBytes += stagingOffset;
+		++loadedCount;
+	}
+	const double endTime = GetTimeSeconds();
+	R3::LogInfo("Loaded {} of {} baked textures ({:.1f}mb) in {:.1f}ms, peak memory {:.1f}mb (was {:.1f}mb before loading)", loadedCount, textures.size(),
+		totalBytes / (1024.0 * 1024.0), (endTime - startTime) * 1000.0, GetPeakMemoryBytes() / (1024.0 * 1024.0), startMemory / (1024.0 * 1024.0));
+	return loadedCount > 0 ? 0 : 1;
+}
+
+// each baked model is re-saved without codecs to the temp directory, both versions are loaded a few times and the fastest load is reported
+// the files are in the OS cache after the first load, so this measures decode cost vs the time saved reading fewer bytes
+int RunModelLoadBenchmark(const std::vector<std::string>& models)
+{
+	R3_PROF_EVENT();
+	constexpr int c_loadsPerModel = 4;
+	uint64_t compressedBytes = 0, rawBytes = 0;
+	double compressedMs = 0.0, rawMs = 0.0;
+	uint32_t loadedCount = 0;
+	auto timeLoad = [](const std::string& path) {
+		double fastestMs = -1.0;
+		for (int i = 0; i < c_loadsPerModel; ++i)
+		{
+			R3::ModelData model;
+			const double startTime = GetTimeSeconds();
+			if (!R3::LoadModelData(path, model))
+			{
+				return -1.0;
+			}
+			const double loadMs = (GetTimeSeconds() - startTime) * 1000.0;
+			fastestMs = fastestMs < 0.0 ? loadMs : std::min(fastestMs, loadMs);
+		}
+		return fastestMs;
+	};
+	for (const auto& path : models)
+	{
+		const std::string bakedPath = R3::GetBakedModelPath(path);
+		auto asset = bakedPath.empty() ? std::nullopt : R3::LoadAssetFile(bakedPath);
+		if (!asset)
+		{
+			continue;
+		}
+		for (auto& blob : asset->m_blobs)
+		{
+			blob.m_codec = R3::AssetBlobCodec::None;
+		}
+		const std::filesystem::path bakedFile(bakedPath);
+		const std::string rawPath = (std::filesystem::temp_directory_path() / (bakedFile.stem().string() + ".raw" + bakedFile.extension().string())).string();
+		if (!R3::SaveAssetFile(*asset, rawPath))
+		{
+			continue;
+		}
+		const double thisCompressedMs = timeLoad(bakedPath), thisRawMs = timeLoad(rawPath);
+		std::error_code ec;
+		if (thisCompressedMs >= 0.0 && thisRawMs >= 0.0)
+		{
+			const uint64_t thisCompressedBytes = std::filesystem::file_size(bakedPath, ec), thisRawBytes = std::filesystem::file_size(rawPath, ec);
+			R3::LogInfo("{}: {}kb -> {}kb, load {:.2f}ms -> {:.2f}ms", path, thisRawBytes / 1024, thisCompressedBytes / 1024, thisRawMs, thisCompressedMs);
+			compressedBytes += thisCompressedBytes;
+			rawBytes += thisRawBytes;
+			compressedMs += thisCompressedMs;
+			rawMs += thisRawMs;
+			++loadedCount;
+		}
+		std::filesystem::remove(rawPath, ec);
+	}
+	R3::LogInfo("Loaded {} of {} baked models: raw {:.1f}mb in {:.1f}ms, compressed {:.1f}mb in {:.1f}ms ({:.2f}x smaller)", loadedCount, models.size(),
+		rawBytes / (1024.0 * 1024.0), rawMs, compressedBytes / (1024.0 * 1024.0), compressedMs, compressedBytes > 0 ? (double)rawBytes / compressedBytes : 0.0);
+	return loadedCount > 0 ? 0 : 1;
+}
+
+// OptimiseModel only runs parts in parallel if a JobSystem exists, r3_bake normally has none (assets are baked in parallel instead)
+// every model is baked on the main thread without a JobSystem first, then again with one, the baked files must be identical
+int RunModelBakeBenchmark(const std::vector<std::string>& models)
+{
+	R3_PROF_EVENT();
+	std::vector<double> serialMs(models.size(), -1.0);
+	std::vector<std::vector<uint8_t>> serialFiles(models.size());
+	auto timeBake = [&](size_t i, std::vector<uint8_t>& bakedData) {
+		const std::string bakedPath = R3::GetBakedModelPath(models[i]);
+		std::error_code ec;
+		std::filesystem::remove(bakedPath, ec);
+		const double startTime = GetTimeSeconds();
+		if (bakedPath.empty() || !R3::BakeModel(models[i], [](int) {}) || !R3::FileIO::LoadBinaryFile(bakedPath, bakedData))
+		{
+			return -1.0;
+		}
+		return (GetTimeSeconds() - startTime) * 1000.0;
+	};
+	for (size_t i = 0; i < models.size(); ++i)
+	{
+		serialMs[i] = timeBake(i, serialFiles[i]);
+	}
+
+	R3::Systems::GetInstance().RegisterSystem<R3::JobSystem>();
+	double totalSerialMs = 0.0, totalParallelMs = 0.0;
+	uint32_t bakedCount = 0, mismatches = 0;
+	for (size_t i = 0; i < models.size(); ++i)
+	{
+		std::vector<uint8_t> parallelFile;
+		const double parallelMs = timeBake(i, parallelFile);
+		if (serialMs[i] < 0.0 || parallelMs < 0.0)
+		{
+			R3::LogError("FAILED {}", models[i]);
+			continue;
+		}
+		const bool matches = parallelFile == serialFiles[i];
+		mismatches += matches ? 0 : 1;
+		totalSerialMs += serialMs[i];
+		totalParallelMs += parallelMs;
+		++bakedCount;
+		R3::LogInfo("{}: serial {:.1f}ms, parallel {:.1f}ms{}", models[i], serialMs[i], parallelMs, matches ? "" : " (baked files differ!)");
+	}
+	R3::Systems::GetInstance().Shutdown();
+	R3::LogInfo("Baked {} of {} models: serial {:.1f}ms, parallel {:.1f}ms ({:.2f}x), {} baked files differ", bakedCount, models.size(), totalSerialMs, totalParallelMs,
+		totalSerialMs / std::max(totalParallelMs, 0.000001), mismatches);
+	R3::BakeCache::SaveManifest();
+	return (bakedCount > 0 && mismatches == 0) ? 0 : 1;
+}
+
+int main(int argc, char** args)
+{
+	R3_PROF_THREAD("Main");
+	BakeArgs bakeArgs;
+	if (!ParseArgs(argc, args, bakeArgs))
+	{
+		R3::LogInfo("Usage: r3_bake [--only-stale] [--prune] [--threads N] [--texture-benchmark] [--texture-load-benchmark] [--model-load-benchmark] [--model-bake-benchmark] [paths]");
+		return 1;
+	}
+	R3::FileIO::InitialisePaths();
+	R3::FileIO::AddBasePath("common");
+
+	std::vector<std::string> models, textures;
+	FindAssets(bakeArgs, models, textures);
+	if (bakeArgs.m_textureBenchmark)
+	{
+		return RunTextureBenchmark(textures);
+	}
+	if (bakeArgs.m_textureLoadBenchmark)
+	{
+		return RunTextureLoadBenchmark(textures);
+	}
+	if (bakeArgs.m_modelLoadBenchmark)
+	{
+		return RunModelLoadBenchmark(models);
+	}
+	if (bakeArgs.m_modelBakeBenchmark)
+	{
+		return RunModelBakeBenchmark(models);
+	}
+	R3::LogInfo("Baking {} models + {} textures on {} threads{}", models.size(), textures.size(), bakeArgs.m_threadCount, bakeArgs.m_onlyStale ? " (only stale)" : "");
+
+	const double startTime = GetTimeSeconds();
+	std::vector<BakeResult> results;
+	R3::Mutex resultsMutex;
+	{
+		R3::JobPool pool(bakeArgs.m_threadCount - 1, R3::JobPool::Priority::Normal, "Bake");	// the main thread also bakes
+		auto bakeAndReport = [&](const std::string& path, bool isModel) {
+			BakeResult result = BakeAsset(path, isModel, bakeArgs.m_onlyStale);
+			R3::ScopedLock lock(resultsMutex);
+			if (!result.m_succeeded)
+			{
+				R3::LogError("FAILED {}", path);
+			}
+			else if (result.m_wasStale)
+			{
+				R3::LogInfo("{} ({:.1f}ms, {}kb -> {}kb)", path, result.m_timeMs, result.m_sourceSize / 1024, result.m_bakedSize / 1024);
+			}
+			results.push_back(std::move(result));
+		};
+
+		// models first, their textures are added to the texture list via the bake manifest
+		RunParallel(pool, models.size(), [&](size_t i) {
+			bakeAndReport(models[i], true);
+		});
+		for (const auto& model : models)
+		{
+			auto dependencies = R3::BakeCache::GetDependencies(model);
+			textures.insert(textures.end(), dependencies.begin(), dependencies.end());
+		}
+		std::sort(textures.begin(), textures.end());
+		textures.erase(std::unique(textures.begin(), textures.end()), textures.end());
+		textures.erase(std::remove_if(textures.begin(), textures.end(), [](const std::string& t) {
+			return R3::FileIO::FindAbsolutePath(t).empty() || std::filesystem::path(t).extension() == ".dds";	// dds textures are already baked
+		}), textures.end());
+		RunParallel(pool, textures.size(), [&](size_t i) {
+			bakeAndReport(textures[i], false);
+		});
+	}
+	R3::BakeCache::SaveManifest();
+
+	uint32_t baked = 0, upToDate = 0, failed = 0;
+	uint64_t totalSourceSize = 0, totalBakedSize = 0;
+	for (const auto& r : results)
+	{
+		failed += r.m_succeeded ? 0 : 1;
+		upToDate += (r.m_succeeded && !r.m_wasStale) ? 1 : 0;
+		baked += (r.m_succeeded && r.m_wasStale) ? 1 : 0;
+		totalSourceSize += r.m_sourceSize;
+		totalBakedSize += r.m_bakedSize;
+	}
+
+	// pruning trusts the manifest to list every live output, so only do it after a complete + successful bake
+	if (bakeArgs.m_prune)
+	{
+		const bool bakedDataRoot = bakeArgs.m_paths.size() == 1 && bakeArgs.m_paths[0] == ".";
+		if (failed > 0)
+		{
+			R3::LogWarn("Not pruning baked files, {} assets failed to bake", failed);
+		}
+		else if (!bakedDataRoot)
+		{
+			R3::LogWarn("Not pruning baked files, only part of the data root was baked");
+		}
+		else
+		{
+			R3::BakeCache::PruneOutputs();
+		}
+	}
+	const double endTime = GetTimeSeconds();
+	R3::LogInfo("Baked {}, up to date {}, failed {} in {:.2f}s ({}mb source -> {}mb baked)",
+		baked, upToDate, failed, endTime - startTime, totalSourceSize / (1024 * 1024), totalBakedSize / (1024 * 1024));
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "core/time.h"
+#include "entities/component_type_registry.h"
+#include "entities/component_storage.h"
+#include "entities/entity_handle.h"
+#include "engine/serialiser.h"
+#include <string>
+
+// Shared helpers for r3_bench, each benchmark returns 0 on success and logs its own results
+namespace R3
+{
+namespace Bench
+{
+	inline double GetTimeSeconds()
+	{
+		return Time::HighPerformanceCounterTicks() / (double)Time::HighPerformanceCounterFrequency();
+	}
+
+	// benchmarks run without the engine so component types are registered on demand, the storage capacity is reset each time
+	template<class ComponentType>
+	void RegisterComponent(uint32_t initialCapacity = 1024)
+	{
+		auto& typeRegistry = Entities::ComponentTypeRegistry::GetInstance();
+		uint32_t typeIndex = Entities::ComponentTypeRegistry::GetTypeIndex<ComponentType>();
+		if (typeIndex == -1)
+		{
+			typeIndex = typeRegistry.Register<ComponentType>();
+		}
+		typeRegistry.SetStorageFactory(ComponentType::GetTypeName(), [typeIndex, initialCapacity](Entities::World* w) {
+			return std::make_unique<Entities::LinearComponentStorage<ComponentType>>(w, typeIndex, initialCapacity);
+		});
+	}
+
+	// a component that references another entity, so copies have to remap handles
+	struct LinkComponent
+	{
+		static std::string_view GetTypeName() { return "BenchmarkLink"; }
+		void SerialiseJson(JsonSerialiser& s)
+		{
+			s("Target", m_target);
+			s("Tag", m_tag);
+		}
+		Entities::EntityHandle m_target;
+		std::string m_tag;
+	};
+
+	// entity_benchmarks.cpp
+	int RunComponentStorageBenchmark();
+	int RunEntityLookupBenchmark();
+	int RunHierarchyBenchmark();
+	int RunPrefabBenchmark();
+	int RunEntityGCBenchmark();
+
+	// transform_benchmarks.cpp
+	int RunInterpolationBenchmark();
+
+	// serialisation_benchmarks.cpp
+	int RunWorldJsonBenchmark();
+	int RunSceneLoadBenchmark();
+	int RunGeneratedSerialiserBenchmark();
+}
+}
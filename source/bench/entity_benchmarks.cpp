@@ -0,0 +1,362 @@
+#include "benchmarks.h"
+#include "engine/components/transform.h"
+#include "engine/components/static_mesh.h"
+#include "entities/world.h"
+#include "entities/queries.h"
+#include "entities/prefab.h"
+#include "core/log.h"
+#include "core/profiler.h"
+#include <format>
+#include <unordered_map>
+#include <vector>
+
+namespace R3
+{
+namespace Bench
+{
+	// adds N transforms, iterates them, then removes 90% of them and reports the storage footprint at each step
+	// build with R3_LINEAR_COMPONENT_STORAGE defined to compare against a single vector per component type
+	int RunComponentStorageBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr uint32_t c_entityCounts[] = { 1, 1000, 100000, 1000000 };
+		constexpr uint32_t c_iterationPasses = 10;
+		RegisterComponent<TransformComponent>(1024 * 32);	// the default capacity used by the engine
+		auto getMemoryKb = [](World& world, size_t& allocatedKb, size_t& usedKb) {
+			size_t allocated = 0, used = 0;
+			world.GetStorage<TransformComponent>()->GetMemoryUsage(allocated, used);
+			allocatedKb = allocated / 1024;
+			usedKb = used / 1024;
+		};
+		for (uint32_t entityCount : c_entityCounts)
+		{
+			World world;
+			std::vector<EntityHandle> entities(entityCount);
+			const double addStart = GetTimeSeconds();
+			for (uint32_t i = 0; i < entityCount; ++i)
+			{
+				entities[i] = world.AddEntity();
+				world.AddComponent<TransformComponent>(entities[i]);
+			}
+			const double addMs = (GetTimeSeconds() - addStart) * 1000.0;
+			size_t allocatedKb = 0, usedKb = 0;
+			getMemoryKb(world, allocatedKb, usedKb);
+
+			uint64_t visited = 0;
+			const double iterateStart = GetTimeSeconds();
+			for (uint32_t pass = 0; pass < c_iterationPasses; ++pass)
+			{
+				Queries::ForEach<TransformComponent>(&world, [&visited](const EntityHandle& e, TransformComponent& t) {
+					visited += t.GetPosition().x == 0.0f ? 1 : 0;	// read the component so the loop cannot be skipped
+					return true;
+				});
+			}
+			const double iterateMs = (GetTimeSeconds() - iterateStart) * 1000.0 / c_iterationPasses;
+			if (visited != (uint64_t)entityCount * c_iterationPasses)
+			{
+				LogError("Iteration visited {} components, expected {}", visited, (uint64_t)entityCount * c_iterationPasses);
+				return 1;
+			}
+
+			for (uint32_t i = 0; i < entityCount; ++i)
+			{
+				if ((i % 10) != 0)
+				{
+					world.RemoveEntity(entities[i]);
+				}
+			}
+			world.CollectGarbage();
+			size_t allocatedAfterKb = 0, usedAfterKb = 0;
+			getMemoryKb(world, allocatedAfterKb, usedAfterKb);
+			LogInfo("{} transforms: add {:.2f}ms, {}kb allocated ({}kb used), iterate {:.3f}ms, after removing 90% {}kb allocated ({}kb used)", entityCount,
+				addMs, allocatedKb, usedKb, iterateMs, allocatedAfterKb, usedAfterKb);
+		}
+		return 0;
+	}
+
+	// 1 in 100 entities has a unique name, the last one created is named 'World Grid' (the worst case for a linear search)
+	int RunEntityLookupBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr uint32_t c_entityCount = 1000000;
+		constexpr uint32_t c_lookups = 1000;
+		RegisterComponent<TransformComponent>(1024 * 32);
+		World world;
+		std::vector<EntityHandle> entities(c_entityCount);
+		const double createStart = GetTimeSeconds();
+		for (uint32_t i = 0; i < c_entityCount; ++i)
+		{
+			entities[i] = world.AddEntity();
+			world.AddComponent<TransformComponent>(entities[i]);
+			if ((i % 100) == 0)
+			{
+				world.SetEntityName(entities[i], std::format("Entity {}", i));
+			}
+		}
+		world.SetEntityName(entities.back(), "World Grid");
+		const double createMs = (GetTimeSeconds() - createStart) * 1000.0;
+
+		std::vector<std::string> names(c_lookups);
+		for (uint32_t i = 0; i < c_lookups; ++i)
+		{
+			names[i] = std::format("Entity {}", ((i * 7919u) % (c_entityCount / 100)) * 100);
+		}
+		uint32_t found = 0;
+		auto timeLookupsUs = [&](auto&& lookup) {
+			const double startTime = GetTimeSeconds();
+			for (uint32_t i = 0; i < c_lookups; ++i)
+			{
+				found += lookup(i) ? 1 : 0;
+			}
+			return (GetTimeSeconds() - startTime) * 1000000.0 / c_lookups;
+		};
+		const double lastNameUs = timeLookupsUs([&](uint32_t i) {
+			return world.GetEntityByName("World Grid") == entities.back();
+		});
+		const double randomNameUs = timeLookupsUs([&](uint32_t i) {
+			return world.GetEntityByName(names[i]).GetID() != -1;
+		});
+		auto storage = world.GetStorage<TransformComponent>();
+		const double findUs = timeLookupsUs([&](uint32_t i) {
+			return storage->Find(entities[(i * 7919u) % c_entityCount].GetID()) != nullptr;
+		});
+		if (found != c_lookups * 3)
+		{
+			LogError("Only {} of {} lookups found an entity", found, c_lookups * 3);
+			return 1;
+		}
+		LogInfo("{} entities created in {:.1f}ms, per lookup: last named {:.3f}us, random name {:.3f}us, component by public ID {:.3f}us", c_entityCount, createMs,
+			lastNameUs, randomNameUs, findUs);
+		return 0;
+	}
+
+	// each entity i > 0 is parented to entity (i - 1) / branching, so a branching of 1 is a single chain
+	// clone copies a hierarchy the same way as pasting in the editor, reparent moves every child of the clone back to the original root
+	int RunHierarchyBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr int c_runs = 3;
+		struct HierarchyShape
+		{
+			std::string_view m_name;
+			uint32_t m_count;
+			uint32_t m_branching;
+		};
+		const HierarchyShape shapes[] = {
+			{ "100k entities, 4 children each", 100000, 4 },
+			{ "10k entity chain", 10000, 1 },
+			{ "20k children of one parent", 20000, 20000 }
+		};
+		RegisterComponent<TransformComponent>();
+		for (const HierarchyShape& shape : shapes)
+		{
+			double buildMs = 1000000.0, cloneMs = 1000000.0, reparentMs = 1000000.0, deleteMs = 1000000.0;
+			for (int run = 0; run < c_runs; ++run)
+			{
+				World world;
+				auto addEntity = [&world]() {
+					const EntityHandle e = world.AddEntity();
+					world.AddComponent<TransformComponent>(e);
+					return e;
+				};
+
+				const double buildStart = GetTimeSeconds();
+				std::vector<EntityHandle> entities(shape.m_count);
+				for (uint32_t i = 0; i < shape.m_count; ++i)
+				{
+					entities[i] = addEntity();
+					if (i > 0)
+					{
+						world.SetParent(entities[i], entities[(i - 1) / shape.m_branching]);
+					}
+				}
+
+				// children are visited after their parents, so each new parent is always known before its children are linked
+				const double cloneStart = GetTimeSeconds();
+				std::unordered_map<uint32_t, EntityHandle> clones;
+				const EntityHandle cloneRoot = addEntity();
+				clones[entities[0].GetID()] = cloneRoot;
+				world.ForEachChildRecursive(entities[0], [&](const EntityHandle& child) {
+					const EntityHandle clone = addEntity();
+					world.SetParent(clone, clones[world.GetParent(child).GetID()]);
+					clones[child.GetID()] = clone;
+				});
+
+				const double reparentStart = GetTimeSeconds();
+				std::vector<EntityHandle> cloneChildren;
+				world.GetChildren(cloneRoot, cloneChildren);
+				for (const auto& child : cloneChildren)
+				{
+					world.SetParent(child, entities[0]);
+				}
+
+				const double deleteStart = GetTimeSeconds();
+				const std::vector<EntityHandle> allChildren = world.GetAllChildren(entities[0]);
+				for (const auto& child : allChildren)
+				{
+					world.RemoveEntity(child);
+				}
+				world.RemoveEntity(entities[0]);
+				world.CollectGarbage();
+				const double deleteEnd = GetTimeSeconds();
+
+				if (allChildren.size() != (shape.m_count - 1) + (clones.size() - 1))
+				{
+					LogError("Expected {} children, found {}", (shape.m_count - 1) + (clones.size() - 1), allChildren.size());
+					return 1;
+				}
+				buildMs = std::min(buildMs, (cloneStart - buildStart) * 1000.0);
+				cloneMs = std::min(cloneMs, (reparentStart - cloneStart) * 1000.0);
+				reparentMs = std::min(reparentMs, (deleteStart - reparentStart) * 1000.0);
+				deleteMs = std::min(deleteMs, (deleteEnd - deleteStart) * 1000.0);
+			}
+			LogInfo("{}: build {:.2f}ms, clone {:.2f}ms, reparent {:.2f}ms, delete {:.2f}ms", shape.m_name, buildMs, cloneMs, reparentMs, deleteMs);
+		}
+		return 0;
+	}
+
+	// the same shape as a dungeon tile: a root with 5 children, every entity has a transform, each child links to its next sibling
+	int RunPrefabBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr uint32_t c_entitiesPerInstance = 6;
+		constexpr uint32_t c_instances = 10000;
+		constexpr int c_runs = 3;
+		RegisterComponent<TransformComponent>(1024 * 32);
+		RegisterComponent<LinkComponent>(1024 * 32);
+		double prefabMs = 1000000.0, jsonMs = 1000000.0;
+		for (int run = 0; run < c_runs; ++run)
+		{
+			World world;
+			std::vector<EntityHandle> source(c_entitiesPerInstance);
+			for (uint32_t i = 0; i < c_entitiesPerInstance; ++i)
+			{
+				source[i] = world.AddEntity();
+				world.AddComponent<TransformComponent>(source[i]);
+				world.GetComponent<TransformComponent>(source[i])->SetPositionNoInterpolation(glm::vec3((float)i, 0.0f, 0.0f));
+				if (i > 0)
+				{
+					world.SetParent(source[i], source[0]);
+				}
+			}
+			for (uint32_t i = 1; i < c_entitiesPerInstance; ++i)
+			{
+				world.AddComponent<LinkComponent>(source[i]);
+				auto link = world.GetComponent<LinkComponent>(source[i]);
+				link->m_target = source[1 + (i % (c_entitiesPerInstance - 1))];
+				link->m_tag = "Wall";
+			}
+			world.SetEntityName(source[0], "Tile");
+
+			const double prefabStart = GetTimeSeconds();
+			Prefab prefab;
+			prefab.Compile(world, source);
+			const std::vector<EntityHandle> instances = prefab.Instantiate(world, c_instances);
+			const double jsonStart = GetTimeSeconds();
+			const JsonSerialiser json = world.SerialiseEntities(source);
+			std::vector<EntityHandle> clones;
+			for (uint32_t i = 0; i < c_instances; ++i)
+			{
+				clones = world.SerialiseEntities(json);
+			}
+			const double jsonEnd = GetTimeSeconds();
+
+			// spot check the last instance of each, every child should link to its own next sibling
+			const EntityHandle* lastInstance = &instances[(c_instances - 1) * c_entitiesPerInstance];
+			for (uint32_t i = 1; i < c_entitiesPerInstance; ++i)
+			{
+				const EntityHandle expected = lastInstance[1 + (i % (c_entitiesPerInstance - 1))];
+				if (world.GetComponent<LinkComponent>(lastInstance[i])->m_target != expected || world.GetParent(lastInstance[i]) != lastInstance[0]
+					|| world.GetComponent<LinkComponent>(clones[i])->m_target != clones[1 + (i % (c_entitiesPerInstance - 1))])
+				{
+					LogError("Instance {} does not match the source entities", i);
+					return 1;
+				}
+			}
+			prefabMs = std::min(prefabMs, (jsonStart - prefabStart) * 1000.0);
+			jsonMs = std::min(jsonMs, (jsonEnd - jsonStart) * 1000.0);
+		}
+		LogInfo("{} instances of {} entities: prefab {:.2f}ms (including compile), json {:.2f}ms ({:.1f}x)", c_instances, c_entitiesPerInstance, prefabMs, jsonMs,
+			jsonMs / std::max(prefabMs, 0.000001));
+		return 0;
+	}
+
+	// the same pattern as regenerating a level: delete every child of a root entity then immediately create replacements
+	// each pass is measured with full collection (everything destroyed in one frame) + incremental collection (the engine default of 1ms per frame)
+	int RunEntityGCBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr uint32_t c_entityCount = 50000;
+		constexpr uint32_t c_passes = 4;
+		constexpr double c_frameBudgetMs = 1.0;
+		RegisterComponent<TransformComponent>();
+		RegisterComponent<StaticMeshComponent>();
+		for (int incremental = 0; incremental < 2; ++incremental)
+		{
+			World world;
+			const EntityHandle root = world.AddEntity();
+			auto createChildren = [&]() {
+				for (uint32_t i = 0; i < c_entityCount; ++i)
+				{
+					const EntityHandle e = world.AddEntity();
+					world.SetParent(e, root);
+					world.AddComponent<TransformComponent>(e);
+					if ((i % 2) == 0)
+					{
+						world.AddComponent<StaticMeshComponent>(e);
+					}
+					if ((i % 4) == 0)
+					{
+						world.SetEntityName(e, "Tile");
+					}
+				}
+			};
+			createChildren();
+			double removeMs = 0.0, collectMs = 0.0, worstFrameMs = 0.0;
+			uint32_t frames = 0;
+			for (uint32_t pass = 0; pass < c_passes; ++pass)
+			{
+				const std::vector<EntityHandle> children = world.GetAllChildren(root);
+				const double removeStart = GetTimeSeconds();
+				for (const auto& child : children)
+				{
+					world.RemoveEntity(child);
+				}
+				removeMs += (GetTimeSeconds() - removeStart) * 1000.0;
+				if (world.GetEntityByName("Tile").GetID() != -1 || world.GetAllChildren(root).size() != 0)
+				{
+					LogError("Removed entities are still reachable");
+					return 1;
+				}
+				createChildren();
+				bool collected = false;
+				while (!collected)
+				{
+					const double frameStart = GetTimeSeconds();
+					if (incremental)
+					{
+						collected = world.CollectGarbage(c_frameBudgetMs);
+					}
+					else
+					{
+						world.CollectGarbage();
+						collected = true;
+					}
+					const double frameMs = (GetTimeSeconds() - frameStart) * 1000.0;
+					collectMs += frameMs;
+					worstFrameMs = std::max(worstFrameMs, frameMs);
+					++frames;
+				}
+			}
+			LogInfo("{} collection: remove {:.2f}ms, collect {:.2f}ms over {} frames, worst frame {:.2f}ms (per {} entities)", incremental ? "Incremental" : "Full",
+				removeMs / c_passes, collectMs / c_passes, frames / c_passes, worstFrameMs, c_entityCount);
+		}
+		return 0;
+	}
+}
+}
@@ -0,0 +1,75 @@
+#include "benchmarks.h"
+#include "core/log.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Headless micro-benchmarks for the entity, transform + serialisation code, nothing is rendered and no assets are baked
+// Asset benchmarks (texture compression, model loading) live in r3_bake as they run on the assets in a data directory
+// r3_bench [--list] [names of benchmarks to run (default = all)]
+
+struct Benchmark
+{
+	std::string_view m_name;
+	std::string_view m_description;
+	std::function<int()> m_run;
+};
+
+const std::vector<Benchmark> c_benchmarks = {
+	{ "component-storage", "component storage memory + iteration cost from 1 to 1M transforms", R3::Bench::RunComponentStorageBenchmark },
+	{ "entity-lookup", "cost of finding entities by name + public ID in a world of 1M entities", R3::Bench::RunEntityLookupBenchmark },
+	{ "interpolation", "per-transform vs batched interpolation of 10k to 1M moving transforms", R3::Bench::RunInterpolationBenchmark },
+	{ "hierarchy", "cost of cloning, reparenting + deleting wide and deep entity hierarchies", R3::Bench::RunHierarchyBenchmark },
+	{ "prefab", "10k prefab instances against cloning the same entities via json", R3::Bench::RunPrefabBenchmark },
+	{ "entity-gc", "deletes + recreates 50k entities, reports the remove + garbage collection cost per frame", R3::Bench::RunEntityGCBenchmark },
+	{ "world-json", "cost of writing + reading a world of 50k entities via json", R3::Bench::RunWorldJsonBenchmark },
+	{ "scene-load", "loads arrrgh/main.scn scaled up 100x via json + the binary world format", R3::Bench::RunSceneLoadBenchmark },
+	{ "generated-serialisers", "200k point lights via serialisers generated from fields vs hand-written ones", R3::Bench::RunGeneratedSerialiserBenchmark },
+};
+
+int main(int argc, char** args)
+{
+	R3_PROF_THREAD("Main");
+	std::vector<const Benchmark*> toRun;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = args[i];
+		auto found = std::find_if(c_benchmarks.begin(), c_benchmarks.end(), [arg](const Benchmark& b) {
+			return b.m_name == arg;
+		});
+		if (found != c_benchmarks.end())
+		{
+			toRun.push_back(&(*found));
+		}
+		else
+		{
+			R3::LogInfo("Usage: r3_bench [--list] [benchmarks]");
+			for (const auto& b : c_benchmarks)
+			{
+				R3::LogInfo("\t{}\t{}", b.m_name, b.m_description);
+			}
+			return arg == "--list" ? 0 : 1;
+		}
+	}
+	if (toRun.empty())
+	{
+		for (const auto& b : c_benchmarks)
+		{
+			toRun.push_back(&b);
+		}
+	}
+
+	int failed = 0;
+	for (const Benchmark* b : toRun)
+	{
+		R3::LogInfo("{}: {}", b->m_name, b->m_description);
+		if (b->m_run() != 0)
+		{
+			R3::LogError("FAILED {}", b->m_name);
+			++failed;
+		}
+	}
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,247 @@
+#include "benchmarks.h"
+#include "engine/components/environment_settings.h"
+#include "engine/components/transform.h"
+#include "engine/components/camera.h"
+#include "engine/components/point_light.h"
+#include "engine/components/lua_script.h"
+#include "entities/world.h"
+#include "core/file_io.h"
+#include "core/log.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <format>
+#include <vector>
+
+namespace R3
+{
+namespace Bench
+{
+	// every entity has a transform, every other one links to the entity before it, 1 in 10 is named
+	// only the conversion between entities + json is measured, not the text parsing or file io
+	int RunWorldJsonBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr uint32_t c_entityCount = 50000;
+		constexpr int c_runs = 5;
+		RegisterComponent<TransformComponent>(1024 * 32);
+		RegisterComponent<LinkComponent>(1024 * 32);
+		World world;
+		EntityHandle previous;
+		for (uint32_t i = 0; i < c_entityCount; ++i)
+		{
+			const EntityHandle e = world.AddEntity();
+			world.AddComponent<TransformComponent>(e);
+			world.GetComponent<TransformComponent>(e)->SetPositionNoInterpolation(glm::vec3((float)i, 0.0f, 0.0f));
+			if ((i % 2) == 0)
+			{
+				world.AddComponent<LinkComponent>(e);
+				world.GetComponent<LinkComponent>(e)->m_target = previous;
+				world.GetComponent<LinkComponent>(e)->m_tag = "Goblin";
+			}
+			if ((i % 10) == 0)
+			{
+				world.SetEntityName(e, std::format("Entity {}", i));
+			}
+			previous = e;
+		}
+
+		double writeMs = 1000000.0, readMs = 1000000.0;
+		for (int run = 0; run < c_runs; ++run)
+		{
+			const double writeStart = GetTimeSeconds();
+			const JsonSerialiser saved = world.SerialiseEntities();
+			const double readStart = GetTimeSeconds();
+			World loaded;
+			const std::vector<EntityHandle> created = loaded.SerialiseEntities(saved);
+			const double readEnd = GetTimeSeconds();
+			if (created.size() != c_entityCount || loaded.GetComponent<LinkComponent>(created[2])->m_target != created[1])
+			{
+				LogError("Loaded world does not match the saved world");
+				return 1;
+			}
+			writeMs = std::min(writeMs, (readStart - writeStart) * 1000.0);
+			readMs = std::min(readMs, (readEnd - readStart) * 1000.0);
+		}
+		LogInfo("{} entities: write {:.1f}ms, read {:.1f}ms", c_entityCount, writeMs, readMs);
+		return 0;
+	}
+
+	// loads arrrgh/main.scn copied 100 times via json + via the binary format, then checks both worlds match
+	// components that are not registered here (game code) are dropped from the scene first
+	int RunSceneLoadBenchmark()
+	{
+		R3_PROF_EVENT();
+		using namespace Entities;
+		constexpr std::string_view c_scenePath = "arrrgh/main.scn";
+		constexpr uint32_t c_copies = 100;
+		constexpr int c_runs = 5;
+		constexpr uint32_t c_noParent = -1;
+		RegisterComponent<EnvironmentSettingsComponent>(8);
+		RegisterComponent<TransformComponent>(1024 * 32);
+		RegisterComponent<CameraComponent>(32);
+		RegisterComponent<LuaScriptComponent>(1024 * 8);
+		FileIO::InitialisePaths();
+		std::string sceneText;
+		if (!FileIO::LoadTextFromFile(c_scenePath, sceneText))
+		{
+			LogError("Failed to load {}, run from the data directory", c_scenePath);
+			return 1;
+		}
+
+		// scale the scene up by copying every entity, IDs + parents are offset per copy
+		JsonSerialiser scene(JsonSerialiser::Read);
+		scene.LoadFromString(sceneText);
+		const nlohmann::json& sourceEntities = scene.GetJson()["AllEntities"];
+		uint32_t idStride = 0;
+		for (const auto& e : sourceEntities)
+		{
+			idStride = std::max(idStride, e["ID"].get<uint32_t>() + 1);
+		}
+		nlohmann::json scaledEntities = nlohmann::json::array();
+		for (uint32_t copy = 0; copy < c_copies; ++copy)
+		{
+			for (const auto& source : sourceEntities)
+			{
+				nlohmann::json e;
+				for (const auto& [key, value] : source.items())
+				{
+					if (key == "ID" || (key == "Parent" && value.get<uint32_t>() != c_noParent))
+					{
+						e[key] = value.get<uint32_t>() + copy * idStride;
+					}
+					else if (key == "Name" || key == "Parent" || ComponentTypeRegistry::GetInstance().GetTypeIndex(key) != -1)
+					{
+						e[key] = value;
+					}
+				}
+				scaledEntities.push_back(std::move(e));
+			}
+		}
+		const std::string scaledText = scaledEntities.dump(1);
+
+		World jsonWorld;
+		{
+			JsonSerialiser entityJson(JsonSerialiser::Read);
+			entityJson.LoadFromString(scaledText);
+			jsonWorld.SerialiseEntities(entityJson);
+		}
+		const std::vector<uint8_t> binaryData = jsonWorld.SerialiseEntitiesBinary();
+
+		double jsonMs = 1000000.0, binaryMs = 1000000.0;
+		for (int run = 0; run < c_runs; ++run)
+		{
+			const double jsonStart = GetTimeSeconds();
+			{
+				World loaded;
+				JsonSerialiser entityJson(JsonSerialiser::Read);
+				entityJson.LoadFromString(scaledText);
+				loaded.SerialiseEntities(entityJson);
+			}
+			const double binaryStart = GetTimeSeconds();
+			{
+				World loaded;
+				std::vector<EntityHandle> created;
+				if (!loaded.SerialiseEntitiesBinary(binaryData.data(), binaryData.size(), created))
+				{
+					LogError("Failed to load the binary world");
+					return 1;
+				}
+			}
+			const double binaryEnd = GetTimeSeconds();
+			jsonMs = std::min(jsonMs, (binaryStart - jsonStart) * 1000.0);
+			binaryMs = std::min(binaryMs, (binaryEnd - binaryStart) * 1000.0);
+		}
+
+		// the binary world must convert back to the same json
+		World binaryWorld;
+		std::vector<EntityHandle> created;
+		binaryWorld.SerialiseEntitiesBinary(binaryData.data(), binaryData.size(), created);
+		if (binaryWorld.SerialiseEntities().GetJson() != jsonWorld.SerialiseEntities().GetJson())
+		{
+			LogError("Binary world does not match the json world");
+			return 1;
+		}
+		LogInfo("{} entities: json {} bytes, {:.2f}ms, binary {} bytes, {:.2f}ms ({:.1f}x)", scaledEntities.size(), scaledText.size(), jsonMs, binaryData.size(), binaryMs,
+			jsonMs / std::max(binaryMs, 0.000001));
+		return 0;
+	}
+
+	// same members + names as PointLightComponent, serialised by hand like it was before it had field descriptors
+	struct HandWrittenPointLight
+	{
+		void SerialiseJson(JsonSerialiser& s)
+		{
+			s("Colour", m_colour);
+			s("Distance", m_distance);
+			s("Brightness", m_brightness);
+			s("Enabled", m_enabled);
+		}
+		glm::vec3 m_colour = { 1,1,1 };
+		float m_distance = 8.0f;
+		float m_brightness = 1.0f;
+		bool m_enabled = true;
+	};
+
+	template<class LightType>
+	void TimeLightSerialiser(std::vector<LightType>& lights, nlohmann::json& written, double& jsonMs, double& archiveMs)
+	{
+		const double jsonStart = GetTimeSeconds();
+		{
+			JsonSerialiser writer(JsonSerialiser::Write);
+			writer("Lights", lights);
+			std::vector<LightType> loaded;
+			JsonSerialiser reader(&writer.GetJson());
+			reader("Lights", loaded);
+			written = std::move(writer.GetJson());
+		}
+		const double archiveStart = GetTimeSeconds();
+		{
+			BinaryArchive archive;
+			JsonSerialiser writer(JsonSerialiser::Write, &archive);
+			writer("Lights", lights);
+			const BinaryArchive readArchive(archive.GetData().data(), archive.GetData().size());
+			std::vector<LightType> loaded;
+			JsonSerialiser reader(&readArchive, readArchive.GetRootRange());
+			reader("Lights", loaded);
+		}
+		const double archiveEnd = GetTimeSeconds();
+		jsonMs = std::min(jsonMs, (archiveStart - jsonStart) * 1000.0);
+		archiveMs = std::min(archiveMs, (archiveEnd - archiveStart) * 1000.0);
+	}
+
+	// writes + reads 200k point lights via json + binary archives, with the serialiser generated from fields vs a hand-written one
+	int RunGeneratedSerialiserBenchmark()
+	{
+		R3_PROF_EVENT();
+		constexpr uint32_t c_lightCount = 200000;
+		constexpr int c_runs = 5;
+		std::vector<PointLightComponent> generated(c_lightCount);
+		std::vector<HandWrittenPointLight> handWritten(c_lightCount);
+		for (uint32_t i = 0; i < c_lightCount; ++i)
+		{
+			generated[i].m_colour = handWritten[i].m_colour = glm::vec3((i % 255) / 255.0f, 0.5f, 1.0f);
+			generated[i].m_distance = handWritten[i].m_distance = 1.0f + (i % 100);
+			generated[i].m_brightness = handWritten[i].m_brightness = 0.25f * (i % 8);
+			generated[i].m_enabled = handWritten[i].m_enabled = (i % 3) != 0;
+		}
+
+		double generatedJsonMs = 1000000.0, generatedArchiveMs = 1000000.0;
+		double handWrittenJsonMs = 1000000.0, handWrittenArchiveMs = 1000000.0;
+		nlohmann::json generatedJson, handWrittenJson;
+		for (int run = 0; run < c_runs; ++run)
+		{
+			TimeLightSerialiser(generated, generatedJson, generatedJsonMs, generatedArchiveMs);
+			TimeLightSerialiser(handWritten, handWrittenJson, handWrittenJsonMs, handWrittenArchiveMs);
+		}
+		if (generatedJson != handWrittenJson)
+		{
+			LogError("Generated + hand-written serialisers do not write the same json");
+			return 1;
+		}
+		LogInfo("{} point lights (write + read): json generated {:.1f}ms, hand-written {:.1f}ms, binary archive generated {:.1f}ms, hand-written {:.1f}ms",
+			c_lightCount, generatedJsonMs, handWrittenJsonMs, generatedArchiveMs, handWrittenArchiveMs);
+		return 0;
+	}
+}
+}
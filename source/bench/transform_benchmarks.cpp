@@ -0,0 +1,82 @@
+#include "benchmarks.h"
+#include "engine/components/transform.h"
+#include "engine/utils/transform_interpolation.h"
+#include "core/log.h"
+#include "core/profiler.h"
+#include <vector>
+
+namespace R3
+{
+namespace Bench
+{
+	// every transform moves a little each tick, 1 in 10 also turns far enough that the batch falls back to slerp
+	int RunInterpolationBenchmark()
+	{
+		R3_PROF_EVENT();
+		constexpr int c_runs = 5;
+		constexpr float c_interpolation = 0.37f;
+		for (uint32_t count : { 10000u, 100000u, 1000000u })
+		{
+			std::vector<TransformComponent> transforms(count);
+			std::vector<glm::vec3> prevPositions(count);
+			std::vector<glm::quat> prevOrientations(count);
+			uint32_t seed = 1;
+			auto random = [&seed]() {
+				seed = seed * 1664525u + 1013904223u;
+				return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+			};
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const glm::vec3 axis = glm::normalize(glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f));
+				const float angle = random() * 6.28f;
+				const float turn = (i % 10) == 0 ? 1.5f : 0.05f;
+				prevPositions[i] = glm::vec3(random(), random(), random()) * 100.0f;
+				prevOrientations[i] = glm::angleAxis(angle, axis);
+				transforms[i].SetPositionNoInterpolation(prevPositions[i]);
+				transforms[i].SetOrientationNoInterpolation(prevOrientations[i]);
+				transforms[i].SetPosition(prevPositions[i] + glm::vec3(random(), 0.0f, random()));
+				transforms[i].SetOrientation(glm::angleAxis(angle + turn, axis));
+			}
+
+			std::vector<glm::mat4> perTransform(count), batched(count);
+			double perTransformMs = 1000000.0, batchedMs = 1000000.0;
+			for (int run = 0; run < c_runs; ++run)
+			{
+				const double perTransformStart = GetTimeSeconds();
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					perTransform[i] = transforms[i].GetLocalInterpolated(c_interpolation);
+				}
+				const double batchStart = GetTimeSeconds();
+				TransformInterpolationBatch batch;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const TransformComponent& t = transforms[i];
+					batch.Add(prevPositions[i], t.GetPosition(), prevOrientations[i], t.GetOrientation(), t.GetScale(), t.GetScale(), &batched[i]);
+					if (batch.IsFull())
+					{
+						InterpolateTransforms(batch, c_interpolation);
+					}
+				}
+				InterpolateTransforms(batch, c_interpolation);
+				const double batchEnd = GetTimeSeconds();
+				perTransformMs = std::min(perTransformMs, (batchStart - perTransformStart) * 1000.0);
+				batchedMs = std::min(batchedMs, (batchEnd - batchStart) * 1000.0);
+			}
+
+			float maxError = 0.0f;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					const glm::vec4 diff = glm::abs(perTransform[i][c] - batched[i][c]);
+					maxError = std::max(maxError, std::max(std::max(diff.x, diff.y), std::max(diff.z, diff.w)));
+				}
+			}
+			LogInfo("{} transforms: per transform {:.3f}ms, batched {:.3f}ms ({:.1f}x), max error {:.2g}", count, perTransformMs, batchedMs,
+				perTransformMs / std::max(batchedMs, 0.000001), maxError);
+		}
+		return 0;
+	}
+}
+}
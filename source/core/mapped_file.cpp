@@ -0,0 +1,126 @@
+#include "mapped_file.h"
+#include "file_io.h"
+#include "profiler.h"
+#include "log.h"
+#include <utility>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace R3
+{
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			m_data = std::exchange(other.m_data, nullptr);
+			m_size = std::exchange(other.m_size, 0);
+			m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+			m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(std::string_view filePath)
+	{
+		R3_PROF_EVENT();
+		Close();
+		std::string actualPath = FileIO::FindAbsolutePath(filePath);
+		if (actualPath.empty())
+		{
+			LogWarn("File '{}' not found", filePath);
+			return false;
+		}
+#ifdef _WIN32
+		HANDLE file = CreateFileA(actualPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			LogWarn("Failed to open file '{}' for mapping ({})", actualPath, GetLastError());
+			return false;
+		}
+		LARGE_INTEGER fileSize = { 0 };
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			LogWarn("Failed to map file '{}' ({})", actualPath, GetLastError());
+			CloseHandle(file);
+			return false;
+		}
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view == nullptr)
+		{
+			LogWarn("Failed to map view of file '{}' ({})", actualPath, GetLastError());
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		m_fileHandle = file;
+		m_mappingHandle = mapping;
+		m_data = static_cast<const uint8_t*>(view);
+		m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		const int fd = open(actualPath.c_str(), O_RDONLY);
+		if (fd == -1)
+		{
+			LogWarn("Failed to open file '{}' for mapping", actualPath);
+			return false;
+		}
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+		void* view = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);	// the mapping keeps the file alive
+		if (view == MAP_FAILED)
+		{
+			LogWarn("Failed to map file '{}'", actualPath);
+			return false;
+		}
+		m_data = static_cast<const uint8_t*>(view);
+		m_size = static_cast<size_t>(fileStat.st_size);
+#endif
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data == nullptr)
+		{
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mappingHandle);
+		CloseHandle(m_fileHandle);
+#else
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+		m_fileHandle = nullptr;
+		m_mappingHandle = nullptr;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string_view>
+#include <span>
+#include <stdint.h>
+
+namespace R3
+{
+	// Read-only memory mapped file, the data is paged in by the OS on demand
+	// Paths are resolved the same way as FileIO::LoadBinaryFile
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		bool Open(std::string_view filePath);
+		void Close();
+		bool IsOpen() const { return m_data != nullptr; }
+		std::span<const uint8_t> GetData() const { return { m_data, m_size }; }
+
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		void* m_fileHandle = nullptr;		// win32 only
+		void* m_mappingHandle = nullptr;	// win32 only
+	};
+}
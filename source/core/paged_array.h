@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <new>
+#include <bit>
+#include <cassert>
+#include <stdint.h>
+
+namespace R3
+{
+	// A packed array of objects stored in fixed-size pages
+	// Pages are allocated on demand and never move, so pointers to existing items remain valid when pushing new ones
+	// Empty pages at the end are released when items are popped (one spare page is kept to avoid thrashing)
+	// ItemsPerPage must be a power of 2 so indexing is just a shift + mask
+	template<class T, uint32_t ItemsPerPage>
+	class PagedArray
+	{
+	public:
+		static_assert(ItemsPerPage > 0 && (ItemsPerPage & (ItemsPerPage - 1)) == 0, "ItemsPerPage must be a power of 2");
+		static constexpr uint32_t c_itemsPerPage = ItemsPerPage;
+
+		PagedArray() = default;
+		PagedArray(const PagedArray&) = delete;
+		PagedArray(PagedArray&&) = delete;
+		~PagedArray() { clear(); }
+
+		size_t size() const { return m_count; }
+		size_t capacity() const { return m_pages.size() * ItemsPerPage; }
+		size_t page_count() const { return m_pages.size(); }
+		void reserve_pages(size_t pageCount) { m_pages.reserve(pageCount); }	// only reserves the page table, no pages are allocated
+
+		T& operator[](size_t index)
+		{
+			assert(index < m_count);
+			return m_pages[index >> c_pageShift]->Items()[index & c_pageMask];
+		}
+		const T& operator[](size_t index) const
+		{
+			assert(index < m_count);
+			return m_pages[index >> c_pageShift]->Items()[index & c_pageMask];
+		}
+
+		template<class... Args>
+		T& emplace_back(Args&&... args)
+		{
+			const size_t pageIndex = m_count >> c_pageShift;
+			if (pageIndex >= m_pages.size())
+			{
+				m_pages.emplace_back(std::make_unique<Page>());
+			}
+			T* newItem = new (m_pages[pageIndex]->Items() + (m_count & c_pageMask)) T(std::forward<Args>(args)...);
+			++m_count;
+			return *newItem;
+		}
+		void push_back(const T& v) { emplace_back(v); }
+		void push_back(T&& v) { emplace_back(std::move(v)); }
+
+		void pop_back()
+		{
+			assert(m_count > 0);
+			(*this)[m_count - 1].~T();
+			--m_count;
+			ReleaseEmptyPages();
+		}
+
+		void clear()
+		{
+			for (size_t i = 0; i < m_count; ++i)
+			{
+				(*this)[i].~T();
+			}
+			m_count = 0;
+			m_pages.clear();
+		}
+
+	private:
+		// shift/mask used to convert an index to page + offset
+		static constexpr uint32_t c_pageShift = std::countr_zero(ItemsPerPage);
+		static constexpr uint32_t c_pageMask = ItemsPerPage - 1;
+
+		// raw uninitialised memory for a page of items, objects are constructed on demand
+		struct Page
+		{
+			T* Items() { return std::launder(reinterpret_cast<T*>(m_data)); }
+			alignas(T) unsigned char m_data[sizeof(T) * ItemsPerPage];
+		};
+
+		void ReleaseEmptyPages()
+		{
+			// keep one empty page around past the last used one
+			const size_t pagesInUse = (m_count + ItemsPerPage - 1) >> c_pageShift;
+			while (m_pages.size() > pagesInUse + 1)
+			{
+				m_pages.pop_back();
+			}
+		}
+
+		std::vector<std::unique_ptr<Page>> m_pages;
+		size_t m_count = 0;
+	};
+}
@@ -1,29 +1,11 @@
 #include "base_actor_stats_component.h"
-#include "engine/systems/lua_system.h"
+#include "entities/component_reflection.h"
 #include <imgui.h>
 
 void DungeonsBaseActorStatsComponent::RegisterScripts(R3::LuaSystem& l)
 {
 	R3_PROF_EVENT();
-	l.RegisterType<DungeonsBaseActorStatsComponent>("DungeonsBaseActorStatsComponent",
-		"m_level", &DungeonsBaseActorStatsComponent::m_level,
-		"m_baseMaxHP", &DungeonsBaseActorStatsComponent::m_baseMaxHP,
-		"m_strength", &DungeonsBaseActorStatsComponent::m_strength,
-		"m_endurance", &DungeonsBaseActorStatsComponent::m_endurance,
-		"m_currentHP", &DungeonsBaseActorStatsComponent::m_currentHP,
-		"m_baseHitChance", &DungeonsBaseActorStatsComponent::m_baseHitChance
-	);
-}
-
-void DungeonsBaseActorStatsComponent::SerialiseJson(R3::JsonSerialiser& s)
-{
-	R3_PROF_EVENT();
-	s("Level", m_level);
-	s("BaseMaxHP", m_baseMaxHP);
-	s("Strength", m_strength);
-	s("Endurance", m_endurance);
-	s("CurrentHP", m_currentHP);
-	s("BaseHitChance", m_baseHitChance);
+	R3::Reflection::RegisterScriptFields<DungeonsBaseActorStatsComponent>(l, "DungeonsBaseActorStatsComponent");
 }
 
 void DungeonsBaseActorStatsComponent::Inspect(const R3::Entities::EntityHandle& e, R3::Entities::World* w, R3::ValueInspector& i)
@@ -8,8 +8,18 @@ class DungeonsBaseActorStatsComponent
 {
 public:
 	static std::string_view GetTypeName() { return "Dungeons_BaseActorStats"; }
+	static constexpr auto GetFields()	// serialisation is generated from these
+	{
+		return std::make_tuple(
+			R3_FIELD(DungeonsBaseActorStatsComponent, m_level, "Level"),
+			R3_FIELD(DungeonsBaseActorStatsComponent, m_baseMaxHP, "BaseMaxHP"),
+			R3_FIELD(DungeonsBaseActorStatsComponent, m_strength, "Strength"),
+			R3_FIELD(DungeonsBaseActorStatsComponent, m_endurance, "Endurance"),
+			R3_FIELD(DungeonsBaseActorStatsComponent, m_currentHP, "CurrentHP"),
+			R3_FIELD(DungeonsBaseActorStatsComponent, m_baseHitChance, "BaseHitChance")
+		);
+	}
 	static void RegisterScripts(R3::LuaSystem&);
-	void SerialiseJson(R3::JsonSerialiser& s);
 	void Inspect(const R3::Entities::EntityHandle& e, R3::Entities::World* w, R3::ValueInspector& i);
 
 	// Use these accessors always as they perform all the relevant scaling calculations
@@ -10,6 +10,7 @@ class DungeonsBlocksTileComponent
 {
 public:
 	static std::string_view GetTypeName() { return "Dungeons_BlocksTile"; }
+	static constexpr auto GetRawMembers() { return std::make_tuple(); }	// no data, binary worlds + prefabs only need to know it exists
 	static void RegisterScripts(R3::LuaSystem&);
 	void SerialiseJson(R3::JsonSerialiser& s);
 };
\ No newline at end of file
@@ -270,41 +270,26 @@ void DungeonsOfArrrgh::SetVisualEntitiesVisible(const DungeonsWorldGridComponent
 {
 	R3_PROF_EVENT();
 	bool staticsModified = false;
+	auto setChildVisible = [&](const R3::Entities::EntityHandle& child) {
+		if (auto meshComponent = w.GetComponent<R3::StaticMeshComponent>(child))
+		{
+			meshComponent->SetShouldDraw(visible);
+			staticsModified = true;
+		}
+		if (auto meshComponent = w.GetComponent<R3::DynamicMeshComponent>(child))
+		{
+			meshComponent->SetShouldDraw(visible);
+		}
+	};
 	for (const auto& tile : tiles)
 	{
 		auto contents = grid.GetContents(tile.x, tile.y);
 		if (contents)
 		{
-			std::vector<R3::Entities::EntityHandle> children;
-			w.GetAllChildren(contents->m_visualEntity, children);
-			for (const auto& child : children)
-			{
-				if (auto meshComponent = w.GetComponent<R3::StaticMeshComponent>(child))
-				{
-					meshComponent->SetShouldDraw(visible);
-					staticsModified = true;
-				}
-				if (auto meshComponent = w.GetComponent<R3::DynamicMeshComponent>(child))
-				{
-					meshComponent->SetShouldDraw(visible);
-				}
-			}
+			w.ForEachChildRecursive(contents->m_visualEntity, setChildVisible);
 			for (const auto& actor : contents->m_entitiesInTile)
 			{
-				std::vector<R3::Entities::EntityHandle> children;
-				w.GetAllChildren(actor, children);
-				for (const auto& child : children)
-				{
-					if (auto meshComponent = w.GetComponent<R3::StaticMeshComponent>(child))
-					{
-						meshComponent->SetShouldDraw(visible);
-						staticsModified = true;
-					}
-					if (auto meshComponent = w.GetComponent<R3::DynamicMeshComponent>(child))
-					{
-						meshComponent->SetShouldDraw(visible);
-					}
-				}
+				w.ForEachChildRecursive(actor, setChildVisible);
 				if (auto meshComponent = w.GetComponent<R3::StaticMeshComponent>(actor))
 				{
 					meshComponent->SetShouldDraw(visible);
@@ -579,11 +564,10 @@ void DungeonsOfArrrgh::GenerateTileVisuals(uint32_t x, uint32_t z, DungeonsWorld
 			auto foundInCache = m_generateVisualsEntityCache.find(tileScene.m_path);
 			if (foundInCache == m_generateVisualsEntityCache.end())
 			{
-				// load the entities via the world, serialise them, then delete the temp loaded entities + store the json
+				// load the entities via the world, compile them to a prefab, then delete the temp loaded entities
 				std::string fullPath = std::format("arrrgh/tiles/{}", tileScene.m_path);
 				auto loadedEntities = activeWorld->Import(fullPath);
-				R3::JsonSerialiser entityData = activeWorld->SerialiseEntities(loadedEntities);
-				m_generateVisualsEntityCache[tileScene.m_path] = entityData.GetJson();
+				m_generateVisualsEntityCache[tileScene.m_path].Compile(*activeWorld, loadedEntities);
 				foundInCache = m_generateVisualsEntityCache.find(tileScene.m_path);
 				for (auto it : loadedEntities)
 				{
@@ -592,8 +576,7 @@ void DungeonsOfArrrgh::GenerateTileVisuals(uint32_t x, uint32_t z, DungeonsWorld
 			}
 			if (foundInCache != m_generateVisualsEntityCache.end())
 			{
-				R3::JsonSerialiser entityData(R3::JsonSerialiser::Read, foundInCache->second);
-				auto clonedEntities = activeWorld->SerialiseEntities(entityData);	// clone via serialisation
+				auto clonedEntities = foundInCache->second.Instantiate(*activeWorld);
 				if (clonedEntities.size() > 0)
 				{
 					glm::vec3 tileOffset = { (float)x * m_wsGridScale.x, 0.0f, (float)z * m_wsGridScale.y };
@@ -654,10 +637,8 @@ void DungeonsOfArrrgh::OnWorldGridDirty(const R3::Entities::EntityHandle& e, cla
 	auto entities = GetSystem<R3::Entities::EntitySystem>();
 	auto activeWorld = entities->GetActiveWorld();
 
-	// delete all previous visual entities
-	std::vector<R3::Entities::EntityHandle> children;
-	activeWorld->GetAllChildren(e, children);
-	for (auto child : children)
+	// delete all previous visual entities (removing unlinks the hierarchy immediately, so gather them first)
+	for (const auto& child : activeWorld->GetAllChildren(e))
 	{
 		activeWorld->RemoveEntity(child);
 	}
@@ -3,6 +3,7 @@
 #include "engine/systems.h"
 #include "engine/serialiser.h"
 #include "entities/entity_handle.h"
+#include "entities/prefab.h"
 #include "core/glm_headers.h"
 #include <unordered_map>
 #include <unordered_set>
@@ -43,7 +44,7 @@ private:
 	void DebugDrawWorldGrid(const class DungeonsWorldGridComponent& grid);
 	template<class Container>
 	void DebugDrawTiles(const class DungeonsWorldGridComponent& grid, Container& tiles);	// expects vector<uvec2> or similar
-	std::unordered_map<std::string, nlohmann::json> m_generateVisualsEntityCache;	// cache serialised entities for speed
+	std::unordered_map<std::string, R3::Entities::Prefab> m_generateVisualsEntityCache;	// tile scenes compiled to prefabs for speed
 	glm::vec3 m_wsGridOffset = { 0,0,0 };
 	glm::vec2 m_wsGridScale = { 4, 4 };
 	bool m_enableFogOfWar = true;		// if disabled, visual entities are always active. does not affect gameplay visibility
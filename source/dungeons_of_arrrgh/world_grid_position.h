@@ -11,6 +11,7 @@ class DungeonsWorldGridPosition
 friend class DungeonsOfArrrgh;	// gross
 public:
 	static std::string_view GetTypeName() { return "Dungeons_WorldGridPosition"; }
+	static constexpr auto GetRawMembers() { return std::make_tuple(&DungeonsWorldGridPosition::m_position); }	// binary worlds + prefabs copy these directly
 	static void RegisterScripts(R3::LuaSystem&);
 	void SerialiseJson(R3::JsonSerialiser& s);
 	void Inspect(const R3::Entities::EntityHandle& e, R3::Entities::World* w, R3::ValueInspector& i);
@@ -3,6 +3,7 @@
 #include "engine/systems/mesh_renderer.h"
 #include "core/profiler.h"
 #include "entities/world.h"
+#include "entities/prefab.h"
 
 namespace R3
 {
@@ -17,8 +18,9 @@ namespace R3
 		auto world = m_window->GetWorld();
 		m_selectedEntities = m_window->GetSelectedEntities();
 		m_window->DeselectAll();
-		JsonSerialiser json = world->SerialiseEntities(m_selectedEntities);	// clone via serialisation
-		m_newIDs = world->SerialiseEntities(json);
+		Entities::Prefab clone;		// clone via a temporary prefab
+		clone.Compile(*world, m_selectedEntities);
+		m_newIDs = clone.Instantiate(*world);
 		for (const auto it : m_newIDs)	// select the new clones
 		{
 			m_window->SelectEntity(it);
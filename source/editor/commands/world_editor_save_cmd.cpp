@@ -15,7 +15,8 @@ namespace R3
 	{
 		R3_PROF_EVENT();
 		FileDialogFilter filters[] = {
-			{ "Scene File", "scn" }
+			{ "Scene File", "scn" },
+			{ "Binary Scene File", "scnb" }
 		};
 		std::string savePath = m_targetPath.empty() ? FileSaveDialog(m_targetPath, filters, std::size(filters)) : m_targetPath;
 		if (savePath != "")
@@ -107,7 +107,8 @@ namespace R3
 	{
 		R3_PROF_EVENT();
 		FileDialogFilter filters[] = {
-			{ "Scene File", "scn" }
+			{ "Scene File", "scn" },
+			{ "Binary Scene File", "scnb" }
 		};
 		std::string fileToOpen = FileLoadDialog("", filters, std::size(filters));
 		if (!fileToOpen.empty())
@@ -120,7 +121,8 @@ namespace R3
 	{
 		R3_PROF_EVENT();
 		FileDialogFilter filters[] = {
-			{ "Scene File", "scn" }
+			{ "Scene File", "scn" },
+			{ "Binary Scene File", "scnb" }
 		};
 		std::string fileToOpen = FileLoadDialog("", filters, std::size(filters));
 		if (!fileToOpen.empty())
@@ -273,7 +273,7 @@ namespace R3
 				// sanitise path, only files relative to data root are allowed
 				auto currentPath = std::filesystem::current_path();
 				auto relativePath = std::filesystem::relative(newPath, currentPath);
-				auto newHandle = textures->LoadTexture(relativePath.string());
+				auto newHandle = textures->LoadTexture(relativePath.string(), true, false);	// not streamed, nothing reports usage for textures picked here
 				m_cmds.Push(std::make_unique<SetValueCommand<TextureHandle>>(label, current, newHandle, setFn));
 				return true;
 			}
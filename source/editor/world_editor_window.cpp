@@ -211,7 +211,8 @@ namespace R3
 		});
 		contextMenu.AddItem("Import Scene", [this]() {
 			FileDialogFilter filters[] = {
-				{ "Scene File", "scn" }
+				{ "Scene File", "scn" },
+				{ "Binary Scene File", "scnb" }
 			};
 			std::string scnPath = FileLoadDialog("", filters, std::size(filters));
 			scnPath = FileIO::SanitisePath(scnPath);
@@ -220,6 +221,23 @@ namespace R3
 				m_cmds->Push(std::make_unique<WorldEditorImportSceneCmd>(this, scnPath));
 			}
 		});
+		contextMenu.AddItem("Stream Scene (no undo)", [this]() {
+			FileDialogFilter filters[] = {
+				{ "Scene File", "scn" },
+				{ "Binary Scene File", "scnb" }
+			};
+			std::string scnPath = FileLoadDialog("", filters, std::size(filters));
+			scnPath = FileIO::SanitisePath(scnPath);
+			if (scnPath.length() > 0)
+			{
+				auto entities = Systems::GetSystem<Entities::EntitySystem>();
+				const uint32_t loadId = entities->StartStreamingLoad(m_worldIdentifier, scnPath);
+				if (loadId != -1)
+				{
+					m_streamingLoads.push_back(loadId);
+				}
+			}
+		});
 		contextMenu.AddItem("Select all", [this]() {
 			auto selectCmd = std::make_unique<WorldEditorSelectEntitiesCommand>(this);
 			selectCmd->m_selectAll = true;
@@ -399,6 +417,14 @@ namespace R3
 			{
 				WorldInfoWidget wi;
 				wi.Update(*w, true);
+				auto entities = Systems::GetSystem<Entities::EntitySystem>();
+				std::erase_if(m_streamingLoads, [entities](uint32_t loadId) {
+					return !entities->IsStreamingLoadActive(loadId);
+				});
+				for (uint32_t loadId : m_streamingLoads)
+				{
+					ImGui::ProgressBar(entities->GetStreamingLoadProgress(loadId), ImVec2(-1, 0), "Streaming...");
+				}
 				m_allEntitiesWidget->Update(*w, m_selectedEntities, true);
 			}
 		}
@@ -549,8 +575,9 @@ namespace R3
 	bool WorldEditorWindow::SaveWorld(std::string_view path)
 	{
 		R3_PROF_EVENT();
-		Entities::World* thisWorld = GetWorld();
-		if (thisWorld && thisWorld->Save(path))
+		// the world is snapshotted + saved in the background so the editor does not stall
+		auto entities = Systems::GetSystem<Entities::EntitySystem>();
+		if (entities->StartBackgroundSave(m_worldIdentifier, path) != -1)
 		{
 			m_filePath = path;
 			return true;
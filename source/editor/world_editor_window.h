@@ -65,5 +65,6 @@ namespace R3
 		std::unique_ptr<EditorCommandList> m_cmds;
 		std::vector<Entities::EntityHandle> m_selectedEntities;
 		bool m_isSelectParentActive = false;	// if active, a 'select parent entity' window is displayed
+		std::vector<uint32_t> m_streamingLoads;	// streaming load IDs targeting this world, used to display progress
 	};
 }
\ No newline at end of file
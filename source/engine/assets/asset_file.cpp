@@ -2,13 +2,14 @@
 #include "core/glm_headers.h"
 #include "core/profiler.h"
 #include "core/file_io.h"
+#include <meshoptimizer.h>
 #include <filesystem>
 #include <fstream>
 #include <chrono>
 
 namespace R3
 {
-    constexpr uint32_t c_currentVersion = 1;
+    constexpr uint32_t c_currentVersion = 2;    // 2 = blob codecs
     constexpr uint32_t c_minSupportedVersion = 1;
     constexpr uint64_t c_assetFileMarker = 0xA55A55B00BB00B13;
 
@@ -24,13 +25,129 @@ namespace R3
         uint64_t m_blobHeaderCount = 0;
     };
 
-    struct AssetBlobHeader
+    struct AssetBlobHeaderV1
     {
         char m_name[64];
         uint64_t m_startOffset = 0;
         uint64_t m_size = 0;
     };
 
+    struct AssetBlobHeader
+    {
+        char m_name[64];
+        uint64_t m_startOffset = 0;
+        uint64_t m_size = 0;                // size in the file
+        uint64_t m_uncompressedSize = 0;
+        AssetBlobCodec m_codec = AssetBlobCodec::None;
+        uint32_t m_elementSize = 0;
+    };
+
+    // upper bound on the decoded size of a blob, used to reject corrupt headers before allocating anything
+    // meshopt vertex streams can encode a run of unchanged bytes in a few header bits, index streams need at least 1 byte per triangle
+    constexpr uint64_t c_maxVertexCodecRatio = 1024;
+    static uint64_t GetMaxDecodedSize(AssetBlobCodec codec, uint32_t elementSize, uint64_t encodedSize)
+    {
+        switch (codec)
+        {
+        case AssetBlobCodec::None:
+            return encodedSize;
+        case AssetBlobCodec::MeshoptVertices:
+            return encodedSize * c_maxVertexCodecRatio;
+        case AssetBlobCodec::MeshoptIndices:
+            return (elementSize == 2 || elementSize == 4) ? encodedSize * elementSize * 3 : 0;
+        default:
+            return 0;
+        }
+    }
+
+    // returns false if the codec cannot be used with this data, the caller should store it raw
+    static bool EncodeBlob(const AssetFile::Blob& blob, std::vector<uint8_t>& result)
+    {
+        R3_PROF_EVENT();
+        const size_t dataSize = blob.m_data.size();
+        if (blob.m_codec == AssetBlobCodec::MeshoptVertices)
+        {
+            const size_t vertexSize = blob.m_elementSize;
+            if (vertexSize == 0 || vertexSize % 4 != 0 || vertexSize > 256 || dataSize % vertexSize != 0)
+            {
+                return false;
+            }
+            const size_t vertexCount = dataSize / vertexSize;
+            result.resize(meshopt_encodeVertexBufferBound(vertexCount, vertexSize));
+            result.resize(meshopt_encodeVertexBuffer(result.data(), result.size(), blob.m_data.data(), vertexCount, vertexSize));
+        }
+        else if (blob.m_codec == AssetBlobCodec::MeshoptIndices)
+        {
+            const size_t indexSize = blob.m_elementSize;
+            if ((indexSize != 2 && indexSize != 4) || dataSize % (indexSize * 3) != 0)
+            {
+                return false;
+            }
+            const size_t indexCount = dataSize / indexSize;
+            size_t vertexCount = 0;
+            for (size_t i = 0; i < indexCount; ++i)
+            {
+                const uint32_t index = (indexSize == 2) ? reinterpret_cast<const uint16_t*>(blob.m_data.data())[i] : reinterpret_cast<const uint32_t*>(blob.m_data.data())[i];
+                vertexCount = std::max(vertexCount, static_cast<size_t>(index) + 1);
+            }
+            result.resize(meshopt_encodeIndexBufferBound(indexCount, vertexCount));
+            if (indexSize == 2)
+            {
+                result.resize(meshopt_encodeIndexBuffer(result.data(), result.size(), reinterpret_cast<const uint16_t*>(blob.m_data.data()), indexCount));
+            }
+            else
+            {
+                result.resize(meshopt_encodeIndexBuffer(result.data(), result.size(), reinterpret_cast<const uint32_t*>(blob.m_data.data()), indexCount));
+            }
+        }
+        else
+        {
+            return false;
+        }
+        return result.size() > 0 && result.size() < dataSize;
+    }
+
+    bool DecodeAssetBlob(const AssetFileView::Blob& blob, std::span<uint8_t> target)
+    {
+        R3_PROF_EVENT();
+        if (target.size() != blob.m_uncompressedSize)
+        {
+            LogError("Blob {} decode target has the wrong size", blob.m_name);
+            return false;
+        }
+        // validate the element size here, meshopt asserts on bad values
+        const uint32_t elementSize = blob.m_elementSize;
+        const bool validVertices = elementSize > 0 && elementSize <= 256 && elementSize % 4 == 0 && target.size() % elementSize == 0;
+        const bool validIndices = (elementSize == 2 || elementSize == 4) && target.size() % (elementSize * 3) == 0;
+        if ((blob.m_codec == AssetBlobCodec::MeshoptVertices && !validVertices) || (blob.m_codec == AssetBlobCodec::MeshoptIndices && !validIndices))
+        {
+            LogError("Blob {} has an invalid element size {}", blob.m_name, elementSize);
+            return false;
+        }
+        int decodeResult = 0;
+        switch (blob.m_codec)
+        {
+        case AssetBlobCodec::None:
+            memcpy(target.data(), blob.m_data.data(), target.size());
+            break;
+        case AssetBlobCodec::MeshoptVertices:
+            decodeResult = meshopt_decodeVertexBuffer(target.data(), target.size() / blob.m_elementSize, blob.m_elementSize, blob.m_data.data(), blob.m_data.size());
+            break;
+        case AssetBlobCodec::MeshoptIndices:
+            decodeResult = meshopt_decodeIndexBuffer(target.data(), target.size() / blob.m_elementSize, blob.m_elementSize, blob.m_data.data(), blob.m_data.size());
+            break;
+        default:
+            decodeResult = -1;
+            break;
+        }
+        if (decodeResult != 0)
+        {
+            LogError("Failed to decode blob {} (codec {}, error {})", blob.m_name, static_cast<uint32_t>(blob.m_codec), decodeResult);
+            return false;
+        }
+        return true;
+    }
+
     // pre-calculate any interesting offsets/sizes
     constexpr uint64_t c_headerSize = sizeof(AssetFileHeader);
     constexpr uint64_t c_blobHeadersOffset = AlignUpPow2(c_headerSize, 64ull);
@@ -51,15 +168,31 @@ namespace R3
         std::string jsonData = asset.m_header.dump();
         const uint64_t jsonEndOffset = c_jsonOffset + jsonData.size();
 
+        // compress any blobs that want it
+        std::vector<std::vector<uint8_t>> encodedBlobs(asset.m_blobs.size());
+        for (int b = 0; b < asset.m_blobs.size(); ++b)
+        {
+            if (asset.m_blobs[b].m_codec != AssetBlobCodec::None && !EncodeBlob(asset.m_blobs[b], encodedBlobs[b]))
+            {
+                encodedBlobs[b].clear();    // store it raw
+            }
+        }
+        auto getBlobData = [&](int b) -> std::span<const uint8_t> {
+            return encodedBlobs[b].size() > 0 ? encodedBlobs[b] : asset.m_blobs[b].m_data;
+        };
+
         // prepare blob headers now we know the size of the json
         std::vector<AssetBlobHeader> blobHeaders(asset.m_blobs.size());
         uint64_t blobOffset = AlignUpPow2(jsonEndOffset, 64ull);;
         for (int b = 0;b<asset.m_blobs.size();++b)
         {
             strcpy_s(blobHeaders[b].m_name, asset.m_blobs[b].m_name.c_str());
-            blobHeaders[b].m_size = asset.m_blobs[b].m_data.size();
+            blobHeaders[b].m_size = getBlobData(b).size();
+            blobHeaders[b].m_uncompressedSize = asset.m_blobs[b].m_data.size();
+            blobHeaders[b].m_codec = encodedBlobs[b].size() > 0 ? asset.m_blobs[b].m_codec : AssetBlobCodec::None;
+            blobHeaders[b].m_elementSize = asset.m_blobs[b].m_elementSize;
             blobHeaders[b].m_startOffset = blobOffset;
-            blobOffset = AlignUpPow2(blobOffset + asset.m_blobs[b].m_data.size(), 64ull);
+            blobOffset = AlignUpPow2(blobOffset + blobHeaders[b].m_size, 64ull);
         }
 
         // prep the asset header
@@ -81,24 +214,41 @@ namespace R3
         memcpy(dataOut.data() + c_jsonOffset, jsonData.data(), jsonData.size());
         for (int b = 0; b < asset.m_blobs.size(); ++b)
         {
-            memcpy(dataOut.data() + blobHeaders[b].m_startOffset, asset.m_blobs[b].m_data.data(), blobHeaders[b].m_size);
+            memcpy(dataOut.data() + blobHeaders[b].m_startOffset, getBlobData(b).data(), blobHeaders[b].m_size);
         }
 
         return FileIO::SaveBinaryFile(path, dataOut);
     }
 
-    std::optional<AssetFile> LoadAssetFile(std::string_view path)
+    std::optional<AssetFileView> LoadAssetFileView(std::string_view path)
     {
         R3_PROF_EVENT();
 
-        // should probably read in chunks!
-        std::vector<uint8_t> rawBuffer;
-        if (!FileIO::LoadBinaryFile(path, rawBuffer))
+        AssetFileView view;
+        std::span<const uint8_t> rawData;
+        if (view.m_file.Open(path))
         {
-            return {};
+            rawData = view.m_file.GetData();
+        }
+        else
+        {
+            // mapping can fail (e.g. the file is empty), fall back to reading the whole file
+            if (!FileIO::LoadBinaryFile(path, view.m_fileData))
+            {
+                return {};
+            }
+            rawData = view.m_fileData;
         }
+        auto isInRange = [&rawData](uint64_t offset, uint64_t size) {
+            return offset <= rawData.size() && size <= rawData.size() - offset;
+        };
 
-        const auto fileHeader = reinterpret_cast<const AssetFileHeader*>(rawBuffer.data());
+        if (!isInRange(0, sizeof(AssetFileHeader)))
+        {
+            LogError("{} is not an asset file", path);
+            return {};
+        }
+        const auto fileHeader = reinterpret_cast<const AssetFileHeader*>(rawData.data());
         if (fileHeader->m_marker != c_assetFileMarker)
         {
             LogError("{} is not an asset file", path);
@@ -109,29 +259,99 @@ namespace R3
             LogWarn("{} file version is too old (file = {}, current = {}", path, fileHeader->m_currentVersion, c_currentVersion);
             return {};
         }
-
-        const AssetBlobHeader* blobHeaders = reinterpret_cast<const AssetBlobHeader*>(rawBuffer.data() + fileHeader->m_blobHeaderOffset);
         const auto blobCount = fileHeader->m_blobHeaderCount;
-        
-        // extract the json
-        std::vector<uint8_t> jsonData;
-        jsonData.resize(fileHeader->m_jsonSize);
-        memcpy(jsonData.data(), rawBuffer.data() + fileHeader->m_jsonOffset, fileHeader->m_jsonSize);
+        const size_t blobHeaderSize = fileHeader->m_currentVersion < 2 ? sizeof(AssetBlobHeaderV1) : sizeof(AssetBlobHeader);
+        if (!isInRange(fileHeader->m_jsonOffset, fileHeader->m_jsonSize) || 
+            blobCount > rawData.size() / blobHeaderSize ||
+            !isInRange(fileHeader->m_blobHeaderOffset, blobCount * blobHeaderSize))
+        {
+            LogError("{} is corrupt", path);
+            return {};
+        }
 
-        // extra the blobs
-        AssetFile newAsset;
-        newAsset.m_header = nlohmann::json::parse(jsonData);
-        newAsset.m_blobs.resize(blobCount);
+        // parse the json in place
+        const char* jsonData = reinterpret_cast<const char*>(rawData.data() + fileHeader->m_jsonOffset);
+        view.m_header = nlohmann::json::parse(jsonData, jsonData + fileHeader->m_jsonSize, nullptr, false);
+        if (view.m_header.is_discarded())
+        {
+            LogError("{} has an invalid json header", path);
+            return {};
+        }
+
+        // blobs point directly into the file data
+        view.m_blobs.resize(blobCount);
         for (int i = 0; i < blobCount; ++i)
         {
-            newAsset.m_blobs[i].m_name = blobHeaders[i].m_name;
-            newAsset.m_blobs[i].m_data.resize(blobHeaders[i].m_size);
-            memcpy(newAsset.m_blobs[i].m_data.data(), rawBuffer.data() + blobHeaders[i].m_startOffset, blobHeaders[i].m_size);
+            AssetBlobHeader blobHeader;
+            memcpy(&blobHeader, rawData.data() + fileHeader->m_blobHeaderOffset + i * blobHeaderSize, blobHeaderSize);
+            if (fileHeader->m_currentVersion < 2)   // no codecs in v1
+            {
+                blobHeader.m_uncompressedSize = blobHeader.m_size;
+                blobHeader.m_codec = AssetBlobCodec::None;
+                blobHeader.m_elementSize = 0;
+            }
+            if (!isInRange(blobHeader.m_startOffset, blobHeader.m_size) ||
+                (blobHeader.m_codec == AssetBlobCodec::None && blobHeader.m_size != blobHeader.m_uncompressedSize) ||
+                (blobHeader.m_codec != AssetBlobCodec::None && blobHeader.m_elementSize == 0) ||
+                blobHeader.m_uncompressedSize > GetMaxDecodedSize(blobHeader.m_codec, blobHeader.m_elementSize, blobHeader.m_size))
+            {
+                LogError("{} is corrupt", path);
+                return {};
+            }
+            AssetFileView::Blob& blob = view.m_blobs[i];
+            blob.m_name = std::string_view(reinterpret_cast<const char*>(rawData.data() + fileHeader->m_blobHeaderOffset + i * blobHeaderSize), strnlen(blobHeader.m_name, sizeof(blobHeader.m_name)));
+            blob.m_data = rawData.subspan(blobHeader.m_startOffset, blobHeader.m_size);
+            blob.m_codec = blobHeader.m_codec;
+            blob.m_elementSize = blobHeader.m_elementSize;
+            blob.m_uncompressedSize = blobHeader.m_uncompressedSize;
+        }
+
+        return view;
+    }
+
+    std::optional<AssetFile> LoadAssetFile(std::string_view path)
+    {
+        R3_PROF_EVENT();
+
+        auto view = LoadAssetFileView(path);
+        if (!view.has_value())
+        {
+            return {};
+        }
+
+        AssetFile newAsset;
+        newAsset.m_header = std::move(view->m_header);
+        newAsset.m_blobs.resize(view->GetBlobs().size());
+        for (int i = 0; i < newAsset.m_blobs.size(); ++i)
+        {
+            const AssetFileView::Blob& blob = view->GetBlobs()[i];
+            newAsset.m_blobs[i].m_name = blob.m_name;
+            newAsset.m_blobs[i].m_codec = blob.m_codec;     // keep the codec so saving the asset again compresses it
+            newAsset.m_blobs[i].m_elementSize = blob.m_elementSize;
+            newAsset.m_blobs[i].m_data.resize(blob.m_uncompressedSize);
+            if (!DecodeAssetBlob(blob, newAsset.m_blobs[i].m_data))
+            {
+                return {};
+            }
         }
 
         return newAsset;
     }
 
+    const AssetFileView::Blob* AssetFileView::FindBlob(std::string_view name) const
+    {
+        auto found = std::find_if(m_blobs.begin(), m_blobs.end(), [name](const AssetFileView::Blob& b) {
+            return b.m_name == name;
+        });
+        return found == m_blobs.end() ? nullptr : &(*found);
+    }
+
+    std::span<const uint8_t> AssetFileView::GetBlob(std::string_view name) const
+    {
+        const Blob* found = FindBlob(name);
+        return (found == nullptr || found->m_codec != AssetBlobCodec::None) ? std::span<const uint8_t>() : found->m_data;
+    }
+
     const AssetFile::Blob* AssetFile::GetBlob(std::string_view name)
     {
         auto found = std::find_if(m_blobs.begin(), m_blobs.end(), [name](const AssetFile::Blob& b) {
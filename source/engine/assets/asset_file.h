@@ -2,10 +2,20 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <span>
+#include "core/mapped_file.h"
 #include "engine/serialiser.h"
 
 namespace R3
 {
+	// Blobs can be compressed when they are saved, the codec is stored per blob
+	enum class AssetBlobCodec : uint32_t
+	{
+		None,				// raw data
+		MeshoptVertices,	// meshopt_encodeVertexBuffer, m_elementSize = vertex size (multiple of 4, <= 256)
+		MeshoptIndices		// meshopt_encodeIndexBuffer (triangle lists), m_elementSize = index size (2 or 4)
+	};
+
 	// Has a json header + a list of named binary blobs
 	class AssetFile
 	{
@@ -13,7 +23,9 @@ namespace R3
 		struct Blob
 		{
 			std::string m_name;
-			std::vector<uint8_t> m_data;
+			std::vector<uint8_t> m_data;		// always uncompressed
+			AssetBlobCodec m_codec = AssetBlobCodec::None;	// applied when saving, falls back to None if the data cannot be compressed
+			uint32_t m_elementSize = 0;			// required by the meshopt codecs
 		};
 		nlohmann::json m_header;
 		std::vector<Blob> m_blobs;
@@ -21,6 +33,47 @@ namespace R3
 		const Blob* GetBlob(std::string_view name);
 	};
 
-	std::optional<AssetFile> LoadAssetFile(std::string_view path);
+	// Read-only view of an asset file, the file is memory mapped and blobs point directly into the mapping (no copies)
+	// The blobs are only valid while the view exists, all blobs are aligned to 64 bytes
+	class AssetFileView
+	{
+	public:
+		struct Blob
+		{
+			std::string_view m_name;
+			std::span<const uint8_t> m_data;	// compressed if m_codec != None, use DecodeAssetBlob
+			AssetBlobCodec m_codec = AssetBlobCodec::None;
+			uint32_t m_elementSize = 0;
+			uint64_t m_uncompressedSize = 0;
+		};
+		nlohmann::json m_header;	// parsed directly from the mapping
+
+		const Blob* FindBlob(std::string_view name) const;
+		std::span<const uint8_t> GetBlob(std::string_view name) const;	// empty if not found or compressed
+		template<class T> std::span<const T> GetBlobAs(std::string_view name) const;	// empty if not found, compressed or the size is not a multiple of sizeof(T)
+		const std::vector<Blob>& GetBlobs() const { return m_blobs; }
+
+	private:
+		friend std::optional<AssetFileView> LoadAssetFileView(std::string_view path);
+		MappedFile m_file;
+		std::vector<uint8_t> m_fileData;	// only used if the file could not be mapped
+		std::vector<Blob> m_blobs;
+	};
+
+	std::optional<AssetFile> LoadAssetFile(std::string_view path);		// copies (+ decompresses) all blobs out of the file
+	std::optional<AssetFileView> LoadAssetFileView(std::string_view path);
 	bool SaveAssetFile(AssetFile& asset, std::string_view path);
-}
\ No newline at end of file
+	bool DecodeAssetBlob(const AssetFileView::Blob& blob, std::span<uint8_t> target);	// target must be m_uncompressedSize bytes
+
+	template<class T>
+	std::span<const T> AssetFileView::GetBlobAs(std::string_view name) const
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Blobs can only be viewed as trivially copyable types");
+		const std::span<const uint8_t> data = GetBlob(name);
+		if (data.size() % sizeof(T) != 0)
+		{
+			return {};
+		}
+		return { reinterpret_cast<const T*>(data.data()), data.size() / sizeof(T) };
+	}
+}
@@ -0,0 +1,430 @@
+#include "bake_cache.h"
+#include "core/file_io.h"
+#include "core/mapped_file.h"
+#include "core/mutex.h"
+#include "core/profiler.h"
+#include "core/log.h"
+#include <nlohmann/json.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <bit>
+
+namespace R3
+{
+	namespace BakeCache
+	{
+		const uint32_t c_manifestVersion = 1;
+		const std::string c_manifestName = "bake_manifest.json";
+		const uint32_t c_maxOutputsPerSource = 4;	// older outputs are pruned
+
+		// xxhash64 primes
+		const uint64_t c_prime1 = 0x9E3779B185EBCA87ull;
+		const uint64_t c_prime2 = 0xC2B2AE3D27D4EB4Full;
+		const uint64_t c_prime3 = 0x165667B19E3779F9ull;
+		const uint64_t c_prime4 = 0x85EBCA77C2B2AE63ull;
+		const uint64_t c_prime5 = 0x27D4EB2F165667C5ull;
+
+		struct SourceHash
+		{
+			uint64_t m_size = 0;
+			int64_t m_writeTime = 0;
+			uint64_t m_hash = 0;
+		};
+
+		struct Manifest
+		{
+			Mutex m_mutex;
+			bool m_loaded = false;
+			bool m_dirty = false;
+			bool m_rejected = false;	// an existing manifest could not be loaded, outputs from previous runs are unknown
+			std::unordered_map<std::string, SourceHash> m_sources;		// key = path relative to data root
+			std::unordered_map<std::string, std::vector<std::string>> m_dependencies;
+			std::unordered_map<std::string, std::vector<std::string>> m_outputs;	// baked file names, most recently used first
+		};
+
+		Manifest& GetManifest()
+		{
+			static Manifest s_manifest;
+			return s_manifest;
+		}
+
+		std::filesystem::path GetBakedDirectory()
+		{
+			return std::filesystem::absolute(std::filesystem::path(FileIO::GetBasePath()) / "baked");
+		}
+
+		std::string GetManifestPath()
+		{
+			return (GetBakedDirectory() / c_manifestName).string();
+		}
+
+		bool IsStringArray(const nlohmann::json& json)
+		{
+			return json.is_array() && std::all_of(json.begin(), json.end(), [](const nlohmann::json& j) {
+				return j.is_string();
+			});
+		}
+
+		// baked outputs are named <source>.<16 hex digit key><extension>
+		bool IsHashedOutput(const std::filesystem::path& path)
+		{
+			const std::string key = path.stem().extension().string();
+			return key.size() == 17 && std::all_of(key.begin() + 1, key.end(), [](char c) {
+				return std::isxdigit(static_cast<unsigned char>(c));
+			});
+		}
+
+		// call with the manifest mutex locked
+		void LoadManifest(Manifest& m)
+		{
+			R3_PROF_EVENT();
+			m.m_loaded = true;
+			const std::string manifestPath = GetManifestPath();
+			std::string jsonText;
+			if (!std::filesystem::exists(manifestPath) || !FileIO::LoadTextFromFile(manifestPath, jsonText))
+			{
+				return;
+			}
+			const auto parsed = nlohmann::json::parse(jsonText, nullptr, false);
+			if (!parsed.is_object() || !parsed.contains("Version") || parsed["Version"] != c_manifestVersion)
+			{
+				LogWarn("Bake manifest {} is invalid or out of date, all sources will be re-hashed", manifestPath);
+				m.m_rejected = true;
+				return;
+			}
+
+			// malformed entries are skipped, they are rebuilt the next time the source is used
+			uint32_t skipped = 0;
+			const auto sources = parsed.find("Sources");
+			if (sources != parsed.end() && sources->is_object())
+			{
+				for (const auto& [path, source] : sources->items())
+				{
+					if (!source.is_object() || !source.contains("Size") || !source.contains("WriteTime") || !source.contains("Hash") ||
+						!source["Size"].is_number_unsigned() || !source["WriteTime"].is_number_integer() || !source["Hash"].is_number_unsigned())
+					{
+						++skipped;
+						continue;
+					}
+					SourceHash& sh = m.m_sources[path];
+					sh.m_size = source["Size"].get<uint64_t>();
+					sh.m_writeTime = source["WriteTime"].get<int64_t>();
+					sh.m_hash = source["Hash"].get<uint64_t>();
+				}
+			}
+			else if (sources != parsed.end())
+			{
+				++skipped;
+			}
+			auto loadStringLists = [&](const char* name, std::unordered_map<std::string, std::vector<std::string>>& target) {
+				const auto lists = parsed.find(name);
+				if (lists != parsed.end() && lists->is_object())
+				{
+					for (const auto& [path, list] : lists->items())
+					{
+						if (!IsStringArray(list))
+						{
+							++skipped;
+							continue;
+						}
+						target[path] = list.get<std::vector<std::string>>();
+					}
+				}
+				else if (lists != parsed.end())
+				{
+					++skipped;
+				}
+			};
+			loadStringLists("Dependencies", m.m_dependencies);
+			loadStringLists("Outputs", m.m_outputs);
+			if (skipped > 0)
+			{
+				LogWarn("Skipped {} malformed entries in bake manifest {}", skipped, manifestPath);
+				m.m_dirty = true;
+			}
+		}
+
+		uint64_t ReadU64(const uint8_t* p)
+		{
+			uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		uint64_t HashRound(uint64_t acc, uint64_t input)
+		{
+			acc += input * c_prime2;
+			acc = std::rotl(acc, 31);
+			return acc * c_prime1;
+		}
+
+		// based on xxhash64, 4 independent lanes of 8 bytes so large files hash at memory speed
+		uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			const uint8_t* end = bytes + size;
+			uint64_t h = 0;
+			if (size >= 32)
+			{
+				uint64_t lanes[4] = { seed + c_prime1 + c_prime2, seed + c_prime2, seed, seed - c_prime1 };
+				for (; bytes + 32 <= end; bytes += 32)
+				{
+					lanes[0] = HashRound(lanes[0], ReadU64(bytes));
+					lanes[1] = HashRound(lanes[1], ReadU64(bytes + 8));
+					lanes[2] = HashRound(lanes[2], ReadU64(bytes + 16));
+					lanes[3] = HashRound(lanes[3], ReadU64(bytes + 24));
+				}
+				h = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+				for (uint64_t lane : lanes)
+				{
+					h = (h ^ HashRound(0, lane)) * c_prime1 + c_prime4;
+				}
+			}
+			else
+			{
+				h = seed + c_prime5;
+			}
+			h += size;
+			for (; bytes + 8 <= end; bytes += 8)
+			{
+				h ^= HashRound(0, ReadU64(bytes));
+				h = std::rotl(h, 27) * c_prime1 + c_prime4;
+			}
+			for (; bytes < end; ++bytes)
+			{
+				h ^= (*bytes) * c_prime5;
+				h = std::rotl(h, 11) * c_prime1;
+			}
+			h ^= h >> 33;
+			h *= c_prime2;
+			h ^= h >> 29;
+			h *= c_prime3;
+			h ^= h >> 32;
+			return h;
+		}
+
+		uint64_t HashFile(std::string_view path)
+		{
+			R3_PROF_EVENT();
+			const std::string actualPath = FileIO::FindAbsolutePath(path);
+			if (actualPath.empty())
+			{
+				return 0;
+			}
+			std::error_code ec;
+			const uint64_t fileSize = std::filesystem::file_size(actualPath, ec);
+			if (ec)
+			{
+				return 0;
+			}
+			const int64_t writeTime = std::filesystem::last_write_time(actualPath, ec).time_since_epoch().count();
+			if (ec)
+			{
+				return 0;
+			}
+			const std::string sourceKey = FileIO::SanitisePath(actualPath);
+			Manifest& m = GetManifest();
+			{
+				ScopedLock lock(m.m_mutex);
+				if (!m.m_loaded)
+				{
+					LoadManifest(m);
+				}
+				auto found = m.m_sources.find(sourceKey);
+				if (found != m.m_sources.end() && found->second.m_size == fileSize && found->second.m_writeTime == writeTime)
+				{
+					return found->second.m_hash;
+				}
+			}
+
+			// hash outside the lock so multiple files can be hashed at once
+			uint64_t hash = HashBytes(nullptr, 0);
+			if (fileSize > 0)
+			{
+				MappedFile file;
+				if (!file.Open(actualPath))
+				{
+					return 0;
+				}
+				hash = HashBytes(file.GetData().data(), file.GetData().size());
+			}
+			if (hash == 0)
+			{
+				hash = 1;	// 0 = missing file
+			}
+
+			ScopedLock lock(m.m_mutex);
+			m.m_sources[sourceKey] = { fileSize, writeTime, hash };
+			m.m_dirty = true;
+			return hash;
+		}
+
+		uint64_t GetBakeKey(std::string_view sourcePath, std::string_view settingsPath, std::string_view bakerName, uint32_t bakerVersion)
+		{
+			R3_PROF_EVENT();
+			const uint64_t inputs[] = {
+				HashFile(sourcePath),
+				settingsPath.empty() ? 0 : HashFile(settingsPath),
+				bakerVersion
+			};
+			return HashBytes(inputs, sizeof(inputs), HashBytes(bakerName.data(), bakerName.size()));
+		}
+
+		std::string GetBakedPath(std::string_view sourcePath, uint64_t key, std::string_view extension)
+		{
+			R3_PROF_EVENT();
+			// get the source path relative to data base directory
+			const std::string sourceKey = FileIO::SanitisePath(sourcePath);
+			if (sourceKey.size() == 0)
+			{
+				return {};
+			}
+			std::string relPath = sourceKey;
+
+			// replace any directory separators with '_'
+			std::replace(relPath.begin(), relPath.end(), '/', '_');
+			std::replace(relPath.begin(), relPath.end(), '\\', '_');
+
+			relPath += std::format(".{:016x}", key);
+			relPath += extension;
+
+			// track the most recent outputs of each source so anything older can be pruned
+			{
+				Manifest& m = GetManifest();
+				ScopedLock lock(m.m_mutex);
+				if (!m.m_loaded)
+				{
+					LoadManifest(m);
+				}
+				auto& outputs = m.m_outputs[sourceKey];
+				if (outputs.empty() || outputs[0] != relPath)
+				{
+					outputs.erase(std::remove(outputs.begin(), outputs.end(), relPath), outputs.end());
+					outputs.insert(outputs.begin(), relPath);
+					outputs.resize(std::min<size_t>(outputs.size(), c_maxOutputsPerSource));
+					m.m_dirty = true;
+				}
+			}
+			return (GetBakedDirectory() / relPath).string();
+		}
+
+		void SetDependencies(std::string_view sourcePath, const std::vector<std::string>& dependencies)
+		{
+			R3_PROF_EVENT();
+			Manifest& m = GetManifest();
+			ScopedLock lock(m.m_mutex);
+			if (!m.m_loaded)
+			{
+				LoadManifest(m);
+			}
+			auto& target = m.m_dependencies[FileIO::SanitisePath(sourcePath)];
+			if (target != dependencies)
+			{
+				target = dependencies;
+				m.m_dirty = true;
+			}
+		}
+
+		std::vector<std::string> GetDependencies(std::string_view sourcePath)
+		{
+			R3_PROF_EVENT();
+			Manifest& m = GetManifest();
+			ScopedLock lock(m.m_mutex);
+			if (!m.m_loaded)
+			{
+				LoadManifest(m);
+			}
+			auto found = m.m_dependencies.find(FileIO::SanitisePath(sourcePath));
+			return found != m.m_dependencies.end() ? found->second : std::vector<std::string>();
+		}
+
+		bool SaveManifest()
+		{
+			R3_PROF_EVENT();
+			Manifest& m = GetManifest();
+			ScopedLock lock(m.m_mutex);
+			if (!m.m_dirty)
+			{
+				return true;
+			}
+			nlohmann::json json;
+			json["Version"] = c_manifestVersion;
+			json["Sources"] = nlohmann::json::object();
+			json["Dependencies"] = nlohmann::json::object();
+			for (const auto& [path, source] : m.m_sources)
+			{
+				json["Sources"][path] = { { "Size", source.m_size }, { "WriteTime", source.m_writeTime }, { "Hash", source.m_hash } };
+			}
+			json["Outputs"] = nlohmann::json::object();
+			for (const auto& [path, dependencies] : m.m_dependencies)
+			{
+				json["Dependencies"][path] = dependencies;
+			}
+			for (const auto& [path, outputs] : m.m_outputs)
+			{
+				json["Outputs"][path] = outputs;
+			}
+			std::error_code ec;
+			std::filesystem::create_directories(GetBakedDirectory(), ec);
+			const std::string manifestPath = GetManifestPath();
+			if (!FileIO::SaveTextToFile(manifestPath, json.dump(1, '\t')))
+			{
+				LogError("Failed to write bake manifest {}", manifestPath);
+				return false;
+			}
+			m.m_dirty = false;
+			return true;
+		}
+
+		uint32_t PruneOutputs()
+		{
+			R3_PROF_EVENT();
+			Manifest& m = GetManifest();
+			ScopedLock lock(m.m_mutex);
+			if (!m.m_loaded)
+			{
+				LoadManifest(m);
+			}
+			if (m.m_rejected)
+			{
+				LogWarn("Bake manifest was not loaded, baked outputs will not be pruned");
+				return 0;
+			}
+			std::unordered_set<std::string> referenced;
+			for (const auto& [path, outputs] : m.m_outputs)
+			{
+				referenced.insert(outputs.begin(), outputs.end());
+			}
+			std::error_code ec;
+			uint32_t removed = 0;
+			uint64_t removedBytes = 0;
+			for (const auto& entry : std::filesystem::directory_iterator(GetBakedDirectory(), ec))
+			{
+				const std::string fileName = entry.path().filename().string();
+				if (!entry.is_regular_file(ec) || !IsHashedOutput(entry.path()) || referenced.contains(fileName))
+				{
+					continue;
+				}
+				const uint64_t fileSize = entry.file_size(ec);
+				if (std::filesystem::remove(entry.path(), ec))
+				{
+					++removed;
+					removedBytes += ec ? 0 : fileSize;
+				}
+				else
+				{
+					LogWarn("Failed to remove stale baked file {}", entry.path().string());
+				}
+			}
+			if (removed > 0)
+			{
+				LogInfo("Pruned {} stale baked files ({}kb)", removed, removedBytes / 1024);
+			}
+			return removed;
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string_view>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Content hashed cache for baked assets
+// Baked files are named using a key = hash(source bytes, bake settings bytes, baker name + version)
+// Editing a source or its settings produces a new key, so only stale assets are rebaked
+// The last few outputs of each source are kept, switching back to a previous version of a source (e.g. another branch) reuses the existing bake
+// The manifest (baked/bake_manifest.json) caches source hashes (validated by size + write time), asset dependencies and the outputs of each source
+// All functions are thread safe
+namespace R3
+{
+	namespace BakeCache
+	{
+		uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+		// hash of the file contents, only re-hashed if the size or write time changed. returns 0 if the file does not exist
+		uint64_t HashFile(std::string_view path);
+
+		// settingsPath is optional, a missing settings file is treated as default settings
+		uint64_t GetBakeKey(std::string_view sourcePath, std::string_view settingsPath, std::string_view bakerName, uint32_t bakerVersion);
+
+		// baked/<source path relative to data root>.<key><extension>, empty if the source is outside the data root
+		// the path is recorded as the most recent output of the source
+		std::string GetBakedPath(std::string_view sourcePath, uint64_t key, std::string_view extension);
+
+		// dependencies = other source assets that are needed to use this one (e.g. model -> textures)
+		void SetDependencies(std::string_view sourcePath, const std::vector<std::string>& dependencies);
+		std::vector<std::string> GetDependencies(std::string_view sourcePath);
+
+		// writes the manifest if anything changed. call once after a batch of bakes/loads (e.g. at shutdown), not per asset
+		bool SaveManifest();
+
+		// deletes baked files that are not one of the recent outputs of a source in the manifest, returns the number removed
+		uint32_t PruneOutputs();
+	}
+}
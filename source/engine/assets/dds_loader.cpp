@@ -3,6 +3,7 @@
 #include "core/profiler.h"
 #include "core/log.h"
 #include "core/file_io.h"
+#include "core/mapped_file.h"
 #include "core/glm_headers.h"
 #include <array>
 
@@ -23,7 +24,9 @@ namespace R3
 
 	enum DDSHeaderCapsFlags
 	{
-		DDSCAPS_TEXTURE = 0x1000				//Required for all textures, the only flag we care about
+		DDSCAPS_COMPLEX = 0x8,					// Optional, must be used on any file that contains more than one surface
+		DDSCAPS_MIPMAP = 0x400000,				// Optional, should be used for a mipmap
+		DDSCAPS_TEXTURE = 0x1000				//Required for all textures
 	};
 
 	enum DDSPixelFormatFlags
@@ -85,7 +88,7 @@ namespace R3
 	static const uint32_t c_ddsPixelFormatSize = 32;	// Size of pixel format struct, should always be 32
 	static const uint32_t c_expectedHeaderFlags = DDSD_HEIGHT | DDSD_WIDTH;
 
-	bool ExtractHeader(const std::vector<uint8_t>& data, DDSFileHeader& header)
+	bool ExtractHeader(std::span<const uint8_t> data, DDSFileHeader& header)
 	{
 		if (data.size() < sizeof(header))
 		{
@@ -214,15 +217,25 @@ namespace R3
 		}
 	}
 
+	// we should not trust the pitch output by exporters according to MS, calculate it from the mip dimensions
+	size_t GetDDSMipSize(uint32_t width, uint32_t height, uint32_t mip, Textures::Format f)
+	{
+		const size_t blocksX = glm::max(1u, ((glm::max(1u, width >> mip) + 3) / 4));
+		const size_t blocksY = glm::max(1u, ((glm::max(1u, height >> mip) + 3) / 4));
+		return blocksX * blocksY * GetBlockSizeBytes(f);
+	}
+
 	std::optional<Textures::TextureData> LoadTexture_DDS(std::string_view path)
 	{
 		R3_PROF_EVENT();
 
-		std::vector<uint8_t> buffer;
-		if (!FileIO::LoadBinaryFile(path, buffer))
+		// the file is mapped and the mips point into it, the data is only copied when the caller uploads it
+		MappedFile file;
+		if (!file.Open(path))
 		{
 			return {};
 		}
+		const std::span<const uint8_t> buffer = file.GetData();
 		DDSFileHeader header;
 		if (!ExtractHeader(buffer, header))
 		{
@@ -233,6 +246,11 @@ namespace R3
 		const DDSHeaderDX10Extension* dx10Extension = nullptr;
 		if (strcmp(fourcc, "DX10") == 0)
 		{
+			if (buffer.size() < sizeof(header) + sizeof(DDSHeaderDX10Extension))
+			{
+				LogWarn("DDS file is truncated");
+				return {};
+			}
 			dx10Extension = reinterpret_cast<const DDSHeaderDX10Extension*>(buffer.data() + sizeof(header));
 		}
 		if (!IsFormatSupported(header, dx10Extension))
@@ -251,9 +269,6 @@ namespace R3
 		newTexture.m_height = header.m_heightPx;
 		newTexture.m_format = *format;
 		size_t mipSrcOffset = sizeof(header) + (dx10Extension ? sizeof(*dx10Extension) : 0);
-		// we should not trust the pitch output by exporters according to MS
-		uint64_t imgPitch = glm::max(1u, ((header.m_widthPx + 3) / 4)) * GetBlockSizeBytes(newTexture.m_format);
-		size_t mip0Size = imgPitch * newTexture.m_height / 4;
 		
 		// 1x1 textures may report as having 0 mips, force them to 1 at least so we can load *something*
 		if (header.m_mipCount == 0 && header.m_heightPx == 1 && header.m_widthPx == 1)
@@ -261,29 +276,99 @@ namespace R3
 			header.m_mipCount = 1;
 		}
 
-		// the image data is not aligned how we would like, so we need to remake it ourselves
-		// each mip level will be stored consecutively with 16 byte alignment
-		size_t maxDataSize = 0;
-		size_t mipSize = mip0Size;
-		for (uint32_t i = 0; i < header.m_mipCount; ++i)
-		{
-			maxDataSize += mipSize + 16;
-			mipSize = glm::max(GetBlockSizeBytes(newTexture.m_format), mipSize / 4);
-		}
-		std::vector<uint8_t> imageDataAligned;
-		imageDataAligned.resize(maxDataSize);
-		size_t dstOffset = 0;
+		// mips are stored consecutively after the header(s), describe them as offsets into the mapped file
 		size_t srcOffset = mipSrcOffset;
-		mipSize = mip0Size;
 		for (uint32_t i = 0; i < header.m_mipCount; ++i)
 		{
-			memcpy(imageDataAligned.data() + dstOffset, buffer.data() + srcOffset, mipSize);
-			newTexture.m_mips.emplace_back(dstOffset, mipSize);
-			dstOffset = AlignUpPow2(dstOffset + mipSize, 16ull);
+			const size_t mipSize = GetDDSMipSize(header.m_widthPx, header.m_heightPx, i, newTexture.m_format);
+			if (srcOffset + mipSize > buffer.size())
+			{
+				LogWarn("DDS file is truncated");
+				return {};
+			}
+			newTexture.m_mips.emplace_back(srcOffset, mipSize);
 			srcOffset += mipSize;
-			mipSize = glm::max(GetBlockSizeBytes(newTexture.m_format), mipSize / 4);
 		}
-		newTexture.m_imgData = std::move(imageDataAligned);
+		newTexture.m_mappedFile = std::move(file);
 		return newTexture;
 	}
+
+	bool SaveTexture_DDS(std::string_view path, const Textures::TextureData& texture)
+	{
+		R3_PROF_EVENT();
+		std::optional<uint32_t> dxgiFormat;
+		const char* fourcc = "DX10";
+		switch (texture.m_format)
+		{
+		case Textures::Format::RGBA_BC1:
+			fourcc = "DXT1";
+			break;
+		case Textures::Format::RGBA_BC2:
+			fourcc = "DXT3";
+			break;
+		case Textures::Format::RGBA_BC3:
+			fourcc = "DXT5";
+			break;
+		case Textures::Format::R_BC4:
+			dxgiFormat = DXGI_FORMAT_BC4_UNORM;
+			break;
+		case Textures::Format::RG_BC5:
+			dxgiFormat = DXGI_FORMAT_BC5_UNORM;
+			break;
+		case Textures::Format::RGBA_BC7:
+			dxgiFormat = DXGI_FORMAT_BC7_UNORM;
+			break;
+		default:
+			LogError("Cannot write format {} to DDS", Textures::FormatToString(texture.m_format));
+			return false;
+		}
+		if (texture.m_mips.empty())
+		{
+			LogError("No mips to write to {}", path);
+			return false;
+		}
+
+		DDSFileHeader header = {};
+		header.m_ddsFileToken = c_ddsFileToken;
+		header.m_headerSize = c_ddsHeaderSize;
+		header.m_flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+		header.m_heightPx = texture.m_height;
+		header.m_widthPx = texture.m_width;
+		header.m_pitchOrLinearSize = static_cast<uint32_t>(GetDDSMipSize(texture.m_width, texture.m_height, 0, texture.m_format));
+		header.m_mipCount = static_cast<uint32_t>(texture.m_mips.size());
+		header.m_pixelFormatSize = c_ddsPixelFormatSize;
+		header.m_pixelFormatFlags = DDPF_FOURCC;
+		memcpy(&header.m_pixelFormatFourCC, fourcc, sizeof(header.m_pixelFormatFourCC));
+		header.m_capsFlags = DDSCAPS_TEXTURE | (header.m_mipCount > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+
+		size_t totalSize = sizeof(header) + (dxgiFormat ? sizeof(DDSHeaderDX10Extension) : 0);
+		for (uint32_t i = 0; i < header.m_mipCount; ++i)
+		{
+			if (texture.m_mips[i].m_sizeBytes != GetDDSMipSize(texture.m_width, texture.m_height, i, texture.m_format))
+			{
+				LogError("Mip {} has unexpected size {}", i, texture.m_mips[i].m_sizeBytes);
+				return false;
+			}
+			totalSize += texture.m_mips[i].m_sizeBytes;
+		}
+		std::vector<uint8_t> buffer;
+		buffer.reserve(totalSize);
+		auto append = [&buffer](const void* data, size_t size) {
+			buffer.insert(buffer.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+		};
+		append(&header, sizeof(header));
+		if (dxgiFormat)
+		{
+			DDSHeaderDX10Extension dx10 = {};
+			dx10.m_dxgiFormat = *dxgiFormat;
+			dx10.resourceDimension = 3;		// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+			dx10.arraySize = 1;
+			append(&dx10, sizeof(dx10));
+		}
+		for (const auto& mip : texture.m_mips)
+		{
+			append(texture.GetImageData().data() + mip.m_offset, mip.m_sizeBytes);
+		}
+		return FileIO::SaveBinaryFile(path, buffer);
+	}
 }
\ No newline at end of file
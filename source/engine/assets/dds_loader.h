@@ -8,4 +8,7 @@ namespace R3
 		struct TextureData;
 	}
 	std::optional<Textures::TextureData> LoadTexture_DDS(std::string_view path);
+
+	// writes a block compressed texture + all of its mips (BC1/BC3 use legacy fourcc, BC4/BC5/BC7 use the DX10 header)
+	bool SaveTexture_DDS(std::string_view path, const Textures::TextureData& texture);
 }
\ No newline at end of file
@@ -0,0 +1,346 @@
+#include "mip_generator.h"
+#include "engine/systems/job_system.h"
+#include "core/profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <array>
+#include <functional>
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define R3_MIPS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace R3
+{
+	namespace Textures
+	{
+		const double c_kaiserRadius = 3.0;		// in destination texels
+		const double c_kaiserAlpha = 4.0;
+		const uint32_t c_pixelsPerJob = 16384;
+		const uint32_t c_linearToSRGBTableSize = 16384;
+
+		struct alignas(16) Pixel
+		{
+			float m_v[4];
+		};
+
+		struct FloatImage
+		{
+			uint32_t m_width = 0;
+			uint32_t m_height = 0;
+			std::vector<Pixel> m_pixels;
+		};
+
+		// the source texels + weights that contribute to each destination texel along one axis
+		struct FilterKernel
+		{
+			uint32_t m_tapCount = 0;			// per destination texel, unused taps have 0 weight
+			std::vector<uint32_t> m_texels;		// source texel of each tap, clamped to the edge
+			std::vector<float> m_weights;
+		};
+
+		// calls fn(row) for each row, in parallel if the job system exists
+		void ForEachRow(uint32_t rowCount, uint32_t rowWidth, const std::function<void(uint32_t)>& fn)
+		{
+			auto jobs = Systems::GetSystem<JobSystem>();
+			if (jobs && rowCount > 1)
+			{
+				const int rowsPerJob = static_cast<int>(std::max(1u, c_pixelsPerJob / rowWidth));
+				jobs->ForEachAsync(JobSystem::ThreadPool::SlowJobs, 0, rowCount, 1, rowsPerJob, fn);
+			}
+			else
+			{
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					fn(row);
+				}
+			}
+		}
+
+		float SRGBToLinear(float v)
+		{
+			return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float LinearToSRGB(float v)
+		{
+			return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+		}
+
+		const float* GetSRGBToLinearTable()
+		{
+			static const auto s_table = []() {
+				std::array<float, 256> table;
+				for (uint32_t i = 0; i < 256; ++i)
+				{
+					table[i] = SRGBToLinear(i / 255.0f);
+				}
+				return table;
+			}();
+			return s_table.data();
+		}
+
+		// 8 bit sRGB of linear values in [0, 1], fine enough that the output is within 0.2 of the exact value
+		const uint8_t* GetLinearToSRGBTable()
+		{
+			static const auto s_table = []() {
+				std::array<uint8_t, c_linearToSRGBTableSize> table;
+				for (uint32_t i = 0; i < c_linearToSRGBTableSize; ++i)
+				{
+					table[i] = static_cast<uint8_t>(LinearToSRGB(i / static_cast<float>(c_linearToSRGBTableSize - 1)) * 255.0f + 0.5f);
+				}
+				return table;
+			}();
+			return s_table.data();
+		}
+
+		double BesselI0(double x)
+		{
+			double sum = 1.0, term = 1.0;
+			for (int k = 1; k < 32 && term > sum * 1e-12; ++k)
+			{
+				const double t = x / (2.0 * k);
+				term *= t * t;
+				sum += term;
+			}
+			return sum;
+		}
+
+		// x = distance from the destination texel centre in destination texels
+		float GetFilterWeight(MipFilter filter, double x)
+		{
+			x = std::abs(x);
+			if (filter == MipFilter::Box)
+			{
+				return x < 0.5 ? 1.0f : (x == 0.5 ? 0.5f : 0.0f);
+			}
+			if (x >= c_kaiserRadius)
+			{
+				return 0.0f;
+			}
+			const double sinc = x == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+			const double t = x / c_kaiserRadius;
+			const double window = BesselI0(c_kaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(c_kaiserAlpha);
+			return static_cast<float>(sinc * window);
+		}
+
+		FilterKernel BuildKernel(MipFilter filter, uint32_t srcSize, uint32_t dstSize)
+		{
+			FilterKernel k;
+			const double scale = static_cast<double>(srcSize) / dstSize;
+			const double radius = (filter == MipFilter::Box ? 0.5 : c_kaiserRadius) * scale;
+			k.m_tapCount = static_cast<uint32_t>(std::ceil(radius * 2.0)) + 1;
+			k.m_texels.resize(static_cast<size_t>(dstSize) * k.m_tapCount);
+			k.m_weights.resize(static_cast<size_t>(dstSize) * k.m_tapCount);
+			for (uint32_t d = 0; d < dstSize; ++d)
+			{
+				const double centre = (d + 0.5) * scale;
+				const int64_t first = static_cast<int64_t>(std::floor(centre - radius));
+				float* weights = &k.m_weights[static_cast<size_t>(d) * k.m_tapCount];
+				uint32_t* texels = &k.m_texels[static_cast<size_t>(d) * k.m_tapCount];
+				float totalWeight = 0.0f;
+				for (uint32_t t = 0; t < k.m_tapCount; ++t)
+				{
+					const int64_t s = first + t;
+					weights[t] = GetFilterWeight(filter, (s + 0.5 - centre) / scale);
+					texels[t] = static_cast<uint32_t>(std::clamp<int64_t>(s, 0, srcSize - 1));
+					totalWeight += weights[t];
+				}
+				for (uint32_t t = 0; t < k.m_tapCount; ++t)
+				{
+					weights[t] /= totalWeight;
+				}
+			}
+			return k;
+		}
+
+		// sum of src[texels[t]] * weights[t]
+		void FilterPixel(const Pixel* src, const uint32_t* texels, const float* weights, uint32_t tapCount, Pixel& result)
+		{
+#ifdef R3_MIPS_USE_SSE2
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t t = 0; t < tapCount; ++t)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(src[texels[t]].m_v), _mm_set1_ps(weights[t])));
+			}
+			_mm_store_ps(result.m_v, sum);
+#else
+			result = {};
+			for (uint32_t t = 0; t < tapCount; ++t)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					result.m_v[c] += src[texels[t]].m_v[c] * weights[t];
+				}
+			}
+#endif
+		}
+
+		// dst += src * weight
+		void AccumulateRow(Pixel* dst, const Pixel* src, float weight, uint32_t count)
+		{
+#ifdef R3_MIPS_USE_SSE2
+			const __m128 w = _mm_set1_ps(weight);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				_mm_store_ps(dst[i].m_v, _mm_add_ps(_mm_load_ps(dst[i].m_v), _mm_mul_ps(_mm_load_ps(src[i].m_v), w)));
+			}
+#else
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					dst[i].m_v[c] += src[i].m_v[c] * weight;
+				}
+			}
+#endif
+		}
+
+		// clamps colour ringing from the kaiser filter or renormalises normals so errors do not accumulate down the chain
+		void FixupPixel(Pixel& p, bool isNormalMap)
+		{
+			if (isNormalMap)
+			{
+				const float length = std::sqrt(p.m_v[0] * p.m_v[0] + p.m_v[1] * p.m_v[1] + p.m_v[2] * p.m_v[2]);
+				if (length > 1e-6f)
+				{
+					p.m_v[0] /= length;
+					p.m_v[1] /= length;
+					p.m_v[2] /= length;
+				}
+				else
+				{
+					p.m_v[0] = p.m_v[1] = 0.0f;
+					p.m_v[2] = 1.0f;
+				}
+			}
+			else
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					p.m_v[c] = std::clamp(p.m_v[c], 0.0f, 1.0f);
+				}
+			}
+			p.m_v[3] = std::clamp(p.m_v[3], 0.0f, 1.0f);
+		}
+
+		// separable filter, horizontal into a temp image then vertical
+		FloatImage Downsample(const FloatImage& src, const MipChainSettings& settings)
+		{
+			R3_PROF_EVENT();
+			FloatImage dst;
+			dst.m_width = std::max(1u, src.m_width / 2);
+			dst.m_height = std::max(1u, src.m_height / 2);
+			dst.m_pixels.resize(static_cast<size_t>(dst.m_width) * dst.m_height);
+			const FilterKernel kernelX = BuildKernel(settings.m_filter, src.m_width, dst.m_width);
+			const FilterKernel kernelY = BuildKernel(settings.m_filter, src.m_height, dst.m_height);
+
+			std::vector<Pixel> horizontal(static_cast<size_t>(dst.m_width) * src.m_height);
+			ForEachRow(src.m_height, dst.m_width, [&](uint32_t y) {
+				const Pixel* srcRow = &src.m_pixels[static_cast<size_t>(y) * src.m_width];
+				Pixel* dstRow = &horizontal[static_cast<size_t>(y) * dst.m_width];
+				for (uint32_t x = 0; x < dst.m_width; ++x)
+				{
+					const size_t firstTap = static_cast<size_t>(x) * kernelX.m_tapCount;
+					FilterPixel(srcRow, &kernelX.m_texels[firstTap], &kernelX.m_weights[firstTap], kernelX.m_tapCount, dstRow[x]);
+				}
+			});
+			ForEachRow(dst.m_height, dst.m_width, [&](uint32_t y) {
+				Pixel* dstRow = &dst.m_pixels[static_cast<size_t>(y) * dst.m_width];
+				const size_t firstTap = static_cast<size_t>(y) * kernelY.m_tapCount;
+				for (uint32_t t = 0; t < kernelY.m_tapCount; ++t)
+				{
+					if (kernelY.m_weights[firstTap + t] != 0.0f)
+					{
+						const Pixel* srcRow = &horizontal[static_cast<size_t>(kernelY.m_texels[firstTap + t]) * dst.m_width];
+						AccumulateRow(dstRow, srcRow, kernelY.m_weights[firstTap + t], dst.m_width);
+					}
+				}
+				for (uint32_t x = 0; x < dst.m_width; ++x)
+				{
+					FixupPixel(dstRow[x], settings.m_isNormalMap);
+				}
+			});
+			return dst;
+		}
+
+		FloatImage DecodeImage(const uint8_t* rgba, uint32_t w, uint32_t h, const MipChainSettings& settings)
+		{
+			R3_PROF_EVENT();
+			FloatImage result;
+			result.m_width = w;
+			result.m_height = h;
+			result.m_pixels.resize(static_cast<size_t>(w) * h);
+			const float* srgbToLinear = GetSRGBToLinearTable();
+			ForEachRow(h, w, [&](uint32_t y) {
+				for (size_t i = static_cast<size_t>(y) * w; i < static_cast<size_t>(y + 1) * w; ++i)
+				{
+					Pixel& p = result.m_pixels[i];
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						const uint8_t v = rgba[i * 4 + c];
+						if (settings.m_isNormalMap)
+						{
+							p.m_v[c] = v / 127.5f - 1.0f;
+						}
+						else
+						{
+							p.m_v[c] = settings.m_isSRGB ? srgbToLinear[v] : v / 255.0f;
+						}
+					}
+					p.m_v[3] = rgba[i * 4 + 3] / 255.0f;
+					FixupPixel(p, settings.m_isNormalMap);
+				}
+			});
+			return result;
+		}
+
+		void EncodeImage(const FloatImage& image, const MipChainSettings& settings, std::vector<uint8_t>& rgba)
+		{
+			R3_PROF_EVENT();
+			rgba.resize(image.m_pixels.size() * 4);
+			const uint8_t* linearToSRGB = GetLinearToSRGBTable();
+			ForEachRow(image.m_height, image.m_width, [&](uint32_t y) {
+				for (size_t i = static_cast<size_t>(y) * image.m_width; i < static_cast<size_t>(y + 1) * image.m_width; ++i)
+				{
+					const Pixel& p = image.m_pixels[i];
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						if (settings.m_isNormalMap)
+						{
+							rgba[i * 4 + c] = static_cast<uint8_t>(std::clamp(p.m_v[c] * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+						}
+						else if (settings.m_isSRGB)
+						{
+							rgba[i * 4 + c] = linearToSRGB[static_cast<uint32_t>(p.m_v[c] * (c_linearToSRGBTableSize - 1) + 0.5f)];
+						}
+						else
+						{
+							rgba[i * 4 + c] = static_cast<uint8_t>(p.m_v[c] * 255.0f + 0.5f);
+						}
+					}
+					rgba[i * 4 + 3] = static_cast<uint8_t>(p.m_v[3] * 255.0f + 0.5f);
+				}
+			});
+		}
+
+		std::vector<std::vector<uint8_t>> GenerateMipChain(const uint8_t* rgba, uint32_t w, uint32_t h, uint32_t mipCount, const MipChainSettings& settings)
+		{
+			R3_PROF_EVENT();
+			std::vector<std::vector<uint8_t>> result(std::max(1u, mipCount));
+			result[0].assign(rgba, rgba + static_cast<size_t>(w) * h * 4);
+			if (mipCount <= 1)
+			{
+				return result;
+			}
+			FloatImage level = DecodeImage(rgba, w, h, settings);
+			for (uint32_t mip = 1; mip < mipCount; ++mip)
+			{
+				level = Downsample(level, settings);
+				EncodeImage(level, settings, result[mip]);
+			}
+			return result;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+
+// Generates mip chains on the CPU at bake time
+// Each level is filtered from the previous one in float, colour is filtered in linear space if the source is sRGB (alpha is always linear)
+// Normal maps are decoded to vectors, filtered + renormalised per level
+// Rows are filtered in parallel via the JobSystem if it exists (runs on the calling thread otherwise)
+namespace R3
+{
+	namespace Textures
+	{
+		enum class MipFilter
+		{
+			Box,		// 2x2 average, fast but blurry + aliases
+			Kaiser		// kaiser windowed sinc (3 texel radius), sharper mips
+		};
+
+		struct MipChainSettings
+		{
+			MipFilter m_filter = MipFilter::Kaiser;
+			bool m_isSRGB = true;			// rgb is sRGB encoded colour
+			bool m_isNormalMap = false;		// rgb = xyz * 0.5 + 0.5, ignores m_isSRGB
+		};
+
+		// rgba = w * h * 4 bytes, result[0] = copy of the top level, result[i] = mip i (max(1, w >> i) * max(1, h >> i) * 4 bytes)
+		std::vector<std::vector<uint8_t>> GenerateMipChain(const uint8_t* rgba, uint32_t w, uint32_t h, uint32_t mipCount, const MipChainSettings& settings);
+	}
+}
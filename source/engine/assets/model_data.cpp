@@ -1,9 +1,11 @@
 #include "model_data.h"
 #include "asset_file.h"
+#include "bake_cache.h"
 #include "core/profiler.h"
 #include "core/mutex.h"
 #include "core/file_io.h"
 #include "core/log.h"
+#include "engine/systems/job_system.h"
 #include <assimp/IOSystem.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -11,13 +13,17 @@
 #include <assimp/ProgressHandler.hpp>
 #include <meshoptimizer.h>
 #include <filesystem>
+#include <atomic>
 
 namespace R3
 {
-	const uint32_t c_bakedModelVersion = 3;		// change this to force rebake
+	const uint32_t c_bakedModelVersion = 6;		// change this to force rebake (part of the bake cache key)
 	const uint32_t c_bakedMaterialTexturePathLength = 256;	// avoid std::string in materials
 	const std::string c_bakedModelExtension = ".bmdl";
 	const std::string c_bakeSettingsExtension = ".bakesettings.json";
+	const size_t c_meshletMaxVertices = 64;
+	const size_t c_meshletMaxTriangles = 124;
+	const float c_meshletConeWeight = 0.25f;		// trade meshlet size for tighter normal cones (better backface culling)
 
 	struct BakeSettings 
 	{
@@ -33,6 +39,11 @@ namespace R3
 		float m_simplifyIndexThreshold = 0.5f;		// the desired reduction in index count (0-1.0)
 		float m_simplifyTargetError = 0.005f;		// acceptable % error when simplifying the model
 		float m_optimiseOverdrawThreshold = 1.05f;	// How much cache efficiency can be sacrificed to optimise for overdraw instead 
+		bool m_compressVertexData = true;			// compress vertices + indices with the meshopt codecs
+		uint32_t m_lodCount = 3;					// simplified LODs to generate per mesh part (max c_maxModelPartLods - 1)
+		float m_lodIndexThreshold = 0.5f;			// the desired index count of each LOD relative to the previous one
+		float m_lodTargetError = 0.1f;				// acceptable % error of each LOD relative to the base mesh
+		bool m_buildMeshlets = true;				// split the base mesh of each part into meshlets for cluster culling
 	};
 
 	struct AssimpLoadSettings
@@ -89,6 +100,16 @@ namespace R3
 			target.m_simplifyTargetError = parsedSettings["SimplifyTargetError"];
 		if (parsedSettings.contains("OverdrawCacheThreshold"))
 			target.m_simplifyTargetError = parsedSettings["OverdrawCacheThreshold"];
+		if (parsedSettings.contains("CompressVertexData"))
+			target.m_compressVertexData = parsedSettings["CompressVertexData"];
+		if (parsedSettings.contains("LodCount"))
+			target.m_lodCount = parsedSettings["LodCount"];
+		if (parsedSettings.contains("LodIndexThreshold"))
+			target.m_lodIndexThreshold = parsedSettings["LodIndexThreshold"];
+		if (parsedSettings.contains("LodTargetError"))
+			target.m_lodTargetError = parsedSettings["LodTargetError"];
+		if (parsedSettings.contains("BuildMeshlets"))
+			target.m_buildMeshlets = parsedSettings["BuildMeshlets"];
 
 		return true;
 	}
@@ -405,37 +426,41 @@ namespace R3
 	std::string GetBakedModelPath(std::string_view pathName)
 	{
 		R3_PROF_EVENT();
-		// get the source path relative to data base directory
-		std::string relPath = FileIO::SanitisePath(pathName);
-		if (relPath.size() == 0)
+		// the key changes if the model, its bake settings or the baker version change
+		const std::string settingsPath = std::string(pathName) + c_bakeSettingsExtension;
+		const uint64_t bakeKey = BakeCache::GetBakeKey(pathName, settingsPath, "Model", c_bakedModelVersion);
+
+		// add our own baked version + extension (so we dont need to check the version in the file)
+		std::string bakedPath = BakeCache::GetBakedPath(pathName, bakeKey, c_bakedModelExtension + std::to_string(c_bakedModelVersion));
+		if (bakedPath.empty())
 		{
 			LogWarn("Model file {} is outside data root", pathName);
-			return {};
 		}
+		return bakedPath;
+	}
 
-		// replace any directory separators with '_'
-		std::replace(relPath.begin(), relPath.end(), '/', '_');
-		std::replace(relPath.begin(), relPath.end(), '\\', '_');
-
-		// add our own baked version + extension (so we dont need to check the version in the file)
-		relPath += c_bakedModelExtension;
-		relPath += std::to_string(c_bakedModelVersion);
-
-		// use the temp directory for baked data
-		std::string bakedPath = std::string(FileIO::GetBasePath()) + "\\baked\\" + relPath;
-		return std::filesystem::absolute(bakedPath).string();
+	template<class T>
+	std::span<const T> BlobDataAs(std::span<const uint8_t> data)	// empty if the size does not match
+	{
+		if (data.size() % sizeof(T) != 0)
+		{
+			return {};
+		}
+		return { reinterpret_cast<const T*>(data.data()), data.size() / sizeof(T) };
 	}
 
 	bool LoadBakedModel(std::string_view filePath, ModelData& result, ProgressCb progCb)
 	{
 		R3_PROF_EVENT();
 
-		auto loadedFile = LoadAssetFile(filePath);
-		if (!loadedFile.has_value())
+		auto fileView = LoadAssetFileView(filePath);
+		if (!fileView.has_value())
 		{
 			LogError("Failed to load baked model file {}", filePath);
 			return false;
 		}
+		auto loadedFile = std::make_shared<const AssetFileView>(std::move(*fileView));
+		result.m_bakedFile = loadedFile;	// keep the file mapped while the model exists
 		uint32_t fileVersion = loadedFile->m_header["Version"];
 		if (fileVersion != c_bakedModelVersion)
 		{
@@ -453,39 +478,79 @@ namespace R3
 			loadedFile->m_header["BoundsMax"]["Z"]
 		};
 		progCb(5);
-		uint32_t vertexCount = loadedFile->m_header["VertexCount"];
-		auto vertexPosUVBlob = loadedFile->GetBlob("VerticesPosUV");
-		if ((vertexCount * sizeof(BakedModelVertexPosUV)) == vertexPosUVBlob->m_data.size())
+
+		// uncompressed vertices + indices are not copied, they are read from the mapped file when they are written to the gpu
+		// compressed blobs are decoded in parallel into a single buffer owned by the model
+		const AssetFileView::Blob* dataBlobs[] = {
+			loadedFile->FindBlob("VerticesPosUV"),
+			loadedFile->FindBlob("VerticesNormTan"),
+			loadedFile->FindBlob("Indices")
+		};
+		const uint32_t dataBlobCount = static_cast<uint32_t>(std::size(dataBlobs));
+		if (std::find(std::begin(dataBlobs), std::end(dataBlobs), nullptr) != std::end(dataBlobs))
 		{
-			result.m_bakedVerticesPosUV.resize(vertexCount);
-			memcpy(result.m_bakedVerticesPosUV.data(), vertexPosUVBlob->m_data.data(), vertexCount * sizeof(BakedModelVertexPosUV));
+			LogError("Missing vertex or index data");
+			return false;
 		}
-		else
+		uint64_t decodedOffsets[std::size(dataBlobs)] = { 0 };
+		uint64_t decodedSize = 0;
+		for (uint32_t b = 0; b < dataBlobCount; ++b)
 		{
-			LogError("Unexpected vertex data size");
-			return false;
+			if (dataBlobs[b]->m_codec != AssetBlobCodec::None)
+			{
+				decodedOffsets[b] = decodedSize;
+				decodedSize = AlignUpPow2(decodedSize + dataBlobs[b]->m_uncompressedSize, 64ull);
+			}
 		}
-		auto vertexNormTanBlob = loadedFile->GetBlob("VerticesNormTan");
-		if ((vertexCount * sizeof(BakedModelVertexNormalTangent)) == vertexNormTanBlob->m_data.size())
+		result.m_bakedDecodedData.resize(decodedSize);
+		std::atomic<bool> decodedOk = true;
+		auto decodeBlob = [&](uint32_t b) {
+			if (dataBlobs[b]->m_codec != AssetBlobCodec::None)
+			{
+				std::span<uint8_t> target(result.m_bakedDecodedData.data() + decodedOffsets[b], dataBlobs[b]->m_uncompressedSize);
+				if (!DecodeAssetBlob(*dataBlobs[b], target))
+				{
+					decodedOk = false;
+				}
+			}
+		};
+		auto jobs = Systems::GetSystem<JobSystem>();
+		if (jobs && decodedSize > 0)
 		{
-			result.m_bakedVerticesNormTan.resize(vertexCount);
-			memcpy(result.m_bakedVerticesNormTan.data(), vertexNormTanBlob->m_data.data(), vertexCount * sizeof(BakedModelVertexNormalTangent));
+			jobs->ForEachAsync(JobSystem::ThreadPool::SlowJobs, 0, dataBlobCount, 1, 1, decodeBlob);
 		}
 		else
 		{
-			LogError("Unexpected vertex data size");
+			for (uint32_t b = 0; b < dataBlobCount; ++b)
+			{
+				decodeBlob(b);
+			}
+		}
+		if (!decodedOk)
+		{
 			return false;
 		}
+		auto getBlobData = [&](uint32_t b) -> std::span<const uint8_t> {
+			if (dataBlobs[b]->m_codec == AssetBlobCodec::None)
+			{
+				return dataBlobs[b]->m_data;
+			}
+			return { result.m_bakedDecodedData.data() + decodedOffsets[b], dataBlobs[b]->m_uncompressedSize };
+		};
 		progCb(40);
 
-		uint32_t indexCount = loadedFile->m_header["IndexCount"];
-		auto indexBlob = loadedFile->GetBlob("Indices");
-		if ((indexCount * sizeof(uint32_t)) == indexBlob->m_data.size())
+		uint32_t vertexCount = loadedFile->m_header["VertexCount"];
+		result.m_bakedVerticesPosUV = BlobDataAs<BakedModelVertexPosUV>(getBlobData(0));
+		result.m_bakedVerticesNormTan = BlobDataAs<BakedModelVertexNormalTangent>(getBlobData(1));
+		if (result.m_bakedVerticesPosUV.size() != vertexCount || result.m_bakedVerticesNormTan.size() != vertexCount)
 		{
-			result.m_indices.resize(indexCount);
-			memcpy(result.m_indices.data(), indexBlob->m_data.data(), indexCount * sizeof(uint32_t));
+			LogError("Unexpected vertex data size");
+			return false;
 		}
-		else
+
+		uint32_t indexCount = loadedFile->m_header["IndexCount"];
+		result.m_bakedIndices = BlobDataAs<uint32_t>(getBlobData(2));
+		if (result.m_bakedIndices.size() != indexCount)
 		{
 			LogError("Unexpected index data size");
 			return false;
@@ -493,26 +558,38 @@ namespace R3
 		progCb(70);
 
 		uint32_t meshCount = loadedFile->m_header["MeshCount"];
-		auto meshBlob = loadedFile->GetBlob("Meshes");
-		if ((meshCount * sizeof(ModelPart)) == meshBlob->m_data.size())
+		auto meshBlob = loadedFile->GetBlobAs<ModelPart>("Meshes");
+		if (meshCount == meshBlob.size())
 		{
-			result.m_parts.resize(meshCount);
-			memcpy(result.m_parts.data(), meshBlob->m_data.data(), meshCount * sizeof(ModelPart));
+			result.m_parts.assign(meshBlob.begin(), meshBlob.end());
 		}
 		else
 		{
 			LogError("Unexpected mesh data size");
 			return false;
 		}
+
+		uint32_t meshletCount = loadedFile->m_header["MeshletCount"];
+		result.m_bakedMeshlets = loadedFile->GetBlobAs<ModelMeshlet>("Meshlets");
+		if (result.m_bakedMeshlets.size() != meshletCount)
+		{
+			LogError("Unexpected meshlet data size");
+			return false;
+		}
+		for (const auto& part : result.m_parts)
+		{
+			if (part.m_firstMeshlet + part.m_meshletCount > meshletCount)
+			{
+				LogError("Mesh part meshlets out of range");
+				return false;
+			}
+		}
 		progCb(90);
 
 		uint32_t materialCount = loadedFile->m_header["MaterialCount"];
-		auto materialBlob = loadedFile->GetBlob("Materials");
-		if ((materialCount * sizeof(BakedMaterial)) == materialBlob->m_data.size())
+		auto bakedMaterials = loadedFile->GetBlobAs<BakedMaterial>("Materials");
+		if (materialCount == bakedMaterials.size())
 		{
-			std::vector<BakedMaterial> bakedMaterials;
-			bakedMaterials.resize(materialCount);
-			memcpy(bakedMaterials.data(), materialBlob->m_data.data(), materialCount * sizeof(BakedMaterial));
 			result.m_materials.resize(materialCount);
 			for (uint32_t i = 0; i < materialCount; ++i)
 			{
@@ -529,7 +606,7 @@ namespace R3
 		return true;
 	}
 
-	bool SaveBakedModel(std::string_view srcPath, std::string_view bakedPath, const ModelData& modelData)
+	bool SaveBakedModel(std::string_view srcPath, std::string_view bakedPath, const ModelData& modelData, const BakeSettings& settings)
 	{
 		R3_PROF_EVENT();
 
@@ -540,6 +617,7 @@ namespace R3
 		bakedFile.m_header["IndexCount"] = modelData.m_indices.size();
 		bakedFile.m_header["MaterialCount"] = modelData.m_materials.size();
 		bakedFile.m_header["MeshCount"] = modelData.m_parts.size();
+		bakedFile.m_header["MeshletCount"] = modelData.m_meshlets.size();
 		auto& boundsMinJson = bakedFile.m_header["BoundsMin"];
 		boundsMinJson["X"] = modelData.m_boundsMin.x;
 		boundsMinJson["Y"] = modelData.m_boundsMin.y;
@@ -601,18 +679,26 @@ namespace R3
 		logStats("Normals", quantNormals);
 		logStats("Tangents", quantTangents);
 
+		const AssetBlobCodec vertexCodec = settings.m_compressVertexData ? AssetBlobCodec::MeshoptVertices : AssetBlobCodec::None;
+		const AssetBlobCodec indexCodec = settings.m_compressVertexData ? AssetBlobCodec::MeshoptIndices : AssetBlobCodec::None;
 		AssetFile::Blob& vertexPosUVBlob = bakedFile.m_blobs.emplace_back();
 		vertexPosUVBlob.m_name = "VerticesPosUV";
+		vertexPosUVBlob.m_codec = vertexCodec;
+		vertexPosUVBlob.m_elementSize = sizeof(BakedModelVertexPosUV);
 		vertexPosUVBlob.m_data.resize(sizeof(BakedModelVertexPosUV) * bakedVerticesPosUV.size());
 		memcpy(vertexPosUVBlob.m_data.data(), bakedVerticesPosUV.data(), sizeof(BakedModelVertexPosUV) * bakedVerticesPosUV.size());
 
 		AssetFile::Blob& vertexPosNormTan = bakedFile.m_blobs.emplace_back();
 		vertexPosNormTan.m_name = "VerticesNormTan";
+		vertexPosNormTan.m_codec = vertexCodec;
+		vertexPosNormTan.m_elementSize = sizeof(BakedModelVertexNormalTangent);
 		vertexPosNormTan.m_data.resize(sizeof(BakedModelVertexNormalTangent)* bakedVerticesNormTan.size());
 		memcpy(vertexPosNormTan.m_data.data(), bakedVerticesNormTan.data(), sizeof(BakedModelVertexNormalTangent)* bakedVerticesNormTan.size());
 
 		AssetFile::Blob& indexBlob = bakedFile.m_blobs.emplace_back();
 		indexBlob.m_name = "Indices";
+		indexBlob.m_codec = indexCodec;
+		indexBlob.m_elementSize = sizeof(uint32_t);
 		indexBlob.m_data.resize(sizeof(uint32_t) * modelData.m_indices.size());
 		memcpy(indexBlob.m_data.data(), modelData.m_indices.data(), sizeof(uint32_t) * modelData.m_indices.size());
 
@@ -621,6 +707,11 @@ namespace R3
 		meshesBlob.m_data.resize(sizeof(ModelPart) * modelData.m_parts.size());
 		memcpy(meshesBlob.m_data.data(), modelData.m_parts.data(), sizeof(ModelPart) * modelData.m_parts.size());
 
+		AssetFile::Blob& meshletsBlob = bakedFile.m_blobs.emplace_back();
+		meshletsBlob.m_name = "Meshlets";
+		meshletsBlob.m_data.resize(sizeof(ModelMeshlet) * modelData.m_meshlets.size());
+		memcpy(meshletsBlob.m_data.data(), modelData.m_meshlets.data(), sizeof(ModelMeshlet) * modelData.m_meshlets.size());
+
 		std::vector<BakedMaterial> bakedMaterials;
 		bakedMaterials.resize(modelData.m_materials.size());
 		for (int m = 0; m < modelData.m_materials.size(); ++m)
@@ -644,109 +735,283 @@ namespace R3
 		return true;
 	}
 
-	void OptimiseModel(ModelData& sourceModel, const BakeSettings& settings, ProgressCb progCb)
+	// returns the simplified indices, resultError is relative to the mesh extents
+	std::vector<uint32_t> SimplifyIndices(const std::vector<uint32_t>& indices, const std::vector<ModelVertex>& vertices, uint32_t targetIndexCount, float targetError, float& resultError)
 	{
 		R3_PROF_EVENT();
+		std::vector<uint32_t> simplifiedIndices(indices.size());	// reserve enough memory for new indices
+		const float attribWeights[] = { 1.0f,1.0f,1.0f,1.0f,1.0f };
+		size_t newIndexCount = meshopt_simplifyWithAttributes(simplifiedIndices.data(),
+			indices.data(),
+			indices.size(),
+			(const float*)vertices.data(),
+			vertices.size(),
+			sizeof(ModelVertex),
+			&vertices[0].m_positionU0[3],			// start at uv0
+			sizeof(ModelVertex),
+			attribWeights,
+			5,										// uv0 + normal + uv1
+			nullptr,
+			targetIndexCount,
+			targetError,
+			0,
+			&resultError
+		);
+		simplifiedIndices.resize(newIndexCount);
+		return simplifiedIndices;
+	}
 
-		// run meshoptimizer on each model part, rebuild the vb/ib for the entire model
-		std::vector<uint32_t> allMeshIndices;		// vb/ib for the entire model (with re-patched indices to reference one giant buffer)
-		std::vector<ModelVertex> allMeshVertices;
-		float progress = 50.0f;
-		for (int part = 0; part < sourceModel.m_parts.size(); ++part)
-		{
-			std::vector<uint32_t> remapTable;
-			std::vector<uint32_t> newPartIndices;		// vb/ib for each part
-			std::vector<ModelVertex> newPartVertices;
-			auto sourceIndexCount = sourceModel.m_parts[part].m_indexCount;
-			auto sourceVerticesCount = sourceModel.m_parts[part].m_vertexCount;
-			auto sourceIndicesPtr = sourceModel.m_indices.data() + sourceModel.m_parts[part].m_indexDataOffset;
-			auto sourceVerticesPtr = sourceModel.m_vertices.data() + sourceModel.m_parts[part].m_vertexDataOffset;
-
-			// Part indices are relative to the entire vertex buffer. Remap them back to the 'local' vertex buffer
-			for (uint32_t i = 0; i < sourceIndexCount; ++i)
+	// splits a mesh into meshlets and rewrites the indices so the triangles of each meshlet are contiguous
+	// meshlet index offsets are relative to the start of the indices
+	std::vector<ModelMeshlet> BuildMeshlets(std::vector<uint32_t>& indices, const std::vector<ModelVertex>& vertices)
+	{
+		R3_PROF_EVENT();
+		const size_t maxMeshlets = meshopt_buildMeshletsBound(indices.size(), c_meshletMaxVertices, c_meshletMaxTriangles);
+		std::vector<meshopt_Meshlet> meshlets(maxMeshlets);
+		std::vector<uint32_t> meshletVertices(maxMeshlets * c_meshletMaxVertices);
+		std::vector<uint8_t> meshletTriangles(maxMeshlets * c_meshletMaxTriangles * 3);
+		const size_t meshletCount = meshopt_buildMeshlets(meshlets.data(), meshletVertices.data(), meshletTriangles.data(),
+			indices.data(), indices.size(), (const float*)vertices.data(), vertices.size(), sizeof(ModelVertex),
+			c_meshletMaxVertices, c_meshletMaxTriangles, c_meshletConeWeight);
+
+		std::vector<ModelMeshlet> result(meshletCount);
+		std::vector<uint32_t> meshletIndices;
+		meshletIndices.reserve(indices.size());
+		for (size_t m = 0; m < meshletCount; ++m)
+		{
+			const meshopt_Meshlet& src = meshlets[m];
+			const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&meshletVertices[src.vertex_offset], &meshletTriangles[src.triangle_offset],
+				src.triangle_count, (const float*)vertices.data(), vertices.size(), sizeof(ModelVertex));
+			ModelMeshlet& meshlet = result[m];
+			meshlet.m_center = { bounds.center[0], bounds.center[1], bounds.center[2] };
+			meshlet.m_radius = bounds.radius;
+			meshlet.m_coneApex = { bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2] };
+			meshlet.m_coneAxis = { bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2] };
+			meshlet.m_coneCutoff = bounds.cone_cutoff;
+			meshlet.m_indexDataOffset = static_cast<uint32_t>(meshletIndices.size());
+			meshlet.m_indexCount = src.triangle_count * 3;
+			for (uint32_t i = 0; i < src.triangle_count * 3; ++i)
 			{
-				sourceModel.m_indices[i + sourceModel.m_parts[part].m_indexDataOffset] -= sourceModel.m_parts[part].m_vertexDataOffset;
-				assert(sourceModel.m_indices[i + sourceModel.m_parts[part].m_indexDataOffset] < sourceVerticesCount);
+				meshletIndices.push_back(meshletVertices[src.vertex_offset + meshletTriangles[src.triangle_offset + i]]);
 			}
+		}
+		if (meshletIndices.size() != indices.size())
+		{
+			LogWarn("Meshlets do not contain all triangles ({} vs {} indices), meshlets will not be used", meshletIndices.size(), indices.size());
+			return {};
+		}
+		indices = std::move(meshletIndices);
+		return result;
+	}
 
-			// First build a remap table
-			remapTable.resize(sourceVerticesCount);
-			size_t newVertexCount = meshopt_generateVertexRemap(remapTable.data(), sourceIndicesPtr, sourceIndexCount, sourceVerticesPtr, sourceVerticesCount, sizeof(ModelVertex));
+	struct OptimisedModelPart		// the results of optimising a single part, indices are relative to the part
+	{
+		std::vector<uint32_t> m_indices;
+		std::vector<ModelVertex> m_vertices;
+		std::vector<ModelMeshlet> m_meshlets;
+		std::vector<uint32_t> m_lodIndices[c_maxModelPartLods - 1];
+	};
 
-			// Generate a new set of indices + vertices based on remap table
-			newPartIndices.resize(sourceIndexCount);
-			newPartVertices.resize(newVertexCount);
-			meshopt_remapIndexBuffer(newPartIndices.data(), sourceIndicesPtr, sourceIndexCount, remapTable.data());
-			meshopt_remapVertexBuffer(newPartVertices.data(), sourceVerticesPtr, sourceVerticesCount, sizeof(ModelVertex), remapTable.data());
+	// runs meshoptimizer on a single part, only touches the source data of this part so parts can be optimised in parallel
+	// the part offsets are not patched here, see OptimiseModel
+	void OptimiseModelPart(ModelData& sourceModel, uint32_t part, const BakeSettings& settings, OptimisedModelPart& result)
+	{
+		R3_PROF_EVENT();
+		std::vector<uint32_t> remapTable;
+		std::vector<uint32_t>& newPartIndices = result.m_indices;		// vb/ib for each part
+		std::vector<ModelVertex>& newPartVertices = result.m_vertices;
+		auto sourceIndexCount = sourceModel.m_parts[part].m_indexCount;
+		auto sourceVerticesCount = sourceModel.m_parts[part].m_vertexCount;
+		auto sourceIndicesPtr = sourceModel.m_indices.data() + sourceModel.m_parts[part].m_indexDataOffset;
+		auto sourceVerticesPtr = sourceModel.m_vertices.data() + sourceModel.m_parts[part].m_vertexDataOffset;
+
+		// Part indices are relative to the entire vertex buffer. Remap them back to the 'local' vertex buffer
+		for (uint32_t i = 0; i < sourceIndexCount; ++i)
+		{
+			sourceModel.m_indices[i + sourceModel.m_parts[part].m_indexDataOffset] -= sourceModel.m_parts[part].m_vertexDataOffset;
+			assert(sourceModel.m_indices[i + sourceModel.m_parts[part].m_indexDataOffset] < sourceVerticesCount);
+		}
 
-			// Optimise indices for vertex cache
-			meshopt_optimizeVertexCache(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.size());
+		// First build a remap table
+		remapTable.resize(sourceVerticesCount);
+		size_t newVertexCount = meshopt_generateVertexRemap(remapTable.data(), sourceIndicesPtr, sourceIndexCount, sourceVerticesPtr, sourceVerticesCount, sizeof(ModelVertex));
 
-			// Optimise indices for overdraw, sacrificing some amount of cache efficiency
-			meshopt_optimizeOverdraw(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), (const float*)newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex), settings.m_optimiseOverdrawThreshold);
+		// Generate a new set of indices + vertices based on remap table
+		newPartIndices.resize(sourceIndexCount);
+		newPartVertices.resize(newVertexCount);
+		meshopt_remapIndexBuffer(newPartIndices.data(), sourceIndicesPtr, sourceIndexCount, remapTable.data());
+		meshopt_remapVertexBuffer(newPartVertices.data(), sourceVerticesPtr, sourceVerticesCount, sizeof(ModelVertex), remapTable.data());
+
+		// Optimise indices for vertex cache
+		meshopt_optimizeVertexCache(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.size());
+
+		// Optimise indices for overdraw, sacrificing some amount of cache efficiency
+		meshopt_optimizeOverdraw(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), (const float*)newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex), settings.m_optimiseOverdrawThreshold);
+
+		// Re-order the vertices and indices for optimal vertex fetch
+		meshopt_optimizeVertexFetch(newPartVertices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex));
 
-			// Re-order the vertices and indices for optimal vertex fetch
+		if (settings.m_simplifyModel)
+		{
+			uint32_t targetIndexCount = (uint32_t)((float)newPartIndices.size() * settings.m_simplifyIndexThreshold);
+			float resultError = 0.0f;
+			std::vector<uint32_t> simplifiedIndices = SimplifyIndices(newPartIndices, newPartVertices, targetIndexCount, settings.m_simplifyTargetError, resultError);
+			LogInfo("Simplified mesh from {} to {} triangles, final error = {} (target error = {})", newPartIndices.size() / 3, simplifiedIndices.size() / 3, resultError, settings.m_simplifyTargetError);
+			newPartIndices = std::move(simplifiedIndices);
+
+			// re-optimise indices
+			meshopt_optimizeVertexCache(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.size());
+			meshopt_optimizeOverdraw(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), (const float*)newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex), settings.m_optimiseOverdrawThreshold);
 			meshopt_optimizeVertexFetch(newPartVertices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex));
+		}
+
+		// Build meshlets from the final base mesh, this changes the order of the triangles
+		if (settings.m_buildMeshlets)
+		{
+			result.m_meshlets = BuildMeshlets(newPartIndices, newPartVertices);
+		}
 
-			if (settings.m_simplifyModel)
+		// Generate LODs, they share the vertices of the base mesh so vertex fetch is not re-optimised
+		// Each LOD is simplified from the base mesh so the error is always relative to LOD 0
+		ModelPart& thisPart = sourceModel.m_parts[part];
+		thisPart.m_lodCount = 0;
+		const uint32_t lodsToBuild = glm::min(settings.m_lodCount, c_maxModelPartLods - 1);
+		const float errorScale = meshopt_simplifyScale((const float*)newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex));
+		size_t previousIndexCount = newPartIndices.size();
+		for (uint32_t lod = 0; lod < lodsToBuild; ++lod)
+		{
+			uint32_t targetIndexCount = (uint32_t)((float)previousIndexCount * settings.m_lodIndexThreshold);
+			float resultError = 0.0f;
+			std::vector<uint32_t> simplifiedIndices = SimplifyIndices(newPartIndices, newPartVertices, targetIndexCount, settings.m_lodTargetError, resultError);
+			if (simplifiedIndices.size() == 0 || simplifiedIndices.size() > previousIndexCount * 0.9f)
 			{
-				std::vector<uint32_t> simplifiedIndices(newPartIndices.size());	// reserve enough memory for new indices
-				uint32_t targetIndexCount = (uint32_t)((float)newPartIndices.size() * settings.m_simplifyIndexThreshold);
-				float resultError = 0.0f;
-
-				const float attribWeights[] = { 1.0f,1.0f,1.0f,1.0f,1.0f };
-				size_t newIndexCount = meshopt_simplifyWithAttributes(simplifiedIndices.data(),
-					newPartIndices.data(),
-					newPartIndices.size(),
-					(const float*)newPartVertices.data(),
-					newPartVertices.size(),
-					sizeof(ModelVertex),
-					&newPartVertices[0].m_positionU0[3],	// start at uv0
-					sizeof(ModelVertex),
-					attribWeights,
-					5,										// uv0 + normal + uv1
-					nullptr,
-					targetIndexCount,
-					settings.m_simplifyTargetError,
-					0,
-					&resultError
-				);
-
-				LogInfo("Simplified mesh from {} to {} triangles, final error = {} (target error = {})", newPartIndices.size() / 2, targetIndexCount / 3,resultError, settings.m_simplifyTargetError);
-
-				newPartIndices.clear();
-				newPartIndices.insert(newPartIndices.end(), simplifiedIndices.begin(), simplifiedIndices.begin() + newIndexCount);
-
-				// re-optimise indices
-				meshopt_optimizeVertexCache(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.size());
-				meshopt_optimizeOverdraw(newPartIndices.data(), newPartIndices.data(), newPartIndices.size(), (const float*)newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex), settings.m_optimiseOverdrawThreshold);
-				meshopt_optimizeVertexFetch(newPartVertices.data(), newPartIndices.data(), newPartIndices.size(), newPartVertices.data(), newPartVertices.size(), sizeof(ModelVertex));
+				break;	// not worth keeping, the simplifier could not remove enough triangles
 			}
+			meshopt_optimizeVertexCache(simplifiedIndices.data(), simplifiedIndices.data(), simplifiedIndices.size(), newPartVertices.size());
+			previousIndexCount = simplifiedIndices.size();
+			result.m_lodIndices[lod] = std::move(simplifiedIndices);
+			thisPart.m_lods[lod].m_error = resultError * errorScale;
+			thisPart.m_lodCount++;
+		}
+	}
 
-			// Patch the part data with the new vb/ib, append the data to the new mesh vb/ib
-			auto newMeshVbOffset = static_cast<uint32_t>(allMeshVertices.size());
-			auto newMeshIbOffset = static_cast<uint32_t>(allMeshIndices.size());
-			for (auto i = 0; i < newPartIndices.size(); ++i)
+	void OptimiseModel(ModelData& sourceModel, const BakeSettings& settings, ProgressCb progCb)
+	{
+		R3_PROF_EVENT();
+
+		// run meshoptimizer on each model part in parallel
+		const uint32_t partCount = static_cast<uint32_t>(sourceModel.m_parts.size());
+		std::vector<OptimisedModelPart> optimisedParts(partCount);
+		std::atomic<uint32_t> partsOptimised = 0;
+		Mutex progressMutex;
+		auto optimisePart = [&](uint32_t part) {
+			OptimiseModelPart(sourceModel, part, settings, optimisedParts[part]);
+			const uint32_t partsDone = ++partsOptimised;
+			ScopedLock lock(progressMutex);		// progress callbacks are not thread safe
+			progCb((int)(50.0f + 45.0f * (float)partsDone / (float)partCount));		// up to 95% progress
+		};
+		auto jobs = Systems::GetSystem<JobSystem>();
+		if (jobs && partCount > 1)
+		{
+			jobs->ForEachAsync(JobSystem::ThreadPool::SlowJobs, 0, partCount, 1, 1, optimisePart);
+		}
+		else
+		{
+			for (uint32_t part = 0; part < partCount; ++part)
 			{
-				newPartIndices[i] += newMeshVbOffset;	// offset indices into final vertex buffer
+				optimisePart(part);
 			}
-			allMeshVertices.insert(allMeshVertices.end(), newPartVertices.begin(), newPartVertices.end());
-			allMeshIndices.insert(allMeshIndices.end(), newPartIndices.begin(), newPartIndices.end());
-
-			sourceModel.m_parts[part].m_indexDataOffset = newMeshIbOffset;
-			sourceModel.m_parts[part].m_vertexDataOffset = newMeshVbOffset;
-			sourceModel.m_parts[part].m_indexCount = (uint32_t)newPartIndices.size();
-			sourceModel.m_parts[part].m_vertexCount = (uint32_t)newVertexCount;
+		}
 
-			progress += 45.0f / (float)sourceModel.m_parts.size();		// up to 95% progress
-			progCb((int)progress);
+		// rebuild the vb/ib for the entire model in part order so the output does not depend on job scheduling
+		// prefix sum of the part sizes first, then each part can be copied to its final location
+		std::vector<uint32_t> partVbOffsets(partCount), partIbOffsets(partCount), partLodIbOffsets(partCount), partFirstMeshlets(partCount);
+		size_t totalVertices = 0, totalIndices = 0, totalMeshlets = 0;
+		for (uint32_t part = 0; part < partCount; ++part)
+		{
+			const OptimisedModelPart& optimised = optimisedParts[part];
+			partVbOffsets[part] = static_cast<uint32_t>(totalVertices);
+			partIbOffsets[part] = static_cast<uint32_t>(totalIndices);
+			partFirstMeshlets[part] = static_cast<uint32_t>(totalMeshlets);
+			totalVertices += optimised.m_vertices.size();
+			totalIndices += optimised.m_indices.size();
+			partLodIbOffsets[part] = static_cast<uint32_t>(totalIndices);	// LOD indices are stored after the base mesh
+			for (uint32_t lod = 0; lod < sourceModel.m_parts[part].m_lodCount; ++lod)
+			{
+				totalIndices += optimised.m_lodIndices[lod].size();
+			}
+			totalMeshlets += optimised.m_meshlets.size();
+		}
+		std::vector<ModelVertex> allMeshVertices(totalVertices);		// vb/ib for the entire model (with re-patched indices to reference one giant buffer)
+		std::vector<uint32_t> allMeshIndices(totalIndices);
+		std::vector<ModelMeshlet> allMeshlets(totalMeshlets);
+		auto mergePart = [&](uint32_t part) {
+			const OptimisedModelPart& optimised = optimisedParts[part];
+			ModelPart& thisPart = sourceModel.m_parts[part];
+			const uint32_t newMeshVbOffset = partVbOffsets[part];
+			const uint32_t newMeshIbOffset = partIbOffsets[part];
+			std::copy(optimised.m_vertices.begin(), optimised.m_vertices.end(), allMeshVertices.begin() + newMeshVbOffset);
+			for (size_t i = 0; i < optimised.m_indices.size(); ++i)
+			{
+				allMeshIndices[newMeshIbOffset + i] = optimised.m_indices[i] + newMeshVbOffset;	// offset indices into final vertex buffer
+			}
+			uint32_t lodIbOffset = partLodIbOffsets[part];
+			for (uint32_t lod = 0; lod < thisPart.m_lodCount; ++lod)
+			{
+				const auto& lodIndices = optimised.m_lodIndices[lod];
+				thisPart.m_lods[lod].m_indexDataOffset = lodIbOffset;
+				thisPart.m_lods[lod].m_indexCount = static_cast<uint32_t>(lodIndices.size());
+				for (size_t i = 0; i < lodIndices.size(); ++i)
+				{
+					allMeshIndices[lodIbOffset + i] = lodIndices[i] + newMeshVbOffset;
+				}
+				lodIbOffset += static_cast<uint32_t>(lodIndices.size());
+			}
+			thisPart.m_firstMeshlet = partFirstMeshlets[part];
+			thisPart.m_meshletCount = static_cast<uint32_t>(optimised.m_meshlets.size());
+			for (size_t m = 0; m < optimised.m_meshlets.size(); ++m)
+			{
+				ModelMeshlet& meshlet = allMeshlets[thisPart.m_firstMeshlet + m];
+				meshlet = optimised.m_meshlets[m];
+				meshlet.m_indexDataOffset += newMeshIbOffset;
+			}
+			thisPart.m_indexDataOffset = newMeshIbOffset;
+			thisPart.m_vertexDataOffset = newMeshVbOffset;
+			thisPart.m_indexCount = static_cast<uint32_t>(optimised.m_indices.size());
+			thisPart.m_vertexCount = static_cast<uint32_t>(optimised.m_vertices.size());
+		};
+		if (jobs && partCount > 1)
+		{
+			jobs->ForEachAsync(JobSystem::ThreadPool::SlowJobs, 0, partCount, 1, 16, mergePart);
+		}
+		else
+		{
+			for (uint32_t part = 0; part < partCount; ++part)
+			{
+				mergePart(part);
+			}
 		}
 
 		// copy the final vb/ib for the entire model
-		sourceModel.m_vertices.clear();
-		sourceModel.m_vertices.insert(sourceModel.m_vertices.end(), allMeshVertices.begin(), allMeshVertices.end());
-		sourceModel.m_indices.clear();
-		sourceModel.m_indices.insert(sourceModel.m_indices.end(), allMeshIndices.begin(), allMeshIndices.end());
+		sourceModel.m_vertices = std::move(allMeshVertices);
+		sourceModel.m_indices = std::move(allMeshIndices);
+		sourceModel.m_meshlets = std::move(allMeshlets);
+	}
+
+	// all textures referenced by the materials, sorted so the manifest does not change between bakes
+	std::vector<std::string> GetTextureDependencies(const ModelData& model)
+	{
+		std::vector<std::string> textures;
+		for (const auto& m : model.m_materials)
+		{
+			for (const auto* maps : { &m.m_diffuseMaps, &m.m_normalMaps, &m.m_metalnessMaps, &m.m_roughnessMaps, &m.m_aoMaps, &m.m_heightMaps })
+			{
+				textures.insert(textures.end(), maps->begin(), maps->end());
+			}
+		}
+		std::sort(textures.begin(), textures.end());
+		textures.erase(std::unique(textures.begin(), textures.end()), textures.end());
+		return textures;
 	}
 
 	bool BakeModel(std::string_view filePath, ProgressCb progCb)
@@ -789,11 +1054,12 @@ namespace R3
 			OptimiseModel(sourceModel, modelBakeSettings, progCb);
 		}
 
-		if (!SaveBakedModel(filePath, bakedPath, sourceModel))
+		if (!SaveBakedModel(filePath, bakedPath, sourceModel, modelBakeSettings))
 		{
 			LogError("Failed to save baked model {} to file {}", filePath, bakedPath);
 			return false;
 		}
+		BakeCache::SetDependencies(filePath, GetTextureDependencies(sourceModel));
 		progCb(100);
 
 		return true;
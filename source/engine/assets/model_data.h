@@ -13,6 +13,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <span>
 #include <functional>
 
 struct aiNode;
@@ -54,6 +55,26 @@ namespace R3
 		float m_roughness;
 	};
 
+	const uint32_t c_maxModelPartLods = 4;	// including the base mesh
+
+	struct ModelPartLod			// simplified version of a part, uses the same vertices as the base mesh
+	{
+		uint32_t m_indexDataOffset;
+		uint32_t m_indexCount;
+		float m_error;				// simplification error in mesh space units
+	};
+
+	struct ModelMeshlet			// cluster of triangles built at bake time for culling, see meshopt_computeMeshletBounds
+	{
+		glm::vec3 m_center;			// bounding sphere in mesh space
+		float m_radius;
+		glm::vec3 m_coneApex;		// normal cone, the meshlet is backfacing if dot(normalize(apex - view pos), axis) >= cutoff
+		glm::vec3 m_coneAxis;
+		float m_coneCutoff;
+		uint32_t m_indexDataOffset;	// the triangles of a meshlet are contiguous in the index buffer
+		uint32_t m_indexCount;
+	};
+
 	struct ModelPart
 	{
 		glm::mat4 m_transform;		// relative to the model
@@ -64,14 +85,25 @@ namespace R3
 		uint32_t m_indexDataOffset;
 		uint32_t m_indexCount;
 		int m_materialIndex;		// -1 = no material
+		uint32_t m_lodCount = 0;	// simplified LODs generated at bake time, the base mesh is LOD 0 and is not included
+		ModelPartLod m_lods[c_maxModelPartLods - 1] = {};
+		uint32_t m_firstMeshlet = 0;	// meshlets of the base mesh, index into model meshlets
+		uint32_t m_meshletCount = 0;
 	};
 
 	struct ModelData
 	{
 		std::vector<ModelVertex> m_vertices;	// verts are in mesh space, only stored for non-baked models
-		std::vector<BakedModelVertexPosUV> m_bakedVerticesPosUV;	// verts are in mesh space + quantised
-		std::vector<BakedModelVertexNormalTangent> m_bakedVerticesNormTan;	// verts are in mesh space + quantised
-		std::vector<uint32_t> m_indices;
+		std::vector<uint32_t> m_indices;		// only stored for non-baked models
+		std::vector<ModelMeshlet> m_meshlets;	// only stored for non-baked models
+
+		// baked models keep the file mapped, vertices + indices point directly into it (or into m_bakedDecodedData if they were compressed)
+		std::shared_ptr<const class AssetFileView> m_bakedFile;
+		std::vector<uint8_t> m_bakedDecodedData;
+		std::span<const BakedModelVertexPosUV> m_bakedVerticesPosUV;	// verts are in mesh space + quantised
+		std::span<const BakedModelVertexNormalTangent> m_bakedVerticesNormTan;	// verts are in mesh space + quantised
+		std::span<const uint32_t> m_bakedIndices;
+		std::span<const ModelMeshlet> m_bakedMeshlets;
 		std::vector<ModelMaterial> m_materials;
 		std::vector<ModelPart> m_parts;
 		glm::vec3 m_boundsMin = glm::vec3{ -1.0f };
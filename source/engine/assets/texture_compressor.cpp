@@ -0,0 +1,844 @@
+#include "texture_compressor.h"
+#include "engine/systems/job_system.h"
+#include "core/profiler.h"
+#include "core/log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define R3_BC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace R3
+{
+	namespace Textures
+	{
+		const float c_bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };		// interpolation factor of each index towards endpoint 1
+		const uint32_t c_bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		const uint32_t c_blocksPerJob = 4096;
+
+		struct BlockPixels		// 16 pixels with one array per channel so 4 pixels can be processed at once
+		{
+			alignas(16) float m_channels[4][16];
+		};
+
+		struct Palette
+		{
+			alignas(16) float m_colours[16][4];
+			uint32_t m_count = 0;
+		};
+
+		struct BitWriter		// writes LSB first, the target must be zeroed
+		{
+			uint8_t* m_data = nullptr;
+			uint32_t m_position = 0;
+			void Write(uint32_t value, uint32_t bitCount)
+			{
+				for (uint32_t b = 0; b < bitCount; ++b, ++m_position)
+				{
+					if ((value >> b) & 1)
+					{
+						m_data[m_position >> 3] |= static_cast<uint8_t>(1 << (m_position & 7));
+					}
+				}
+			}
+		};
+
+		struct BitReader
+		{
+			const uint8_t* m_data = nullptr;
+			uint32_t m_position = 0;
+			uint32_t Read(uint32_t bitCount)
+			{
+				uint32_t value = 0;
+				for (uint32_t b = 0; b < bitCount; ++b, ++m_position)
+				{
+					value |= ((m_data[m_position >> 3] >> (m_position & 7)) & 1) << b;
+				}
+				return value;
+			}
+		};
+
+		uint32_t GetBlockBytes(Format f)
+		{
+			return (f == Format::RGBA_BC1 || f == Format::R_BC4) ? 8 : 16;
+		}
+
+		std::string_view QualityToString(CompressionQuality q)
+		{
+			switch (q)
+			{
+			case CompressionQuality::Fast:
+				return "Fast";
+			case CompressionQuality::Normal:
+				return "Normal";
+			case CompressionQuality::High:
+				return "High";
+			default:
+				return "Unknown";
+			}
+		}
+
+		bool IsBlockCompressed(Format f)
+		{
+			return f == Format::RGBA_BC1 || f == Format::RGBA_BC2 || f == Format::RGBA_BC3 || f == Format::R_BC4 || f == Format::RG_BC5 || f == Format::RGBA_BC7;
+		}
+
+		uint64_t GetCompressedSizeBytes(uint32_t w, uint32_t h, Format f)
+		{
+			const uint64_t blockCount = static_cast<uint64_t>((w + 3) / 4) * ((h + 3) / 4);
+			return blockCount * GetBlockBytes(f);
+		}
+
+		// pixels outside the image are clamped to the edge
+		void LoadBlock(const uint8_t* rgba, uint32_t w, uint32_t h, uint32_t blockX, uint32_t blockY, BlockPixels& result)
+		{
+			for (uint32_t y = 0; y < 4; ++y)
+			{
+				const uint32_t srcY = std::min(blockY * 4 + y, h - 1);
+				for (uint32_t x = 0; x < 4; ++x)
+				{
+					const uint32_t srcX = std::min(blockX * 4 + x, w - 1);
+					const uint8_t* src = rgba + (static_cast<size_t>(srcY) * w + srcX) * 4;
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						result.m_channels[c][y * 4 + x] = src[c];
+					}
+				}
+			}
+		}
+
+		// writes the closest palette entry for each pixel, returns the total squared error
+		float FitIndices(const BlockPixels& px, const Palette& palette, uint32_t channels, uint8_t indices[16])
+		{
+#ifdef R3_BC_USE_SSE2
+			__m128 totalError = _mm_setzero_ps();
+			for (uint32_t group = 0; group < 16; group += 4)
+			{
+				__m128 bestError = _mm_set1_ps(std::numeric_limits<float>::max());
+				__m128i bestIndex = _mm_setzero_si128();
+				for (uint32_t p = 0; p < palette.m_count; ++p)
+				{
+					__m128 error = _mm_setzero_ps();
+					for (uint32_t c = 0; c < channels; ++c)
+					{
+						const __m128 d = _mm_sub_ps(_mm_load_ps(&px.m_channels[c][group]), _mm_set1_ps(palette.m_colours[p][c]));
+						error = _mm_add_ps(error, _mm_mul_ps(d, d));
+					}
+					const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+					bestError = _mm_min_ps(error, bestError);
+					bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+				}
+				alignas(16) int32_t groupIndices[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(groupIndices), bestIndex);
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					indices[group + i] = static_cast<uint8_t>(groupIndices[i]);
+				}
+				totalError = _mm_add_ps(totalError, bestError);
+			}
+			alignas(16) float errors[4];
+			_mm_store_ps(errors, totalError);
+			return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+			float totalError = 0.0f;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				float bestError = std::numeric_limits<float>::max();
+				for (uint32_t p = 0; p < palette.m_count; ++p)
+				{
+					float error = 0.0f;
+					for (uint32_t c = 0; c < channels; ++c)
+					{
+						const float d = px.m_channels[c][i] - palette.m_colours[p][c];
+						error += d * d;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						indices[i] = static_cast<uint8_t>(p);
+					}
+				}
+				totalError += bestError;
+			}
+			return totalError;
+#endif
+		}
+
+		// min/max of each channel, channels that decrease as channel 0 increases are flipped
+		void GetBoundingBoxEndpoints(const BlockPixels& px, uint32_t channels, float e0[4], float e1[4])
+		{
+			float mean[4] = { 0 };
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				e0[c] = *std::min_element(px.m_channels[c], px.m_channels[c] + 16);
+				e1[c] = *std::max_element(px.m_channels[c], px.m_channels[c] + 16);
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					mean[c] += px.m_channels[c][i] / 16.0f;
+				}
+			}
+			for (uint32_t c = 1; c < channels; ++c)
+			{
+				float covariance = 0.0f;
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					covariance += (px.m_channels[0][i] - mean[0]) * (px.m_channels[c][i] - mean[c]);
+				}
+				if (covariance < 0.0f)
+				{
+					std::swap(e0[c], e1[c]);
+				}
+			}
+		}
+
+		// endpoints at the extents of the pixels projected onto their principal axis
+		void GetPrincipalAxisEndpoints(const BlockPixels& px, uint32_t channels, float e0[4], float e1[4])
+		{
+			float mean[4] = { 0 };
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					mean[c] += px.m_channels[c][i] / 16.0f;
+				}
+			}
+			float covariance[4][4] = { { 0 } };
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				for (uint32_t a = 0; a < channels; ++a)
+				{
+					for (uint32_t b = 0; b < channels; ++b)
+					{
+						covariance[a][b] += (px.m_channels[a][i] - mean[a]) * (px.m_channels[b][i] - mean[b]);
+					}
+				}
+			}
+
+			// power iteration, starting from the row with the most variance
+			uint32_t largestRow = 0;
+			for (uint32_t c = 1; c < channels; ++c)
+			{
+				largestRow = covariance[c][c] > covariance[largestRow][largestRow] ? c : largestRow;
+			}
+			float axis[4] = { 0 };
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				axis[c] = covariance[largestRow][c];
+			}
+			for (uint32_t iteration = 0; iteration < 8; ++iteration)
+			{
+				float newAxis[4] = { 0 };
+				float largest = 0.0f;
+				for (uint32_t a = 0; a < channels; ++a)
+				{
+					for (uint32_t b = 0; b < channels; ++b)
+					{
+						newAxis[a] += covariance[a][b] * axis[b];
+					}
+					largest = std::max(largest, std::abs(newAxis[a]));
+				}
+				if (largest == 0.0f)
+				{
+					break;
+				}
+				for (uint32_t c = 0; c < channels; ++c)
+				{
+					axis[c] = newAxis[c] / largest;
+				}
+			}
+			float axisLengthSq = 0.0f;
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				axisLengthSq += axis[c] * axis[c];
+			}
+			if (axisLengthSq < 1e-8f)		// flat block
+			{
+				for (uint32_t c = 0; c < channels; ++c)
+				{
+					e0[c] = e1[c] = mean[c];
+				}
+				return;
+			}
+			float minT = std::numeric_limits<float>::max(), maxT = -std::numeric_limits<float>::max();
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				float t = 0.0f;
+				for (uint32_t c = 0; c < channels; ++c)
+				{
+					t += (px.m_channels[c][i] - mean[c]) * axis[c];
+				}
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				e0[c] = std::clamp(mean[c] + axis[c] * minT / axisLengthSq, 0.0f, 255.0f);
+				e1[c] = std::clamp(mean[c] + axis[c] * maxT / axisLengthSq, 0.0f, 255.0f);
+			}
+		}
+
+		// least squares fit of the endpoints for a set of indices, weights = interpolation factor of each index
+		bool RefineEndpoints(const BlockPixels& px, uint32_t channels, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+		{
+			float a = 0.0f, b = 0.0f, c = 0.0f;
+			float x0[4] = { 0 }, x1[4] = { 0 };
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const float w = weights[indices[i]];
+				a += (1.0f - w) * (1.0f - w);
+				b += (1.0f - w) * w;
+				c += w * w;
+				for (uint32_t ch = 0; ch < channels; ++ch)
+				{
+					x0[ch] += (1.0f - w) * px.m_channels[ch][i];
+					x1[ch] += w * px.m_channels[ch][i];
+				}
+			}
+			const float determinant = a * c - b * b;
+			if (std::abs(determinant) < 1e-6f)
+			{
+				return false;
+			}
+			for (uint32_t ch = 0; ch < channels; ++ch)
+			{
+				e0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / determinant, 0.0f, 255.0f);
+				e1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / determinant, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		uint32_t GetRefinementIterations(CompressionQuality q)
+		{
+			return q == CompressionQuality::Fast ? 0 : (q == CompressionQuality::Normal ? 1 : 4);
+		}
+
+		uint16_t To565(const float c[4])
+		{
+			const uint32_t r = static_cast<uint32_t>(std::lround(c[0] * 31.0f / 255.0f));
+			const uint32_t g = static_cast<uint32_t>(std::lround(c[1] * 63.0f / 255.0f));
+			const uint32_t b = static_cast<uint32_t>(std::lround(c[2] * 31.0f / 255.0f));
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		void From565(uint16_t v, uint32_t result[3])
+		{
+			const uint32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+			result[0] = (r << 3) | (r >> 2);
+			result[1] = (g << 2) | (g >> 4);
+			result[2] = (b << 3) | (b >> 2);
+		}
+
+		// 4 colour mode palette (c0 > c1, or any order in BC3)
+		void MakeBC1Palette(uint16_t c0, uint16_t c1, Palette& palette)
+		{
+			uint32_t p0[3], p1[3];
+			From565(c0, p0);
+			From565(c1, p1);
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				palette.m_colours[0][c] = static_cast<float>(p0[c]);
+				palette.m_colours[1][c] = static_cast<float>(p1[c]);
+				palette.m_colours[2][c] = static_cast<float>((2 * p0[c] + p1[c]) / 3);
+				palette.m_colours[3][c] = static_cast<float>((p0[c] + 2 * p1[c]) / 3);
+			}
+			palette.m_count = 4;
+		}
+
+		void EncodeBC1Colour(const BlockPixels& px, CompressionQuality q, uint8_t* out)
+		{
+			float e0[4], e1[4];
+			if (q == CompressionQuality::Fast)
+			{
+				GetBoundingBoxEndpoints(px, 3, e0, e1);
+			}
+			else
+			{
+				GetPrincipalAxisEndpoints(px, 3, e0, e1);
+			}
+			uint16_t bestC0 = To565(e0), bestC1 = To565(e1);
+			uint8_t bestIndices[16];
+			Palette palette;
+			MakeBC1Palette(bestC0, bestC1, palette);
+			float bestError = FitIndices(px, palette, 3, bestIndices);
+			const uint32_t iterations = GetRefinementIterations(q);
+			for (uint32_t i = 0; i < iterations && bestError > 0.0f; ++i)
+			{
+				if (!RefineEndpoints(px, 3, bestIndices, c_bc1Weights, e0, e1))
+				{
+					break;
+				}
+				const uint16_t c0 = To565(e0), c1 = To565(e1);
+				if (c0 == bestC0 && c1 == bestC1)
+				{
+					break;
+				}
+				uint8_t indices[16];
+				MakeBC1Palette(c0, c1, palette);
+				const float error = FitIndices(px, palette, 3, indices);
+				if (error >= bestError)
+				{
+					break;
+				}
+				bestError = error;
+				bestC0 = c0;
+				bestC1 = c1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			// c0 > c1 selects 4 colour mode
+			if (bestC0 < bestC1)
+			{
+				std::swap(bestC0, bestC1);
+				for (auto& index : bestIndices)
+				{
+					index ^= 1;
+				}
+			}
+			else if (bestC0 == bestC1)
+			{
+				memset(bestIndices, 0, sizeof(bestIndices));
+			}
+			uint32_t packedIndices = 0;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				packedIndices |= static_cast<uint32_t>(bestIndices[i]) << (i * 2);
+			}
+			memcpy(out, &bestC0, 2);
+			memcpy(out + 2, &bestC1, 2);
+			memcpy(out + 4, &packedIndices, 4);
+		}
+
+		void MakeBC4Palette(uint32_t e0, uint32_t e1, Palette& palette)
+		{
+			palette.m_colours[0][0] = static_cast<float>(e0);
+			palette.m_colours[1][0] = static_cast<float>(e1);
+			if (e0 > e1)
+			{
+				for (uint32_t i = 1; i < 7; ++i)
+				{
+					palette.m_colours[i + 1][0] = static_cast<float>(((7 - i) * e0 + i * e1 + 3) / 7);
+				}
+			}
+			else
+			{
+				for (uint32_t i = 1; i < 5; ++i)
+				{
+					palette.m_colours[i + 1][0] = static_cast<float>(((5 - i) * e0 + i * e1 + 2) / 5);
+				}
+				palette.m_colours[6][0] = 0.0f;
+				palette.m_colours[7][0] = 255.0f;
+			}
+			palette.m_count = 8;
+		}
+
+		// encodes channel 0 of the pixels
+		void EncodeBC4(const BlockPixels& px, CompressionQuality q, uint8_t* out)
+		{
+			const float* values = px.m_channels[0];
+			const uint32_t minValue = static_cast<uint32_t>(*std::min_element(values, values + 16));
+			const uint32_t maxValue = static_cast<uint32_t>(*std::max_element(values, values + 16));
+			Palette palette;
+			uint32_t bestE0 = maxValue, bestE1 = minValue;
+			uint8_t bestIndices[16];
+			MakeBC4Palette(bestE0, bestE1, palette);
+			float bestError = FitIndices(px, palette, 1, bestIndices);
+			auto tryEndpoints = [&](uint32_t e0, uint32_t e1) {
+				uint8_t indices[16];
+				MakeBC4Palette(e0, e1, palette);
+				const float error = FitIndices(px, palette, 1, indices);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestE0 = e0;
+					bestE1 = e1;
+					memcpy(bestIndices, indices, sizeof(indices));
+				}
+			};
+			if (q != CompressionQuality::Fast && bestError > 0.0f)
+			{
+				// 6 value mode has explicit 0 + 255, so the endpoints only need to cover the other values
+				uint32_t innerMin = 255, innerMax = 0;
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					const uint32_t v = static_cast<uint32_t>(values[i]);
+					if (v != 0 && v != 255)
+					{
+						innerMin = std::min(innerMin, v);
+						innerMax = std::max(innerMax, v);
+					}
+				}
+				if (innerMin <= innerMax)
+				{
+					tryEndpoints(innerMin, innerMax);
+				}
+			}
+			if (q == CompressionQuality::High && bestError > 0.0f && maxValue - minValue > 8)
+			{
+				// pulling the endpoints in slightly can reduce the error for the values in between
+				for (uint32_t insetMax = 0; insetMax < 4; ++insetMax)
+				{
+					for (uint32_t insetMin = 0; insetMin < 4; ++insetMin)
+					{
+						tryEndpoints(maxValue - insetMax, minValue + insetMin);
+					}
+				}
+			}
+			uint64_t packed = bestE0 | (bestE1 << 8);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				packed |= static_cast<uint64_t>(bestIndices[i]) << (16 + i * 3);
+			}
+			memcpy(out, &packed, 8);
+		}
+
+		void EncodeBC4Channel(const BlockPixels& px, uint32_t channel, CompressionQuality q, uint8_t* out)
+		{
+			BlockPixels singleChannel;
+			memcpy(singleChannel.m_channels[0], px.m_channels[channel], sizeof(singleChannel.m_channels[0]));
+			EncodeBC4(singleChannel, q, out);
+		}
+
+		// quantised mode 6 endpoints, values are 7 bits + p-bit
+		struct BC7Endpoints
+		{
+			uint32_t m_e0[4];
+			uint32_t m_e1[4];
+			uint32_t m_p0;
+			uint32_t m_p1;
+		};
+
+		void MakeBC7Palette(const BC7Endpoints& e, Palette& palette)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t v0 = (e.m_e0[c] << 1) | e.m_p0;
+				const uint32_t v1 = (e.m_e1[c] << 1) | e.m_p1;
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					palette.m_colours[i][c] = static_cast<float>(((64 - c_bc7Weights4[i]) * v0 + c_bc7Weights4[i] * v1 + 32) >> 6);
+				}
+			}
+			palette.m_count = 16;
+		}
+
+		uint32_t QuantiseBC7(float v, uint32_t pBit)
+		{
+			return static_cast<uint32_t>(std::clamp(std::lround((v - pBit) / 2.0f), 0l, 127l));
+		}
+
+		float GetQuantisationErrorBC7(const float e[4], uint32_t pBit)
+		{
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const float d = e[c] - static_cast<float>((QuantiseBC7(e[c], pBit) << 1) | pBit);
+				error += d * d;
+			}
+			return error;
+		}
+
+		// finds the best quantisation of the endpoints + the indices, returns the error
+		float FitBC7Mode6(const BlockPixels& px, const float e0[4], const float e1[4], bool searchPBits, BC7Endpoints& result, uint8_t indices[16])
+		{
+			float bestError = std::numeric_limits<float>::max();
+			Palette palette;
+			for (uint32_t pBits = 0; pBits < 4; ++pBits)
+			{
+				BC7Endpoints candidate;
+				candidate.m_p0 = pBits & 1;
+				candidate.m_p1 = pBits >> 1;
+				if (!searchPBits)	// use the p-bit with the lowest quantisation error for each endpoint
+				{
+					candidate.m_p0 = GetQuantisationErrorBC7(e0, 1) < GetQuantisationErrorBC7(e0, 0) ? 1 : 0;
+					candidate.m_p1 = GetQuantisationErrorBC7(e1, 1) < GetQuantisationErrorBC7(e1, 0) ? 1 : 0;
+				}
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					candidate.m_e0[c] = QuantiseBC7(e0[c], candidate.m_p0);
+					candidate.m_e1[c] = QuantiseBC7(e1[c], candidate.m_p1);
+				}
+				uint8_t candidateIndices[16];
+				MakeBC7Palette(candidate, palette);
+				const float error = FitIndices(px, palette, 4, candidateIndices);
+				if (error < bestError)
+				{
+					bestError = error;
+					result = candidate;
+					memcpy(indices, candidateIndices, sizeof(candidateIndices));
+				}
+				if (!searchPBits)
+				{
+					break;
+				}
+			}
+			return bestError;
+		}
+
+		void EncodeBC7(const BlockPixels& px, CompressionQuality q, uint8_t* out)
+		{
+			float e0[4], e1[4];
+			if (q == CompressionQuality::Fast)
+			{
+				GetBoundingBoxEndpoints(px, 4, e0, e1);
+			}
+			else
+			{
+				GetPrincipalAxisEndpoints(px, 4, e0, e1);
+			}
+			const bool searchPBits = q == CompressionQuality::High;
+			BC7Endpoints best;
+			uint8_t bestIndices[16];
+			float bestError = FitBC7Mode6(px, e0, e1, searchPBits, best, bestIndices);
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				weights[i] = c_bc7Weights4[i] / 64.0f;
+			}
+			const uint32_t iterations = GetRefinementIterations(q);
+			for (uint32_t i = 0; i < iterations && bestError > 0.0f; ++i)
+			{
+				if (!RefineEndpoints(px, 4, bestIndices, weights, e0, e1))
+				{
+					break;
+				}
+				BC7Endpoints candidate;
+				uint8_t indices[16];
+				const float error = FitBC7Mode6(px, e0, e1, searchPBits, candidate, indices);
+				if (error >= bestError)
+				{
+					break;
+				}
+				bestError = error;
+				best = candidate;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			// the msb of the first index is implicitly 0, swap the endpoints if required
+			if (bestIndices[0] & 8)
+			{
+				std::swap(best.m_e0, best.m_e1);
+				std::swap(best.m_p0, best.m_p1);
+				for (auto& index : bestIndices)
+				{
+					index = 15 - index;
+				}
+			}
+			memset(out, 0, 16);
+			BitWriter bits = { out };
+			bits.Write(1 << 6, 7);		// mode 6
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				bits.Write(best.m_e0[c], 7);
+				bits.Write(best.m_e1[c], 7);
+			}
+			bits.Write(best.m_p0, 1);
+			bits.Write(best.m_p1, 1);
+			bits.Write(bestIndices[0], 3);
+			for (uint32_t i = 1; i < 16; ++i)
+			{
+				bits.Write(bestIndices[i], 4);
+			}
+		}
+
+		bool CompressImage(const uint8_t* rgba, uint32_t w, uint32_t h, Format f, CompressionQuality q, std::span<uint8_t> output)
+		{
+			R3_PROF_EVENT();
+			if (!IsBlockCompressed(f) || f == Format::RGBA_BC2)
+			{
+				LogError("Format {} is not supported by the texture compressor", FormatToString(f));
+				return false;
+			}
+			if (w == 0 || h == 0 || output.size() < GetCompressedSizeBytes(w, h, f))
+			{
+				LogError("Bad size passed to texture compressor ({}x{}, {} bytes output)", w, h, output.size());
+				return false;
+			}
+			const uint32_t blocksX = (w + 3) / 4;
+			const uint32_t blocksY = (h + 3) / 4;
+			const uint32_t blockBytes = GetBlockBytes(f);
+			auto compressRow = [&](uint32_t blockY) {
+				BlockPixels px;
+				uint8_t* dst = output.data() + static_cast<size_t>(blockY) * blocksX * blockBytes;
+				for (uint32_t blockX = 0; blockX < blocksX; ++blockX, dst += blockBytes)
+				{
+					LoadBlock(rgba, w, h, blockX, blockY, px);
+					switch (f)
+					{
+					case Format::RGBA_BC1:
+						EncodeBC1Colour(px, q, dst);
+						break;
+					case Format::RGBA_BC3:
+						EncodeBC4Channel(px, 3, q, dst);
+						EncodeBC1Colour(px, q, dst + 8);
+						break;
+					case Format::R_BC4:
+						EncodeBC4(px, q, dst);
+						break;
+					case Format::RG_BC5:
+						EncodeBC4(px, q, dst);
+						EncodeBC4Channel(px, 1, q, dst + 8);
+						break;
+					case Format::RGBA_BC7:
+						EncodeBC7(px, q, dst);
+						break;
+					default:
+						break;
+					}
+				}
+			};
+			auto jobs = Systems::GetSystem<JobSystem>();
+			if (jobs && blocksY > 1)
+			{
+				const int rowsPerJob = static_cast<int>(std::max(1u, c_blocksPerJob / blocksX));
+				jobs->ForEachAsync(JobSystem::ThreadPool::SlowJobs, 0, blocksY, 1, rowsPerJob, compressRow);
+			}
+			else
+			{
+				for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+				{
+					compressRow(blockY);
+				}
+			}
+			return true;
+		}
+
+		void DecodeBC1Colour(const uint8_t* block, bool forceFourColours, uint8_t result[16][4])
+		{
+			uint16_t c0, c1;
+			uint32_t packedIndices;
+			memcpy(&c0, block, 2);
+			memcpy(&c1, block + 2, 2);
+			memcpy(&packedIndices, block + 4, 4);
+			uint32_t p[4][4];
+			From565(c0, p[0]);
+			From565(c1, p[1]);
+			p[0][3] = p[1][3] = p[2][3] = p[3][3] = 255;
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				if (c0 > c1 || forceFourColours)
+				{
+					p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+					p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+				}
+				else
+				{
+					p[2][c] = (p[0][c] + p[1][c]) / 2;
+					p[3][c] = 0;
+				}
+			}
+			if (c0 <= c1 && !forceFourColours)
+			{
+				p[3][3] = 0;
+			}
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t index = (packedIndices >> (i * 2)) & 3;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					result[i][c] = static_cast<uint8_t>(p[index][c]);
+				}
+			}
+		}
+
+		void DecodeBC4(const uint8_t* block, uint8_t result[16][4], uint32_t channel)
+		{
+			uint64_t packed;
+			memcpy(&packed, block, 8);
+			Palette palette;
+			MakeBC4Palette(packed & 0xff, (packed >> 8) & 0xff, palette);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				result[i][channel] = static_cast<uint8_t>(palette.m_colours[(packed >> (16 + i * 3)) & 7][0]);
+			}
+		}
+
+		bool DecodeBC7(const uint8_t* block, uint8_t result[16][4])
+		{
+			BitReader bits = { block };
+			if (bits.Read(7) != (1 << 6))
+			{
+				return false;	// only mode 6 is supported
+			}
+			BC7Endpoints e;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				e.m_e0[c] = bits.Read(7);
+				e.m_e1[c] = bits.Read(7);
+			}
+			e.m_p0 = bits.Read(1);
+			e.m_p1 = bits.Read(1);
+			Palette palette;
+			MakeBC7Palette(e, palette);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t index = bits.Read(i == 0 ? 3 : 4);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					result[i][c] = static_cast<uint8_t>(palette.m_colours[index][c]);
+				}
+			}
+			return true;
+		}
+
+		bool DecompressImage(const uint8_t* blocks, uint32_t w, uint32_t h, Format f, std::span<uint8_t> rgba)
+		{
+			R3_PROF_EVENT();
+			if (!IsBlockCompressed(f) || f == Format::RGBA_BC2 || rgba.size() < static_cast<size_t>(w) * h * 4)
+			{
+				return false;
+			}
+			const uint32_t blocksX = (w + 3) / 4;
+			const uint32_t blocksY = (h + 3) / 4;
+			const uint32_t blockBytes = GetBlockBytes(f);
+			for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+			{
+				for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+				{
+					const uint8_t* block = blocks + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+					uint8_t decoded[16][4];
+					for (auto& px : decoded)
+					{
+						px[0] = px[1] = px[2] = 0;
+						px[3] = 255;
+					}
+					switch (f)
+					{
+					case Format::RGBA_BC1:
+						DecodeBC1Colour(block, false, decoded);
+						break;
+					case Format::RGBA_BC3:
+						DecodeBC1Colour(block + 8, true, decoded);
+						DecodeBC4(block, decoded, 3);
+						break;
+					case Format::R_BC4:
+						DecodeBC4(block, decoded, 0);
+						break;
+					case Format::RG_BC5:
+						DecodeBC4(block, decoded, 0);
+						DecodeBC4(block + 8, decoded, 1);
+						break;
+					case Format::RGBA_BC7:
+						if (!DecodeBC7(block, decoded))
+						{
+							return false;
+						}
+						break;
+					default:
+						break;
+					}
+					for (uint32_t y = 0; y < 4 && blockY * 4 + y < h; ++y)
+					{
+						for (uint32_t x = 0; x < 4 && blockX * 4 + x < w; ++x)
+						{
+							memcpy(rgba.data() + ((static_cast<size_t>(blockY) * 4 + y) * w + blockX * 4 + x) * 4, decoded[y * 4 + x], 4);
+						}
+					}
+				}
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "textures.h"
+#include <span>
+#include <stdint.h>
+
+// Block compression for baked textures (BC1, BC3, BC4, BC5, BC7)
+// Input is always RGBA8, BC4 encodes R, BC5 encodes RG, BC1 ignores alpha
+// BC7 only uses mode 6 (1 subset, RGBA endpoints), good for most colour textures but weaker on blocks with very different colours
+// Block rows are compressed in parallel via the JobSystem if it exists (runs on the calling thread otherwise)
+namespace R3
+{
+	namespace Textures
+	{
+		enum class CompressionQuality
+		{
+			Fast,		// bounding box endpoints, no refinement
+			Normal,		// principal axis endpoints + 1 least squares refinement
+			High		// principal axis endpoints + more refinement, exhaustive BC7 p-bits
+		};
+		std::string_view QualityToString(CompressionQuality q);
+
+		bool IsBlockCompressed(Format f);
+		uint64_t GetCompressedSizeBytes(uint32_t w, uint32_t h, Format f);	// w, h are rounded up to whole blocks
+
+		// rgba = w * h * 4 bytes, output must be at least GetCompressedSizeBytes(w, h, f)
+		bool CompressImage(const uint8_t* rgba, uint32_t w, uint32_t h, Format f, CompressionQuality q, std::span<uint8_t> output);
+
+		// decodes the blocks written by CompressImage to rgba (w * h * 4 bytes), used to validate the compressor
+		// BC4 decodes to (R,0,0,255), BC5 to (R,G,0,255), BC7 only supports mode 6
+		bool DecompressImage(const uint8_t* blocks, uint32_t w, uint32_t h, Format f, std::span<uint8_t> rgba);
+	}
+}
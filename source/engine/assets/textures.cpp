@@ -1,10 +1,13 @@
 #include "textures.h"
 #include "dds_loader.h"
+#include "bake_cache.h"
+#include "texture_compressor.h"
+#include "mip_generator.h"
 #include "core/file_io.h"
 #include "core/log.h"
 #include "core/profiler.h"
-#include "core/run_external_process.h"
 #include <stb_image.h>
+#include <nlohmann/json.hpp>
 #include <algorithm>
 #include <filesystem>
 
@@ -12,6 +15,63 @@ namespace R3
 {
 	namespace Textures
 	{
+		const uint32_t c_bakedTextureVersion = 3;		// change this to force rebake (part of the bake cache key)
+		const std::string c_bakeSettingsExtension = ".bakesettings.json";
+
+		struct TextureBakeSettings
+		{
+			CompressionQuality m_quality = CompressionQuality::Normal;
+			bool m_generateMips = true;
+			MipChainSettings m_mips;
+		};
+
+		std::string GetBakeSettingsPath(std::string_view pathName)
+		{
+			return std::string(pathName) + c_bakeSettingsExtension;
+		}
+
+		bool LoadBakeSettings(std::string_view pathName, TextureBakeSettings& target)
+		{
+			R3_PROF_EVENT();
+			std::string jsonText;
+			const std::string bakeSettingsPath = GetBakeSettingsPath(pathName);
+			if (!std::filesystem::exists(bakeSettingsPath) || !FileIO::LoadTextFromFile(bakeSettingsPath, jsonText))
+			{
+				return false;
+			}
+			auto parsedSettings = nlohmann::json::parse(jsonText, nullptr, false);
+			if (parsedSettings.is_discarded())
+			{
+				LogWarn("Failed to parse texture bake settings {}", bakeSettingsPath);
+				return false;
+			}
+			if (parsedSettings.contains("CompressionQuality"))
+			{
+				const std::string quality = parsedSettings["CompressionQuality"];
+				for (auto q : { CompressionQuality::Fast, CompressionQuality::Normal, CompressionQuality::High })
+				{
+					target.m_quality = QualityToString(q) == quality ? q : target.m_quality;
+				}
+			}
+			if (parsedSettings.contains("GenerateMips"))
+				target.m_generateMips = parsedSettings["GenerateMips"];
+			if (parsedSettings.contains("MipFilter"))
+				target.m_mips.m_filter = parsedSettings["MipFilter"] == "Box" ? MipFilter::Box : MipFilter::Kaiser;
+			if (parsedSettings.contains("IsNormalMap"))
+				target.m_mips.m_isNormalMap = parsedSettings["IsNormalMap"];
+			if (parsedSettings.contains("IsSRGB"))
+				target.m_mips.m_isSRGB = parsedSettings["IsSRGB"];
+			return true;
+		}
+
+		// used when the bake settings do not say, e.g. "brick_normal.png", "brick_n.png", "brick_nrm.png"
+		bool LooksLikeNormalMap(std::string_view pathName)
+		{
+			std::string name = std::filesystem::path(pathName).stem().string();
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return name.find("normal") != std::string::npos || name.ends_with("_n") || name.ends_with("_nrm");
+		}
+
 		bool BakeTexture(std::string_view pathName)
 		{
 			R3_PROF_EVENT();
@@ -37,41 +97,89 @@ namespace R3
 			if (stbi_info(pathName.data(), &w, &h, &srcComponents) == 0)
 			{
 				LogWarn("Failed to get texture info from {}", pathName);
-				return {};
+				return false;
 			}
-			// Use AMD Compressonator to bake the texture
-			bool useGPUCompression = true;
-			bool generateMips = true;
-			uint32_t mipCount = generateMips ? static_cast<uint32_t>(std::floor(std::log2(std::max(w, h)))) + 1 : 1;
-			std::string outFileType = "dds";
-			std::string outEncoding;
+			TextureBakeSettings settings;
+			settings.m_mips.m_isNormalMap = LooksLikeNormalMap(pathName);
+			settings.m_mips.m_isSRGB = srcComponents >= 3;		// 1 + 2 channel textures are usually data (roughness, etc)
+			LoadBakeSettings(pathName, settings);
+			TextureData baked;
+			baked.m_width = w;
+			baked.m_height = h;
 			switch (srcComponents)
 			{
 			case 1:
-				outEncoding = "BC4";
+				baked.m_format = Format::R_BC4;
 				break;
 			case 2:
-				outEncoding = "BC5";
+				baked.m_format = Format::RG_BC5;
 				break;
 			default:
-				outEncoding = "BC7";
+				baked.m_format = Format::RGBA_BC7;
 				break;
 			}
-			std::string mipOptions = "-nomipmap";
-			if (mipCount > 1)
-			{
-				mipOptions = std::format("-miplevels {}", mipCount);
-			}
-			const std::string c_appName = "compressonatorcli.exe";
-			std::string cmdLine = std::format("{} {} -fd {} {} {}", 
-				mipOptions,
-				useGPUCompression ? "-EncodeWith GPU" : "",
-				outEncoding,
-				std::filesystem::absolute(pathName).string(),
-				bakedPath);
-			LogInfo("Running {} {}", c_appName, cmdLine);
-			auto runBakeResult = RunProcess(c_appName, cmdLine);
-			return runBakeResult.has_value() && runBakeResult.value() != 0;
+
+			// always load as rgba, the compressor picks the channels it needs
+			unsigned char* rawData = nullptr;
+			{
+				R3_PROF_EVENT("stbi_load");
+				int components = 0;
+				rawData = stbi_load(pathName.data(), &w, &h, &components, 4);
+				if (rawData == nullptr)
+				{
+					LogError("Failed to load texture file '{}'", pathName);
+					return false;
+				}
+			}
+			std::vector<uint8_t> topMip(rawData, rawData + static_cast<size_t>(w) * h * 4);
+			stbi_image_free(rawData);
+			if (srcComponents == 2)
+			{
+				// stb expands grey + alpha to (grey, grey, grey, alpha), BC5 wants them in red + green
+				for (size_t i = 0; i < topMip.size(); i += 4)
+				{
+					topMip[i + 1] = topMip[i + 3];
+					topMip[i + 3] = 255;
+				}
+			}
+			if (srcComponents == 2 && settings.m_mips.m_isNormalMap)
+			{
+				// reconstruct z so the mips can be renormalised, only xy are stored
+				for (size_t i = 0; i < topMip.size(); i += 4)
+				{
+					const float x = topMip[i] / 127.5f - 1.0f, y = topMip[i + 1] / 127.5f - 1.0f;
+					const float z = std::sqrt(std::max(0.0f, 1.0f - x * x - y * y));
+					topMip[i + 2] = static_cast<uint8_t>(z * 127.5f + 127.5f);
+				}
+			}
+
+			// mips are filtered on the cpu + stored in the baked file, so nothing needs to be generated at runtime
+			const uint32_t mipCount = settings.m_generateMips ? static_cast<uint32_t>(std::floor(std::log2(std::max(w, h)))) + 1 : 1;
+			const auto mips = GenerateMipChain(topMip.data(), baked.m_width, baked.m_height, mipCount, settings.m_mips);
+			size_t totalSize = 0;
+			for (uint32_t mip = 0; mip < mipCount; ++mip)
+			{
+				const uint32_t mipW = std::max(1u, baked.m_width >> mip), mipH = std::max(1u, baked.m_height >> mip);
+				baked.m_mips.emplace_back(totalSize, GetCompressedSizeBytes(mipW, mipH, baked.m_format));
+				totalSize += baked.m_mips.back().m_sizeBytes;
+			}
+			baked.m_imgData.resize(totalSize);
+			bool compressed = true;
+			for (uint32_t mip = 0; mip < mipCount && compressed; ++mip)
+			{
+				const uint32_t mipW = std::max(1u, baked.m_width >> mip), mipH = std::max(1u, baked.m_height >> mip);
+				std::span<uint8_t> output(baked.m_imgData.data() + baked.m_mips[mip].m_offset, baked.m_mips[mip].m_sizeBytes);
+				compressed = CompressImage(mips[mip].data(), mipW, mipH, baked.m_format, settings.m_quality, output);
+			}
+
+			std::error_code ec;
+			std::filesystem::create_directories(std::filesystem::path(bakedPath).parent_path(), ec);
+			const bool saved = compressed && SaveTexture_DDS(bakedPath, baked);
+			if (!saved)
+			{
+				LogError("Failed to bake texture {}", pathName);
+			}
+			return saved;
 		}
 
 		std::string_view FormatToString(Format f)
@@ -119,16 +227,9 @@ namespace R3
 				return std::filesystem::absolute(relPath).string();
 			}
 
-			// replace any directory separators with '_'
-			std::replace(relPath.begin(), relPath.end(), '/', '_');
-			std::replace(relPath.begin(), relPath.end(), '\\', '_');
-
-			// add our own extension
-			relPath += ".dds";
-
-			// use the temp directory for baked data
-			std::string bakedPath = std::string(FileIO::GetBasePath()) + "\\baked\\" + relPath;
-			return std::filesystem::absolute(bakedPath).string();
+			// the key changes if the source texture, its bake settings or the baker version change
+			const uint64_t bakeKey = BakeCache::GetBakeKey(relPath, GetBakeSettingsPath(relPath), "Texture", c_bakedTextureVersion);
+			return BakeCache::GetBakedPath(relPath, bakeKey, ".dds");
 		}
 
 		std::optional<TextureData> LoadTexture_stb_image(std::string_view pathName)
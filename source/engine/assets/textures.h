@@ -1,7 +1,9 @@
 #pragma once
+#include "core/mapped_file.h"
 #include <string>
 #include <optional>
 #include <vector>
+#include <span>
 
 namespace R3
 {
@@ -28,11 +30,13 @@ namespace R3
 			uint32_t m_height = 0;
 			Format m_format = Format::RGBA_U8;
 			struct ImageData {
-				size_t m_offset = 0;		// offset into m_imgData
+				size_t m_offset = 0;		// offset into GetImageData(), not aligned (mip sizes are whole blocks/texels)
 				size_t m_sizeBytes = 0;
 			};
 			std::vector<ImageData> m_mips;
-			std::vector<uint8_t> m_imgData;
+			std::vector<uint8_t> m_imgData;		// owned image data, empty if the texture was mapped from a file
+			MappedFile m_mappedFile;			// the mapped source file (DDS), mip offsets are into the whole file
+			std::span<const uint8_t> GetImageData() const { return m_mappedFile.IsOpen() ? m_mappedFile.GetData() : std::span<const uint8_t>(m_imgData); }
 		};
 
 		// Helpers for loading + baking textures	
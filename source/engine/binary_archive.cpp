@@ -0,0 +1,128 @@
+#include "binary_archive.h"
+
+namespace R3
+{
+	BinaryArchive::BinaryArchive(const uint8_t* data, size_t dataSize)
+		: m_readData(data)
+		, m_readSize(dataSize)
+	{
+	}
+
+	BinaryArchive::BinaryArchive(std::vector<uint8_t>&& data)
+		: m_ownedReadData(std::move(data))
+	{
+		m_readData = m_ownedReadData.data();
+		m_readSize = m_ownedReadData.size();
+	}
+
+	size_t BinaryArchive::BeginField(uint32_t fieldID)
+	{
+		const size_t fieldOffset = m_writeData.size();
+		WriteBytes(&fieldID, sizeof(fieldID));
+		BeginBlock();
+		return fieldOffset;
+	}
+
+	size_t BinaryArchive::BeginBlock()
+	{
+		const size_t blockOffset = m_writeData.size();
+		m_writeData.push_back(0);	// the size is patched in EndBlock, most blocks are small enough for a single byte varint
+		return blockOffset;
+	}
+
+	void BinaryArchive::EndBlock(size_t blockOffset)
+	{
+		uint64_t blockSize = m_writeData.size() - blockOffset - 1;
+		uint8_t sizeBytes[10];
+		uint32_t sizeLength = 0;
+		do
+		{
+			sizeBytes[sizeLength++] = static_cast<uint8_t>(blockSize & 0x7f) | (blockSize >= 0x80 ? 0x80 : 0);
+			blockSize >>= 7;
+		} while (blockSize > 0);
+		if (sizeLength > 1)		// make room for the bigger size
+		{
+			m_writeData.insert(m_writeData.begin() + blockOffset + 1, sizeLength - 1, 0);
+		}
+		memcpy(m_writeData.data() + blockOffset, sizeBytes, sizeLength);
+	}
+
+	void BinaryArchive::WriteVarint(uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			m_writeData.push_back(static_cast<uint8_t>(v) | 0x80);
+			v >>= 7;
+		}
+		m_writeData.push_back(static_cast<uint8_t>(v));
+	}
+
+	void BinaryArchive::WriteBytes(const void* src, size_t size)
+	{
+		const uint8_t* srcBytes = static_cast<const uint8_t*>(src);
+		m_writeData.insert(m_writeData.end(), srcBytes, srcBytes + size);
+	}
+
+	bool BinaryArchive::FindField(const Range& object, size_t& cursor, uint32_t fieldID, Range& payload) const
+	{
+		// fields are usually read in the order they were written, so start at the cursor + wrap around
+		auto searchRange = [&](size_t offset, size_t end) {
+			while (offset < end)
+			{
+				uint32_t thisID = 0;
+				ReadBytes(offset, object.m_end, &thisID, sizeof(thisID));
+				const Range thisPayload = ReadBlock(offset, object.m_end);
+				if (thisID == fieldID)
+				{
+					payload = thisPayload;
+					cursor = thisPayload.m_end;
+					return true;
+				}
+				offset = thisPayload.m_end;
+			}
+			return false;
+		};
+		return searchRange(cursor, object.m_end) || searchRange(object.m_begin, cursor);
+	}
+
+	BinaryArchive::Range BinaryArchive::ReadBlock(size_t& offset, size_t end) const
+	{
+		const uint64_t blockSize = ReadVarint(offset, end);
+		if (blockSize > end - offset)
+		{
+			throw std::runtime_error("Block size out of range");
+		}
+		const Range block = { offset, offset + blockSize };
+		offset += blockSize;
+		return block;
+	}
+
+	uint64_t BinaryArchive::ReadVarint(size_t& offset, size_t end) const
+	{
+		uint64_t result = 0;
+		for (uint32_t shift = 0; shift < 64; shift += 7)
+		{
+			if (offset >= end)
+			{
+				throw std::runtime_error("Varint out of range");
+			}
+			const uint8_t b = m_readData[offset++];
+			result |= static_cast<uint64_t>(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+			{
+				return result;
+			}
+		}
+		throw std::runtime_error("Varint is too long");
+	}
+
+	void BinaryArchive::ReadBytes(size_t& offset, size_t end, void* dst, size_t size) const
+	{
+		if (end > m_readSize || offset > end || size > end - offset)
+		{
+			throw std::runtime_error("Read out of range");
+		}
+		memcpy(dst, m_readData + offset, size);
+		offset += size;
+	}
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <stdexcept>
+#include <cstring>
+#include <stdint.h>
+
+namespace R3
+{
+	// Compact binary backend for JsonSerialiser, pass an archive to a serialiser to use it (see serialiser.h)
+	// Objects are stored as a list of fields: [uint32 field id][varint payload size][payload]
+	// Field IDs are a hash of the field name, so fields can be added, removed or reordered and old data still loads
+	// Ints are varints (zigzag encoded if signed), floats are raw, strings + arrays are prefixed with a varint count
+	// Not human readable! Use it for data that only the engine reads (undo, clone, prefabs, binary saves)
+	class BinaryArchive
+	{
+	public:
+		struct Range	// [m_begin, m_end) byte offsets into the data
+		{
+			size_t m_begin = 0;
+			size_t m_end = 0;
+		};
+
+		BinaryArchive() = default;									// for writing
+		BinaryArchive(const uint8_t* data, size_t dataSize);		// for reading, data must outlive the archive
+		BinaryArchive(std::vector<uint8_t>&& data);				// for reading, takes ownership of the data
+		BinaryArchive(BinaryArchive&&) = default;
+		BinaryArchive& operator=(BinaryArchive&&) = default;
+		BinaryArchive(const BinaryArchive&) = delete;				// read data may point into our own buffer
+		BinaryArchive& operator=(const BinaryArchive&) = delete;
+
+		std::vector<uint8_t>& GetData() { return m_writeData; }	// the written data
+		const uint8_t* GetReadData() const { return m_readData; }
+		size_t GetReadSize() const { return m_readSize; }
+		Range GetRootRange() const { return { 0, m_readSize }; }
+		static constexpr uint32_t FieldID(std::string_view name);	// FNV-1a hash of the name
+
+		// Writing
+		size_t BeginField(uint32_t fieldID);		// returns the offset of the field, pass it to EndField once the payload is written
+		void EndField(size_t fieldOffset) { EndBlock(fieldOffset + sizeof(uint32_t)); }
+		size_t BeginBlock();						// size prefixed block of data
+		void EndBlock(size_t blockOffset);			// patches the size, moves the block if the size needs more than 1 byte
+		void WriteVarint(uint64_t v);
+		void WriteBytes(const void* src, size_t size);
+		template<class T> void Write(const T& v);	// ints, floats, bools, strings
+
+		// Reading, everything is bounds checked and throws std::runtime_error on bad data
+		// FindField searches the fields in 'object' starting at cursor, the cursor is moved past the field if it is found
+		bool FindField(const Range& object, size_t& cursor, uint32_t fieldID, Range& payload) const;
+		Range ReadBlock(size_t& offset, size_t end) const;
+		uint64_t ReadVarint(size_t& offset, size_t end) const;
+		void ReadBytes(size_t& offset, size_t end, void* dst, size_t size) const;
+		template<class T> void Read(size_t& offset, size_t end, T& v) const;
+
+	private:
+		std::vector<uint8_t> m_writeData;
+		std::vector<uint8_t> m_ownedReadData;
+		const uint8_t* m_readData = nullptr;
+		size_t m_readSize = 0;
+	};
+
+	constexpr uint32_t BinaryArchive::FieldID(std::string_view name)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : name)
+		{
+			hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+		}
+		return hash;
+	}
+
+	template<class T>
+	void BinaryArchive::Write(const T& v)
+	{
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			m_writeData.push_back(v ? 1 : 0);
+		}
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+		{
+			const int64_t s = static_cast<int64_t>(v);
+			WriteVarint((static_cast<uint64_t>(s) << 1) ^ static_cast<uint64_t>(s >> 63));	// zigzag, small negative values stay small
+		}
+		else if constexpr (std::is_integral_v<T>)
+		{
+			WriteVarint(static_cast<uint64_t>(v));
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			WriteBytes(&v, sizeof(v));
+		}
+		else if constexpr (std::is_same_v<T, std::string>)
+		{
+			WriteVarint(v.size());
+			WriteBytes(v.data(), v.size());
+		}
+		else
+		{
+			static_assert(!sizeof(T), "Unsupported type");
+		}
+	}
+
+	template<class T>
+	void BinaryArchive::Read(size_t& offset, size_t end, T& v) const
+	{
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			uint8_t b = 0;
+			ReadBytes(offset, end, &b, 1);
+			v = b != 0;
+		}
+		else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+		{
+			const uint64_t z = ReadVarint(offset, end);
+			v = static_cast<T>(static_cast<int64_t>(z >> 1) ^ -static_cast<int64_t>(z & 1));
+		}
+		else if constexpr (std::is_integral_v<T>)
+		{
+			v = static_cast<T>(ReadVarint(offset, end));
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			ReadBytes(offset, end, &v, sizeof(v));
+		}
+		else if constexpr (std::is_same_v<T, std::string>)
+		{
+			const uint64_t length = ReadVarint(offset, end);
+			if (length > end - offset)
+			{
+				throw std::runtime_error("String length out of range");
+			}
+			v.assign(reinterpret_cast<const char*>(m_readData + offset), length);
+			offset += length;
+		}
+		else
+		{
+			static_assert(!sizeof(T), "Unsupported type");
+		}
+	}
+}
@@ -7,8 +7,14 @@ namespace R3
 	{
 	public:
 		static std::string_view GetTypeName() { return "Camera"; }
-		static void RegisterScripts(class LuaSystem&);
-		void SerialiseJson(JsonSerialiser& s);
+		static constexpr auto GetFields()	// serialisation + scripts are generated from these
+		{
+			return std::make_tuple(
+				R3_FIELD(CameraComponent, m_nearPlane, "Near Plane"),
+				R3_FIELD(CameraComponent, m_farPlane, "Far Plane"),
+				R3_FIELD(CameraComponent, m_fov, "FOV")
+			);
+		}
 		void Inspect(const Entities::EntityHandle& e, Entities::World* w, ValueInspector& i);
 
 		float m_nearPlane = 0.1f;
@@ -7,9 +7,15 @@ namespace R3
 	{
 	public:
 		static std::string_view GetTypeName() { return "PointLight"; }
-		static void RegisterScripts(class LuaSystem&);
-		void SerialiseJson(JsonSerialiser& s);
-		void Inspect(const Entities::EntityHandle& e, Entities::World* w, ValueInspector& i);
+		static constexpr auto GetFields()	// serialisation, inspector + scripts are generated from these
+		{
+			return std::make_tuple(
+				R3_FIELD(PointLightComponent, m_colour, "Colour").Colour(),
+				R3_FIELD(PointLightComponent, m_brightness, "Brightness").Range(0.0f, 0.1f, 10000.0f),
+				R3_FIELD(PointLightComponent, m_distance, "Distance").Range(0.1f, 0.1f, 10000.0f),
+				R3_FIELD(PointLightComponent, m_enabled, "Enabled")
+			);
+		}
 
 		glm::vec3 m_colour = { 1,1,1 };
 		float m_distance = 8.0f;		// max distance it can cast light
@@ -8,6 +8,11 @@ namespace R3
 	{
 	public:
 		static std::string_view GetTypeName() { return "SpotLight"; }
+		static constexpr auto GetRawMembers()	// binary worlds + prefabs copy these directly
+		{
+			return std::make_tuple(&SpotLightComponent::m_colour, &SpotLightComponent::m_distance, &SpotLightComponent::m_outerAngle, &SpotLightComponent::m_innerAngle,
+				&SpotLightComponent::m_brightness, &SpotLightComponent::m_enabled, &SpotLightComponent::m_castShadows);
+		}
 		static void RegisterScripts(class LuaSystem&);
 		void SerialiseJson(JsonSerialiser& s);
 		void Inspect(const Entities::EntityHandle& e, Entities::World* w, ValueInspector& i);
@@ -108,22 +108,9 @@ namespace R3
 
 	glm::mat4 TransformComponent::GetWorldspaceInterpolated(const Entities::EntityHandle& e, Entities::World& w) const
 	{
-		glm::mat4 result;
-
 		// first calculate interpolated matrix for this transform
-		if (m_prevPosition == m_position && m_prevScale == m_scale && m_prevOrientation == m_orientation)
-		{
-			result = m_matrix;
-		}
-		else
-		{
-			static auto time = Systems::GetSystem<TimeSystem>();
-			double accumulator = time->GetFixedUpdateInterpolation();
-			const glm::vec3 pos = glm::mix(m_prevPosition, m_position, accumulator);
-			const glm::vec3 scale = glm::mix(m_prevScale, m_scale, accumulator);
-			const glm::quat rot = glm::slerp(m_prevOrientation, m_orientation, static_cast<float>(accumulator));
-			result = glm::scale(glm::translate(glm::identity<glm::mat4>(), pos) * glm::mat4_cast(rot), scale);
-		}
+		static auto time = Systems::GetSystem<TimeSystem>();
+		glm::mat4 result = GetLocalInterpolated(time->GetFixedUpdateInterpolation());
 
 		// apply parent if required
 		if (m_isRelative)
@@ -139,6 +126,18 @@ namespace R3
 		return result;
 	}
 
+	glm::mat4 TransformComponent::GetLocalInterpolated(double interpolation) const
+	{
+		if (m_prevPosition == m_position && m_prevScale == m_scale && m_prevOrientation == m_orientation)
+		{
+			return m_matrix;
+		}
+		const glm::vec3 pos = glm::mix(m_prevPosition, m_position, interpolation);
+		const glm::vec3 scale = glm::mix(m_prevScale, m_scale, interpolation);
+		const glm::quat rot = glm::slerp(m_prevOrientation, m_orientation, static_cast<float>(interpolation));
+		return glm::scale(glm::translate(glm::identity<glm::mat4>(), pos) * glm::mat4_cast(rot), scale);
+	}
+
 	void TransformComponent::StorePreviousFrameData()
 	{
 		m_prevPosition = m_position;
@@ -7,6 +7,11 @@ namespace R3
 	{
 	public:
 		static std::string_view GetTypeName() { return "Transform"; }
+		static constexpr auto GetRawMembers()	// binary worlds + prefabs copy these directly
+		{
+			return std::make_tuple(&TransformComponent::m_matrix, &TransformComponent::m_position, &TransformComponent::m_orientation, &TransformComponent::m_scale,
+				&TransformComponent::m_prevPosition, &TransformComponent::m_prevOrientation, &TransformComponent::m_prevScale, &TransformComponent::m_isRelative);
+		}
 		static void RegisterScripts(class LuaSystem&);
 		void SerialiseJson(JsonSerialiser& s);
 		void Inspect(const Entities::EntityHandle& e, Entities::World* w, ValueInspector& i);
@@ -34,9 +39,14 @@ namespace R3
 		glm::mat4 GetWorldspaceMatrix(const Entities::EntityHandle& e, Entities::World& w) const;				// no interpolation, always returns the latest value
 		glm::mat4 GetWorldspaceInterpolated(const Entities::EntityHandle& e, Entities::World& w) const;			// interpolate between the previous + current version, based on fixed delta time remaining
 
+		// Local (parent-relative) matrices, mainly used by TransformSystem to build the world matrix cache
+		const glm::mat4& GetLocalMatrix() const { return m_matrix; }
+		glm::mat4 GetLocalInterpolated(double interpolation) const;
+
 		void StorePreviousFrameData();						// called at start of fixed update, used to interpolate values! should not be public API
 
 	private:
+		friend class TransformSystem;
 		void RebuildMatrix();
 		glm::mat4 m_matrix = glm::identity<glm::mat4>();		// local -> parent transform
 		glm::vec3 m_position = { 0.0f,0.0f,0.0f };
@@ -18,6 +18,7 @@
 #include "systems/immediate_render_system.h"
 #include "systems/frame_scheduler_system.h"
 #include "systems/render_stats.h"
+#include "assets/bake_cache.h"
 #include "render/render_system.h"
 #include "entities/systems/entity_system.h"
 #include "core/platform.h"
@@ -77,6 +78,8 @@ namespace R3
 			auto& varUpdate = updateSequence.AddSequence("VariableUpdate");
 			{
 				varUpdate.AddFn("LuaSystem::RunVariableUpdateScripts");
+				varUpdate.AddFn("Entities::UpdateStreamingLoads");
+				varUpdate.AddFn("Entities::UpdateBackgroundSaves");
 				varUpdate.AddFn("Entities::RunGC");
 				varUpdate.AddFn("LightsSystem::DrawLightBounds");
 			}
@@ -97,6 +100,7 @@ namespace R3
 			}
 			{
 				auto& renderUpdate = updateSequence.AddSequence("RenderUpdate");
+				renderUpdate.AddFn("Transforms::UpdateWorldMatrices");		// must happen before anything reads cached world matrices
 				renderUpdate.AddFn("Cameras::PreRenderUpdate");
 				renderUpdate.AddFn("LightsSystem::PreRenderUpdate");
 				{
@@ -106,6 +110,7 @@ namespace R3
 					renderASyncUpdate.AddFn("LightsSystem::CollectSpotLights");
 					renderASyncUpdate.AddFn("FrameScheduler::UpdateTonemapper");
 				}
+				renderUpdate.AddFn("Textures::UpdateStreaming");			// must happen after MeshRenderer::CollectInstances reports texture usage
 				renderUpdate.AddFn("LightsSystem::CollectShadowCasters");	// must happen after CollectSpotLights / CollectPointLights
 				renderUpdate.AddFn("LightsSystem::CollectAllLightsData");
 				renderUpdate.AddFn("FrameScheduler::BuildRenderGraph");		// must happen after LightsSystem::CollectAllLightsData
@@ -175,6 +180,7 @@ namespace R3
 
 		// Shut down
 		Systems::GetInstance().Shutdown();
+		BakeCache::SaveManifest();	// source hashes + outputs used by any bakes/loads this session
 		auto shutdownResult = Platform::Shutdown();
 		assert(shutdownResult == Platform::ShutdownResult::ShutdownOK);
 		return shutdownResult == Platform::ShutdownResult::ShutdownOK ? 0 : 1;
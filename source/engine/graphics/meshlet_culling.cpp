@@ -0,0 +1,56 @@
+#include "meshlet_culling.h"
+#include "engine/assets/model_data.h"
+#include "engine/utils/frustum.h"
+#include "core/profiler.h"
+
+namespace R3
+{
+	uint32_t CullMeshlets(std::span<const ModelMeshlet> meshlets, const glm::mat4& transform, const Frustum& frustum, glm::vec3 viewPosition,
+		const VkDrawIndexedIndirectCommand& drawTemplate, VkDrawIndexedIndirectCommand* outDraws, MeshletCullingStats& stats)
+	{
+		R3_PROF_EVENT();
+		const glm::mat3 rotationScale(transform);
+		const glm::vec3 axisScales(glm::length(rotationScale[0]), glm::length(rotationScale[1]), glm::length(rotationScale[2]));
+		const float maxScale = glm::compMax(axisScales);
+
+		// normal cones are only valid for uniform scale without mirroring, skip the backface test otherwise
+		const bool testCones = glm::determinant(rotationScale) > 0.0f && (maxScale - glm::compMin(axisScales)) <= maxScale * 0.01f;
+
+		uint32_t drawCount = 0;
+		VkDrawIndexedIndirectCommand* currentDraw = nullptr;	// the draw being extended by contiguous meshlets
+		for (const ModelMeshlet& meshlet : meshlets)
+		{
+			++stats.m_meshletsTested;
+			const glm::vec3 center = glm::vec3(transform * glm::vec4(meshlet.m_center, 1.0f));
+			if (!frustum.IsSphereVisible(center, meshlet.m_radius * maxScale))
+			{
+				++stats.m_frustumCulled;
+				continue;
+			}
+			if (testCones)
+			{
+				const glm::vec3 apex = glm::vec3(transform * glm::vec4(meshlet.m_coneApex, 1.0f));
+				const glm::vec3 axis = glm::normalize(rotationScale * meshlet.m_coneAxis);
+				if (glm::dot(glm::normalize(apex - viewPosition), axis) >= meshlet.m_coneCutoff)
+				{
+					++stats.m_backfaceCulled;
+					continue;
+				}
+			}
+			stats.m_indicesDrawn += meshlet.m_indexCount;
+			if (currentDraw && currentDraw->firstIndex + currentDraw->indexCount == meshlet.m_indexDataOffset)
+			{
+				currentDraw->indexCount += meshlet.m_indexCount;
+			}
+			else
+			{
+				currentDraw = &outDraws[drawCount++];
+				*currentDraw = drawTemplate;
+				currentDraw->firstIndex = meshlet.m_indexDataOffset;
+				currentDraw->indexCount = meshlet.m_indexCount;
+			}
+		}
+		stats.m_drawsWritten += drawCount;
+		return drawCount;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "core/glm_headers.h"
+#include <vulkan/vulkan_core.h>
+#include <span>
+
+// CPU cluster culling, does not touch the device so it can be run + measured headless
+// Each meshlet is tested against the frustum (bounding sphere) and the view position (normal cone)
+// Visible meshlets that are next to each other in the index buffer are merged into a single draw
+namespace R3
+{
+	struct ModelMeshlet;
+	class Frustum;
+
+	struct MeshletCullingStats
+	{
+		uint32_t m_meshletsTested = 0;
+		uint32_t m_frustumCulled = 0;
+		uint32_t m_backfaceCulled = 0;
+		uint32_t m_indicesDrawn = 0;
+		uint32_t m_drawsWritten = 0;
+	};
+
+	// worst case number of draws written by CullMeshlets (every other meshlet visible)
+	inline uint32_t GetMaxMeshletDraws(uint32_t meshletCount) { return (meshletCount + 1) / 2; }
+
+	// writes draws for the visible meshlets of one instance to outDraws, returns the number of draws written
+	// outDraws must have space for GetMaxMeshletDraws(meshlets.size()) draws
+	// drawTemplate provides vertexOffset, firstInstance + instanceCount, indexCount + firstIndex are set from the meshlets
+	// transform = mesh space -> world space, the frustum + view position are in world space
+	uint32_t CullMeshlets(std::span<const ModelMeshlet> meshlets, const glm::mat4& transform, const Frustum& frustum, glm::vec3 viewPosition,
+		const VkDrawIndexedIndirectCommand& drawTemplate, VkDrawIndexedIndirectCommand* outDraws, MeshletCullingStats& stats);
+}
@@ -0,0 +1,217 @@
+#include "texture_residency.h"
+#include "engine/assets/textures.h"
+#include "engine/assets/texture_compressor.h"
+#include "core/profiler.h"
+#include <algorithm>
+
+namespace R3
+{
+	// a mip is only wanted if the texture covers more than half of its size on screen (i.e. the gpu would sample it)
+	constexpr float c_minImportance = 0.5f;
+
+	uint32_t TextureResidency::GetTailMip(uint32_t width, uint32_t height, uint32_t mipCount)
+	{
+		uint32_t mip = 0;
+		while (mip + 1 < mipCount && std::max(width >> mip, height >> mip) > c_minResidentSize)
+		{
+			++mip;
+		}
+		return mip;
+	}
+
+	void TextureResidency::SetTexture(uint32_t texture, uint32_t width, uint32_t height, Textures::Format format, uint32_t mipCount, bool streamable, uint32_t firstMip)
+	{
+		if (texture >= m_textures.size())
+		{
+			m_textures.resize(texture + 1);
+		}
+		TextureState& t = m_textures[texture];
+		t = {};
+		t.m_width = width;
+		t.m_height = height;
+		t.m_tailMip = streamable ? GetTailMip(width, height, mipCount) : 0;
+
+		// store the bytes of each mip + all mips after it so the size of any resident range is a single lookup
+		t.m_mipSizes.resize(mipCount + 1, 0);
+		for (int mip = (int)mipCount - 1; mip >= 0; --mip)
+		{
+			const uint32_t w = std::max(1u, width >> mip);
+			const uint32_t h = std::max(1u, height >> mip);
+			const uint64_t mipBytes = Textures::IsBlockCompressed(format) ? Textures::GetCompressedSizeBytes(w, h, format) : Textures::GetMipSizeBytes(w, h, format);
+			t.m_mipSizes[mip] = t.m_mipSizes[mip + 1] + mipBytes;
+		}
+		t.m_residentMip = mipCount;		// nothing resident until the first load completes
+		t.m_pendingMip = std::min(firstMip, t.m_tailMip);
+	}
+
+	void TextureResidency::SetResidentMip(uint32_t texture, uint32_t firstMip)
+	{
+		if (texture < m_textures.size())
+		{
+			m_textures[texture].m_residentMip = firstMip;
+			m_textures[texture].m_pendingMip = -1;
+		}
+	}
+
+	uint32_t TextureResidency::GetResidentMip(uint32_t texture) const
+	{
+		return texture < m_textures.size() ? m_textures[texture].m_residentMip : 0;
+	}
+
+	void TextureResidency::ReportUsage(uint32_t texture, float screenSizePixels)
+	{
+		if (texture < m_textures.size())
+		{
+			m_textures[texture].m_reportedSize = std::max(m_textures[texture].m_reportedSize, screenSizePixels);
+		}
+	}
+
+	uint64_t TextureResidency::GetBytes(const TextureState& t, uint32_t firstMip) const
+	{
+		return firstMip < t.m_mipSizes.size() ? t.m_mipSizes[firstMip] : 0;
+	}
+
+	uint64_t TextureResidency::GetResidentBytes() const
+	{
+		uint64_t total = 0;
+		for (const auto& t : m_textures)
+		{
+			total += GetBytes(t, t.m_residentMip);
+		}
+		return total;
+	}
+
+	uint32_t TextureResidency::GetPendingCount() const
+	{
+		return (uint32_t)std::count_if(m_textures.begin(), m_textures.end(), [](const TextureState& t) {
+			return t.m_pendingMip != -1;
+		});
+	}
+
+	void TextureResidency::Update(uint32_t maxRequests, std::vector<MipRequest>& requests)
+	{
+		R3_PROF_EVENT();
+		struct Step
+		{
+			float m_importance;
+			uint32_t m_texture;
+			uint32_t m_mip;
+		};
+		std::vector<Step> steps;
+		std::vector<uint32_t> targetMips(m_textures.size(), 0);
+		std::vector<float> usage(m_textures.size(), 0.0f);
+
+		// the tails are always resident, every other mip becomes a step with importance = screen size / mip size
+		uint64_t wantedBytes = 0;
+		for (uint32_t i = 0; i < m_textures.size(); ++i)
+		{
+			TextureState& t = m_textures[i];
+			if (t.m_reportedSize > 0.0f)
+			{
+				t.m_lastUsedSize = t.m_reportedSize;
+				t.m_framesUnused = 0;
+			}
+			else if (t.m_framesUnused <= c_framesBeforeUnused)
+			{
+				++t.m_framesUnused;
+			}
+			t.m_reportedSize = 0.0f;
+			usage[i] = t.m_framesUnused <= c_framesBeforeUnused ? t.m_lastUsedSize : 0.0f;
+			targetMips[i] = t.m_tailMip;
+			wantedBytes += GetBytes(t, t.m_tailMip);
+			const float maxDimension = (float)std::max(t.m_width, t.m_height);
+			for (int mip = (int)t.m_tailMip - 1; mip >= 0; --mip)
+			{
+				const float importance = usage[i] * (float)(1u << mip) / maxDimension;
+				if (importance <= c_minImportance)
+				{
+					break;
+				}
+				steps.push_back({ importance, i, (uint32_t)mip });
+			}
+		}
+
+		// take the most important steps that fit in the budget, a mip is only taken if all smaller mips were
+		// each mip is half as important as the next smaller one so they are always visited smallest first
+		std::sort(steps.begin(), steps.end(), [](const Step& s0, const Step& s1) {
+			if (s0.m_importance != s1.m_importance)
+			{
+				return s0.m_importance > s1.m_importance;
+			}
+			return s0.m_texture != s1.m_texture ? s0.m_texture < s1.m_texture : s0.m_mip > s1.m_mip;
+		});
+		for (const Step& s : steps)
+		{
+			const TextureState& t = m_textures[s.m_texture];
+			const uint64_t stepBytes = t.m_mipSizes[s.m_mip] - t.m_mipSizes[s.m_mip + 1];
+			if (targetMips[s.m_texture] == s.m_mip + 1 && wantedBytes + stepBytes <= m_budgetBytes)
+			{
+				targetMips[s.m_texture] = s.m_mip;
+				wantedBytes += stepBytes;
+			}
+		}
+		m_wantedBytes = wantedBytes;
+
+		// bytes resident once all pending requests complete + the extra bytes needed by all of the wanted loads
+		// resident mips that are no longer wanted are kept until the budget is needed for something else
+		uint64_t projectedBytes = 0, wantedLoadBytes = 0;
+		std::vector<uint32_t> evictions, loads;
+		for (uint32_t i = 0; i < m_textures.size(); ++i)
+		{
+			const TextureState& t = m_textures[i];
+			if (t.m_pendingMip != -1)
+			{
+				projectedBytes += GetBytes(t, t.m_pendingMip);
+				continue;
+			}
+			projectedBytes += GetBytes(t, t.m_residentMip);
+			if (t.m_residentMip < targetMips[i])
+			{
+				evictions.push_back(i);
+			}
+			else if (t.m_residentMip > targetMips[i])
+			{
+				loads.push_back(i);
+				wantedLoadBytes += GetBytes(t, targetMips[i]) - GetBytes(t, t.m_residentMip);
+			}
+		}
+
+		// evict from the least used textures first until the wanted loads fit
+		requests.clear();
+		if (projectedBytes + wantedLoadBytes > m_budgetBytes)
+		{
+			std::sort(evictions.begin(), evictions.end(), [&usage](uint32_t t0, uint32_t t1) {
+				return usage[t0] != usage[t1] ? usage[t0] < usage[t1] : t0 < t1;
+			});
+			for (uint32_t i = 0; i < evictions.size() && projectedBytes + wantedLoadBytes > m_budgetBytes && requests.size() < maxRequests; ++i)
+			{
+				TextureState& t = m_textures[evictions[i]];
+				projectedBytes -= GetBytes(t, t.m_residentMip) - GetBytes(t, targetMips[evictions[i]]);
+				t.m_pendingMip = targetMips[evictions[i]];
+				requests.push_back({ evictions[i], t.m_pendingMip });
+			}
+		}
+
+		// the most under-sampled textures are loaded first, each load waits until it fits in the budget
+		auto loadPriority = [&](uint32_t texture) {
+			const TextureState& t = m_textures[texture];
+			return usage[texture] * (float)(1u << (t.m_residentMip - 1)) / (float)std::max(t.m_width, t.m_height);
+		};
+		std::sort(loads.begin(), loads.end(), [&](uint32_t t0, uint32_t t1) {
+			const float p0 = loadPriority(t0), p1 = loadPriority(t1);
+			return p0 != p1 ? p0 > p1 : t0 < t1;
+		});
+		for (uint32_t i = 0; i < loads.size() && requests.size() < maxRequests; ++i)
+		{
+			TextureState& t = m_textures[loads[i]];
+			const uint64_t loadBytes = GetBytes(t, targetMips[loads[i]]) - GetBytes(t, t.m_residentMip);
+			if (projectedBytes + loadBytes > m_budgetBytes)
+			{
+				continue;
+			}
+			projectedBytes += loadBytes;
+			t.m_pendingMip = targetMips[loads[i]];
+			requests.push_back({ loads[i], t.m_pendingMip });
+		}
+	}
+}
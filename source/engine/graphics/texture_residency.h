@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+
+// Decides which mips of each texture should be resident on the gpu (no gpu code, the texture system does the actual loads)
+// Textures always keep their mip tail (mips <= c_minResidentSize) resident, higher mips are streamed in by priority
+// Priority of a mip = projected size of the texture on screen / size of the mip, i.e. how under-sampled the texture would be without it
+// Usage is reported every frame (e.g. by the mesh renderer), textures that are not reported for a while are treated as unused
+// If the wanted mips do not fit in the budget the least important mips are not loaded, and high mips that are not wanted are evicted
+namespace R3
+{
+	namespace Textures
+	{
+		enum class Format;
+	}
+
+	class TextureResidency
+	{
+	public:
+		struct MipRequest
+		{
+			uint32_t m_texture = 0;		// index passed to SetTexture
+			uint32_t m_firstMip = 0;	// mips [m_firstMip, mip count) should be resident
+		};
+		static constexpr uint32_t c_minResidentSize = 128;		// mips this size or smaller are always resident
+		static constexpr uint32_t c_framesBeforeUnused = 60;	// textures with no usage reports for this long are treated as unused
+
+		static uint32_t GetTailMip(uint32_t width, uint32_t height, uint32_t mipCount);
+
+		void SetBudgetBytes(uint64_t budget) { m_budgetBytes = budget; }
+		uint64_t GetBudgetBytes() const { return m_budgetBytes; }
+
+		// streamable = false for textures that must always be fully resident (e.g. single mip textures with mips generated on the gpu)
+		// the new texture is marked as pending until SetResidentMip is called
+		void SetTexture(uint32_t texture, uint32_t width, uint32_t height, Textures::Format format, uint32_t mipCount, bool streamable, uint32_t firstMip);
+
+		// call when a load completes (or fails, pass the current resident mip), clears any pending request
+		void SetResidentMip(uint32_t texture, uint32_t firstMip);
+		uint32_t GetResidentMip(uint32_t texture) const;
+
+		// screenSizePixels = projected size of the longest edge of the texture, the max of all reports in a frame is used
+		void ReportUsage(uint32_t texture, float screenSizePixels);
+
+		// call once per frame, writes up to maxRequests textures that need new mips loaded or evicted
+		// evictions are returned first, then loads in priority order. requested textures are pending until SetResidentMip
+		void Update(uint32_t maxRequests, std::vector<MipRequest>& requests);
+
+		uint64_t GetResidentBytes() const;		// total of all resident mips
+		uint64_t GetWantedBytes() const { return m_wantedBytes; }	// total of the mips chosen by the last Update
+		uint32_t GetPendingCount() const;
+
+	private:
+		struct TextureState
+		{
+			std::vector<uint64_t> m_mipSizes;	// bytes of each mip
+			uint32_t m_width = 0;
+			uint32_t m_height = 0;
+			uint32_t m_tailMip = 0;
+			uint32_t m_residentMip = 0;
+			uint32_t m_pendingMip = -1;			// -1 = no request in flight
+			float m_reportedSize = 0.0f;		// max reported this frame
+			float m_lastUsedSize = 0.0f;		// last non-zero report
+			uint32_t m_framesUnused = c_framesBeforeUnused + 1;
+		};
+		uint64_t GetBytes(const TextureState& t, uint32_t firstMip) const;
+		std::vector<TextureState> m_textures;
+		uint64_t m_budgetBytes = 512 * 1024 * 1024;
+		uint64_t m_wantedBytes = 0;
+	};
+}
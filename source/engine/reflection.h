@@ -0,0 +1,145 @@
+#pragma once
+#include "core/glm_headers.h"
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+
+// Compile-time field descriptors
+// Add a constexpr GetFields() function returning a tuple of fields to a class, e.g.
+//	static constexpr auto GetFields()
+//	{
+//		return std::make_tuple(
+//			R3_FIELD(MyComponent, m_colour, "Colour").Colour(),
+//			R3_FIELD(MyComponent, m_distance, "Distance").Range(0.1f, 0.1f, 10000.0f)
+//		);
+//	}
+// JsonSerialiser (json + binary archives) uses the fields if there is no SerialiseJson function
+// Components also get a generated inspector + script bindings if they do not implement Inspect/RegisterScripts (see entities/component_reflection.h)
+// Trivially copyable classes where every field is plain data are raw serialised by binary worlds + prefabs, no opt-in is needed
+namespace R3
+{
+namespace Reflection
+{
+	enum FieldFlags : uint32_t
+	{
+		NoSerialise = (1 << 0),
+		NoInspect = (1 << 1),
+		NoScript = (1 << 2),
+		ReadOnly = (1 << 3),	// visible in the inspector but cannot be edited
+		IsColour = (1 << 4),	// inspect vec3/vec4 with a colour picker
+	};
+
+	template<class ClassType, class MemberType>
+	struct Field
+	{
+		using Class = ClassType;
+		using Type = MemberType;
+		std::string_view m_name;				// used by the serialiser + inspector
+		const char* m_scriptName = nullptr;		// name of the member in scripts
+		MemberType ClassType::* m_member = nullptr;
+		uint32_t m_flags = 0;
+		float m_step = 1.0f;					// inspector ranges, only used for scalars + vectors
+		float m_min = 0.0f;
+		float m_max = 0.0f;
+		std::string_view m_label;				// inspector label, if empty m_name is used
+
+		// chain these to describe the field
+		constexpr Field Flags(uint32_t f) const { Field r = *this; r.m_flags |= f; return r; }
+		constexpr Field Colour() const { return Flags(IsColour); }
+		constexpr Field Range(float step, float minv, float maxv) const { Field r = *this; r.m_step = step; r.m_min = minv; r.m_max = maxv; return r; }
+		constexpr Field Label(std::string_view label) const { Field r = *this; r.m_label = label; return r; }
+		constexpr std::string_view GetLabel() const { return m_label.empty() ? m_name : m_label; }
+		constexpr bool HasFlag(uint32_t f) const { return (m_flags & f) != 0; }
+	};
+
+	template<class ClassType, class MemberType>
+	constexpr Field<ClassType, MemberType> MakeField(std::string_view name, const char* scriptName, MemberType ClassType::* member)
+	{
+		Field<ClassType, MemberType> f;
+		f.m_name = name;
+		f.m_scriptName = scriptName;
+		f.m_member = member;
+		return f;
+	}
+
+	template <typename T>		// SFINAE trick to detect GetFields fn
+	class HasFields
+	{
+		typedef char one;
+		typedef long two;
+		template <typename C> static one test(decltype(&C::GetFields));
+		template <typename C> static two test(...);
+	public:
+		enum { value = sizeof(test<T>(0)) == sizeof(char) };
+	};
+
+	template<class T> constexpr size_t FieldCount()
+	{
+		return std::tuple_size_v<decltype(T::GetFields())>;
+	}
+
+	// the field at a given index, as a type so it can be used in constant expressions
+	template<class T, size_t Index>
+	struct FieldAt
+	{
+		static constexpr auto c_field = std::get<Index>(T::GetFields());
+	};
+
+	// calls fn(FieldAt<T, Index>()) for each field, test flags with 'if constexpr (decltype(f)::c_field.HasFlag(...))'
+	template<class T, class Fn, size_t... Index>
+	void ForEachField(Fn&& fn, std::index_sequence<Index...>)
+	{
+		(fn(FieldAt<T, Index>()), ...);
+	}
+	template<class T, class Fn>
+	void ForEachField(Fn&& fn)
+	{
+		ForEachField<T>(fn, std::make_index_sequence<FieldCount<T>()>());
+	}
+
+	// plain data = every bit is data (no padding) and contains no handles, pointers or anything that needs fixing up on load
+	// floats never have unique object representations (+0/-0) but have no padding bits
+	// glm types are plain data as only their components are copied, never the padding lane of an aligned vec3 (see entities/raw_members.h)
+	template<class T> constexpr bool IsPlainData()
+	{
+		if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+		{
+			return true;
+		}
+		else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+		{
+			return std::has_unique_object_representations_v<T>;
+		}
+		else if constexpr (std::is_same_v<T, glm::vec2> || std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::vec4> || std::is_same_v<T, glm::quat>
+			|| std::is_same_v<T, glm::ivec2> || std::is_same_v<T, glm::uvec2> || std::is_same_v<T, glm::mat4>)
+		{
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	// true if the type is trivially copyable + standard layout and every field is plain data
+	// members without a field are not serialised, the same as json, so they keep their default values on load
+	template<class T> constexpr bool IsPlainDataStruct()
+	{
+		if constexpr (!std::is_trivially_copyable_v<T> || !std::is_standard_layout_v<T> || !HasFields<T>::value)
+		{
+			return false;
+		}
+		else
+		{
+			return []<size_t... Index>(std::index_sequence<Index...>) {
+				return ((IsPlainData<typename decltype(FieldAt<T, Index>::c_field)::Type>() && !FieldAt<T, Index>::c_field.HasFlag(NoSerialise)) && ...);
+			}(std::make_index_sequence<FieldCount<T>()>());
+		}
+	}
+}
+}
+
+// Describe a field of a class, the member name is used for scripts
+#define R3_FIELD(ClassType, member, name) R3::Reflection::MakeField(name, #member, &ClassType::member)
@@ -7,5 +7,6 @@ namespace R3
 	{
 		R3_PROF_EVENT();
 		m_json = json::parse(jsonData);
+		m_readView = nullptr;
 	}
 }
\ No newline at end of file
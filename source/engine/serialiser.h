@@ -1,15 +1,24 @@
 #pragma once
 #include "core/log.h"
 #include "core/glm_headers.h"
+#include "binary_archive.h"
+#include "reflection.h"
 #include <nlohmann/json.hpp>
+#include <cassert>
 #include <string_view>
 #include <type_traits>
 #include <memory>
+#include <functional>
 #include <vector>
 #include <unordered_map>
 
 namespace R3
 {
+	namespace Entities
+	{
+		class EntityHandle;
+	}
+
 	// serialiser knows about 
 	// ints, floats, bools, strings, vec2, vec3, vec4, quat
 	// objects (that have a Serialise function)
@@ -18,7 +27,11 @@ namespace R3
 
 	// To serialise a custom type, specialise the SerialiseJson template in the R3 namespace
 	// Or you can add a SerialiseJson(JsonSerialiser&) member function to your objects
+	// Types with field descriptors (see reflection.h) are serialised automatically if they have no SerialiseJson function
 	// call TypeName() in serialiser to append a type name to data that will be tested on load
+	// An entity remap fn can be set when reading, it is called for every entity handle that is loaded (used to patch IDs)
+	// Child serialisers inherit the remap fn from their parent, so multiple threads can read with different remap fns
+	// Pass a BinaryArchive to serialise the exact same data in a compact binary form instead of json (see binary_archive.h)
 
 	template<class T> void SerialiseJson(T&, class JsonSerialiser&)
 	{
@@ -42,15 +55,31 @@ namespace R3
 		enum Mode {
 			Read, Write
 		};
-		std::string c_str() { return m_json.dump(2); }
+		std::string c_str() { return ActiveJson().dump(2); }
 		void LoadFromString(std::string_view jsonData);
-		nlohmann::json& GetJson() { return m_json; }
-		const nlohmann::json& GetJson() const { return m_json; }
+		nlohmann::json& GetJson() { assert(m_readView == nullptr); return m_json; }	// views are read-only
+		const nlohmann::json& GetJson() const { return ActiveJson(); }
 		Mode GetMode() { return m_mode; }
 
-		JsonSerialiser(Mode m) : m_mode(m) { }
-		JsonSerialiser(Mode m, const nlohmann::json& j) : m_mode(m), m_json(j) {}
-		JsonSerialiser(Mode m, nlohmann::json&& j) : m_mode(m), m_json(std::move(j)) {}
+		using EntityRemapFn = std::function<void(Entities::EntityHandle&)>;
+		void SetEntityRemap(const EntityRemapFn* fn) { m_entityRemapFn = fn; }	// fn must outlive the serialiser
+		const EntityRemapFn* GetEntityRemap() const { return m_entityRemapFn; }
+
+		JsonSerialiser(Mode m, const EntityRemapFn* remapFn = nullptr) : m_mode(m), m_entityRemapFn(remapFn) { }
+		JsonSerialiser(Mode m, const nlohmann::json& j, const EntityRemapFn* remapFn = nullptr) : m_mode(m), m_json(j), m_entityRemapFn(remapFn) {}
+		JsonSerialiser(Mode m, nlohmann::json&& j, const EntityRemapFn* remapFn = nullptr) : m_mode(m), m_json(std::move(j)), m_entityRemapFn(remapFn) {}
+
+		// Read-only view of json owned by someone else, nothing is copied. readView must outlive the serialiser
+		// Child serialisers created while reading are always views into their parent
+		JsonSerialiser(const nlohmann::json* readView, const EntityRemapFn* remapFn = nullptr) : m_mode(Read), m_readView(readView), m_entityRemapFn(remapFn) {}
+
+		// Binary archives, writes append to the archive, reads use the whole archive or a single block in it (an object written via BeginBlock/EndBlock)
+		JsonSerialiser(Mode m, BinaryArchive* archive, const EntityRemapFn* remapFn = nullptr)
+			: m_mode(m), m_entityRemapFn(remapFn), m_archive(archive), m_readObject(archive->GetRootRange()), m_readCursor(0) {}
+		JsonSerialiser(const BinaryArchive* archive, const BinaryArchive::Range& object, const EntityRemapFn* remapFn = nullptr)
+			: m_mode(Read), m_entityRemapFn(remapFn), m_archive(const_cast<BinaryArchive*>(archive)), m_readObject(object), m_readCursor(object.m_begin) {}	// archive is never modified when reading
+		bool IsBinary() const { return m_archive != nullptr; }
+		BinaryArchive* GetArchive() { return m_archive; }	// null when using json
 
 		// (optional-ish) call this at the start of a custom serialiser
 		// the name will be written along with the class data + validated when reading
@@ -59,13 +88,26 @@ namespace R3
 			const char* typeNameId = "_tnid";
 			if (m_mode == Mode::Read)
 			{
-				std::string_view readName = m_json[typeNameId];
+				std::string readName;
+				if (m_archive)
+				{
+					(*this)(typeNameId, readName);
+				}
+				else
+				{
+					readName = ActiveJson().at(typeNameId).get<std::string>();
+				}
 				if (readName != name)
 				{
 					LogError("Type mismatch in data (expected type {}, actual type {})!", name, readName);
 					assert(!"Type mismatch!");
 				}
 			}
+			else if (m_archive)
+			{
+				std::string writeName(name);
+				(*this)(typeNameId, writeName);
+			}
 			else
 			{
 				m_json[typeNameId] = name;
@@ -73,121 +115,84 @@ namespace R3
 		}
 
 		// Main serialisation operator
-		// this is getting ridiculous, refactor asap
+		// Reading never copies json, values + child serialisers read directly from the parent data
 		template<class ValueType>
 		void operator()(std::string_view name, ValueType& t)
 		{
-			constexpr bool isInt = std::is_integral<ValueType>::value;
-			constexpr bool isFloat = std::is_floating_point<ValueType>::value;
-			constexpr bool isString = (std::is_same<ValueType, std::string>::value);
-			constexpr bool hasSerialiserMember = HasSerialiser<ValueType>::value;
 			try
 			{
-				if (m_mode == Mode::Read)
+				if (m_archive)
 				{
-					if constexpr (isInt || isFloat || isString)
-					{
-						t = m_json[name];
-					}
-					else
-					{
-						JsonSerialiser js(m_mode, m_json[name]);
-						if constexpr (hasSerialiserMember)
-						{
-							t.SerialiseJson(js);
-						}
-						else
-						{
-							SerialiseJson(t, js);
-						}
-					}
+					SerialiseBinaryField(name, [&](size_t& offset, size_t end) {
+						ReadBinaryValue(offset, end, t);
+					}, [&]() {
+						WriteBinaryValue(t);
+					});
+				}
+				else if (m_mode == Mode::Read)
+				{
+					ReadValue(ActiveJson().at(name), t);
 				}
 				else
 				{
-					if constexpr (isInt || isFloat || isString)
-					{
-						m_json[name] = t;
-					}
-					else
-					{
-						JsonSerialiser js(m_mode);
-						if constexpr (hasSerialiserMember)
-						{
-							t.SerialiseJson(js);
-						}
-						else
-						{
-							SerialiseJson(t, js);
-						}
-						m_json[name] = std::move(js.m_json);
-					}
+					WriteValue(t, m_json[name]);
 				}
 			}
 			catch (std::exception e)
 			{
-				LogError("Failed to serialise {} - ", name, e.what());
+				LogError("Failed to serialise {} - {}", name, e.what());
 			}
 		}
 
 		// handles vectors of things
+		// vectors of ints, floats + strings are converted directly without any child serialisers
 		template<class ValueType>
 		void operator()(std::string_view name, std::vector<ValueType>& v)
 		{
-			constexpr bool isInt = std::is_integral<ValueType>::value;
-			constexpr bool isFloat = std::is_floating_point<ValueType>::value;
-			constexpr bool isString = (std::is_same<ValueType, std::string>::value);
-			constexpr bool hasSerialiserMember = HasSerialiser<ValueType>::value;
 			try
 			{
-				if (m_mode == Mode::Read)
+				if (m_archive)
+				{
+					SerialiseBinaryField(name, [&](size_t& offset, size_t end) {
+						ReadBinaryVector(offset, end, v);
+					}, [&]() {
+						WriteBinaryVector(v);
+					});
+				}
+				else if (m_mode == Mode::Read)
 				{
-					std::vector<json> listJson = m_json[name];
-					for (int i = 0; i < listJson.size(); ++i)
+					const json& listJson = ActiveJson().at(name);
+					v.reserve(v.size() + listJson.size());
+					for (const auto& itemJson : listJson)
 					{
-						if constexpr (isInt || isFloat || isString)
+						if constexpr (IsPrimitive<ValueType>())
 						{
-							v.emplace_back(listJson[i]);
+							v.push_back(itemJson.get<ValueType>());
 						}
 						else
 						{
-							JsonSerialiser js(m_mode, std::move(listJson[i]));
 							ValueType newVal;
-							if constexpr (hasSerialiserMember)
-							{
-								newVal.SerialiseJson(js);
-							}
-							else
-							{
-								SerialiseJson(newVal, js);
-							}
+							ReadValue(itemJson, newVal);
 							v.emplace_back(std::move(newVal));
 						}
 					}
 				}
 				else
 				{
-					std::vector<json> listJson;
-					for (int i = 0; i < v.size(); ++i)
+					json& listJson = m_json[name];
+					if constexpr (IsPrimitive<ValueType>())
 					{
-						if constexpr (isInt || isFloat || isString)
-						{
-							listJson.push_back(v[i]);
-						}
-						else
+						listJson = v;
+					}
+					else
+					{
+						listJson = json::array();
+						listJson.get_ref<json::array_t&>().reserve(v.size());
+						for (auto& item : v)
 						{
-							JsonSerialiser js(m_mode);
-							if constexpr (hasSerialiserMember)
-							{
-								v[i].SerialiseJson(js);
-							}
-							else
-							{
-								SerialiseJson(v[i], js);
-							}
-							listJson.push_back(std::move(js.m_json));
+							WriteValue(item, listJson.emplace_back());
 						}
 					}
-					m_json[name] = listJson;
 				}
 			}
 			catch (std::exception e)
@@ -200,106 +205,215 @@ namespace R3
 		template<class KeyType, class ValueType>
 		void operator()(std::string_view name, std::unordered_map<KeyType, ValueType>& v)
 		{
-			constexpr bool keyIsInt = std::is_integral<KeyType>::value;
-			constexpr bool keyIsFloat = std::is_floating_point<KeyType>::value;
-			constexpr bool keyIsString = (std::is_same<KeyType, std::string>::value);
-			constexpr bool keyHasSerialiserMember = HasSerialiser<KeyType>::value;
-			constexpr bool valueIsInt = std::is_integral<ValueType>::value;
-			constexpr bool valueIsFloat = std::is_floating_point<ValueType>::value;
-			constexpr bool valueIsString = (std::is_same<ValueType, std::string>::value);
-			constexpr bool valueHasSerialiserMember = HasSerialiser<ValueType>::value;
-			if (m_mode == Mode::Write)
+			if (m_archive)
 			{
-				std::vector<json> listJson;
-				for (auto& it : v)
-				{
-					json itJson;
-					if constexpr (keyIsInt || keyIsFloat || keyIsString)
-					{
-						itJson["Key"] = it.first;
-					}
-					else
-					{
-						KeyType keyVal = it.first;	// we need a non-const ref to the key, so make a temp copy
-						JsonSerialiser keyJs(m_mode);
-						if constexpr (keyHasSerialiserMember)
-						{
-							keyVal.SerialiseJson(keyJs);
-						}
-						else
-						{
-							SerialiseJson(keyVal, keyJs);
-						}
-						itJson["Key"] = keyJs.m_json;
-					}
-					if constexpr (valueIsInt || valueIsFloat || valueIsString)
+				SerialiseBinaryField(name, [&](size_t& offset, size_t end) {
+					const uint64_t count = m_archive->ReadVarint(offset, end);
+					for (uint64_t i = 0; i < count; ++i)
 					{
-						itJson["Value"] = it.second;
+						KeyType key;
+						ReadBinaryValue(offset, end, key);
+						ValueType value;
+						ReadBinaryValue(offset, end, value);
+						v[key] = std::move(value);
 					}
-					else
+				}, [&]() {
+					m_archive->WriteVarint(v.size());
+					for (auto& it : v)
 					{
-						JsonSerialiser valueJs(m_mode);
-						if constexpr (valueHasSerialiserMember)
-						{
-							it.second.SerialiseJson(valueJs);
-						}
-						else
-						{
-							SerialiseJson(it.second, valueJs);
-						}
-						itJson["Value"] = valueJs.m_json;
+						KeyType keyVal = it.first;
+						WriteBinaryValue(keyVal);
+						WriteBinaryValue(it.second);
 					}
-					listJson.push_back(itJson);
+				});
+			}
+			else if (m_mode == Mode::Write)
+			{
+				json& listJson = m_json[name];
+				listJson = json::array();
+				listJson.get_ref<json::array_t&>().reserve(v.size());
+				for (auto& it : v)
+				{
+					json& itJson = listJson.emplace_back();
+					KeyType keyVal = it.first;	// we need a non-const ref to the key, so make a temp copy
+					WriteValue(keyVal, itJson["Key"]);
+					WriteValue(it.second, itJson["Value"]);
 				}
-				m_json[name] = listJson;
 			}
 			else
 			{
-				std::vector<json> listJson = m_json[name];
-				for (int i = 0; i < listJson.size(); ++i)
+				const json& listJson = ActiveJson().at(name);
+				for (const auto& itJson : listJson)
 				{
 					KeyType key;
-					if constexpr (keyIsInt || keyIsFloat || keyIsString)
-					{
-						key = listJson[i]["Key"];
-					}
-					else
-					{
-						JsonSerialiser js(m_mode, listJson[i]["Key"]);
-						if constexpr (keyHasSerialiserMember)
-						{
-							key.SerialiseJson(js);
-						}
-						else
-						{
-							SerialiseJson(key, js);
-						}
-					}
+					ReadValue(itJson.at("Key"), key);
 					ValueType value;
-					if constexpr (valueIsInt || valueIsFloat || valueIsString)
+					ReadValue(itJson.at("Value"), value);
+					v[key] = std::move(value);
+				}
+			}
+		}
+	private:
+		using json = nlohmann::json;
+		template<class ValueType> static constexpr bool IsPrimitive()
+		{
+			return std::is_integral<ValueType>::value || std::is_floating_point<ValueType>::value || std::is_same<ValueType, std::string>::value;
+		}
+		template<class ValueType> static void SerialiseValue(ValueType& t, JsonSerialiser& js)
+		{
+			if constexpr (HasSerialiser<ValueType>::value)
+			{
+				t.SerialiseJson(js);
+			}
+			else if constexpr (Reflection::HasFields<ValueType>::value)
+			{
+				SerialiseFields(t, js);
+			}
+			else
+			{
+				SerialiseJson(t, js);
+			}
+		}
+		template<class ValueType> static void SerialiseFields(ValueType& t, JsonSerialiser& js)
+		{
+			Reflection::ForEachField<ValueType>([&](auto f) {
+				constexpr auto field = decltype(f)::c_field;
+				if constexpr (!field.HasFlag(Reflection::NoSerialise))
+				{
+					js(field.m_name, t.*field.m_member);
+				}
+			});
+		}
+		template<class ValueType> void ReadValue(const json& src, ValueType& t)
+		{
+			if constexpr (IsPrimitive<ValueType>())
+			{
+				src.get_to(t);
+			}
+			else
+			{
+				JsonSerialiser js(&src, m_entityRemapFn);
+				SerialiseValue(t, js);
+			}
+		}
+		template<class ValueType> void WriteValue(ValueType& t, json& target)
+		{
+			if constexpr (IsPrimitive<ValueType>())
+			{
+				target = t;
+			}
+			else
+			{
+				JsonSerialiser js(m_mode);
+				SerialiseValue(t, js);
+				target = std::move(js.m_json);
+			}
+		}
+		const json& ActiveJson() const { return m_readView ? *m_readView : m_json; }
+
+		// binary archive helpers, objects are always written as a block so they can be skipped/read as a unit
+		template<class ReadFn, class WriteFn>
+		void SerialiseBinaryField(std::string_view name, const ReadFn& readFn, const WriteFn& writeFn)
+		{
+			const uint32_t fieldID = BinaryArchive::FieldID(name);
+			if (m_mode == Mode::Read)
+			{
+				BinaryArchive::Range payload;
+				if (!m_archive->FindField(m_readObject, m_readCursor, fieldID, payload))
+				{
+					throw std::runtime_error("Field not found");
+				}
+				size_t offset = payload.m_begin;
+				readFn(offset, payload.m_end);
+			}
+			else
+			{
+				const size_t field = m_archive->BeginField(fieldID);
+				writeFn();
+				m_archive->EndField(field);
+			}
+		}
+		template<class ValueType> void ReadBinaryValue(size_t& offset, size_t end, ValueType& t)
+		{
+			if constexpr (IsPrimitive<ValueType>())
+			{
+				m_archive->Read(offset, end, t);
+			}
+			else
+			{
+				JsonSerialiser js(m_archive, m_archive->ReadBlock(offset, end), m_entityRemapFn);
+				SerialiseValue(t, js);
+			}
+		}
+		template<class ValueType> void WriteBinaryValue(ValueType& t)
+		{
+			if constexpr (IsPrimitive<ValueType>())
+			{
+				m_archive->Write(t);
+			}
+			else
+			{
+				const size_t block = m_archive->BeginBlock();
+				JsonSerialiser js(m_mode, m_archive, m_entityRemapFn);
+				SerialiseValue(t, js);
+				m_archive->EndBlock(block);
+			}
+		}
+		template<class ValueType> void ReadBinaryVector(size_t& offset, size_t end, std::vector<ValueType>& v)
+		{
+			const uint64_t count = m_archive->ReadVarint(offset, end);
+			if (count > end - offset)	// every element takes at least 1 byte
+			{
+				throw std::runtime_error("Vector count out of range");
+			}
+			if constexpr (std::is_floating_point<ValueType>::value)	// floats are stored raw, copy them all at once
+			{
+				const size_t oldSize = v.size();
+				v.resize(oldSize + count);
+				m_archive->ReadBytes(offset, end, v.data() + oldSize, count * sizeof(ValueType));
+			}
+			else
+			{
+				v.reserve(v.size() + count);
+				for (uint64_t i = 0; i < count; ++i)
+				{
+					ValueType newVal;
+					ReadBinaryValue(offset, end, newVal);
+					v.emplace_back(std::move(newVal));
+				}
+			}
+		}
+		template<class ValueType> void WriteBinaryVector(std::vector<ValueType>& v)
+		{
+			m_archive->WriteVarint(v.size());
+			if constexpr (std::is_floating_point<ValueType>::value)
+			{
+				m_archive->WriteBytes(v.data(), v.size() * sizeof(ValueType));
+			}
+			else
+			{
+				for (size_t i = 0; i < v.size(); ++i)
+				{
+					if constexpr (std::is_same<ValueType, bool>::value)
 					{
-						value = listJson[i]["Value"];
+						bool value = v[i];	// vector<bool> elements are not addressable
+						WriteBinaryValue(value);
 					}
 					else
 					{
-						JsonSerialiser js(m_mode, listJson[i]["Value"]);
-						if constexpr (valueHasSerialiserMember)
-						{
-							value.SerialiseJson(js);
-						}
-						else
-						{
-							SerialiseJson(value, js);
-						}
+						WriteBinaryValue(v[i]);
 					}
-					v[key] = value;
 				}
 			}
 		}
-	private:
-		using json = nlohmann::json;
+
 		Mode m_mode = Write;
 		json m_json;
+		const json* m_readView = nullptr;	// if set, all reads come from here instead of m_json
+		const EntityRemapFn* m_entityRemapFn = nullptr;
+		BinaryArchive* m_archive = nullptr;		// if set, json is not used at all
+		BinaryArchive::Range m_readObject;		// the fields of the object being read
+		size_t m_readCursor = 0;				// next field to read, fields are usually read in order
 	};
 
 	template<> inline void SerialiseJson(glm::vec2& t, JsonSerialiser& s)
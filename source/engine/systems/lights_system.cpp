@@ -2,6 +2,7 @@
 #include "engine/ui/imgui_menubar_helper.h"
 #include "engine/systems/immediate_render_system.h"
 #include "engine/systems/camera_system.h"
+#include "engine/systems/transform_system.h"
 #include "engine/components/point_light.h"
 #include "engine/components/spot_light.h"
 #include "engine/components/environment_settings.h"
@@ -270,6 +271,7 @@ namespace R3
 		}
 
 		// Collect + cull point lights
+		auto transforms = GetSystem<TransformSystem>();
 		auto mainCamera = GetSystem<CameraSystem>()->GetMainCamera();
 		Frustum viewFrustum(mainCamera.ProjectionMatrix() * mainCamera.ViewMatrix());
 		static std::vector<Pointlight> activePointLights;
@@ -279,7 +281,7 @@ namespace R3
 		{
 			if (pl.m_enabled)
 			{
-				glm::vec3 lightCenter = glm::vec3(t.GetWorldspaceInterpolated(e, *activeWorld)[3]);
+				glm::vec3 lightCenter = glm::vec3(transforms->GetWorldMatrixInterpolated(e, t, *activeWorld)[3]);
 				if (viewFrustum.IsSphereVisible(lightCenter, pl.m_distance))
 				{
 					Pointlight newlight;
@@ -315,6 +317,7 @@ namespace R3
 		}
 
 		// Collect + cull spot lights
+		auto transforms = GetSystem<TransformSystem>();
 		auto mainCamera = GetSystem<CameraSystem>()->GetMainCamera();
 		Frustum viewFrustum(mainCamera.ProjectionMatrix() * mainCamera.ViewMatrix());
 		static std::vector<Spotlight> activeSpotLights;
@@ -323,7 +326,7 @@ namespace R3
 		auto collectSpotLights = [&](const Entities::EntityHandle& e, SpotLightComponent& sl, TransformComponent& t) {
 			if (sl.m_enabled)
 			{
-				glm::mat4 worldSpaceTransform = t.GetWorldspaceInterpolated(e, *activeWorld);
+				glm::mat4 worldSpaceTransform = transforms->GetWorldMatrixInterpolated(e, t, *activeWorld);
 				glm::vec3 lightPosition = glm::vec3(worldSpaceTransform[3]);
 				glm::vec3 lightDirection = glm::normalize(glm::vec3(0, 0, 1) * glm::mat3(worldSpaceTransform));
 				Frustum lightFrustum(CalculateSpotlightMatrix(lightPosition, lightDirection, sl.m_distance, sl.m_outerAngle));
@@ -4,9 +4,12 @@
 #include "lights_system.h"
 #include "texture_system.h"
 #include "time_system.h"
+#include "transform_system.h"
 #include "engine/utils/frustum.h"
+#include "engine/utils/lod_selection.h"
 #include "engine/ui/imgui_menubar_helper.h"
 #include "engine/graphics/static_mesh_instance_culling_compute.h"
+#include "engine/graphics/meshlet_culling.h"
 #include "engine/components/transform.h"
 #include "engine/components/static_mesh.h"
 #include "engine/components/static_mesh_materials.h"
@@ -119,6 +122,13 @@ namespace R3
 		ImGui::Text(txt.c_str());
 		txt = std::format("    {} Dynamic Shadow Casters", m_frameStats.m_totalDynamicShadowCasters);
 		ImGui::Text(txt.c_str());
+		if (m_enableCpuMeshletCulling)
+		{
+			txt = std::format("{} Meshlets tested, {} outside frustum, {} backfacing", m_frameStats.m_meshletsTested, m_frameStats.m_meshletsFrustumCulled, m_frameStats.m_meshletsBackfaceCulled);
+			ImGui::Text(txt.c_str());
+			txt = std::format("    {} Meshlet draws, {} Triangles", m_frameStats.m_meshletDraws, m_frameStats.m_meshletIndicesDrawn / 3);
+			ImGui::Text(txt.c_str());
+		}
 		txt = std::format("Part instances took {:.3f}ms to collect", 1000.0 * (m_frameStats.m_collectInstancesEndTime - m_frameStats.m_collectInstancesStartTime));
 		ImGui::Text(txt.c_str());
 		txt = std::format("Draw buckets took {:.3f}ms to prepare", 1000.0 * (m_frameStats.m_prepareBucketsEndTime - m_frameStats.m_prepareBucketsStartTime));
@@ -145,6 +155,19 @@ namespace R3
 			ImGui::Begin("Mesh Renderer");
 			ImGui::Checkbox("Enable Compute Culling", &m_enableComputeCulling);
 			ImGui::Checkbox("Enable Shadow Caster Culling", &m_enableLightCascadeCulling);
+			if (ImGui::Checkbox("Enable CPU Meshlet Culling (Opaques)", &m_enableCpuMeshletCulling))
+			{
+				SetStaticsDirty();		// static instance transforms are only stored if meshlet culling is enabled
+			}
+			if (ImGui::Checkbox("Enable LODs", &m_enableLods))
+			{
+				SetStaticsDirty();
+			}
+			if (ImGui::DragFloat("LOD Max Error (pixels)", &m_lodMaxErrorPixels, 0.05f, 0.0f, 64.0f))
+			{
+				SetStaticsDirty();
+			}
+			ImGui::DragFloat("Static LOD Update Distance", &m_staticLodUpdateDistance, 0.1f, 0.0f, 1000.0f);
 			if (ImGui::Button("Rebuild statics"))
 			{
 				SetStaticsDirty();
@@ -378,9 +401,12 @@ namespace R3
 		{
 			Frustum mainFrustum = GetMainCameraFrustum();
 			m_frameStats.m_prepareBucketsStartTime = GetSystem<TimeSystem>()->GetElapsedTimeReal();
-			PrepareAndCullDrawBucketCompute(*ctx.m_device, ctx.m_graphicsCmds, mainFrustum, m_staticMeshInstances.GetBufferDeviceAddress(), m_staticOpaques, m_staticOpaqueDrawData);
+			if (!m_enableCpuMeshletCulling)	// opaques were already culled on cpu
+			{
+				PrepareAndCullDrawBucketCompute(*ctx.m_device, ctx.m_graphicsCmds, mainFrustum, m_staticMeshInstances.GetBufferDeviceAddress(), m_staticOpaques, m_staticOpaqueDrawData);
+				PrepareAndCullDrawBucketCompute(*ctx.m_device, ctx.m_graphicsCmds, mainFrustum, m_dynamicMeshInstances.GetBufferDeviceAddress(), m_dynamicOpaques, m_dynamicOpaqueDrawData);
+			}
 			PrepareAndCullDrawBucketCompute(*ctx.m_device, ctx.m_graphicsCmds, mainFrustum, m_staticMeshInstances.GetBufferDeviceAddress(), m_staticTransparents, m_staticTransparentDrawData);
-			PrepareAndCullDrawBucketCompute(*ctx.m_device, ctx.m_graphicsCmds, mainFrustum, m_dynamicMeshInstances.GetBufferDeviceAddress(), m_dynamicOpaques, m_dynamicOpaqueDrawData);
 			PrepareAndCullDrawBucketCompute(*ctx.m_device, ctx.m_graphicsCmds, mainFrustum, m_dynamicMeshInstances.GetBufferDeviceAddress(), m_dynamicTransparents, m_dynamicTransparentDrawData);
 			if (m_enableLightCascadeCulling)
 			{
@@ -745,11 +771,41 @@ namespace R3
 		}
 	}
 
+	// the texture is assumed to span the part bounds once per uv repeat, so tiling materials need fewer texels
+	static float GetTextureUvScale(const MeshMaterial& material)
+	{
+		return glm::max(glm::min(glm::abs(material.m_uvOffsetScale.z), glm::abs(material.m_uvOffsetScale.w)), 0.001f);
+	}
+
+	static void AddTextureUsage(std::unordered_map<uint32_t, float>& textureUsage, const MeshMaterial& material, float partSizePixels)
+	{
+		const float textureSizePixels = partSizePixels / GetTextureUvScale(material);
+		for (uint32_t texture : { material.m_albedoTexture, material.m_roughnessTexture, material.m_metalnessTexture, material.m_normalTexture, material.m_aoTexture })
+		{
+			if (texture != -1)
+			{
+				float& usage = textureUsage[texture];
+				usage = glm::max(usage, textureSizePixels);
+			}
+		}
+	}
+
 	template<class MeshCmpType, bool UseInterpolatedTransforms>
-	void MeshRenderer::RebuildInstances(LinearWriteOnlyGpuArray<MeshInstance>& instanceBuffer, MeshPartInstanceBucket& opaques, MeshPartInstanceBucket& transparents)
+	void MeshRenderer::RebuildInstances(LinearWriteOnlyGpuArray<MeshInstance>& instanceBuffer, std::vector<glm::mat4>& instanceTransforms, MeshPartInstanceBucket& opaques, MeshPartInstanceBucket& transparents)
 	{
 		R3_PROF_EVENT();
+		instanceTransforms.clear();
+		std::unordered_map<uint32_t, float>& textureUsage = std::is_same<MeshCmpType, StaticMeshComponent>::value ? m_staticTextureUsage : m_dynamicTextureUsage;
+		textureUsage.clear();
+		constexpr bool c_isStatic = std::is_same<MeshCmpType, StaticMeshComponent>::value;
+		if constexpr (c_isStatic)
+		{
+			m_staticInstanceLods.clear();
+			m_staticInstanceTextures.clear();
+			m_staticPartInstanceOwners.clear();
+		}
 		auto staticMeshes = GetSystem<StaticMeshSystem>();
+		auto transforms = GetSystem<TransformSystem>();
 		auto activeWorld = GetSystem<Entities::EntitySystem>()->GetActiveWorld();
 		if (activeWorld)
 		{
@@ -760,6 +816,9 @@ namespace R3
 			const MeshMaterial* overrideMaterials = nullptr;	// cache a ptr to the last override components' material data
 			uint32_t currentInstanceBufferOffset = 0;
 			MeshInstance* instanceWritePtr = instanceBuffer.GetWritePtr();
+			const Camera& mainCamera = GetSystem<CameraSystem>()->GetMainCamera();
+			const glm::vec3 lodViewPosition = mainCamera.Position();
+			const float lodProjectionScale = GetLodProjectionScale(mainCamera.FOV(), GetSystem<RenderSystem>()->GetWindowExtents().y);
 			auto forEachEntity = [&](const Entities::EntityHandle& e, MeshCmpType& s, TransformComponent& t)
 			{
 				const auto modelHandle = s.GetModelHandle();
@@ -787,28 +846,60 @@ namespace R3
 					glm::mat4 instanceTransform;
 					if constexpr (UseInterpolatedTransforms)
 					{
-						instanceTransform = t.GetWorldspaceInterpolated(e, *activeWorld);
+						instanceTransform = transforms->GetWorldMatrixInterpolated(e, t, *activeWorld);
 					}
 					else
 					{
-						instanceTransform = t.GetWorldspaceMatrix(e, *activeWorld);
+						instanceTransform = transforms->GetWorldMatrix(e, t, *activeWorld);
+					}
+					const float meshScale = GetLodMeshScale(instanceTransform);
+					const glm::vec3 boundsCenter = glm::vec3(instanceTransform * glm::vec4((currentMeshData.m_boundsMin + currentMeshData.m_boundsMax) * 0.5f, 1.0f));
+					const float boundsRadius = glm::length(currentMeshData.m_boundsMax - currentMeshData.m_boundsMin) * 0.5f * meshScale;
+					const float instanceSizePixels = GetProjectedSizePixels(boundsCenter, boundsRadius, lodViewPosition, lodProjectionScale);	// drives texture streaming
+					uint32_t lod = 0;
+					if (m_enableLods && currentMeshData.m_lodCount > 1)
+					{
+						lod = SelectLod(currentMeshData.m_lodErrors, currentMeshData.m_lodCount, meshScale, boundsCenter, boundsRadius, lodViewPosition, lodProjectionScale, m_lodMaxErrorPixels);
+					}
+					const uint32_t firstLodPart = currentMeshData.m_firstMeshPartOffset + (lod * currentMeshData.m_meshPartCount);
+					if constexpr (c_isStatic)
+					{
+						m_staticInstanceLods.push_back({ boundsCenter, boundsRadius, meshScale, modelHandle.m_index, lod, currentInstanceBufferOffset,
+							static_cast<uint32_t>(m_staticInstanceTextures.size()), 0 });
 					}
 					for (uint32_t part = 0; part < currentMeshData.m_meshPartCount; ++part)
 					{
-						const MeshPart* currentPart = staticMeshes->GetMeshPart(currentMeshData.m_firstMeshPartOffset + part);
+						const MeshPart* currentPart = staticMeshes->GetMeshPart(firstLodPart + part);
 						const uint32_t relativePartMatIndex = currentPart->m_materialIndex - currentMeshData.m_materialGpuIndex;
 						const glm::mat4 partTransform = instanceTransform * currentPart->m_transform;
 
 						VkDeviceAddress materialAddress = materialBaseAddress + (relativePartMatIndex * sizeof(MeshMaterial));
 						instanceWritePtr[currentInstanceBufferOffset].m_transform = partTransform;
+						if (m_enableCpuMeshletCulling)
+						{
+							instanceTransforms.push_back(partTransform);	// matches the instance buffer
+						}
 						instanceWritePtr[currentInstanceBufferOffset].m_materialDataAddress = materialAddress;
 
 						BucketPartInstance bucketInstance;
-						bucketInstance.m_partGlobalIndex = currentMeshData.m_firstMeshPartOffset + part;
+						bucketInstance.m_partGlobalIndex = firstLodPart + part;
 						bucketInstance.m_partInstanceIndex = currentInstanceBufferOffset;
 
 						const MeshMaterial* meshMaterial = overrideMaterials == nullptr ?
 							staticMeshes->GetMeshMaterial(currentMeshData.m_materialGpuIndex + relativePartMatIndex) : &overrideMaterials[relativePartMatIndex];
+						AddTextureUsage(textureUsage, *meshMaterial, instanceSizePixels);
+						if constexpr (c_isStatic)
+						{
+							for (uint32_t texture : { meshMaterial->m_albedoTexture, meshMaterial->m_roughnessTexture, meshMaterial->m_metalnessTexture, meshMaterial->m_normalTexture, meshMaterial->m_aoTexture })
+							{
+								if (texture != -1)
+								{
+									m_staticInstanceTextures.push_back({ texture, GetTextureUvScale(*meshMaterial) });
+									m_staticInstanceLods.back().m_textureCount++;
+								}
+							}
+							m_staticPartInstanceOwners.push_back(static_cast<uint32_t>(m_staticInstanceLods.size() - 1));
+						}
 						if (meshMaterial->m_albedoOpacity.w >= 1.0f)
 						{
 							opaques.m_partInstances.emplace_back(bucketInstance);
@@ -820,7 +911,7 @@ namespace R3
 
 						if (meshMaterial->m_flags & (uint32_t)MeshMaterialFlags::CastShadows)
 						{
-							if constexpr (std::is_same<MeshCmpType, StaticMeshComponent>::value)
+							if constexpr (c_isStatic)
 							{
 								m_staticShadowCasters.m_partInstances.emplace_back(bucketInstance);
 							}
@@ -851,7 +942,72 @@ namespace R3
 		m_staticTransparents.m_partInstances.clear();
 		m_staticShadowCasters.m_partInstances.clear();
 		RebuildStaticMaterialOverrides();
-		RebuildInstances<StaticMeshComponent, false>(m_staticMeshInstances, m_staticOpaques, m_staticTransparents);
+		m_staticLodViewPosition = GetSystem<CameraSystem>()->GetMainCamera().Position();
+		RebuildInstances<StaticMeshComponent, false>(m_staticMeshInstances, m_staticInstanceTransforms, m_staticOpaques, m_staticTransparents);
+	}
+
+	void MeshRenderer::UpdateStaticLods()
+	{
+		R3_PROF_EVENT();
+		auto staticMeshes = GetSystem<StaticMeshSystem>();
+		const Camera& mainCamera = GetSystem<CameraSystem>()->GetMainCamera();
+		const glm::vec3 lodViewPosition = mainCamera.Position();
+		const float lodProjectionScale = GetLodProjectionScale(mainCamera.FOV(), GetSystem<RenderSystem>()->GetWindowExtents().y);
+		m_staticLodViewPosition = lodViewPosition;
+		m_staticTextureUsage.clear();
+
+		ModelDataHandle currentMeshDataHandle;
+		MeshDrawData currentMeshData;
+		bool lodsChanged = false;
+		for (auto& instance : m_staticInstanceLods)
+		{
+			const float instanceSizePixels = GetProjectedSizePixels(instance.m_boundsCenter, instance.m_boundsRadius, lodViewPosition, lodProjectionScale);
+			for (uint32_t t = instance.m_firstTexture; t < instance.m_firstTexture + instance.m_textureCount; ++t)
+			{
+				float& usage = m_staticTextureUsage[m_staticInstanceTextures[t].m_texture];
+				usage = glm::max(usage, instanceSizePixels / m_staticInstanceTextures[t].m_uvScale);
+			}
+			if (instance.m_modelHandleIndex != currentMeshDataHandle.m_index)
+			{
+				if (!staticMeshes->GetMeshDataForModel(ModelDataHandle{ instance.m_modelHandleIndex }, currentMeshData))
+				{
+					continue;
+				}
+				currentMeshDataHandle.m_index = instance.m_modelHandleIndex;
+			}
+			uint32_t lod = 0;
+			if (m_enableLods && currentMeshData.m_lodCount > 1)
+			{
+				lod = SelectLod(currentMeshData.m_lodErrors, currentMeshData.m_lodCount, instance.m_meshScale, instance.m_boundsCenter, instance.m_boundsRadius, lodViewPosition, lodProjectionScale, m_lodMaxErrorPixels);
+			}
+			lodsChanged |= lod != instance.m_lod;
+			instance.m_lod = lod;
+		}
+		if (!lodsChanged)
+		{
+			return;
+		}
+
+		// the instance data of each part is the same for every LOD, only the mesh part each bucket entry draws changes
+		auto updateBucket = [&](MeshPartInstanceBucket& bucket) {
+			for (auto& bucketInstance : bucket.m_partInstances)
+			{
+				const auto& instance = m_staticInstanceLods[m_staticPartInstanceOwners[bucketInstance.m_partInstanceIndex]];
+				if (instance.m_modelHandleIndex != currentMeshDataHandle.m_index)
+				{
+					if (!staticMeshes->GetMeshDataForModel(ModelDataHandle{ instance.m_modelHandleIndex }, currentMeshData))
+					{
+						continue;
+					}
+					currentMeshDataHandle.m_index = instance.m_modelHandleIndex;
+				}
+				const uint32_t part = bucketInstance.m_partInstanceIndex - instance.m_firstPartInstance;
+				bucketInstance.m_partGlobalIndex = currentMeshData.m_firstMeshPartOffset + (instance.m_lod * currentMeshData.m_meshPartCount) + part;
+			}
+		};
+		updateBucket(m_staticOpaques);
+		updateBucket(m_staticTransparents);
+		updateBucket(m_staticShadowCasters);
 	}
 
 	// must be called after RebuildStaticScene to get proper material updates after scene rebuild
@@ -860,7 +1016,7 @@ namespace R3
 		m_dynamicOpaques.m_partInstances.clear();
 		m_dynamicTransparents.m_partInstances.clear();
 		m_dynamicShadowCasters.m_partInstances.clear();
-		RebuildInstances<DynamicMeshComponent, true>(m_dynamicMeshInstances, m_dynamicOpaques, m_dynamicTransparents);
+		RebuildInstances<DynamicMeshComponent, true>(m_dynamicMeshInstances, m_dynamicInstanceTransforms, m_dynamicOpaques, m_dynamicTransparents);
 	}
 
 	// populates draw calls for all instances in this bucket with no culling on cpu
@@ -884,6 +1040,54 @@ namespace R3
 		}
 	}
 
+	// cull instances + their meshlets on cpu, writes one draw per run of visible meshlets
+	// parts without meshlets (or that do not fit in the draw buffer) are drawn whole if they are visible
+	void MeshRenderer::PrepareDrawBucketMeshlets(const MeshPartInstanceBucket& bucket, const std::vector<glm::mat4>& instanceTransforms, const Frustum& f, glm::vec3 viewPos, MeshPartBucketDrawIndirects& drawData)
+	{
+		R3_PROF_EVENT();
+		auto staticMeshes = GetSystem<StaticMeshSystem>();
+		const uint32_t currentDrawBufferStart = m_thisFrameBuffer * c_maxInstances;
+		drawData.m_firstDrawOffset = (currentDrawBufferStart + m_currentDrawBufferOffset);
+		VkDrawIndexedIndirectCommand* drawPtr = static_cast<VkDrawIndexedIndirectCommand*>(m_drawIndirectHostVisible.m_mappedBuffer) + drawData.m_firstDrawOffset;
+		const uint32_t maxDraws = c_maxInstances - m_currentDrawBufferOffset;
+		const uint32_t instanceCount = static_cast<uint32_t>(bucket.m_partInstances.size());
+		MeshletCullingStats stats;
+		uint32_t drawCount = 0;
+		for (uint32_t i = 0; i < instanceCount && drawCount < maxDraws; ++i)
+		{
+			const auto& bucketInstance = bucket.m_partInstances[i];
+			const MeshPart* currentPartData = staticMeshes->GetMeshPart(bucketInstance.m_partGlobalIndex);
+			const glm::mat4& transform = instanceTransforms[bucketInstance.m_partInstanceIndex];
+			if (!f.IsBoxVisible(glm::vec3(currentPartData->m_boundsMin), glm::vec3(currentPartData->m_boundsMax), transform))
+			{
+				continue;
+			}
+			VkDrawIndexedIndirectCommand partDraw;
+			partDraw.indexCount = currentPartData->m_indexCount;
+			partDraw.instanceCount = 1;
+			partDraw.firstIndex = (uint32_t)currentPartData->m_indexStartOffset;
+			partDraw.vertexOffset = currentPartData->m_vertexDataOffset;
+			partDraw.firstInstance = bucketInstance.m_partInstanceIndex;
+			const auto meshlets = staticMeshes->GetMeshPartMeshlets(bucketInstance.m_partGlobalIndex);
+			const uint32_t drawsReserved = instanceCount - i - 1;	// make sure every remaining instance can write at least one draw
+			if (meshlets.size() > 0 && drawCount + GetMaxMeshletDraws(static_cast<uint32_t>(meshlets.size())) + drawsReserved <= maxDraws)
+			{
+				drawCount += CullMeshlets(meshlets, transform, f, viewPos, partDraw, drawPtr + drawCount, stats);
+			}
+			else
+			{
+				drawPtr[drawCount++] = partDraw;
+			}
+		}
+		drawData.m_drawCount = drawCount;
+		m_currentDrawBufferOffset += drawCount;
+		m_frameStats.m_meshletsTested += stats.m_meshletsTested;
+		m_frameStats.m_meshletsFrustumCulled += stats.m_frustumCulled;
+		m_frameStats.m_meshletsBackfaceCulled += stats.m_backfaceCulled;
+		m_frameStats.m_meshletDraws += stats.m_drawsWritten;
+		m_frameStats.m_meshletIndicesDrawn += stats.m_indicesDrawn;
+	}
+
 	// use compute to cull and prepare draw calls for instances in this bucket
 	void MeshRenderer::PrepareAndCullDrawBucketCompute(Device& d, VkCommandBuffer cmds, const Frustum& f, VkDeviceAddress instanceDataBuffer, const MeshPartInstanceBucket& bucket, MeshPartBucketDrawIndirects& drawData)
 	{
@@ -907,6 +1111,7 @@ namespace R3
 	{
 		R3_PROF_EVENT();
 
+
 		// this is the safest place to trigger static scene rebuild
 		if (m_staticSceneRebuildRequested.exchange(false) == true)
 		{
@@ -918,8 +1123,16 @@ namespace R3
 		{
 			RebuildStaticScene();
 		}
+		else if (glm::distance(GetSystem<CameraSystem>()->GetMainCamera().Position(), m_staticLodViewPosition) > m_staticLodUpdateDistance)
+		{
+			UpdateStaticLods();		// the camera moved far enough to re-select static LODs, the static instances are not rebuilt
+		}
 		RebuildDynamicScene();
 
+		// static usage is only updated when the statics are rebuilt or their LODs change, report it every frame so the textures stay resident
+		GetSystem<TextureSystem>()->ReportTextureUsage(m_staticTextureUsage);
+		GetSystem<TextureSystem>()->ReportTextureUsage(m_dynamicTextureUsage);
+
 		m_frameStats.m_totalOpaqueInstances = (uint32_t)(m_staticOpaques.m_partInstances.size() + m_dynamicOpaques.m_partInstances.size());
 		m_frameStats.m_totalTransparentInstances = (uint32_t)(m_staticTransparents.m_partInstances.size() + m_dynamicTransparents.m_partInstances.size());
 		m_frameStats.m_totalStaticInstances = (uint32_t)(m_staticOpaques.m_partInstances.size() + m_staticTransparents.m_partInstances.size());
@@ -929,11 +1142,26 @@ namespace R3
 		m_frameStats.m_totalPartInstances = m_frameStats.m_totalOpaqueInstances + m_frameStats.m_totalTransparentInstances;
 		m_frameStats.m_collectInstancesEndTime = GetSystem<TimeSystem>()->GetElapsedTimeReal();
 		m_frameStats.m_prepareBucketsStartTime = GetSystem<TimeSystem>()->GetElapsedTimeReal();
+		m_frameStats.m_meshletsTested = 0;
+		m_frameStats.m_meshletsFrustumCulled = 0;
+		m_frameStats.m_meshletsBackfaceCulled = 0;
+		m_frameStats.m_meshletDraws = 0;
+		m_frameStats.m_meshletIndicesDrawn = 0;
+		if (m_enableCpuMeshletCulling)		// opaques are culled here, compute culling skips them
+		{
+			const Frustum mainFrustum = GetMainCameraFrustum();
+			const glm::vec3 viewPos = GetSystem<CameraSystem>()->GetMainCamera().Position();
+			PrepareDrawBucketMeshlets(m_staticOpaques, m_staticInstanceTransforms, mainFrustum, viewPos, m_staticOpaqueDrawData);
+			PrepareDrawBucketMeshlets(m_dynamicOpaques, m_dynamicInstanceTransforms, mainFrustum, viewPos, m_dynamicOpaqueDrawData);
+		}
 		if (!m_enableComputeCulling)		// do nothing here, gpu culling happens later
 		{
-			PrepareDrawBucket(m_staticOpaques, m_staticOpaqueDrawData);
+			if (!m_enableCpuMeshletCulling)
+			{
+				PrepareDrawBucket(m_staticOpaques, m_staticOpaqueDrawData);
+				PrepareDrawBucket(m_dynamicOpaques, m_dynamicOpaqueDrawData);
+			}
 			PrepareDrawBucket(m_staticTransparents, m_staticTransparentDrawData);
-			PrepareDrawBucket(m_dynamicOpaques, m_dynamicOpaqueDrawData);
 			PrepareDrawBucket(m_dynamicTransparents, m_dynamicTransparentDrawData);
 		}
 		if(!m_enableLightCascadeCulling)
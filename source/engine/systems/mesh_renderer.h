@@ -67,10 +67,12 @@ namespace R3
 		void RebuildStaticMaterialOverrides();						// re-allocate material indexes for all static material overrides + upload them to gpu. Call before RebuildInstances!
 		// build instance data for a mesh component type
 		template<class MeshCmpType, bool UseInterpolatedTransforms>
-		void RebuildInstances(LinearWriteOnlyGpuArray<MeshInstance>& instanceBuffer, MeshPartInstanceBucket& opaques, MeshPartInstanceBucket& transparents);
+		void RebuildInstances(LinearWriteOnlyGpuArray<MeshInstance>& instanceBuffer, std::vector<glm::mat4>& instanceTransforms, MeshPartInstanceBucket& opaques, MeshPartInstanceBucket& transparents);
 		void RebuildStaticScene();									// collect static entities, rebuilds static draw buckets
+		void UpdateStaticLods();									// re-select LODs + texture usage of static instances for the current camera, no rebuild
 		void RebuildDynamicScene();
 		void PrepareDrawBucket(const MeshPartInstanceBucket& bucket, MeshPartBucketDrawIndirects& drawData);	// write draw indirects with no culling, only used when culling disabled
+		void PrepareDrawBucketMeshlets(const MeshPartInstanceBucket& bucket, const std::vector<glm::mat4>& instanceTransforms, const Frustum& f, glm::vec3 viewPos, MeshPartBucketDrawIndirects& drawData);	// cull instances + meshlets on cpu
 		void PrepareAndCullDrawBucketCompute(Device&, VkCommandBuffer cmds, const Frustum& f, VkDeviceAddress instanceDataBuffer, const MeshPartInstanceBucket& bucket, MeshPartBucketDrawIndirects& drawData);	// cull instances + write draw indirects
 		bool ShowGui();
 		bool CollectInstances();									// collects dynamic instances + rebuilds static scene if required. Called from frame graph
@@ -100,6 +102,11 @@ namespace R3
 			double m_collectInstancesEndTime = 0.0;
 			double m_prepareBucketsStartTime = 0.0;
 			double m_prepareBucketsEndTime = 0.0;
+			uint32_t m_meshletsTested = 0;
+			uint32_t m_meshletsFrustumCulled = 0;
+			uint32_t m_meshletsBackfaceCulled = 0;
+			uint32_t m_meshletDraws = 0;
+			uint32_t m_meshletIndicesDrawn = 0;
 		};
 
 		struct ShaderGlobals;	// Passed to each mesh drawing shader
@@ -110,6 +117,32 @@ namespace R3
 
 		bool m_enableComputeCulling = true;		// run instance culling in compute
 		bool m_enableLightCascadeCulling = true;	// run instance culling on shadow cascade casters
+		bool m_enableCpuMeshletCulling = false;	// cull opaque instances + their meshlets on cpu instead of in compute
+		bool m_enableLods = true;					// select a LOD per instance from the projected simplification error
+		float m_lodMaxErrorPixels = 1.0f;			// use the lowest detail LOD with a projected error below this
+		float m_staticLodUpdateDistance = 4.0f;		// static LODs are re-selected when the camera moves this far
+		glm::vec3 m_staticLodViewPosition = glm::vec3(0.0f);	// camera position when static LODs were last selected
+		std::unordered_map<uint32_t, float> m_staticTextureUsage;		// texture index -> max projected size in pixels, reported to the texture system
+		std::unordered_map<uint32_t, float> m_dynamicTextureUsage;
+		struct StaticInstanceLod	// everything needed to re-select the LOD + texture usage of a static instance without a rebuild
+		{
+			glm::vec3 m_boundsCenter;
+			float m_boundsRadius;
+			float m_meshScale;
+			uint32_t m_modelHandleIndex;
+			uint32_t m_lod;
+			uint32_t m_firstPartInstance;	// parts of an instance are contiguous in the instance buffer
+			uint32_t m_firstTexture;		// range in m_staticInstanceTextures
+			uint32_t m_textureCount;
+		};
+		struct StaticInstanceTexture
+		{
+			uint32_t m_texture;
+			float m_uvScale;
+		};
+		std::vector<StaticInstanceLod> m_staticInstanceLods;				// one per static instance
+		std::vector<StaticInstanceTexture> m_staticInstanceTextures;		// textures used by each static instance
+		std::vector<uint32_t> m_staticPartInstanceOwners;					// part instance index -> index into m_staticInstanceLods
 		bool m_showGui = false;
 		std::atomic<bool> m_staticSceneRebuildRequested = false;		// trigger a scene rebuild. kept separate from m_rebuildingStaticScene so it can be called from anywhere
 		bool m_rebuildingStaticScene = false;							// a scene rebuild is in progress this frame
@@ -124,6 +157,8 @@ namespace R3
 		LinearWriteOnlyGpuArray<MeshMaterial> m_staticMaterialOverrides;	// all static material overrides written here on scene rebuild
 		LinearWriteOnlyGpuArray<MeshInstance> m_staticMeshInstances;		// all static instance data written here on static scene rebuild
 		LinearWriteOnlyGpuArray<MeshInstance> m_dynamicMeshInstances;		// all dynamic instance data written here every frame
+		std::vector<glm::mat4> m_staticInstanceTransforms;					// cpu copy of static instance transforms, only written if cpu meshlet culling is enabled
+		std::vector<glm::mat4> m_dynamicInstanceTransforms;					// cpu copy of dynamic instance transforms, ^^
 		LinearWriteOnlyGpuArray<ShaderGlobals> m_globalsBuffer;				// globals for this frame, one written per pass
 
 		MeshPartInstanceBucket m_staticOpaques;								// all static opaque instances collected here on scene rebuild
@@ -18,6 +18,8 @@ namespace R3
 		m_allData.reserve(1024 * 4);
 		m_allMaterials.resize(c_maxMaterialsToStore);
 		m_allParts.reserve(c_maxMeshParts);
+		m_allPartMeshlets.reserve(c_maxMeshParts);
+		m_allMeshlets.reserve(c_maxMeshlets);
 	}
 
 	StaticMeshSystem::~StaticMeshSystem()
@@ -93,6 +95,13 @@ namespace R3
 		return &m_allParts[partIndex];
 	}
 
+	std::span<const ModelMeshlet> StaticMeshSystem::GetMeshPartMeshlets(uint32_t partIndex)
+	{
+		assert(partIndex < m_allPartMeshlets.size());
+		const MeshPartMeshlets& meshlets = m_allPartMeshlets[partIndex];
+		return { m_allMeshlets.data() + meshlets.m_firstMeshlet, meshlets.m_meshletCount };
+	}
+
 	bool StaticMeshSystem::GetMeshPart(uint32_t partIndex, MeshPart& result)
 	{
 		if (partIndex < m_allParts.size())
@@ -131,7 +140,7 @@ namespace R3
 				LogError("Mismatch with split vertex data buffers! Aborting");
 				return;
 			}
-			newMesh.m_indexDataOffset = static_cast<uint32_t>(m_allIndices.Allocate(m->m_indices.size()));
+			newMesh.m_indexDataOffset = static_cast<uint32_t>(m_allIndices.Allocate(m->m_bakedIndices.size()));
 			if (newMesh.m_vertexDataOffset == -1 || newMesh.m_indexDataOffset == -1)
 			{
 				LogError("Failed to create vertex or index buffer for mesh {}", Systems::GetSystem<ModelDataSystem>()->GetModelName(handle));
@@ -140,7 +149,7 @@ namespace R3
 
 			newMesh.m_materialCount = static_cast<uint32_t>(m->m_materials.size());
 			newMesh.m_meshPartCount = static_cast<uint32_t>(m->m_parts.size());
-			newMesh.m_totalIndices = static_cast<uint32_t>(m->m_indices.size());
+			newMesh.m_totalIndices = static_cast<uint32_t>(m->m_bakedIndices.size());
 			newMesh.m_totalVertices = static_cast<uint32_t>(m->m_bakedVerticesPosUV.size());
 			newMesh.m_boundsMax = m->m_boundsMax;
 			newMesh.m_boundsMin = m->m_boundsMin;
@@ -182,27 +191,84 @@ namespace R3
 					m_allMaterialsGpu.Write(gpuIndex, newMesh.m_materialCount, &m_allMaterials[gpuIndex]);
 				}
 				
-				newMesh.m_firstMeshPartOffset = static_cast<uint32_t>(m_allParts.size());
-				m_allParts.resize(m_allParts.size() + newMesh.m_meshPartCount);
+				// each LOD gets a full set of parts so instances can switch LOD by offsetting the part index
+				// parts with fewer LODs than the rest of the model reuse their lowest detail LOD
+				newMesh.m_lodCount = 1;
+				newMesh.m_lodErrors[0] = 0.0f;
 				for (uint32_t part = 0; part < newMesh.m_meshPartCount; ++part)
 				{
-					auto& pt = m_allParts[part + newMesh.m_firstMeshPartOffset];
-					pt.m_transform = m->m_parts[part].m_transform;
-					pt.m_boundsMax = glm::vec4(m->m_parts[part].m_boundsMax,0);
-					pt.m_boundsMin = glm::vec4(m->m_parts[part].m_boundsMin,0);
-					pt.m_indexCount = m->m_parts[part].m_indexCount;
-					pt.m_indexStartOffset = newMesh.m_indexDataOffset + m->m_parts[part].m_indexDataOffset;
-					pt.m_materialIndex = newMesh.m_materialGpuIndex + m->m_parts[part].m_materialIndex;	// GPU index!
-					pt.m_vertexDataOffset = static_cast<uint32_t>(newMesh.m_vertexDataOffset);
+					newMesh.m_lodCount = glm::max(newMesh.m_lodCount, glm::min(m->m_parts[part].m_lodCount + 1, c_maxModelPartLods));
+				}
+				for (uint32_t lod = 1; lod < newMesh.m_lodCount; ++lod)
+				{
+					newMesh.m_lodErrors[lod] = newMesh.m_lodErrors[lod - 1];
+					for (uint32_t part = 0; part < newMesh.m_meshPartCount; ++part)
+					{
+						const auto& srcPart = m->m_parts[part];
+						const uint32_t partLod = glm::min(lod, srcPart.m_lodCount);
+						if (partLod > 0)
+						{
+							newMesh.m_lodErrors[lod] = glm::max(newMesh.m_lodErrors[lod], srcPart.m_lods[partLod - 1].m_error);
+						}
+					}
+				}
+				// m_allParts + the gpu part buffer have a fixed size, drop LODs that do not fit (the base mesh must always fit)
+				const uint32_t partsRemaining = c_maxMeshParts - static_cast<uint32_t>(m_allParts.size());
+				if (newMesh.m_meshPartCount > partsRemaining)
+				{
+					LogError("Max mesh parts reached, failed to add mesh {}", Systems::GetSystem<ModelDataSystem>()->GetModelName(handle));
+					return;
+				}
+				if (newMesh.m_meshPartCount * newMesh.m_lodCount > partsRemaining)
+				{
+					newMesh.m_lodCount = partsRemaining / newMesh.m_meshPartCount;
+					LogWarn("Max mesh parts reached, mesh {} only has {} LODs", Systems::GetSystem<ModelDataSystem>()->GetModelName(handle), newMesh.m_lodCount - 1);
+				}
+				const uint32_t totalParts = newMesh.m_meshPartCount * newMesh.m_lodCount;
+				newMesh.m_firstMeshPartOffset = static_cast<uint32_t>(m_allParts.size());
+				m_allParts.resize(m_allParts.size() + totalParts);
+				m_allPartMeshlets.resize(m_allParts.size());
+				for (uint32_t lod = 0; lod < newMesh.m_lodCount; ++lod)
+				{
+					for (uint32_t part = 0; part < newMesh.m_meshPartCount; ++part)
+					{
+						const auto& srcPart = m->m_parts[part];
+						const uint32_t partLod = glm::min(lod, srcPart.m_lodCount);
+						auto& pt = m_allParts[(lod * newMesh.m_meshPartCount) + part + newMesh.m_firstMeshPartOffset];
+						pt.m_transform = srcPart.m_transform;
+						pt.m_boundsMax = glm::vec4(srcPart.m_boundsMax,0);
+						pt.m_boundsMin = glm::vec4(srcPart.m_boundsMin,0);
+						pt.m_indexCount = partLod == 0 ? srcPart.m_indexCount : srcPart.m_lods[partLod - 1].m_indexCount;
+						pt.m_indexStartOffset = newMesh.m_indexDataOffset + (partLod == 0 ? srcPart.m_indexDataOffset : srcPart.m_lods[partLod - 1].m_indexDataOffset);
+						pt.m_materialIndex = newMesh.m_materialGpuIndex + srcPart.m_materialIndex;	// GPU index!
+						pt.m_vertexDataOffset = static_cast<uint32_t>(newMesh.m_vertexDataOffset);
+					}
+				}
+				// meshlets only cover the base mesh, LODs are always drawn whole
+				const size_t meshletCount = m->m_bakedMeshlets.size();
+				if (meshletCount > 0 && m_allMeshlets.size() + meshletCount <= c_maxMeshlets)
+				{
+					const uint32_t firstMeshlet = static_cast<uint32_t>(m_allMeshlets.size());
+					for (const auto& meshlet : m->m_bakedMeshlets)
+					{
+						auto& newMeshlet = m_allMeshlets.emplace_back(meshlet);
+						newMeshlet.m_indexDataOffset += newMesh.m_indexDataOffset;
+					}
+					for (uint32_t part = 0; part < newMesh.m_meshPartCount; ++part)
+					{
+						auto& partMeshlets = m_allPartMeshlets[part + newMesh.m_firstMeshPartOffset];
+						partMeshlets.m_firstMeshlet = firstMeshlet + m->m_parts[part].m_firstMeshlet;
+						partMeshlets.m_meshletCount = m->m_parts[part].m_meshletCount;
+					}
 				}
-				m_allMeshPartsGpu.Write(newMesh.m_firstMeshPartOffset, newMesh.m_meshPartCount, &m_allParts[newMesh.m_firstMeshPartOffset]);
+				m_allMeshPartsGpu.Write(newMesh.m_firstMeshPartOffset, totalParts, &m_allParts[newMesh.m_firstMeshPartOffset]);
 			}
-			// now copy the vertex + index data to staging
+			// now copy the vertex + index data to staging, baked data is read directly from the mapped model file
 			{
 				R3_PROF_EVENT("WriteGpuDataToStaging");
 				m_allVertsPosUV.Write(newMesh.m_vertexDataOffset, m->m_bakedVerticesPosUV.size(), m->m_bakedVerticesPosUV.data());
 				m_allVertsNormalTangent.Write(newMesh.m_vertexDataOffset, m->m_bakedVerticesNormTan.size(), m->m_bakedVerticesNormTan.data());
-				m_allIndices.Write(newMesh.m_indexDataOffset, m->m_indices.size(), m->m_indices.data());
+				m_allIndices.Write(newMesh.m_indexDataOffset, m->m_bakedIndices.size(), m->m_bakedIndices.data());
 			}
 			{
 				ScopedLock lock(m_allDataMutex);			// todo, m_allMaterials and allParts probably need this lock too
@@ -5,6 +5,7 @@
 #include "core/glm_headers.h"
 #include "core/callback_array.h"
 #include "core/mutex.h"
+#include "engine/assets/model_data.h"
 
 // This system handles only STATIC data associated with meshes
 // vertices/indices/materials/parts
@@ -27,6 +28,12 @@ namespace R3
 		uint32_t m_vertexDataOffset;			// used when generating draw calls
 	};
 
+	struct MeshPartMeshlets						// cpu only, meshlets of a part used for cluster culling
+	{
+		uint32_t m_firstMeshlet = 0;			// index into all meshlets
+		uint32_t m_meshletCount = 0;
+	};
+
 	enum class MeshMaterialFlags
 	{
 		EnablePunchThroughAlpha = 1,
@@ -60,6 +67,8 @@ namespace R3
 		uint32_t m_totalVertices;
 		uint32_t m_totalIndices;
 		uint32_t m_materialCount;
+		uint32_t m_lodCount;					// parts are stored per LOD, part p of LOD n = m_firstMeshPartOffset + (n * m_meshPartCount) + p
+		float m_lodErrors[c_maxModelPartLods];	// largest simplification error of any part per LOD, in mesh space
 	};
 
 	struct ModelDataHandle;
@@ -87,6 +96,7 @@ namespace R3
 		bool GetMeshMaterial(uint32_t materialIndex, MeshMaterial& result);
 		const MeshMaterial* GetMeshMaterial(uint32_t materialIndex);
 		const MeshPart* GetMeshPart(uint32_t partIndex);
+		std::span<const ModelMeshlet> GetMeshPartMeshlets(uint32_t partIndex);	// empty if the part has none, meshlet index offsets are absolute
 
 		// Callbacks that fire when a model is ready to draw
 		using ModelReadyCallback = std::function<void(const ModelDataHandle&)>;
@@ -108,6 +118,8 @@ namespace R3
 		std::vector<MeshDrawData> m_allData;
 		std::vector<MeshMaterial> m_allMaterials;				// cpu-side copy of m_allMaterialsGpu
 		std::vector<MeshPart> m_allParts;						// cpu-side copy of m_allMeshPartsGpu
+		std::vector<MeshPartMeshlets> m_allPartMeshlets;		// matches m_allParts
+		std::vector<ModelMeshlet> m_allMeshlets;				// cpu only, reserved up front so it is never reallocated
 
 		WriteOnlyGpuArray<MeshMaterial> m_allMaterialsGpu;	// gpu buffer of materials
 		WriteOnlyGpuArray<MeshPart> m_allMeshPartsGpu;		// gpu buffer of mesh parts
@@ -119,5 +131,6 @@ namespace R3
 		const uint32_t c_maxIndicesToStore = 1024 * 1024 * 32;		// ~128mb
 		const uint32_t c_maxMaterialsToStore = 1024 * 32;			// ~2mb
 		const uint32_t c_maxMeshParts = 1024 * 32;					// ~3.5mb
+		const uint32_t c_maxMeshlets = 1024 * 256;					// ~14mb
 	};
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "texture_system.h"
 #include "job_system.h"
+#include "time_system.h"
 #include "engine/assets/textures.h"
+#include "engine/assets/texture_compressor.h"
+#include "engine/graphics/texture_residency.h"
 #include "engine/ui/imgui_menubar_helper.h"
 #include "engine/serialiser.h"
 #include "render/vulkan_helpers.h"
@@ -34,7 +37,8 @@ namespace R3
 		uint32_t m_width = 0;
 		uint32_t m_height = 0;
 		Textures::Format m_format;
-		uint32_t m_miplevels = 1;
+		uint32_t m_miplevels = 1;			// mips in the image
+		uint32_t m_residentMip = 0;			// mip of the full texture stored in image mip 0
 		VkImage m_image = VK_NULL_HANDLE;
 		VmaAllocation m_allocation = nullptr;
 		VkImageView m_imageView = VK_NULL_HANDLE;
@@ -46,12 +50,23 @@ namespace R3
 		TextureHandle m_destination;
 		Textures::TextureData m_data;
 		uint32_t m_miplevels = 1;							// if > loaded mips, generate on gpu after load
+		uint32_t m_firstMip = 0;							// first mip of m_data uploaded to the image
 		PooledBuffer m_stagingBuffer;
 		VkImage m_image = VK_NULL_HANDLE;
 		VmaAllocation m_allocation = nullptr;
 		VkImageView m_imageView = VK_NULL_HANDLE;
 	};
 
+	// images replaced by streaming, kept alive until the gpu is done with them
+	struct TextureSystem::ReleasedImage
+	{
+		VkImage m_image = VK_NULL_HANDLE;
+		VmaAllocation m_allocation = nullptr;
+		VkImageView m_imageView = VK_NULL_HANDLE;
+		VkDescriptorSet m_imGuiDescSet = VK_NULL_HANDLE;
+		uint64_t m_frameReleased = 0;
+	};
+
 	void TextureHandle::SerialiseJson(JsonSerialiser& s)
 	{
 		static auto textures = Systems::GetSystem<TextureSystem>();
@@ -74,6 +89,9 @@ namespace R3
 		RegisterTick("Textures::ShowGui", [this]() {
 			return ShowGui();
 		});
+		RegisterTick("Textures::UpdateStreaming", [this]() {
+			return UpdateStreaming();
+		});
 
 		auto render = GetSystem<RenderSystem>();
 		render->m_onShutdownCbs.AddCallback([this](Device& d) {
@@ -86,7 +104,9 @@ namespace R3
 	}
 
 	TextureSystem::TextureSystem()
+		: m_residency(std::make_unique<TextureResidency>())
 	{
+		m_textures.reserve(c_maxTextures);	// never reallocates, names returned by GetTextureName stay valid while other threads add textures
 	}
 
 	std::string_view TextureSystem::GetTextureName(const TextureHandle& t)
@@ -125,8 +145,8 @@ namespace R3
 		if (t.m_index != -1 && t.m_index < m_textures.size())			// only valid for uncompressed textures
 		{
 			const auto& tt = m_textures[t.m_index];
-			uint32_t imgWidth = tt.m_width;
-			uint32_t imgHeight = tt.m_height;
+			uint32_t imgWidth = std::max(1u, tt.m_width >> tt.m_residentMip);
+			uint32_t imgHeight = std::max(1u, tt.m_height >> tt.m_residentMip);
 			size_t sizeBytes = Textures::GetMipSizeBytes(imgWidth, imgHeight, tt.m_format);
 			for (uint32_t mip = 1; mip < tt.m_miplevels; ++mip)
 			{
@@ -150,6 +170,21 @@ namespace R3
 		return sizeBytes;
 	}
 
+	void TextureSystem::ReportTextureUsage(const std::unordered_map<uint32_t, float>& screenSizes)
+	{
+		R3_PROF_EVENT();
+		ScopedLock lock(m_residencyMutex);
+		for (const auto& it : screenSizes)
+		{
+			m_residency->ReportUsage(it.first, it.second);
+		}
+	}
+
+	void TextureSystem::SetStreamingBudgetBytes(uint64_t budget)
+	{
+		m_streamingBudgetMb = (int)(budget / (1024 * 1024));
+	}
+
 	VkDescriptorSet_T* TextureSystem::GetTextureImguiSet(const TextureHandle& t)
 	{
 		ScopedLock lock(m_texturesMutex);
@@ -244,7 +279,7 @@ namespace R3
 		return true;
 	}
 
-	TextureHandle TextureSystem::LoadTexture(std::string path, bool mipsEnabled)
+	TextureHandle TextureSystem::LoadTexture(std::string path, bool mipsEnabled, bool streamable)
 	{
 		R3_PROF_EVENT();
 		auto actualPath = FileIO::SanitisePath(path);
@@ -253,37 +288,39 @@ namespace R3
 			return TextureHandle::Invalid();
 		}
 
-		// check for existence of this texture...
-		TextureHandle foundHandle = FindExistingMatchingName(actualPath);
-		if (foundHandle.m_index != -1)
-		{
-			return foundHandle;
-		}
-		if (m_textures.size() + 1 > c_maxTextures)
-		{
-			LogWarn("Max texture handles reached");
-			return TextureHandle::Invalid();
-		}
-
-		// make a new handle entry even if the load fails
-		// (we want to return a usable handle regardless)
+		// find or add the texture under a single lock, components can load textures from multiple threads (parallel world loads)
 		TextureHandle newHandle;
 		{
 			ScopedLock lock(m_texturesMutex);
+			TextureHandle foundHandle = FindExistingMatchingName(actualPath);
+			if (foundHandle.m_index != -1)
+			{
+				return foundHandle;
+			}
+			if (m_textures.size() + 1 > c_maxTextures)
+			{
+				LogWarn("Max texture handles reached");
+				return TextureHandle::Invalid();
+			}
+
+			// make a new handle entry even if the load fails
+			// (we want to return a usable handle regardless)
 			m_textures.push_back({ actualPath });
 			newHandle = TextureHandle{ static_cast<uint32_t>(m_textures.size() - 1) };
 		}
 		m_descriptorsNeedUpdate = true;	// ensure a new entry is written to the descriptor set (or gpu will crash if it tries to read an unset one)
 
 		// push a job to load the texture data
-		auto loadTextureJob = [actualPath, newHandle, this, mipsEnabled]()
+		auto loadTextureJob = [actualPath, newHandle, this, mipsEnabled, streamable]()
 		{
 			char debugName[1024] = { '\0' };
 			sprintf_s(debugName, "LoadTexture %s", actualPath.c_str());
 			R3_PROF_EVENT_DYN(debugName);
-			if (!LoadTextureInternal(actualPath, mipsEnabled && m_generateMips, newHandle))
+			if (!LoadTextureInternal(actualPath, mipsEnabled && m_generateMips, streamable, newHandle, {}))
 			{
 				LogError("Failed to load texture {}", actualPath);
+				ScopedLock lock(m_residencyMutex);
+				m_residency->SetResidentMip(newHandle.m_index, m_residency->GetResidentMip(newHandle.m_index));	// cancel the initial request
 			}
 			m_texturesLoading--;
 		};
@@ -307,12 +344,33 @@ namespace R3
 				vkDestroyImageView(d.GetVkDevice(), m_textures[t].m_imageView, nullptr);
 				vmaDestroyImage(d.GetVMA(), m_textures[t].m_image, m_textures[t].m_allocation);
 			}
+			CollectReleasedImages(d, true);
 		}
 		vkDestroySampler(d.GetVkDevice(), m_defaultSampler, nullptr);
 		m_descriptorAllocator = {};
 		vkDestroyDescriptorSetLayout(d.GetVkDevice(), m_allTexturesDescriptorLayout, nullptr);
 	}
 
+	void TextureSystem::CollectReleasedImages(Device& d, bool releaseAll)
+	{
+		R3_PROF_EVENT();
+		const uint64_t currentFrame = GetSystem<TimeSystem>()->GetFrameIndex();
+		for (int i = (int)m_releasedImages.size() - 1; i >= 0; --i)
+		{
+			const ReleasedImage& r = m_releasedImages[i];
+			if (releaseAll || r.m_frameReleased + c_framesBeforeRelease < currentFrame)
+			{
+				if (!releaseAll && r.m_imGuiDescSet != VK_NULL_HANDLE)	// imgui frees its sets on shutdown
+				{
+					ImGui_ImplVulkan_RemoveTexture(r.m_imGuiDescSet);
+				}
+				vkDestroyImageView(d.GetVkDevice(), r.m_imageView, nullptr);
+				vmaDestroyImage(d.GetVMA(), r.m_image, r.m_allocation);
+				m_releasedImages.erase(m_releasedImages.begin() + i);
+			}
+		}
+	}
+
 	// assumes all mips have been transitioned to dst_optimal
 	void TextureSystem::GenerateMipsFromTopMip(Device& d, VkCommandBuffer_T* cmdBuffer, LoadedTexture& t)
 	{
@@ -366,6 +424,19 @@ namespace R3
 			if (mipWidth > 1) mipWidth /= 2;
 			if (mipHeight > 1) mipHeight /= 2;
 		}
+
+		// move the source mips back to transfer_dst so the caller can transition every mip at once
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = t.m_miplevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmdBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
 	}
 
 	void TextureSystem::ProcessLoadedTextures(class RenderPassContext& ctx)
@@ -383,6 +454,10 @@ namespace R3
 		{
 			assert(t->m_destination.m_index != -1 && t->m_destination.m_index < m_textures.size());
 			auto& dst = m_textures[t->m_destination.m_index];
+			if (dst.m_image != VK_NULL_HANDLE)	// streaming replaced the resident mips, the old image may still be in use
+			{
+				m_releasedImages.push_back({ dst.m_image, dst.m_allocation, dst.m_imageView, dst.m_imGuiDescSet, GetSystem<TimeSystem>()->GetFrameIndex() });
+			}
 			dst.m_width = t->m_data.m_width;
 			dst.m_height = t->m_data.m_height;
 			dst.m_format= t->m_data.m_format;
@@ -390,6 +465,7 @@ namespace R3
 			dst.m_image = t->m_image;
 			dst.m_imageView = t->m_imageView;
 			dst.m_miplevels = t->m_miplevels;
+			dst.m_residentMip = t->m_firstMip;
 
 			// transition all mips to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
 			auto transferbarrier = VulkanHelpers::MakeImageBarrier(dst.m_image,dst.m_miplevels,
@@ -402,12 +478,12 @@ namespace R3
 			// VK_PIPELINE_STAGE_TRANSFER_BIT = any time before transfers run
 			vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &transferbarrier);
 
-			// copy all loaded mips from staging to the final image
+			// copy all loaded mips from staging to the final image, mip offsets are into the staging buffer
 			const auto loadedMipCount = t->m_data.m_mips.size();
-			uint32_t width = dst.m_width;
-			uint32_t height = dst.m_height;
+			uint32_t width = std::max(1u, dst.m_width >> t->m_firstMip);
+			uint32_t height = std::max(1u, dst.m_height >> t->m_firstMip);
 			std::vector<VkBufferImageCopy> imgCopies;
-			for (auto mip = 0; mip < loadedMipCount; ++mip)
+			for (auto mip = t->m_firstMip; mip < loadedMipCount; ++mip)
 			{
 				// now copy from staging to the final image mip 0
 				VkBufferImageCopy copyRegion = {};
@@ -415,7 +491,7 @@ namespace R3
 				copyRegion.bufferRowLength = 0;
 				copyRegion.bufferImageHeight = 0;
 				copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				copyRegion.imageSubresource.mipLevel = mip;
+				copyRegion.imageSubresource.mipLevel = mip - t->m_firstMip;
 				copyRegion.imageSubresource.baseArrayLayer = 0;
 				copyRegion.imageSubresource.layerCount = 1;
 				copyRegion.imageExtent = { width, height, 1 };
@@ -427,7 +503,7 @@ namespace R3
 			vkCmdCopyBufferToImage(cmdBuffer, t->m_stagingBuffer.m_buffer.m_buffer, dst.m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				(uint32_t)imgCopies.size(), imgCopies.data());
 
-			if (dst.m_miplevels > 1 && dst.m_miplevels < loadedMipCount)	// generate any missing mips
+			if (dst.m_miplevels > 1 && loadedMipCount - t->m_firstMip < dst.m_miplevels)	// generate any missing mips
 			{
 				GenerateMipsFromTopMip(d, cmdBuffer, *t);
 			}
@@ -445,13 +521,18 @@ namespace R3
 			dst.m_imGuiDescSet = ImGui_ImplVulkan_AddTexture(m_defaultSampler, dst.m_imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 			render->GetBufferPool()->Release(t->m_stagingBuffer);
 			m_descriptorsNeedUpdate = true;	// update the descriptors now
+			{
+				ScopedLock residencyLock(m_residencyMutex);
+				m_residency->SetResidentMip(t->m_destination.m_index, t->m_firstMip);
+			}
 		}
+		CollectReleasedImages(d, false);
 
 		// for now just write all descriptors each frame
-		if (m_descriptorsNeedUpdate)
+		// the flag is cleared first, so textures added by other threads while writing are picked up next frame
+		if (m_descriptorsNeedUpdate.exchange(false))
 		{
 			WriteAllTextureDescriptors(cmdBuffer);
-			m_descriptorsNeedUpdate = false;
 		}
 
 		return true;
@@ -470,6 +551,14 @@ namespace R3
 			{
 				ImGui::Checkbox("Runtime mip generation", &m_generateMips);
 				ImGui::Checkbox("Load baked textures", &m_loadBakedTextures);
+				ImGui::Checkbox("Stream texture mips", &m_enableStreaming);
+				ImGui::SliderInt("Streaming budget (mb)", &m_streamingBudgetMb, 16, 4096);
+				{
+					ScopedLock residencyLock(m_residencyMutex);
+					std::string residencyTxt = std::format("Streaming: {:.3f}mb resident, {:.3f}mb wanted, {} requests pending",
+						m_residency->GetResidentBytes() / (1024.0 * 1024.0), m_residency->GetWantedBytes() / (1024.0 * 1024.0), m_residency->GetPendingCount());
+					ImGui::Text(residencyTxt.c_str());
+				}
 				uint64_t totalMemUsed = GetTotalGpuMemoryUsedBytes();
 				double totalMemoryMb = (uint64_t)totalMemUsed / (1024.0 * 1024.0);
 				std::string txt = std::format("{:.3f}mb gpu memory used", totalMemoryMb);
@@ -485,7 +574,7 @@ namespace R3
 						auto sizeBytes = GetTextureGpuSizeBytes(TextureHandle(ti));
 						double sizeMb = (double)sizeBytes / (1024.0 * 1024.0);
 						totalMemoryMb += sizeMb;
-						txt = std::format("{} ({}x{}@{} - {:.3f}mb)", t.m_name, t.m_width, t.m_height, Textures::FormatToString(t.m_format), sizeMb);
+						txt = std::format("{} ({}x{}@{} - mip {} - {:.3f}mb)", t.m_name, t.m_width, t.m_height, Textures::FormatToString(t.m_format), t.m_residentMip, sizeMb);
 						ImGui::SeparatorText(txt.c_str());
 						if (t.m_imGuiDescSet != VK_NULL_HANDLE)
 						{
@@ -500,7 +589,45 @@ namespace R3
 		return true;
 	}
 
-	bool TextureSystem::LoadTextureInternal(std::string_view path, bool generateMips, TextureHandle targetHandle)
+	bool TextureSystem::UpdateStreaming()
+	{
+		R3_PROF_EVENT();
+		if (!m_enableStreaming)
+		{
+			return true;
+		}
+		std::vector<TextureResidency::MipRequest> requests;
+		{
+			ScopedLock lock(m_residencyMutex);
+			m_residency->SetBudgetBytes((uint64_t)m_streamingBudgetMb * 1024 * 1024);
+			const uint32_t pending = m_residency->GetPendingCount();
+			m_residency->Update(pending < c_maxStreamingLoads ? c_maxStreamingLoads - pending : 0, requests);
+		}
+
+		// reload each requested texture with a new set of resident mips, the old image is released once the new one arrives
+		for (const auto& request : requests)
+		{
+			std::string path(GetTextureName(TextureHandle{ request.m_texture }));
+			auto streamTextureJob = [path, request, this]()
+			{
+				char debugName[1024] = { '\0' };
+				sprintf_s(debugName, "StreamTexture %s mip %d", path.c_str(), request.m_firstMip);
+				R3_PROF_EVENT_DYN(debugName);
+				if (!LoadTextureInternal(path, false, true, TextureHandle{ request.m_texture }, request.m_firstMip))
+				{
+					LogError("Failed to stream texture {}", path);
+					ScopedLock lock(m_residencyMutex);
+					m_residency->SetResidentMip(request.m_texture, m_residency->GetResidentMip(request.m_texture));	// cancel the request
+				}
+				m_texturesLoading--;
+			};
+			m_texturesLoading++;
+			GetSystem<JobSystem>()->PushJob(JobSystem::SlowJobs, streamTextureJob);
+		}
+		return true;
+	}
+
+	bool TextureSystem::LoadTextureInternal(std::string_view path, bool generateMips, bool streamable, TextureHandle targetHandle, std::optional<uint32_t> firstMip)
 	{
 		R3_PROF_EVENT();
 		auto render = GetSystem<RenderSystem>();
@@ -508,7 +635,10 @@ namespace R3
 		std::optional<Textures::TextureData> srcTexture;
 		if (m_loadBakedTextures)
 		{
-			Textures::BakeTexture(path);	// bake the texture if needed
+			if (!firstMip.has_value())
+			{
+				Textures::BakeTexture(path);	// bake the texture if needed (streaming reloads use the existing baked file)
+			}
 			auto bakedPath = Textures::GetBakedTexturePath(path);
 			srcTexture = Textures::LoadTexture(bakedPath);
 		}
@@ -521,8 +651,35 @@ namespace R3
 			LogError("Failed to load source texture {}", path);
 			return false;
 		}
-		// upload the entire buffer to staging + use the mip offsets to do the appropriate copies later on
-		const size_t stagingSize = srcTexture->m_imgData.size();
+		// baked textures contain every mip, only unbaked textures (top mip only) need blits at runtime
+		const bool generateRuntimeMips = generateMips
+			&& srcTexture->m_mips.size() == 1
+			&& !Textures::IsBlockCompressed(srcTexture->m_format);
+		uint32_t mipCount = (uint32_t)srcTexture->m_mips.size();
+		if (generateRuntimeMips)
+		{
+			mipCount = Textures::GetMipmapCount(srcTexture->m_width, srcTexture->m_height, srcTexture->m_format);
+		}
+
+		// textures with a full mip chain are streamed, new textures start with only their mip tail resident
+		uint32_t residentMip = std::min(firstMip.value_or(0), (uint32_t)srcTexture->m_mips.size() - 1);
+		if (!firstMip.has_value())
+		{
+			const bool isStreamed = streamable && m_enableStreaming && srcTexture->m_mips.size() > 1;
+			if (isStreamed)
+			{
+				residentMip = TextureResidency::GetTailMip(srcTexture->m_width, srcTexture->m_height, mipCount);
+			}
+			ScopedLock lock(m_residencyMutex);
+			m_residency->SetTexture(targetHandle.m_index, srcTexture->m_width, srcTexture->m_height, srcTexture->m_format, mipCount, isStreamed, residentMip);
+		}
+
+		// copy the resident mips to staging with 16 byte alignment, this is the only copy of mapped (DDS) textures
+		size_t stagingSize = 0;
+		for (uint32_t mip = residentMip; mip < srcTexture->m_mips.size(); ++mip)
+		{
+			stagingSize = AlignUpPow2(stagingSize, (size_t)16) + srcTexture->m_mips[mip].m_sizeBytes;
+		}
 		auto stagingBuffer = render->GetBufferPool()->GetBuffer("Texture Staging Buffer", stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_AUTO, true);
 		if (!stagingBuffer.has_value())
 		{
@@ -531,29 +688,34 @@ namespace R3
 		}
 		{
 			R3_PROF_EVENT("CopyToStaging");
-			memcpy(stagingBuffer->m_mappedBuffer, srcTexture->m_imgData.data(), stagingSize);
+			const std::span<const uint8_t> imageData = srcTexture->GetImageData();
+			size_t stagingOffset = 0;
+			for (uint32_t mip = residentMip; mip < srcTexture->m_mips.size(); ++mip)
+			{
+				auto& mipData = srcTexture->m_mips[mip];
+				stagingOffset = AlignUpPow2(stagingOffset, (size_t)16);
+				memcpy(static_cast<uint8_t*>(stagingBuffer->m_mappedBuffer) + stagingOffset, imageData.data() + mipData.m_offset, mipData.m_sizeBytes);
+				mipData.m_offset = stagingOffset;	// mip offsets are now into the staging buffer
+				stagingOffset += mipData.m_sizeBytes;
+			}
+			// the image data is no longer needed, release it (or unmap the file) before the upload happens
+			srcTexture->m_imgData = {};
+			srcTexture->m_mappedFile.Close();
 		}
 		auto loadedData = std::make_unique<LoadedTexture>();
 		loadedData->m_destination = targetHandle;
 		loadedData->m_data = std::move(*srcTexture);
 		loadedData->m_stagingBuffer = std::move(*stagingBuffer);
-		bool canGenerateRuntimeMips = loadedData->m_data.m_format != Textures::Format::RGBA_BC7
-			&& loadedData->m_data.m_format != Textures::Format::RG_BC5
-			&& loadedData->m_data.m_format != Textures::Format::R_BC4;
-		uint32_t mipCount = (uint32_t)loadedData->m_data.m_mips.size();
-		if (generateMips && canGenerateRuntimeMips)
-		{
-			mipCount = Textures::GetMipmapCount(loadedData->m_data.m_width, loadedData->m_data.m_height, loadedData->m_data.m_format);
-		}
-		loadedData->m_miplevels = mipCount;
+		loadedData->m_miplevels = mipCount - residentMip;
+		loadedData->m_firstMip = residentMip;
 		// Create the vulkan image and image-view now
 		VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-		if (generateMips)
+		if (generateRuntimeMips)
 		{
 			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;	// mips are copied from this texture
 		}
 		VkExtent3D extents = {
-			(uint32_t)loadedData->m_data.m_width, (uint32_t)loadedData->m_data.m_height, 1
+			std::max(1u, loadedData->m_data.m_width >> residentMip), std::max(1u, loadedData->m_data.m_height >> residentMip), 1
 		};
 		VkFormat format;
 		switch (loadedData->m_data.m_format)
@@ -589,7 +751,7 @@ namespace R3
 			LogError("Unsupported format {}", (int)loadedData->m_data.m_format);
 			return false;
 		}
-		auto imageCreateInfo = VulkanHelpers::CreateImage2DNoMSAA(format, usage, extents, mipCount);
+		auto imageCreateInfo = VulkanHelpers::CreateImage2DNoMSAA(format, usage, extents, loadedData->m_miplevels);
 		VmaAllocationCreateInfo allocInfo = { };
 		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 		allocInfo.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);	// fast gpu memory
@@ -600,7 +762,7 @@ namespace R3
 			return false;
 		}
 		VulkanHelpers::SetImageName(device->GetVkDevice(), loadedData->m_image, std::filesystem::path(path).filename().string());
-		auto viewCreateInfo = VulkanHelpers::CreateImageView2DNoMSAA(format, loadedData->m_image, VK_IMAGE_ASPECT_COLOR_BIT, mipCount);
+		auto viewCreateInfo = VulkanHelpers::CreateImageView2DNoMSAA(format, loadedData->m_image, VK_IMAGE_ASPECT_COLOR_BIT, loadedData->m_miplevels);
 		r = vkCreateImageView(device->GetVkDevice(), &viewCreateInfo, nullptr, &loadedData->m_imageView);
 		if (!VulkanHelpers::CheckResult(r))
 		{
@@ -611,10 +773,9 @@ namespace R3
 		return true;
 	}
 
-	TextureHandle TextureSystem::FindExistingMatchingName(std::string name)
+	TextureHandle TextureSystem::FindExistingMatchingName(std::string_view name)
 	{
 		R3_PROF_EVENT();
-		ScopedLock lock(m_texturesMutex);
 		for (uint64_t i = 0; i < m_textures.size(); ++i)
 		{
 			if (m_textures[i].m_name == name)
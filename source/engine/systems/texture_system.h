@@ -4,7 +4,9 @@
 #include "core/mutex.h"
 #include "core/glm_headers.h"
 #include <concurrentqueue/concurrentqueue.h>
+#include <atomic>
 #include <optional>
+#include <unordered_map>
 
 struct VkCommandBuffer_T;
 struct VkSampler_T;
@@ -20,6 +22,7 @@ namespace R3
 	class DescriptorSetSimpleAllocator;
 	class Device;
 	class AssetFile;
+	class TextureResidency;
 
 	// Handle to a texture
 	struct TextureHandle
@@ -39,7 +42,8 @@ namespace R3
 		virtual bool Init();
 		void ProcessLoadedTextures(class RenderPassContext& ctx);
 		
-		TextureHandle LoadTexture(std::string path, bool mipsEnabled = true);
+		// streamable = false for textures that nothing reports usage for (e.g. editor previews), they stay fully resident
+		TextureHandle LoadTexture(std::string path, bool mipsEnabled = true, bool streamable = true);
 		std::string_view GetTextureName(const TextureHandle& t);
 		glm::ivec2 GetTextureDimensions(const TextureHandle& t);
 		uint64_t GetTextureGpuSizeBytes(const TextureHandle& t);
@@ -47,6 +51,10 @@ namespace R3
 		VkDescriptorSet_T* GetTextureImguiSet(const TextureHandle& t);
 		uint64_t GetTotalGpuMemoryUsedBytes();
 
+		// texture index -> projected size of the texture on screen in pixels, drives which mips are streamed in
+		void ReportTextureUsage(const std::unordered_map<uint32_t, float>& screenSizes);
+		void SetStreamingBudgetBytes(uint64_t budget);
+
 		VkDescriptorSetLayout_T* GetDescriptorsLayout();				// used to create pipelines that accept the array of textures
 		VkDescriptorSet_T* GetAllTexturesSet();
 
@@ -54,18 +62,31 @@ namespace R3
 		struct TextureDesc;
 		struct LoadedTexture;
 
-		bool LoadTextureInternal(std::string_view path, bool generateMips, TextureHandle targetHandle);
+		struct ReleasedImage;
+
+		// firstMip = most detailed mip to upload, if not set it is chosen by the residency (streamed textures start with their mip tail)
+		bool LoadTextureInternal(std::string_view path, bool generateMips, bool streamable, TextureHandle targetHandle, std::optional<uint32_t> firstMip);
 		void GenerateMipsFromTopMip(Device& d, VkCommandBuffer_T* cmdBuffer, LoadedTexture& t);
 		void WriteAllTextureDescriptors(VkCommandBuffer_T* buf);
-		TextureHandle FindExistingMatchingName(std::string name);	// locks the mutex
+		TextureHandle FindExistingMatchingName(std::string_view name);	// m_texturesMutex must be locked
 		void Shutdown(Device& d);
 		bool ProcessLoadedTextures(Device& d, VkCommandBuffer_T* cmdBuffer);
 		bool ShowGui();
+		bool UpdateStreaming();
+		void CollectReleasedImages(Device& d, bool releaseAll);
 
 		moodycamel::ConcurrentQueue<std::unique_ptr<LoadedTexture>> m_loadedTextures;
 		std::atomic<int> m_texturesLoading = 0;
 
 		const uint32_t c_maxTextures = 1024;
+		const uint32_t c_maxStreamingLoads = 8;			// max streaming requests in flight
+		const uint64_t c_framesBeforeRelease = 5;		// replaced images are destroyed after this many frames
+
+		Mutex m_residencyMutex;
+		std::unique_ptr<TextureResidency> m_residency;
+		std::vector<ReleasedImage> m_releasedImages;	// protected by m_texturesMutex
+		bool m_enableStreaming = true;
+		int m_streamingBudgetMb = 512;
 
 		Mutex m_texturesMutex;
 		std::vector<TextureDesc> m_textures;
@@ -74,7 +95,7 @@ namespace R3
 		VkDescriptorSetLayout_T* m_allTexturesDescriptorLayout = nullptr;
 		std::unique_ptr<DescriptorSetSimpleAllocator> m_descriptorAllocator;
 		VkDescriptorSet_T* m_allTexturesSet = nullptr;	// the global set (bindless!)
-		bool m_descriptorsNeedUpdate = false;
+		std::atomic<bool> m_descriptorsNeedUpdate = false;	// set by any thread that adds a texture
 		bool m_generateMips = true;
 		bool m_loadBakedTextures = true;
 		bool m_showGui = false;
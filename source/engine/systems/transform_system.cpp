@@ -1,17 +1,215 @@
 #include "transform_system.h"
+#include "time_system.h"
+#include "job_system.h"
 #include "engine/components/transform.h"
+#include "engine/utils/transform_interpolation.h"
 #include "entities/systems/entity_system.h"
 #include "entities/queries.h"
 #include "core/profiler.h"
+#include <algorithm>
 
 namespace R3
 {
+	// world matrices for a single depth level are calculated in parallel, but only if there are enough of them
+	constexpr uint32_t c_matricesPerJob = 2048;
+
 	void TransformSystem::RegisterTickFns()
 	{
 		R3_PROF_EVENT();
 		RegisterTick("Transforms::OnFixedUpdate", [this]() {
 			return OnFixedUpdate();
 		});
+		RegisterTick("Transforms::UpdateWorldMatrices", [this]() {
+			return UpdateWorldMatrices();
+		});
+	}
+
+	uint32_t TransformSystem::GetCacheIndex(const Entities::EntityHandle& e, Entities::World& w) const
+	{
+		const uint32_t privateIndex = e.GetPrivateIndex();
+		if (&w == m_cachedWorld && privateIndex < m_entityToSortedIndex.size())
+		{
+			const uint32_t cacheIndex = m_entityToSortedIndex[privateIndex];
+			if (cacheIndex < m_sortedEntities.size() && m_sortedEntities[cacheIndex] == e)
+			{
+				return cacheIndex;
+			}
+		}
+		return -1;
+	}
+
+	glm::mat4 TransformSystem::GetWorldMatrix(const Entities::EntityHandle& e, const TransformComponent& t, Entities::World& w) const
+	{
+		const uint32_t cacheIndex = GetCacheIndex(e, w);
+		if (cacheIndex != -1)
+		{
+			return m_worldMatrices[cacheIndex];
+		}
+		return t.GetWorldspaceMatrix(e, w);
+	}
+
+	glm::mat4 TransformSystem::GetWorldMatrixInterpolated(const Entities::EntityHandle& e, const TransformComponent& t, Entities::World& w) const
+	{
+		const uint32_t cacheIndex = GetCacheIndex(e, w);
+		if (cacheIndex != -1)
+		{
+			return m_worldMatricesInterpolated[cacheIndex];
+		}
+		return t.GetWorldspaceInterpolated(e, w);
+	}
+
+	void TransformSystem::RebuildHierarchy(Entities::World& w)
+	{
+		R3_PROF_EVENT();
+		m_sortedEntities.clear();
+		m_sortedParents.clear();
+		m_depthOffsets.clear();
+		std::fill(m_entityToSortedIndex.begin(), m_entityToSortedIndex.end(), -1);
+		auto addSorted = [&](const Entities::EntityHandle& e, uint32_t parentIndex) {
+			if (e.GetPrivateIndex() >= m_entityToSortedIndex.size())
+			{
+				m_entityToSortedIndex.resize(e.GetPrivateIndex() + 1, -1);
+			}
+			m_entityToSortedIndex[e.GetPrivateIndex()] = static_cast<uint32_t>(m_sortedEntities.size());
+			m_sortedEntities.push_back(e);
+			m_sortedParents.push_back(parentIndex);
+		};
+
+		// roots are any transforms without a parent transform (entities pending delete are skipped)
+		auto collectRoots = [&](const Entities::EntityHandle& e, TransformComponent& t) {
+			if (w.GetComponent<TransformComponent>(e) != nullptr && w.GetComponent<TransformComponent>(w.GetParent(e)) == nullptr)
+			{
+				addSorted(e, -1);
+			}
+			return true;
+		};
+		Entities::Queries::ForEach<TransformComponent>(&w, collectRoots);
+
+		// walk the hierarchy breadth-first, each pass adds the transforms at the next depth
+		uint32_t depthStart = 0;
+		while (depthStart < m_sortedEntities.size())
+		{
+			m_depthOffsets.push_back(depthStart);
+			const uint32_t depthEnd = static_cast<uint32_t>(m_sortedEntities.size());
+			for (uint32_t parentIndex = depthStart; parentIndex < depthEnd; ++parentIndex)
+			{
+				// copy the parent handle, m_sortedEntities may reallocate while adding children
+				const Entities::EntityHandle parent = m_sortedEntities[parentIndex];
+				w.ForEachChild(parent, [&](const Entities::EntityHandle& child) {
+					if (w.GetComponent<TransformComponent>(child) != nullptr)
+					{
+						addSorted(child, parentIndex);
+					}
+				});
+			}
+			depthStart = depthEnd;
+		}
+		m_depthOffsets.push_back(static_cast<uint32_t>(m_sortedEntities.size()));
+		m_worldMatrices.resize(m_sortedEntities.size());
+		m_worldMatricesInterpolated.resize(m_sortedEntities.size());
+		m_localMatricesInterpolated.resize(m_sortedEntities.size());
+	}
+
+	void TransformSystem::InterpolateLocalMatrices(Entities::World& w, float interpolation)
+	{
+		R3_PROF_EVENT();
+		const uint32_t typeIndex = Entities::ComponentTypeRegistry::GetTypeIndex<TransformComponent>();
+		const uint32_t count = static_cast<uint32_t>(m_sortedEntities.size());
+		const uint32_t jobCount = (count + c_matricesPerJob - 1) / c_matricesPerJob;
+		auto interpolateRange = [&](uint32_t job) {
+			// anything that moved is added to a batch, everything else can use the current matrix
+			TransformInterpolationBatch batch;
+			const uint32_t end = std::min(count, (job + 1) * c_matricesPerJob);
+			for (uint32_t i = job * c_matricesPerJob; i < end; ++i)
+			{
+				const TransformComponent* t = w.GetComponentFast<TransformComponent>(m_sortedEntities[i], typeIndex);
+				if (t == nullptr)	// entity was deleted since the hierarchy was built
+				{
+					continue;
+				}
+				if (t->m_prevPosition == t->m_position && t->m_prevScale == t->m_scale && t->m_prevOrientation == t->m_orientation)
+				{
+					m_localMatricesInterpolated[i] = t->m_matrix;
+				}
+				else
+				{
+					batch.Add(t->m_prevPosition, t->m_position, t->m_prevOrientation, t->m_orientation, t->m_prevScale, t->m_scale, &m_localMatricesInterpolated[i]);
+					if (batch.IsFull())
+					{
+						InterpolateTransforms(batch, interpolation);
+					}
+				}
+			}
+			InterpolateTransforms(batch, interpolation);
+		};
+		if (jobCount > 1)
+		{
+			GetSystem<JobSystem>()->ForEachAsync(JobSystem::ThreadPool::FastJobs, 0, jobCount, 1, 1, interpolateRange);
+		}
+		else if (jobCount == 1)
+		{
+			interpolateRange(0);
+		}
+	}
+
+	bool TransformSystem::UpdateWorldMatrices()
+	{
+		R3_PROF_EVENT();
+		auto world = Systems::GetSystem<Entities::EntitySystem>()->GetActiveWorld();
+		if (world == nullptr)
+		{
+			m_cachedWorld = nullptr;
+			return true;
+		}
+		const uint64_t structureVersion = world->GetStructureVersion(Entities::ComponentTypeRegistry::GetTypeIndex<TransformComponent>());
+		if (world != m_cachedWorld || structureVersion != m_cachedStructureVersion)
+		{
+			RebuildHierarchy(*world);
+			m_cachedWorld = world;
+			m_cachedStructureVersion = structureVersion;
+		}
+
+		const double interpolation = GetSystem<TimeSystem>()->GetFixedUpdateInterpolation();
+		InterpolateLocalMatrices(*world, static_cast<float>(interpolation));
+
+		// calculate all matrices at each depth in parallel, parent matrices are always ready before children
+		const uint32_t typeIndex = Entities::ComponentTypeRegistry::GetTypeIndex<TransformComponent>();
+		auto updateMatrix = [&](uint32_t i) {
+			const TransformComponent* t = world->GetComponentFast<TransformComponent>(m_sortedEntities[i], typeIndex);
+			if (t == nullptr)	// entity was deleted since the hierarchy was built
+			{
+				return;
+			}
+			const uint32_t parent = m_sortedParents[i];
+			if (parent != -1 && t->IsRelativeToParent())
+			{
+				m_worldMatrices[i] = m_worldMatrices[parent] * t->GetLocalMatrix();
+				m_worldMatricesInterpolated[i] = m_worldMatricesInterpolated[parent] * m_localMatricesInterpolated[i];
+			}
+			else
+			{
+				m_worldMatrices[i] = t->GetLocalMatrix();
+				m_worldMatricesInterpolated[i] = m_localMatricesInterpolated[i];
+			}
+		};
+		auto jobs = GetSystem<JobSystem>();
+		for (size_t depth = 0; depth + 1 < m_depthOffsets.size(); ++depth)
+		{
+			const uint32_t start = m_depthOffsets[depth], end = m_depthOffsets[depth + 1];
+			if (end - start > c_matricesPerJob)
+			{
+				jobs->ForEachAsync(JobSystem::ThreadPool::FastJobs, start, end, 1, c_matricesPerJob, updateMatrix);
+			}
+			else
+			{
+				for (uint32_t i = start; i < end; ++i)
+				{
+					updateMatrix(i);
+				}
+			}
+		}
+
+		return true;
 	}
 
 	bool TransformSystem::OnFixedUpdate()
@@ -1,15 +1,43 @@
 #pragma once
 #include "engine/systems.h"
+#include "entities/entity_handle.h"
+#include "core/glm_headers.h"
+#include <vector>
 
 namespace R3
 {
+	namespace Entities
+	{
+		class World;
+	}
+	class TransformComponent;
 	class TransformSystem : public System
 	{
 	public:
 		static std::string_view GetName() { return "Transforms"; }
 		virtual void RegisterTickFns();
 
+		// Cached world-space matrices, calculated once per frame in UpdateWorldMatrices
+		// Falls back to walking the hierarchy if the entity was not in the cache (e.g. it was created after the update)
+		glm::mat4 GetWorldMatrix(const Entities::EntityHandle& e, const TransformComponent& t, Entities::World& w) const;
+		glm::mat4 GetWorldMatrixInterpolated(const Entities::EntityHandle& e, const TransformComponent& t, Entities::World& w) const;
+
 	private:
 		bool OnFixedUpdate();
+		bool UpdateWorldMatrices();
+		void RebuildHierarchy(Entities::World& w);		// sort all transforms by depth in the entity hierarchy
+		uint32_t GetCacheIndex(const Entities::EntityHandle& e, Entities::World& w) const;	// index into the cached matrices or -1
+		void InterpolateLocalMatrices(Entities::World& w, float interpolation);	// batched SIMD interpolation of all moving transforms
+
+		// Flattened hierarchy, all transforms sorted by depth so parents are always processed before children
+		std::vector<Entities::EntityHandle> m_sortedEntities;
+		std::vector<uint32_t> m_sortedParents;		// index into m_sortedEntities of the parent transform, or -1 for roots
+		std::vector<uint32_t> m_depthOffsets;		// offset into m_sortedEntities for the first transform at each depth (+ 1 entry for the end)
+		std::vector<uint32_t> m_entityToSortedIndex;	// private entity index -> index into m_sortedEntities, or -1 if not cached
+		std::vector<glm::mat4> m_worldMatrices;		// world-space matrices matching m_sortedEntities
+		std::vector<glm::mat4> m_worldMatricesInterpolated;
+		std::vector<glm::mat4> m_localMatricesInterpolated;
+		Entities::World* m_cachedWorld = nullptr;	// used to detect when the hierarchy needs rebuilding
+		uint64_t m_cachedStructureVersion = -1;
 	};
 }
\ No newline at end of file
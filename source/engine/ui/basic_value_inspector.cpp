@@ -269,7 +269,7 @@ namespace R3
 				// sanitise path, only files relative to data root are allowed
 				auto currentPath = std::filesystem::current_path();
 				auto relativePath = std::filesystem::relative(newPath, currentPath);
-				auto newHandle = textures->LoadTexture(relativePath.string());
+				auto newHandle = textures->LoadTexture(relativePath.string(), true, false);	// not streamed, nothing reports usage for textures picked here
 				setFn(newHandle);
 				return true;
 			}
@@ -20,6 +20,10 @@ namespace R3
 		m_planes[Top] = m[3] - m[1];
 		m_planes[Near] = m[3] + m[2];
 		m_planes[Far] = m[3] - m[2];
+		for (int i = 0; i < Count; ++i)	// normalise so IsSphereVisible can compare distances against the radius
+		{
+			m_planes[i] /= glm::length(glm::vec3(m_planes[i]));
+		}
 
 		glm::vec3 crosses[Combinations] = {
 			glm::cross(glm::vec3(m_planes[Left]),   glm::vec3(m_planes[Right])),
@@ -0,0 +1,39 @@
+#include "lod_selection.h"
+
+namespace R3
+{
+	float GetLodProjectionScale(float fovY, float viewportHeight)
+	{
+		return (viewportHeight * 0.5f) / glm::tan(glm::radians(fovY) * 0.5f);
+	}
+
+	float GetLodMeshScale(const glm::mat4& transform)
+	{
+		const float scaleSq = glm::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+			glm::max(glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])), glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))));
+		return glm::sqrt(scaleSq);
+	}
+
+	float GetProjectedSizePixels(glm::vec3 boundsCenter, float boundsRadius, glm::vec3 viewPosition, float projectionScale)
+	{
+		const float distance = glm::max(glm::length(boundsCenter - viewPosition) - boundsRadius, 0.001f);
+		return boundsRadius * 2.0f * projectionScale / distance;
+	}
+
+	uint32_t SelectLod(const float* lodErrors, uint32_t lodCount, float meshScale, glm::vec3 boundsCenter, float boundsRadius,
+		glm::vec3 viewPosition, float projectionScale, float maxErrorPixels)
+	{
+		const float distance = glm::length(boundsCenter - viewPosition) - boundsRadius;	// distance to the closest point of the bounds
+		if (distance <= 0.0f || lodCount < 2)
+		{
+			return 0;
+		}
+		const float errorToPixels = meshScale * projectionScale / distance;
+		uint32_t lod = 0;
+		while (lod + 1 < lodCount && lodErrors[lod + 1] * errorToPixels <= maxErrorPixels)
+		{
+			++lod;
+		}
+		return lod;
+	}
+}
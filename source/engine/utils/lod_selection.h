@@ -0,0 +1,22 @@
+#pragma once
+#include "core/glm_headers.h"
+
+// Screen-space LOD selection
+// LOD errors are the simplification error of each LOD in mesh space units, LOD 0 has no error
+// The projected error of a LOD is roughly how many pixels the simplified mesh is off from the original
+namespace R3
+{
+	// converts a size at distance 1 from the camera to pixels. fovY in degrees (see Camera::FOV)
+	float GetLodProjectionScale(float fovY, float viewportHeight);
+
+	// largest scale of a transform, used to scale mesh space errors + bounds to world space
+	float GetLodMeshScale(const glm::mat4& transform);
+
+	// projected diameter in pixels of a world space sphere, measured from its closest point (very large if the view position is inside it)
+	float GetProjectedSizePixels(glm::vec3 boundsCenter, float boundsRadius, glm::vec3 viewPosition, float projectionScale);
+
+	// returns the lowest detail LOD with a projected error <= maxErrorPixels, errors must be increasing
+	// bounds are a world space sphere, LOD 0 is always used if the view position is inside it
+	uint32_t SelectLod(const float* lodErrors, uint32_t lodCount, float meshScale, glm::vec3 boundsCenter, float boundsRadius,
+		glm::vec3 viewPosition, float projectionScale, float maxErrorPixels);
+}
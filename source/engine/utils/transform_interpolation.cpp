@@ -0,0 +1,170 @@
+#include "transform_interpolation.h"
+#include "core/profiler.h"
+#include <cassert>
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#define R3_TRANSFORM_INTERPOLATION_SSE
+	#include <emmintrin.h>
+	#include <xmmintrin.h>
+#endif
+
+namespace R3
+{
+	// nlerp is close enough to slerp when the angle between orientations is small (~36 degrees)
+	constexpr float c_nlerpMinDot = 0.95f;
+
+	void TransformInterpolationBatch::Add(glm::vec3 prevPos, glm::vec3 pos, glm::quat prevRot, glm::quat rot, glm::vec3 prevScale, glm::vec3 scale, glm::mat4* output)
+	{
+		assert(m_count < c_maxCount);
+		const uint32_t i = m_count++;
+		for (int c = 0; c < 3; ++c)
+		{
+			m_prevPosition[c][i] = prevPos[c];
+			m_position[c][i] = pos[c];
+			m_prevScale[c][i] = prevScale[c];
+			m_scale[c][i] = scale[c];
+		}
+		m_prevOrientation[0][i] = prevRot.x;
+		m_prevOrientation[1][i] = prevRot.y;
+		m_prevOrientation[2][i] = prevRot.z;
+		m_prevOrientation[3][i] = prevRot.w;
+		m_orientation[0][i] = rot.x;
+		m_orientation[1][i] = rot.y;
+		m_orientation[2][i] = rot.z;
+		m_orientation[3][i] = rot.w;
+		m_outputs[i] = output;
+	}
+
+	// scalar path, used for anything that cannot use nlerp + any transforms left over after the SIMD path
+	static void InterpolateSingle(const TransformInterpolationBatch& b, uint32_t i, float t)
+	{
+		const glm::vec3 prevPos(b.m_prevPosition[0][i], b.m_prevPosition[1][i], b.m_prevPosition[2][i]);
+		const glm::vec3 pos(b.m_position[0][i], b.m_position[1][i], b.m_position[2][i]);
+		const glm::vec3 prevScale(b.m_prevScale[0][i], b.m_prevScale[1][i], b.m_prevScale[2][i]);
+		const glm::vec3 scale(b.m_scale[0][i], b.m_scale[1][i], b.m_scale[2][i]);
+		glm::quat q0, q1;
+		q0.x = b.m_prevOrientation[0][i];	q0.y = b.m_prevOrientation[1][i];	q0.z = b.m_prevOrientation[2][i];	q0.w = b.m_prevOrientation[3][i];
+		q1.x = b.m_orientation[0][i];		q1.y = b.m_orientation[1][i];		q1.z = b.m_orientation[2][i];		q1.w = b.m_orientation[3][i];
+		glm::quat rot;
+		const float cosTheta = glm::dot(q0, q1);
+		if (glm::abs(cosTheta) >= c_nlerpMinDot)
+		{
+			rot = glm::normalize(glm::lerp(q0, cosTheta < 0.0f ? -q1 : q1, t));
+		}
+		else
+		{
+			rot = glm::slerp(q0, q1, t);
+		}
+		*b.m_outputs[i] = glm::scale(glm::translate(glm::identity<glm::mat4>(), glm::mix(prevPos, pos, t)) * glm::mat4_cast(rot), glm::mix(prevScale, scale, t));
+	}
+
+#ifdef R3_TRANSFORM_INTERPOLATION_SSE
+	// interpolate 4 transforms starting at index i
+	static void InterpolateSSE(const TransformInterpolationBatch& b, uint32_t i, float t)
+	{
+		const __m128 vt = _mm_set1_ps(t);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		auto lerp = [&](const float* a, const float* c) {
+			const __m128 va = _mm_load_ps(a + i);
+			return _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(c + i), va), vt));
+		};
+
+		const __m128 px = lerp(b.m_prevPosition[0], b.m_position[0]);
+		const __m128 py = lerp(b.m_prevPosition[1], b.m_position[1]);
+		const __m128 pz = lerp(b.m_prevPosition[2], b.m_position[2]);
+		const __m128 sx = lerp(b.m_prevScale[0], b.m_scale[0]);
+		const __m128 sy = lerp(b.m_prevScale[1], b.m_scale[1]);
+		const __m128 sz = lerp(b.m_prevScale[2], b.m_scale[2]);
+
+		// nlerp, flipping q1 if required to take the shortest path
+		const __m128 q0x = _mm_load_ps(b.m_prevOrientation[0] + i), q0y = _mm_load_ps(b.m_prevOrientation[1] + i);
+		const __m128 q0z = _mm_load_ps(b.m_prevOrientation[2] + i), q0w = _mm_load_ps(b.m_prevOrientation[3] + i);
+		__m128 q1x = _mm_load_ps(b.m_orientation[0] + i), q1y = _mm_load_ps(b.m_orientation[1] + i);
+		__m128 q1z = _mm_load_ps(b.m_orientation[2] + i), q1w = _mm_load_ps(b.m_orientation[3] + i);
+		const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(q0x, q1x), _mm_mul_ps(q0y, q1y)), _mm_add_ps(_mm_mul_ps(q0z, q1z), _mm_mul_ps(q0w, q1w)));
+		const __m128 dotSign = _mm_and_ps(dot, signBit);
+		q1x = _mm_xor_ps(q1x, dotSign);
+		q1y = _mm_xor_ps(q1y, dotSign);
+		q1z = _mm_xor_ps(q1z, dotSign);
+		q1w = _mm_xor_ps(q1w, dotSign);
+		__m128 qx = _mm_add_ps(q0x, _mm_mul_ps(_mm_sub_ps(q1x, q0x), vt));
+		__m128 qy = _mm_add_ps(q0y, _mm_mul_ps(_mm_sub_ps(q1y, q0y), vt));
+		__m128 qz = _mm_add_ps(q0z, _mm_mul_ps(_mm_sub_ps(q1z, q0z), vt));
+		__m128 qw = _mm_add_ps(q0w, _mm_mul_ps(_mm_sub_ps(q1w, q0w), vt));
+		const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+		const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+		qx = _mm_mul_ps(qx, invLength);
+		qy = _mm_mul_ps(qy, invLength);
+		qz = _mm_mul_ps(qz, invLength);
+		qw = _mm_mul_ps(qw, invLength);
+		const int needsSlerp = _mm_movemask_ps(_mm_cmplt_ps(_mm_andnot_ps(signBit, dot), _mm_set1_ps(c_nlerpMinDot)));
+
+		// rotation matrix (see glm::mat3_cast), with scale applied to each column
+		const __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		const __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		const __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+		__m128 columns[4][4] = {
+			{
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+				zero
+			},
+			{
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+				zero
+			},
+			{
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+				zero
+			},
+			{ px, py, pz, one }
+		};
+
+		// each column register holds one component for 4 transforms, transpose to get 1 column per transform
+		for (int c = 0; c < 4; ++c)
+		{
+			_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				_mm_storeu_ps(glm::value_ptr((*b.m_outputs[i + lane])[c]), columns[c][lane]);
+			}
+		}
+
+		// anything with a large rotation goes through the slow path
+		if (needsSlerp != 0)
+		{
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if (needsSlerp & (1 << lane))
+				{
+					InterpolateSingle(b, i + lane, t);
+				}
+			}
+		}
+	}
+#endif
+
+	void InterpolateTransforms(TransformInterpolationBatch& batch, float interpolation)
+	{
+		uint32_t i = 0;
+#ifdef R3_TRANSFORM_INTERPOLATION_SSE
+		for (; i + 4 <= batch.m_count; i += 4)
+		{
+			InterpolateSSE(batch, i, interpolation);
+		}
+#endif
+		for (; i < batch.m_count; ++i)
+		{
+			InterpolateSingle(batch, i, interpolation);
+		}
+		batch.m_count = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include "core/glm_headers.h"
+
+namespace R3
+{
+	// Batched interpolation of local transforms (translation * rotation * scale) between previous + current values
+	// Inputs are stored as structure-of-arrays so they can be processed 4 at a time with SSE
+	// Orientations use nlerp when they are close enough, otherwise they fall back to slerp
+	struct TransformInterpolationBatch
+	{
+		static constexpr uint32_t c_maxCount = 64;	// must be a multiple of 4
+		void Add(glm::vec3 prevPos, glm::vec3 pos, glm::quat prevRot, glm::quat rot, glm::vec3 prevScale, glm::vec3 scale, glm::mat4* output);
+		bool IsFull() const { return m_count == c_maxCount; }
+
+		alignas(16) float m_prevPosition[3][c_maxCount];
+		alignas(16) float m_position[3][c_maxCount];
+		alignas(16) float m_prevOrientation[4][c_maxCount];	// x,y,z,w
+		alignas(16) float m_orientation[4][c_maxCount];
+		alignas(16) float m_prevScale[3][c_maxCount];
+		alignas(16) float m_scale[3][c_maxCount];
+		glm::mat4* m_outputs[c_maxCount];
+		uint32_t m_count = 0;
+	};
+
+	// writes the interpolated local matrix for everything in the batch to the outputs, then resets the batch
+	void InterpolateTransforms(TransformInterpolationBatch& batch, float interpolation);
+}
\ No newline at end of file
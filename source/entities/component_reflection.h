@@ -0,0 +1,109 @@
+#pragma once
+#include "entities/world.h"
+#include "engine/reflection.h"
+#include "engine/ui/value_inspector.h"
+#include "engine/systems/lua_system.h"
+
+// Inspector + script bindings generated from component field descriptors (see engine/reflection.h)
+// EntitySystem uses these automatically for components with GetFields() that do not implement Inspect/RegisterScripts
+// They can also be called directly from a hand-written Inspect/RegisterScripts
+namespace R3
+{
+namespace Reflection
+{
+	// inspector for a single field, ranges are taken from the field descriptor
+	template<class ComponentType, class FieldType>
+	void InspectField(ComponentType& c, const Field<ComponentType, FieldType>& field, const Entities::EntityHandle& e, Entities::World* w, ValueInspector& i)
+	{
+		const auto member = field.m_member;
+		auto setFn = [e, w, member](FieldType newValue) {
+			auto foundCmp = w->GetComponent<ComponentType>(e);
+			if (foundCmp)
+			{
+				foundCmp->*member = newValue;
+			}
+		};
+		std::function<void(FieldType)> setter = setFn;
+		if (field.HasFlag(ReadOnly))
+		{
+			setter = [](FieldType) {};
+		}
+		const FieldType& value = c.*member;
+		const std::string_view label = field.GetLabel();
+		if constexpr (std::is_same_v<FieldType, bool>)
+		{
+			i.Inspect(label, value, setter);
+		}
+		else if constexpr (std::is_integral_v<FieldType>)
+		{
+			i.Inspect(label, static_cast<int>(value), [setter](int v) { setter(static_cast<FieldType>(v)); },
+				static_cast<int>(field.m_step), static_cast<int>(field.m_min), static_cast<int>(field.m_max));
+		}
+		else if constexpr (std::is_same_v<FieldType, float>)
+		{
+			i.Inspect(label, value, setter, field.m_step, field.m_min, field.m_max);
+		}
+		else if constexpr (std::is_same_v<FieldType, glm::vec3> || std::is_same_v<FieldType, glm::vec4>)
+		{
+			if (field.HasFlag(IsColour))
+			{
+				i.InspectColour(label, value, setter);
+			}
+			else
+			{
+				i.Inspect(label, value, setter, FieldType(field.m_min), FieldType(field.m_max));
+			}
+		}
+		else if constexpr (std::is_same_v<FieldType, glm::uvec2>)
+		{
+			i.Inspect(label, value, setter, FieldType(static_cast<uint32_t>(field.m_min)), FieldType(static_cast<uint32_t>(field.m_max)));
+		}
+		else if constexpr (std::is_same_v<FieldType, std::string>)
+		{
+			i.Inspect(label, std::string_view(value), setter);
+		}
+		else if constexpr (std::is_same_v<FieldType, Entities::EntityHandle>)
+		{
+			i.InspectEntity(label, value, w, setter);
+		}
+		else
+		{
+			static_assert(!sizeof(FieldType), "No generated inspector for this type, add NoInspect + write a custom Inspect fn");
+		}
+	}
+
+	template<class ComponentType>
+	void InspectFields(ComponentType& c, const Entities::EntityHandle& e, Entities::World* w, ValueInspector& i)
+	{
+		ForEachField<ComponentType>([&](auto f) {
+			constexpr auto field = decltype(f)::c_field;
+			if constexpr (!field.HasFlag(NoInspect))
+			{
+				InspectField(c, field, e, w, i);
+			}
+		});
+	}
+
+	// registers the component type with all fields that do not have the NoScript flag
+	template<class ComponentType>
+	void RegisterScriptFields(LuaSystem& l, std::string_view typeName)
+	{
+		auto scriptArgs = []<size_t... Index>(std::index_sequence<Index...>) {
+			return std::tuple_cat([]() {
+				constexpr auto field = FieldAt<ComponentType, Index>::c_field;
+				if constexpr (field.HasFlag(NoScript))
+				{
+					return std::tuple<>();
+				}
+				else
+				{
+					return std::make_tuple(field.m_scriptName, field.m_member);
+				}
+			}()...);
+		}(std::make_index_sequence<FieldCount<ComponentType>()>());
+		std::apply([&](auto&&... args) {
+			l.RegisterType<ComponentType>(typeName, args...);
+		}, scriptArgs);
+	}
+}
+}
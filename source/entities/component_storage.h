@@ -4,12 +4,25 @@
 #include "world.h"
 #include "core/profiler.h"
 #include "core/log.h"
+#include "core/paged_array.h"
 #include "engine/systems/job_system.h"
 #include "engine/serialiser.h"
+#include "raw_members.h"
 #include <vector>
+#include <memory>
 #include <unordered_map>
 #include <cassert>
 #include <algorithm>
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+// Paged storage allocates components in fixed-size pages on demand. Pages never move, so components can
+// be added during iteration + pointers remain valid until a component is destroyed or moved by a delete
+// Define R3_LINEAR_COMPONENT_STORAGE to store each component type in a single contiguous vector instead
+#ifndef R3_LINEAR_COMPONENT_STORAGE
+#define R3_PAGED_COMPONENT_STORAGE
+#endif
 
 namespace R3
 {
@@ -17,6 +30,17 @@ namespace Entities
 {
 	class World;
 
+	// Components can opt-in to raw binary serialisation by listing their members with GetRawMembers (see raw_members.h)
+	// Components with field descriptors + no SerialiseJson are raw serialisable if all fields are plain data (see engine/reflection.h)
+	template <typename T>
+	class ComponentIsRawSerialisable
+	{
+		template <typename C> static constexpr bool test(decltype(&C::GetRawMembers)) { return true; }
+		template <typename C> static constexpr bool test(...) { return !HasSerialiser<C>::value && Reflection::IsPlainDataStruct<C>(); }
+	public:
+		enum { value = test<T>(0) };
+	};
+
 	// Base class used just so we can have an array of these things
 	class ComponentStorage
 	{
@@ -31,6 +55,19 @@ namespace Entities
 		virtual void Destroy(const EntityHandle& e, uint32_t index) = 0;	// you must know the index to destroy a component (for speed)
 		virtual void DestroyAll() = 0;
 		virtual void Serialise(const EntityHandle& e, uint32_t index, JsonSerialiser& s) = 0;
+		virtual const EntityHandle& GetOwnerAtIndex(uint32_t index) = 0;
+		virtual void MoveTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex) = 0;	// move a component into an existing slot in another storage of the same type
+		virtual bool IsCopyable() = 0;
+		virtual void CopyTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex) = 0;	// as above but copies, only supported if IsCopyable() returns true
+		virtual void* GetComponentPointer(uint32_t index) = 0;	// untyped access, used to patch entity handles inside components
+		virtual std::unique_ptr<ComponentStorage> CreateSnapshot(World* snapshotWorld) = 0;	// copy of all components owned by snapshotWorld, returns null if the type is not copyable
+
+		// Raw binary serialisation, only supported if IsRawSerialisable() returns true
+		virtual bool IsRawSerialisable() = 0;
+		virtual uint32_t GetComponentSize() = 0;
+		virtual uint32_t GetRawSize() = 0;		// packed size of one component in raw data
+		virtual void WriteRaw(uint32_t index, uint32_t count, uint8_t* target) = 0;		// pack components [index, index + count) to target
+		virtual void ReadRaw(uint32_t index, uint32_t count, const uint8_t* src) = 0;	// overwrite existing components [index, index + count)
 	protected:
 		World* m_ownerWorld = nullptr;
 		uint32_t m_typeIndex = -1;
@@ -48,12 +85,23 @@ namespace Entities
 		virtual void Destroy(const EntityHandle& e, uint32_t index);
 		virtual void DestroyAll();
 		virtual void Serialise(const EntityHandle& e, uint32_t index, JsonSerialiser& s);
+		virtual const EntityHandle& GetOwnerAtIndex(uint32_t index) { return m_owners[index]; }
+		virtual void MoveTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex);
+		virtual bool IsCopyable() { return std::is_copy_assignable_v<ComponentType>; }
+		virtual void CopyTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex);
+		virtual void* GetComponentPointer(uint32_t index) { return GetAtIndex(index); }
+		virtual std::unique_ptr<ComponentStorage> CreateSnapshot(World* snapshotWorld);
+		virtual bool IsRawSerialisable() { return c_isRawSerialisable; }
+		virtual uint32_t GetComponentSize() { return sizeof(ComponentType); }
+		virtual uint32_t GetRawSize();
+		virtual void WriteRaw(uint32_t index, uint32_t count, uint8_t* target);
+		virtual void ReadRaw(uint32_t index, uint32_t count, const uint8_t* src);
 
 		// Fastpath API
 		ComponentType* GetAtIndex(uint32_t index);	// fastest path, direct random access, but no safety! not even a bounds check in release
 
-		// Slowpath API, only use for debugging
-		ComponentType* Find(uint32_t entityID);		// find component by entity public ID, does not need a valid handle!
+		// Find component by entity public ID, does not need a valid handle! (ID is resolved via the world)
+		ComponentType* Find(uint32_t entityID);
 
 		// It = bool(const EntityHandle& e, ComponentType& cmp)
 		// Returns early if the iterator returns false
@@ -66,8 +114,18 @@ namespace Entities
 		void ForEachAsync(uint32_t componentsPerJob, const It& fn);
 
 	private:
+		static constexpr bool c_isRawSerialisable = ComponentIsRawSerialisable<ComponentType>::value;
+		template<class CopyFn>	// void(ComponentType* components, uint32_t count, size_t offset)
+		void ForEachContiguousRange(uint32_t index, uint32_t count, const CopyFn& fn);
+#ifdef R3_PAGED_COMPONENT_STORAGE
+		static constexpr size_t c_pageSizeBytes = 16 * 1024;	// aim for roughly this many bytes per page of components
+		static constexpr uint32_t c_componentsPerPage = static_cast<uint32_t>(std::bit_floor(std::max(size_t(1), c_pageSizeBytes / sizeof(ComponentType))));
+		PagedArray<EntityHandle, c_componentsPerPage> m_owners;	// these are entity IDs
+		PagedArray<ComponentType, c_componentsPerPage> m_components;
+#else
 		std::vector<EntityHandle> m_owners;	// these are entity IDs
 		std::vector<ComponentType> m_components;
+#endif
 		int32_t m_iterationDepth = 0;	// this is a safety net to catch if we delete during iteration
 		uint64_t m_generation = 1;		// increases every time the existing pointers/storage are changed 
 	};
@@ -76,8 +134,15 @@ namespace Entities
 	LinearComponentStorage< ComponentType>::LinearComponentStorage(World* w, uint32_t typeIndex, uint32_t initialCapacity)
 		: ComponentStorage(w, typeIndex)
 	{
+#ifdef R3_PAGED_COMPONENT_STORAGE
+		// only the page tables are reserved, pages are allocated as they are needed
+		const size_t pageCount = (initialCapacity + c_componentsPerPage - 1) / c_componentsPerPage;
+		m_owners.reserve_pages(pageCount);
+		m_components.reserve_pages(pageCount);
+#else
 		m_owners.reserve(initialCapacity);
 		m_components.reserve(initialCapacity);
+#endif
 	}
 
 	template<class ComponentType>
@@ -107,6 +172,144 @@ namespace Entities
 		}
 	}
 
+	template<class ComponentType>
+	void LinearComponentStorage<ComponentType>::MoveTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex)
+	{
+		auto& typedTarget = static_cast<LinearComponentStorage<ComponentType>&>(target);
+		assert(typedTarget.m_typeIndex == m_typeIndex);
+		*typedTarget.GetAtIndex(targetIndex) = std::move(*GetAtIndex(index));
+	}
+
+	template<class ComponentType>
+	void LinearComponentStorage<ComponentType>::CopyTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex)
+	{
+		assert(IsCopyable());
+		if constexpr (std::is_copy_assignable_v<ComponentType>)
+		{
+			auto& typedTarget = static_cast<LinearComponentStorage<ComponentType>&>(target);
+			assert(typedTarget.m_typeIndex == m_typeIndex);
+			*typedTarget.GetAtIndex(targetIndex) = *GetAtIndex(index);
+		}
+	}
+
+	template<class ComponentType>
+	std::unique_ptr<ComponentStorage> LinearComponentStorage<ComponentType>::CreateSnapshot(World* snapshotWorld)
+	{
+		R3_PROF_EVENT();
+		if constexpr (std::is_copy_constructible_v<ComponentType>)
+		{
+			const uint32_t count = static_cast<uint32_t>(m_components.size());
+			auto snapshot = std::make_unique<LinearComponentStorage<ComponentType>>(snapshotWorld, m_typeIndex, count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				snapshot->m_owners.push_back(m_owners[i]);
+			}
+			if constexpr (std::is_trivially_copyable_v<ComponentType>)
+			{
+				// bulk copy, both storages have the same page layout so the ranges match up
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					snapshot->m_components.emplace_back();
+				}
+				ForEachContiguousRange(0, count, [&snapshot](ComponentType* components, uint32_t rangeCount, size_t offset) {
+					memcpy(&snapshot->m_components[offset], components, rangeCount * sizeof(ComponentType));
+				});
+			}
+			else
+			{
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					snapshot->m_components.push_back(m_components[i]);
+				}
+			}
+			return snapshot;
+		}
+		return nullptr;
+	}
+
+	template<class ComponentType>
+	template<class CopyFn>
+	void LinearComponentStorage<ComponentType>::ForEachContiguousRange(uint32_t index, uint32_t count, const CopyFn& fn)
+	{
+		assert(index + count <= m_components.size());
+#ifdef R3_PAGED_COMPONENT_STORAGE
+		size_t offset = 0;
+		while (count > 0)	// components are only contiguous within a page
+		{
+			const uint32_t rangeCount = std::min(count, c_componentsPerPage - (index & (c_componentsPerPage - 1)));
+			fn(&m_components[index], rangeCount, offset);
+			index += rangeCount;
+			count -= rangeCount;
+			offset += rangeCount;
+		}
+#else
+		if (count > 0)
+		{
+			fn(&m_components[index], count, 0);
+		}
+#endif
+	}
+
+	template<class ComponentType>
+	uint32_t LinearComponentStorage<ComponentType>::GetRawSize()
+	{
+		if constexpr (c_isRawSerialisable)
+		{
+			static_assert(RawMembers::AllMembersAreRaw<ComponentType>(), "Raw serialised members must be scalars, enums or glm types");
+			return RawMembers::PackedSize<ComponentType>();
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
+	template<class ComponentType>
+	void LinearComponentStorage<ComponentType>::WriteRaw(uint32_t index, uint32_t count, uint8_t* target)
+	{
+		assert(c_isRawSerialisable);
+		if constexpr (c_isRawSerialisable)
+		{
+			constexpr uint32_t c_rawSize = RawMembers::PackedSize<ComponentType>();
+			ForEachContiguousRange(index, count, [target](ComponentType* components, uint32_t rangeCount, size_t offset) {
+				if constexpr (RawMembers::IsStoredWhole<ComponentType>())
+				{
+					memcpy(target + offset * c_rawSize, components, rangeCount * sizeof(ComponentType));
+				}
+				else
+				{
+					for (uint32_t i = 0; i < rangeCount; ++i)
+					{
+						RawMembers::Write(components[i], target + (offset + i) * c_rawSize);
+					}
+				}
+			});
+		}
+	}
+
+	template<class ComponentType>
+	void LinearComponentStorage<ComponentType>::ReadRaw(uint32_t index, uint32_t count, const uint8_t* src)
+	{
+		assert(c_isRawSerialisable);
+		if constexpr (c_isRawSerialisable)
+		{
+			constexpr uint32_t c_rawSize = RawMembers::PackedSize<ComponentType>();
+			ForEachContiguousRange(index, count, [src](ComponentType* components, uint32_t rangeCount, size_t offset) {
+				if constexpr (RawMembers::IsStoredWhole<ComponentType>())
+				{
+					memcpy(components, src + offset * c_rawSize, rangeCount * sizeof(ComponentType));
+				}
+				else
+				{
+					for (uint32_t i = 0; i < rangeCount; ++i)
+					{
+						RawMembers::Read(components[i], src + (offset + i) * c_rawSize);
+					}
+				}
+			});
+		}
+	}
+
 	template<class ComponentType>
 	ComponentType* LinearComponentStorage<ComponentType>::GetAtIndex(uint32_t index)
 	{
@@ -126,14 +329,14 @@ namespace Entities
 		assert(m_owners.size() == m_components.size());
 
 		// more safety nets, ensure storage doesn't move
-		void* storagePtr = m_components.data();
+		const uint64_t generation = m_generation;
 
 		auto jobs = Systems::GetSystem<JobSystem>();
 		jobs->ForEachAsync(JobSystem::ThreadPool::FastJobs, 0, (uint32_t)m_components.size(), 1, componentsPerJob, [this, fn](uint32_t i) {
 			fn(m_owners[i], m_components[i]);
 		});
 
-		if (storagePtr != m_components.data())
+		if (generation != m_generation)
 		{
 			LogError("NO! Storage ptr was changed during iteration!");
 			assert(!"NO! Storage ptr was changed during iteration!");
@@ -155,16 +358,31 @@ namespace Entities
 		assert(m_owners.size() == m_components.size());
 
 		// more safety nets, ensure storage doesn't move
-		void* storagePtr = m_components.data();
+		const uint64_t generation = m_generation;
 
 		auto currentActiveComponents = m_components.size();
+#ifdef R3_PAGED_COMPONENT_STORAGE
+		// walk each page with plain pointers, pages never move so this is still safe if components are added
+		bool keepGoing = true;
+		for (size_t pageStart = 0; pageStart < currentActiveComponents && keepGoing; pageStart += c_componentsPerPage)
+		{
+			const size_t pageEnd = std::min(currentActiveComponents, pageStart + c_componentsPerPage);
+			const EntityHandle* owners = &m_owners[pageStart];
+			ComponentType* components = &m_components[pageStart];
+			for (size_t c = 0; c < pageEnd - pageStart && keepGoing; ++c)
+			{
+				keepGoing = fn(owners[c], components[c]);
+			}
+		}
+#else
 		for (int c = 0; c < currentActiveComponents; ++c)
 		{
 			if (!fn(m_owners[c], m_components[c]))
 				break;
 		}
+#endif
 
-		if (storagePtr != m_components.data())
+		if (generation != m_generation)
 		{
 			LogError("NO! Storage ptr was changed during iteration!");
 			assert(!"NO! Storage ptr was changed during iteration!");
@@ -177,19 +395,8 @@ namespace Entities
 	template<class ComponentType>
 	ComponentType* LinearComponentStorage<ComponentType>::Find(uint32_t entityID)
 	{
-		R3_PROF_EVENT();
-		auto found = std::find_if(m_owners.begin(), m_owners.end(), [entityID](const EntityHandle& e) {
-			return e.GetID() == entityID;
-		});
-		if (found == m_owners.end())
-		{
-			return nullptr;
-		}
-		else
-		{
-			const auto index = std::distance(m_owners.begin(), found);
-			return &m_components[index];
-		}
+		const EntityHandle owner = m_ownerWorld->GetEntityFromID(entityID);
+		return m_ownerWorld->GetComponent<ComponentType>(owner);
 	}
 
 	template<class ComponentType>
@@ -198,11 +405,13 @@ namespace Entities
 		R3_PROF_EVENT();
 
 		// assert(Find(e.GetID()) == nullptr);		// safety check for duplicates (very slow)
+#ifndef R3_PAGED_COMPONENT_STORAGE
 		size_t oldCapacity = m_components.capacity();
 		if (m_components.size() + 1 >= oldCapacity)
 		{
 			++m_generation;	// pointers are about to be invalidated
 		}
+#endif
 		m_owners.push_back(e);
 		m_components.emplace_back();
 		assert(m_owners.size() == m_components.size());
@@ -236,8 +445,8 @@ namespace Entities
 				// inform the world so the entity data can be updated correctly
 				// we do it first to ensure the entity data NEVER has an out-of-bounds index
 				m_ownerWorld->OnComponentMoved(m_owners[oldIndex], m_typeIndex, oldIndex, index);
-				std::iter_swap(m_owners.begin() + index, m_owners.end() - 1);
-				std::iter_swap(m_components.begin() + index, m_components.end() - 1);
+				std::swap(m_owners[index], m_owners[oldIndex]);
+				std::swap(m_components[index], m_components[oldIndex]);
 			}
 			m_owners.pop_back();
 			m_components.pop_back();
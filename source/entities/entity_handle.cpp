@@ -5,14 +5,12 @@ namespace R3
 {
 	namespace Entities
 	{
-		EntityHandle::OnLoaded EntityHandle::m_onLoadedFn = nullptr;
-
 		void EntityHandle::SerialiseJson(class JsonSerialiser& json)
 		{
 			json("ID", m_publicID);
-			if (json.GetMode() == JsonSerialiser::Read && m_onLoadedFn)
+			if (json.GetMode() == JsonSerialiser::Read && json.GetEntityRemap())
 			{
-				m_onLoadedFn(*this);
+				(*json.GetEntityRemap())(*this);
 			}
 		}
 	}
@@ -20,14 +20,11 @@ namespace R3
 				return m_publicID == e.m_publicID && m_privateIndex == e.m_privateIndex;
 			}
 
-			// We need to remap entity IDs during loading, this allows you to intercept every serialised handle
-			using OnLoaded = std::function<void(EntityHandle&)>;
-			static void SetOnLoadFinishCallback(OnLoaded fn) { m_onLoadedFn = fn; }
+			// IDs are remapped during loading via the entity remap fn of the serialiser (see JsonSerialiser::SetEntityRemap)
 			void SerialiseJson(JsonSerialiser& json);
 		private:
 			uint32_t m_publicID = -1;
 			uint32_t m_privateIndex = -1;
-			static OnLoaded m_onLoadedFn;
 		};
 	}
 }
\ No newline at end of file
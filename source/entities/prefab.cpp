@@ -0,0 +1,258 @@
+#include "prefab.h"
+#include "world.h"
+#include "component_storage.h"
+#include "component_type_registry.h"
+#include "core/profiler.h"
+#include "core/log.h"
+#include <cassert>
+
+namespace R3
+{
+namespace Entities
+{
+	Prefab::Prefab()
+	{
+	}
+
+	Prefab::~Prefab()
+	{
+	}
+
+	Prefab::Prefab(Prefab&&) = default;
+	Prefab& Prefab::operator=(Prefab&&) = default;
+
+	void Prefab::Clear()
+	{
+		m_parentRows.clear();
+		m_names.clear();
+		m_sourceIDToRow.clear();
+		m_columns.clear();
+	}
+
+	bool Prefab::Compile(World& source, const std::vector<EntityHandle>& entities)
+	{
+		R3_PROF_EVENT();
+		Clear();
+
+		// assign rows to entities
+		std::vector<EntityHandle> rowEntities;
+		rowEntities.reserve(entities.size());
+		for (const auto& e : entities)
+		{
+			if (source.IsHandleValid(e) && FindRow(e.GetID()) == -1)
+			{
+				if (e.GetID() >= m_sourceIDToRow.size())
+				{
+					m_sourceIDToRow.resize(e.GetID() + 1, -1);
+				}
+				m_sourceIDToRow[e.GetID()] = static_cast<uint32_t>(rowEntities.size());
+				rowEntities.push_back(e);
+			}
+		}
+		const uint32_t rowCount = static_cast<uint32_t>(rowEntities.size());
+		m_parentRows.resize(rowCount, -1);
+		m_names.resize(rowCount);
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			const EntityHandle parent = source.GetParent(rowEntities[row]);
+			m_parentRows[row] = source.IsHandleValid(parent) ? FindRow(parent.GetID()) : -1;
+			m_names[row] = source.GetEntityName(rowEntities[row]);
+		}
+
+		// copy all components into prototype storage, one column per type
+		const auto& allTypes = ComponentTypeRegistry::GetInstance().AllTypes();
+		for (uint32_t typeIndex = 0; typeIndex < source.m_allComponents.size(); ++typeIndex)
+		{
+			ComponentStorage* sourceStorage = source.m_allComponents[typeIndex].get();
+			if (sourceStorage == nullptr || sourceStorage->GetTotalCount() == 0)
+			{
+				continue;
+			}
+			Column column;
+			column.m_typeIndex = typeIndex;
+			column.m_prototypes = allTypes[typeIndex].m_storageFactory(nullptr);	// prototypes do not belong to a world
+			const uint32_t componentSize = column.m_prototypes->GetComponentSize();
+
+			// copy each component via a binary archive, any entity handles encountered while reading are recorded as patches
+			uint32_t currentComponent = 0;
+			uint8_t* currentPtr = nullptr;
+			const JsonSerialiser::EntityRemapFn recordHandle = [&](EntityHandle& h) {
+				const uint32_t row = FindRow(h.GetID());
+				const size_t offset = reinterpret_cast<uint8_t*>(&h) - currentPtr;
+				if (reinterpret_cast<uint8_t*>(&h) < currentPtr || offset + sizeof(EntityHandle) > componentSize)
+				{
+					column.m_useArchive = true;	// handle is not stored in the component itself, we cannot patch it
+				}
+				else if (row != -1)
+				{
+					column.m_patches.push_back({ currentComponent, static_cast<uint32_t>(offset), row });
+				}
+				if (row == -1 && h.GetID() != -1)
+				{
+					h = source.GetEntityFromID(h.GetID());	// external references keep pointing at the source world entity
+				}
+			};
+			BinaryArchive& archive = column.m_archive;
+			for (uint32_t row = 0; row < rowCount; ++row)
+			{
+				const uint32_t sourceIndex = source.m_allEntities[rowEntities[row].GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex);
+				if (sourceIndex == -1)
+				{
+					continue;
+				}
+				const size_t block = archive.BeginBlock();
+				JsonSerialiser writeArchive(JsonSerialiser::Write, &archive);
+				sourceStorage->Serialise(rowEntities[row], sourceIndex, writeArchive);
+				archive.EndBlock(block);
+				const EntityHandle prototypeOwner(row, row);
+				currentComponent = column.m_prototypes->Create(prototypeOwner);
+				currentPtr = static_cast<uint8_t*>(column.m_prototypes->GetComponentPointer(currentComponent));
+				const BinaryArchive readArchive(archive.GetData().data(), archive.GetData().size());
+				size_t readOffset = block;
+				JsonSerialiser readComponent(&readArchive, readArchive.ReadBlock(readOffset, readArchive.GetReadSize()), &recordHandle);
+				column.m_prototypes->Serialise(prototypeOwner, currentComponent, readComponent);
+				column.m_ownerRows.push_back(row);
+			}
+			if (column.m_ownerRows.size() == 0)
+			{
+				continue;
+			}
+			if (!column.m_prototypes->IsCopyable())
+			{
+				column.m_useArchive = true;
+			}
+			if (column.m_useArchive)
+			{
+				column.m_patches.clear();
+				column.m_archive = BinaryArchive(std::move(archive.GetData()));	// switch the archive to reading
+				size_t offset = 0;
+				for (size_t c = 0; c < column.m_ownerRows.size(); ++c)
+				{
+					column.m_archiveBlocks.push_back(column.m_archive.ReadBlock(offset, column.m_archive.GetReadSize()));
+				}
+			}
+			else
+			{
+				column.m_archive = BinaryArchive();
+				if (column.m_prototypes->IsRawSerialisable())
+				{
+					column.m_rawData.resize(column.m_ownerRows.size() * static_cast<size_t>(column.m_prototypes->GetRawSize()));
+					column.m_prototypes->WriteRaw(0, static_cast<uint32_t>(column.m_ownerRows.size()), column.m_rawData.data());
+				}
+			}
+			m_columns.push_back(std::move(column));
+		}
+		return rowCount > 0;
+	}
+
+	std::vector<EntityHandle> Prefab::Instantiate(World& target, uint32_t count) const
+	{
+		std::vector<EntityHandle> createdHandles;
+		Instantiate(target, count, createdHandles);
+		return createdHandles;
+	}
+
+	void Prefab::Instantiate(World& target, uint32_t count, std::vector<EntityHandle>& createdHandles) const
+	{
+		R3_PROF_EVENT();
+		const uint32_t rowCount = GetEntityCount();
+		const size_t firstHandle = createdHandles.size();
+		createdHandles.reserve(firstHandle + static_cast<size_t>(count) * rowCount);
+		{
+			R3_PROF_EVENT("CreateEntities");
+			for (uint32_t i = 0; i < count * rowCount; ++i)
+			{
+				createdHandles.push_back(target.AddEntity());
+			}
+			for (uint32_t instance = 0; instance < count; ++instance)
+			{
+				const EntityHandle* instanceHandles = &createdHandles[firstHandle + static_cast<size_t>(instance) * rowCount];
+				for (uint32_t row = 0; row < rowCount; ++row)
+				{
+					if (m_parentRows[row] != -1)
+					{
+						target.SetParent(instanceHandles[row], instanceHandles[m_parentRows[row]]);
+					}
+					if (!m_names[row].empty())
+					{
+						target.SetEntityName(instanceHandles[row], m_names[row]);
+					}
+				}
+			}
+		}
+
+		const auto& allTypes = ComponentTypeRegistry::GetInstance().AllTypes();
+		for (const Column& column : m_columns)
+		{
+			R3_PROF_EVENT("CopyColumn");
+			const uint32_t typeIndex = column.m_typeIndex;
+			const uint32_t componentCount = static_cast<uint32_t>(column.m_ownerRows.size());
+			ComponentStorage* storage = target.GetOrCreateStorage(typeIndex);
+
+			// components are appended to the end of the storage, so we can usually copy all of them at once
+			const uint32_t firstIndex = storage->GetTotalCount();
+			bool isContiguous = true;
+			for (uint32_t instance = 0; instance < count; ++instance)
+			{
+				const EntityHandle* instanceHandles = &createdHandles[firstHandle + static_cast<size_t>(instance) * rowCount];
+				for (uint32_t c = 0; c < componentCount; ++c)
+				{
+					const EntityHandle& owner = instanceHandles[column.m_ownerRows[c]];
+					target.AddComponentInternal(owner, typeIndex);
+					isContiguous &= (target.m_allEntities[owner.GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex) == firstIndex + instance * componentCount + c);
+				}
+			}
+			auto getTargetIndex = [&](uint32_t instance, uint32_t c) {
+				if (isContiguous)
+				{
+					return firstIndex + instance * componentCount + c;
+				}
+				const EntityHandle& owner = createdHandles[firstHandle + static_cast<size_t>(instance) * rowCount + column.m_ownerRows[c]];
+				return target.m_allEntities[owner.GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex);
+			};
+
+			for (uint32_t instance = 0; instance < count; ++instance)
+			{
+				const EntityHandle* instanceHandles = &createdHandles[firstHandle + static_cast<size_t>(instance) * rowCount];
+				if (column.m_useArchive)
+				{
+					const JsonSerialiser::EntityRemapFn remapFn = [&](EntityHandle& h) {
+						const uint32_t row = FindRow(h.GetID());
+						h = (row != -1) ? instanceHandles[row] : target.GetEntityFromID(h.GetID());
+					};
+					const std::string& typeName = allTypes[typeIndex].m_name;
+					for (uint32_t c = 0; c < componentCount; ++c)
+					{
+						try
+						{
+							JsonSerialiser componentArchive(&column.m_archive, column.m_archiveBlocks[c], &remapFn);
+							storage->Serialise(instanceHandles[column.m_ownerRows[c]], getTargetIndex(instance, c), componentArchive);
+						}
+						catch (std::exception e)
+						{
+							LogError("Failed to instantiate component {} - {}", typeName, e.what());
+						}
+					}
+					continue;
+				}
+				if (column.m_rawData.size() > 0 && isContiguous)
+				{
+					storage->ReadRaw(getTargetIndex(instance, 0), componentCount, column.m_rawData.data());
+				}
+				else
+				{
+					for (uint32_t c = 0; c < componentCount; ++c)
+					{
+						column.m_prototypes->CopyTo(c, *storage, getTargetIndex(instance, c));
+					}
+				}
+				for (const HandlePatch& patch : column.m_patches)
+				{
+					uint8_t* component = static_cast<uint8_t*>(storage->GetComponentPointer(getTargetIndex(instance, patch.m_component)));
+					*reinterpret_cast<EntityHandle*>(component + patch.m_offset) = instanceHandles[patch.m_row];
+				}
+			}
+		}
+	}
+}
+}
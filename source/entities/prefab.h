@@ -0,0 +1,63 @@
+#pragma once
+#include "entity_handle.h"
+#include "engine/serialiser.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+// A set of entities compiled once into a template that can be instantiated many times
+// Components are copied directly from prototypes (raw components are copied in bulk), no json is involved unless required
+// Entity handles inside components that reference entities in the prefab are patched via a flat table of byte offsets
+// Components that store handles outside of the component itself (e.g. in a vector) fall back to serialisation via a binary archive
+namespace R3
+{
+namespace Entities
+{
+	class World;
+	class ComponentStorage;
+	class Prefab
+	{
+	public:
+		Prefab();
+		~Prefab();
+		Prefab(Prefab&&);
+		Prefab& operator=(Prefab&&);
+
+		// Compile from a set of entities, children are not included automatically
+		// Handles that reference entities outside the set are copied as-is, parents outside the set are not kept
+		bool Compile(World& source, const std::vector<EntityHandle>& entities);
+		void Clear();
+		bool IsEmpty() const { return m_parentRows.size() == 0; }
+		uint32_t GetEntityCount() const { return static_cast<uint32_t>(m_parentRows.size()); }
+
+		// Create count copies, returns GetEntityCount() handles per instance (in the order they were compiled)
+		std::vector<EntityHandle> Instantiate(World& target, uint32_t count = 1) const;
+		void Instantiate(World& target, uint32_t count, std::vector<EntityHandle>& createdHandles) const;
+
+	private:
+		struct HandlePatch
+		{
+			uint32_t m_component;	// index into the column
+			uint32_t m_offset;		// byte offset of the handle in the component
+			uint32_t m_row;			// the entity the handle references
+		};
+		struct Column		// all components of a single type
+		{
+			uint32_t m_typeIndex = -1;
+			std::vector<uint32_t> m_ownerRows;
+			std::unique_ptr<ComponentStorage> m_prototypes;	// matches m_ownerRows, not owned by any world
+			std::vector<uint8_t> m_rawData;				// raw components are copied in bulk from here
+			std::vector<HandlePatch> m_patches;
+			BinaryArchive m_archive;						// one block per component, only used if m_useArchive is set
+			std::vector<BinaryArchive::Range> m_archiveBlocks;
+			bool m_useArchive = false;
+		};
+		uint32_t FindRow(uint32_t sourceID) const { return sourceID < m_sourceIDToRow.size() ? m_sourceIDToRow[sourceID] : -1; }
+
+		std::vector<uint32_t> m_parentRows;			// row of the parent entity or -1
+		std::vector<std::string> m_names;
+		std::vector<uint32_t> m_sourceIDToRow;		// flat table, public ID in the source world -> row
+		std::vector<Column> m_columns;
+	};
+}
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include "core/glm_headers.h"
+#include "engine/reflection.h"
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <stdint.h>
+
+// Raw binary serialisation (binary worlds + prefabs) copies components one member at a time into packed data
+// Components opt-in by listing the members to copy, e.g.
+//	static constexpr auto GetRawMembers() { return std::make_tuple(&MyComponent::m_position, &MyComponent::m_enabled); }
+// Only list plain data members (scalars, enums + glm types, see Reflection::IsPlainData). Never entity handles, pointers or asset handles!
+// Components with field descriptors that are all plain data are copied via their fields instead (see engine/reflection.h)
+// Padding is never copied (e.g. the 4th lane of an aligned glm::vec3), so raw data never contains uninitialised memory
+namespace R3
+{
+namespace Entities
+{
+namespace RawMembers
+{
+	// scalars are 1x1, glm vectors + quaternions are 1xN, matrices are columns x rows
+	template<class T> struct MemberLayout
+	{
+		using Scalar = T;
+		static constexpr uint32_t c_columns = 1;
+		static constexpr uint32_t c_rows = 1;
+	};
+	template<glm::length_t L, class T, glm::qualifier Q> struct MemberLayout<glm::vec<L, T, Q>>
+	{
+		using Scalar = T;
+		static constexpr uint32_t c_columns = 1;
+		static constexpr uint32_t c_rows = L;
+	};
+	template<class T, glm::qualifier Q> struct MemberLayout<glm::qua<T, Q>>
+	{
+		using Scalar = T;
+		static constexpr uint32_t c_columns = 1;
+		static constexpr uint32_t c_rows = 4;
+	};
+	template<glm::length_t C, glm::length_t R, class T, glm::qualifier Q> struct MemberLayout<glm::mat<C, R, T, Q>>
+	{
+		using Scalar = T;
+		static constexpr uint32_t c_columns = C;
+		static constexpr uint32_t c_rows = R;
+	};
+
+	template<class T> constexpr bool IsRawMember()
+	{
+		return Reflection::IsPlainData<T>();
+	}
+
+	// packed size of a member, glm types only store their components
+	template<class T> constexpr uint32_t MemberSize()
+	{
+		return MemberLayout<T>::c_columns * MemberLayout<T>::c_rows * sizeof(typename MemberLayout<T>::Scalar);
+	}
+
+	template<class T> void WriteMember(const T& v, uint8_t* target)
+	{
+		if constexpr (MemberLayout<T>::c_columns > 1)	// matrix columns may be padded
+		{
+			constexpr size_t c_columnSize = MemberLayout<T>::c_rows * sizeof(typename MemberLayout<T>::Scalar);
+			for (uint32_t c = 0; c < MemberLayout<T>::c_columns; ++c)
+			{
+				memcpy(target + c * c_columnSize, &v[c], c_columnSize);
+			}
+		}
+		else
+		{
+			memcpy(target, &v, MemberSize<T>());
+		}
+	}
+
+	template<class T> void ReadMember(T& v, const uint8_t* src)
+	{
+		if constexpr (MemberLayout<T>::c_columns > 1)	// matrix columns may be padded
+		{
+			constexpr size_t c_columnSize = MemberLayout<T>::c_rows * sizeof(typename MemberLayout<T>::Scalar);
+			for (uint32_t c = 0; c < MemberLayout<T>::c_columns; ++c)
+			{
+				memcpy(&v[c], src + c * c_columnSize, c_columnSize);
+			}
+		}
+		else
+		{
+			memcpy(&v, src, MemberSize<T>());
+		}
+	}
+
+	template <typename T>		// SFINAE trick to detect GetRawMembers fn
+	class HasRawMembers
+	{
+		typedef char one;
+		typedef long two;
+		template <typename C> static one test(decltype(&C::GetRawMembers));
+		template <typename C> static two test(...);
+	public:
+		enum { value = sizeof(test<T>(0)) == sizeof(char) };
+	};
+
+	// tuple of member pointers, from GetRawMembers or the field descriptors
+	template<class T> constexpr auto GetMembers()
+	{
+		if constexpr (HasRawMembers<T>::value)
+		{
+			return T::GetRawMembers();
+		}
+		else
+		{
+			return std::apply([](auto... fields) { return std::make_tuple(fields.m_member...); }, T::GetFields());
+		}
+	}
+
+	template<class C, class M> constexpr bool IsRawMember(M C::*) { return IsRawMember<M>(); }
+	template<class C, class M> constexpr uint32_t MemberSize(M C::*) { return MemberSize<M>(); }
+
+	template<class T> constexpr bool AllMembersAreRaw()
+	{
+		return std::apply([](auto... members) { return (IsRawMember(members) && ...); }, GetMembers<T>());
+	}
+
+	// size of one packed component
+	template<class T> constexpr uint32_t PackedSize()
+	{
+		return std::apply([](auto... members) { return (uint32_t(0) + ... + MemberSize(members)); }, GetMembers<T>());
+	}
+
+	// if the members cover every byte of T it is stored as a straight copy
+	template<class T> constexpr bool IsStoredWhole()
+	{
+		return std::has_unique_object_representations_v<T> && PackedSize<T>() == sizeof(T);
+	}
+
+	template<class T> void Write(const T& component, uint8_t* target)
+	{
+		std::apply([&](auto... members) {
+			((WriteMember(component.*members, target), target += MemberSize(members)), ...);
+		}, GetMembers<T>());
+	}
+
+	template<class T> void Read(T& component, const uint8_t* src)
+	{
+		std::apply([&](auto... members) {
+			((ReadMember(component.*members, src), src += MemberSize(members)), ...);
+		}, GetMembers<T>());
+	}
+}
+}
+}
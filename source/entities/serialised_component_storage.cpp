@@ -0,0 +1,111 @@
+#include "serialised_component_storage.h"
+
+namespace R3
+{
+namespace Entities
+{
+	SerialisedComponentStorage::SerialisedComponentStorage(World* w, uint32_t typeIndex, ComponentStorage& source, bool binary)
+		: ComponentStorage(w, typeIndex)
+		, m_binary(binary)
+	{
+		R3_PROF_EVENT();
+		const uint32_t count = source.GetTotalCount();
+		m_owners.reserve(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const EntityHandle& owner = source.GetOwnerAtIndex(i);
+			m_owners.push_back(owner);
+			if (m_binary)
+			{
+				const size_t begin = m_archive.GetData().size();
+				JsonSerialiser componentArchive(JsonSerialiser::Write, &m_archive);
+				source.Serialise(owner, i, componentArchive);
+				m_ranges.push_back({ begin, m_archive.GetData().size() });
+			}
+			else
+			{
+				JsonSerialiser componentJson(JsonSerialiser::Write);
+				source.Serialise(owner, i, componentJson);
+				m_json.push_back(std::move(componentJson.GetJson()));
+			}
+		}
+	}
+
+	void SerialisedComponentStorage::GetMemoryUsage(size_t& totalBytesAllocated, size_t& totalBytesUsed)
+	{
+		const size_t entityMemTotal = m_owners.capacity() * sizeof(EntityHandle);
+		const size_t entityMemUsed = m_owners.size() * sizeof(EntityHandle);
+		const size_t dataMemTotal = m_archive.GetData().capacity() + m_ranges.capacity() * sizeof(BinaryArchive::Range) + m_json.capacity() * sizeof(nlohmann::json);
+		const size_t dataMemUsed = m_archive.GetData().size() + m_ranges.size() * sizeof(BinaryArchive::Range) + m_json.size() * sizeof(nlohmann::json);
+		totalBytesAllocated = entityMemTotal + dataMemTotal;
+		totalBytesUsed = entityMemUsed + dataMemUsed;
+	}
+
+	uint32_t SerialisedComponentStorage::Create(const EntityHandle& e)
+	{
+		assert(!"Serialised storage cannot create components");
+		return -1;
+	}
+
+	void SerialisedComponentStorage::Destroy(const EntityHandle& e, uint32_t index)
+	{
+		assert(!"Serialised storage cannot destroy components");
+	}
+
+	void SerialisedComponentStorage::DestroyAll()
+	{
+		m_owners.clear();
+		m_json.clear();
+		m_archive = BinaryArchive();
+		m_ranges.clear();
+	}
+
+	void SerialisedComponentStorage::Serialise(const EntityHandle& e, uint32_t index, JsonSerialiser& s)
+	{
+		if (index == -1 || index >= m_owners.size() || e.GetID() == -1 || e.GetPrivateIndex() == -1)
+		{
+			return;
+		}
+		assert(m_owners[index] == e);
+		assert(s.GetMode() == JsonSerialiser::Write);
+		if (m_owners[index] != e || s.GetMode() != JsonSerialiser::Write)
+		{
+			return;
+		}
+		if (s.IsBinary() != m_binary)
+		{
+			LogError("Serialised components cannot be written in a different format to the one they were captured in");
+			return;
+		}
+		if (m_binary)
+		{
+			const BinaryArchive::Range& range = m_ranges[index];
+			s.GetArchive()->WriteBytes(m_archive.GetData().data() + range.m_begin, range.m_end - range.m_begin);
+		}
+		else
+		{
+			s.GetJson().update(m_json[index]);
+		}
+	}
+
+	void SerialisedComponentStorage::MoveTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex)
+	{
+		assert(!"Serialised storage cannot move components");
+	}
+
+	void SerialisedComponentStorage::CopyTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex)
+	{
+		assert(!"Serialised storage cannot copy components");
+	}
+
+	void SerialisedComponentStorage::WriteRaw(uint32_t index, uint32_t count, uint8_t* target)
+	{
+		assert(!"Serialised storage is not raw serialisable");
+	}
+
+	void SerialisedComponentStorage::ReadRaw(uint32_t index, uint32_t count, const uint8_t* src)
+	{
+		assert(!"Serialised storage is not raw serialisable");
+	}
+}
+}
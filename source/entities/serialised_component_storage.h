@@ -0,0 +1,43 @@
+#pragma once
+#include "component_storage.h"
+
+// Storage used by world snapshots for components that cannot be copied as raw data
+// Components are serialised when the snapshot is taken, on the thread that owns the world
+// Asset handles + scripts are resolved there, saving the snapshot just replays the serialised data
+// Only serialisation is supported, the components themselves are not kept
+namespace R3
+{
+namespace Entities
+{
+	class SerialisedComponentStorage : public ComponentStorage
+	{
+	public:
+		// serialises every component in source, binary = BinaryArchive data, otherwise json
+		SerialisedComponentStorage(World* w, uint32_t typeIndex, ComponentStorage& source, bool binary);
+		virtual void GetMemoryUsage(size_t& totalBytesAllocated, size_t& totalBytesUsed);
+		virtual uint32_t GetTotalCount() { return static_cast<uint32_t>(m_owners.size()); }
+		virtual uint32_t Create(const EntityHandle& e);
+		virtual void Destroy(const EntityHandle& e, uint32_t index);
+		virtual void DestroyAll();
+		virtual void Serialise(const EntityHandle& e, uint32_t index, JsonSerialiser& s);	// writes only, in the format passed to the constructor
+		virtual const EntityHandle& GetOwnerAtIndex(uint32_t index) { return m_owners[index]; }
+		virtual void MoveTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex);
+		virtual bool IsCopyable() { return false; }
+		virtual void CopyTo(uint32_t index, ComponentStorage& target, uint32_t targetIndex);
+		virtual void* GetComponentPointer(uint32_t index) { return nullptr; }
+		virtual std::unique_ptr<ComponentStorage> CreateSnapshot(World* snapshotWorld) { return nullptr; }
+		virtual bool IsRawSerialisable() { return false; }
+		virtual uint32_t GetComponentSize() { return 0; }
+		virtual uint32_t GetRawSize() { return 0; }
+		virtual void WriteRaw(uint32_t index, uint32_t count, uint8_t* target);
+		virtual void ReadRaw(uint32_t index, uint32_t count, const uint8_t* src);
+
+	private:
+		bool m_binary = false;
+		std::vector<EntityHandle> m_owners;
+		std::vector<nlohmann::json> m_json;				// one object per component if !m_binary
+		BinaryArchive m_archive;						// all components if m_binary
+		std::vector<BinaryArchive::Range> m_ranges;		// the data of each component in m_archive
+	};
+}
+}
@@ -2,6 +2,10 @@
 #include "entities/world.h"
 #include "engine/ui/imgui_menubar_helper.h"
 #include "core/profiler.h"
+#include "core/log.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
 #include <cassert>
 #include <imgui.h>
 
@@ -26,6 +30,12 @@ namespace Entities
 		RegisterTick("Entities::RunGC", [this]() {
 			return RunGC();
 		});
+		RegisterTick("Entities::UpdateStreamingLoads", [this]() {
+			return UpdateStreamingLoads();
+		});
+		RegisterTick("Entities::UpdateBackgroundSaves", [this]() {
+			return UpdateBackgroundSaves();
+		});
 	}
 
 	bool EntitySystem::Init()
@@ -53,10 +63,30 @@ namespace Entities
 			scripts->RegisterFunction("ActiveWorld", [this]() -> Entities::World* {
 				return GetActiveWorld();
 			});
+			scripts->RegisterFunction("StreamScene", [this](std::string path) -> uint32_t {
+				return StartStreamingLoad(m_activeWorldId, path);
+			});
+			scripts->RegisterFunction("IsStreamingLoadActive", [this](uint32_t loadId) {
+				return IsStreamingLoadActive(loadId);
+			});
+			scripts->RegisterFunction("GetStreamingLoadProgress", [this](uint32_t loadId) {
+				return GetStreamingLoadProgress(loadId);
+			});
 		}
 		return true;
 	}
 
+	void EntitySystem::Shutdown()
+	{
+		R3_PROF_EVENT();
+		// the job system drops queued jobs on shutdown, make sure any saves make it to disk first
+		while (m_backgroundSaves.size() > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			UpdateBackgroundSaves();
+		}
+	}
+
 	World* EntitySystem::CreateWorld(const std::string& id, std::string_view worldName)
 	{
 		R3_PROF_EVENT();
@@ -82,9 +112,109 @@ namespace Entities
 	void EntitySystem::DestroyWorld(const std::string& id)
 	{
 		R3_PROF_EVENT();
+		std::erase_if(m_streamingLoads, [&id](const StreamingLoad& l) {	// loads must not outlive their world
+			return l.m_worldId == id;
+		});
 		m_worlds.erase(id);
 	}
 
+	uint32_t EntitySystem::StartStreamingLoad(const std::string& worldId, std::string_view path, const WorldStreamingLoad::Budget& budget)
+	{
+		R3_PROF_EVENT();
+		World* world = GetWorld(worldId);
+		if (world == nullptr)
+		{
+			LogError("Cannot stream '{}' into world '{}', it does not exist", path, worldId);
+			return -1;
+		}
+		const uint32_t loadId = m_nextStreamingLoadId++;
+		m_streamingLoads.push_back({ loadId, worldId, std::make_unique<WorldStreamingLoad>(*world, path, budget) });
+		return loadId;
+	}
+
+	bool EntitySystem::IsStreamingLoadActive(uint32_t loadId)
+	{
+		return std::any_of(m_streamingLoads.begin(), m_streamingLoads.end(), [loadId](const StreamingLoad& l) {
+			return l.m_id == loadId;
+		});
+	}
+
+	float EntitySystem::GetStreamingLoadProgress(uint32_t loadId)
+	{
+		for (const auto& l : m_streamingLoads)
+		{
+			if (l.m_id == loadId)
+			{
+				return l.m_load->GetProgress();
+			}
+		}
+		return 1.0f;
+	}
+
+	bool EntitySystem::UpdateStreamingLoads()
+	{
+		R3_PROF_EVENT();
+		for (auto& l : m_streamingLoads)
+		{
+			l.m_load->Update();
+		}
+		std::erase_if(m_streamingLoads, [](const StreamingLoad& l) {
+			return l.m_load->IsFinished();
+		});
+		return true;
+	}
+
+	uint32_t EntitySystem::StartBackgroundSave(const std::string& worldId, std::string_view path)
+	{
+		R3_PROF_EVENT();
+		World* w = GetWorld(worldId);
+		if (w == nullptr)
+		{
+			LogError("Cannot save world '{}', it does not exist", worldId);
+			return -1;
+		}
+		const bool alreadySaving = std::any_of(m_backgroundSaves.begin(), m_backgroundSaves.end(), [path](const BackgroundSave& s) {
+			return s.m_save->GetPath() == path;
+		});
+		if (alreadySaving)
+		{
+			LogWarn("'{}' is already being saved", path);
+			return -1;
+		}
+		const uint32_t saveId = m_nextBackgroundSaveId++;
+		m_backgroundSaves.push_back({ saveId, std::make_unique<WorldBackgroundSave>(*w, path) });
+		return saveId;
+	}
+
+	bool EntitySystem::IsBackgroundSaveActive(uint32_t saveId)
+	{
+		return std::any_of(m_backgroundSaves.begin(), m_backgroundSaves.end(), [saveId](const BackgroundSave& s) {
+			return s.m_id == saveId;
+		});
+	}
+
+	bool EntitySystem::UpdateBackgroundSaves()
+	{
+		R3_PROF_EVENT();
+		// finished saves are destroyed here, so their snapshots are freed on the main thread
+		std::erase_if(m_backgroundSaves, [](const BackgroundSave& s) {
+			if (!s.m_save->IsFinished())
+			{
+				return false;
+			}
+			if (s.m_save->Succeeded())
+			{
+				LogInfo("Saved world to '{}'", s.m_save->GetPath());
+			}
+			else
+			{
+				LogError("Failed to save world to '{}'", s.m_save->GetPath());
+			}
+			return true;
+		});
+		return true;
+	}
+
 	World* EntitySystem::GetActiveWorld()
 	{
 		return GetWorld(m_activeWorldId);
@@ -109,6 +239,11 @@ namespace Entities
 		{
 			const auto& alltypes = ComponentTypeRegistry::GetInstance().AllTypes();
 			std::string txt;
+			ImGui::InputDouble("GC Budget (ms)", &m_gcMaxMilliseconds, 0.1, 1.0, "%.2f");
+			if (ImGui::Button("Collect All Garbage"))
+			{
+				CollectAllGarbage();
+			}
 			for (auto& w : m_worlds)
 			{
 				size_t worldTotalBytes = 0, worldBytesUsed = 0;
@@ -136,18 +271,51 @@ namespace Entities
 				txt = std::format("Reserved Handles: {}", w.second->GetReservedHandleCount());
 				ImGui::Text(txt.c_str());
 			}
+			if (m_streamingLoads.size() > 0)
+			{
+				ImGui::SeparatorText("Streaming Loads");
+				for (const auto& l : m_streamingLoads)
+				{
+					txt = std::format("{} -> {} ({})", l.m_load->GetPath(), l.m_worldId, WorldStreamingLoad::GetStateName(l.m_load->GetState()));
+					ImGui::ProgressBar(l.m_load->GetProgress(), ImVec2(-1, 0), txt.c_str());
+				}
+			}
+			if (m_backgroundSaves.size() > 0)
+			{
+				ImGui::SeparatorText("Background Saves");
+				for (const auto& s : m_backgroundSaves)
+				{
+					txt = std::format("Saving '{}'", s.m_save->GetPath());
+					ImGui::Text(txt.c_str());
+				}
+			}
 		}
 		ImGui::End();
 		return true;
 	}
 
-	bool EntitySystem::RunGC()
+	void EntitySystem::SetGCBudget(double maxMilliseconds, uint32_t maxEntities)
+	{
+		m_gcMaxMilliseconds = maxMilliseconds;
+		m_gcMaxEntities = maxEntities;
+	}
+
+	void EntitySystem::CollectAllGarbage()
 	{
 		R3_PROF_EVENT();
 		for (auto& w : m_worlds)
 		{
 			w.second->CollectGarbage();
 		}
+	}
+
+	bool EntitySystem::RunGC()
+	{
+		R3_PROF_EVENT();
+		for (auto& w : m_worlds)
+		{
+			w.second->CollectGarbage(m_gcMaxMilliseconds, m_gcMaxEntities);
+		}
 		return true;
 	}
 }
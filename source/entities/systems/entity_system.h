@@ -3,7 +3,10 @@
 #include "engine/systems/lua_system.h"
 #include "entities/component_type_registry.h"
 #include "entities/component_storage.h"
+#include "entities/component_reflection.h"
 #include "entities/world.h"
+#include "entities/world_streaming_load.h"
+#include "entities/world_background_save.h"
 #include <memory>
 #include <unordered_map>
 
@@ -20,6 +23,7 @@ namespace Entities
 		static std::string_view GetName() { return "Entities"; }
 		virtual void RegisterTickFns();
 		virtual bool Init();
+		virtual void Shutdown();
 
 		template<class ComponentType>
 		void RegisterComponentType(uint32_t initialCapacity = 1024);
@@ -32,10 +36,42 @@ namespace Entities
 		const std::string& GetActiveWorldID() { return m_activeWorldId; }
 		World* GetActiveWorld();
 
+		// Streaming loads merge a world file into an existing world over multiple frames (see world_streaming_load.h)
+		uint32_t StartStreamingLoad(const std::string& worldId, std::string_view path, const WorldStreamingLoad::Budget& budget = {});	// returns a load ID, or -1 if the world does not exist
+		bool IsStreamingLoadActive(uint32_t loadId);
+		float GetStreamingLoadProgress(uint32_t loadId);	// 0-1, returns 1 once the load has finished (or failed)
+
+		// Background saves write a snapshot of a world on another thread (see world_background_save.h)
+		uint32_t StartBackgroundSave(const std::string& worldId, std::string_view path);	// returns a save ID, or -1 if the world does not exist or the path is already being saved
+		bool IsBackgroundSaveActive(uint32_t saveId);
+
+		// Pending entity deletions are collected incrementally each frame within this budget
+		void SetGCBudget(double maxMilliseconds, uint32_t maxEntities = -1);
+		void CollectAllGarbage();	// destroy everything pending in all worlds now, ignores the budget
+
 	private:
 		bool ShowGui();
 		bool RunGC();
+		bool UpdateStreamingLoads();
+		bool UpdateBackgroundSaves();
+		struct StreamingLoad
+		{
+			uint32_t m_id = -1;
+			std::string m_worldId;
+			std::unique_ptr<WorldStreamingLoad> m_load;
+		};
+		struct BackgroundSave
+		{
+			uint32_t m_id = -1;
+			std::unique_ptr<WorldBackgroundSave> m_save;
+		};
 		bool m_showGui = false;
+		double m_gcMaxMilliseconds = 1.0;		// per world, per frame
+		uint32_t m_gcMaxEntities = -1;
+		std::vector<StreamingLoad> m_streamingLoads;	// removed as soon as they finish
+		uint32_t m_nextStreamingLoadId = 0;
+		std::vector<BackgroundSave> m_backgroundSaves;	// removed once they finish
+		uint32_t m_nextBackgroundSaveId = 0;
 		std::unordered_map<std::string, std::unique_ptr<World>> m_worlds;
 		std::string m_activeWorldId;
 	};
@@ -83,15 +119,33 @@ namespace Entities
 			};
 			typeRegistry.SetInspector(ComponentType::GetTypeName(), std::move(inspectorGlue));
 		}
+		else if constexpr (Reflection::HasFields<ComponentType>::value)	// otherwise generate one from the field descriptors
+		{
+			auto inspectorGlue = [](const EntityHandle& e, World& w, ValueInspector& i) {
+				auto* actualComponent = w.GetComponent<ComponentType>(e);
+				if (actualComponent)
+				{
+					Reflection::InspectFields(*actualComponent, e, &w, i);
+				}
+			};
+			typeRegistry.SetInspector(ComponentType::GetTypeName(), std::move(inspectorGlue));
+		}
 
-		// If the component has a 'RegisterScripts' function, call it now
+		// If the component has a 'RegisterScripts' function (or field descriptors), register the type now
 		// Then register script accessors (scripts can only touch the active world)
-		if constexpr (ComponentHasScripts<ComponentType>::value)
+		if constexpr (ComponentHasScripts<ComponentType>::value || Reflection::HasFields<ComponentType>::value)
 		{
 			auto scripts = Systems::GetSystem<LuaSystem>();
 			if (scripts)
 			{
-				ComponentType::RegisterScripts(*scripts);
+				if constexpr (ComponentHasScripts<ComponentType>::value)
+				{
+					ComponentType::RegisterScripts(*scripts);
+				}
+				else
+				{
+					Reflection::RegisterScriptFields<ComponentType>(*scripts, ComponentType::GetTypeName());
+				}
 				scripts->AddTypeMember<World>("World", std::format("AddComponent_{}", ComponentType::GetTypeName()), 
 					[this](Entities::EntityHandle e) -> ComponentType*
 				{
@@ -2,10 +2,15 @@
 #include "core/profiler.h"
 #include "core/log.h"
 #include "core/file_io.h"
+#include "core/mapped_file.h"
+#include "core/time.h"
 #include "engine/serialiser.h"
 #include "component_storage.h"
+#include "serialised_component_storage.h"
 #include "component_type_registry.h"
 #include "entity_handle.h"
+#include "engine/systems/job_system.h"
+#include <algorithm>
 #include <cassert>
 
 
@@ -13,10 +18,17 @@ namespace R3
 {
 namespace Entities
 {
+	bool World::IsBinaryWorldPath(std::string_view path)
+	{
+		return path.ends_with(".scnb");
+	}
+
 	World::World()
 	{
 		m_allEntities.reserve(1024 * 256);
+		m_allEntityLinks.reserve(1024 * 256);
 		m_allEntityNames.reserve(1024 * 256);
+		m_allEntityNameLinks.reserve(1024 * 256);
 	}
 
 	World::~World()
@@ -25,9 +37,71 @@ namespace Entities
 
 	void World::SetEntityName(const EntityHandle& h, std::string_view name)
 	{
-		if (IsHandleValid(h))
+		if (IsHandleValid(h) && m_allEntityNames[h.GetPrivateIndex()] != name)
 		{
+			RemoveFromNameIndex(h.GetPrivateIndex());
 			m_allEntityNames[h.GetPrivateIndex()] = name;
+			AddToNameIndex(h.GetPrivateIndex());
+		}
+	}
+
+	void World::AddToNameIndex(uint32_t privateIndex)
+	{
+		const std::string& name = m_allEntityNames[privateIndex];
+		if (name.empty())
+		{
+			return;
+		}
+		auto& links = m_allEntityNameLinks[privateIndex];
+		assert(links.m_previous == -1 && links.m_next == -1);
+		auto found = m_nameIndex.find(name);
+		if (found == m_nameIndex.end())
+		{
+			m_nameIndex.emplace(name, EntityNameIndex{ privateIndex, privateIndex });
+		}
+		else
+		{
+			// append to the end of the list so the first entity with a name is always found first
+			m_allEntityNameLinks[found->second.m_last].m_next = privateIndex;
+			links.m_previous = found->second.m_last;
+			found->second.m_last = privateIndex;
+		}
+	}
+
+	void World::RemoveFromNameIndex(uint32_t privateIndex)
+	{
+		const std::string& name = m_allEntityNames[privateIndex];
+		if (name.empty())
+		{
+			return;
+		}
+		auto found = m_nameIndex.find(name);
+		assert(found != m_nameIndex.end());
+		if (found == m_nameIndex.end())
+		{
+			return;
+		}
+		auto& links = m_allEntityNameLinks[privateIndex];
+		if (links.m_previous != -1)
+		{
+			m_allEntityNameLinks[links.m_previous].m_next = links.m_next;
+		}
+		else
+		{
+			found->second.m_first = links.m_next;
+		}
+		if (links.m_next != -1)
+		{
+			m_allEntityNameLinks[links.m_next].m_previous = links.m_previous;
+		}
+		else
+		{
+			found->second.m_last = links.m_previous;
+		}
+		links = {};
+		if (found->second.m_first == -1)
+		{
+			m_nameIndex.erase(found);
 		}
 	}
 
@@ -42,17 +116,13 @@ namespace Entities
 
 	EntityHandle World::GetEntityByName(std::string_view name)
 	{
-		R3_PROF_EVENT();
-		EntityHandle foundEntity;
-		ForEachActiveEntity([&](const EntityHandle& e) {
-			if (GetEntityName(e) == name)
-			{
-				foundEntity = e;
-				return false;
-			}
-			return true;
-		});
-		return foundEntity;
+		auto found = m_nameIndex.find(name);
+		if (found != m_nameIndex.end())
+		{
+			const uint32_t privateIndex = found->second.m_first;
+			return EntityHandle(m_allEntities[privateIndex].m_publicID, privateIndex);
+		}
+		return {};
 	}
 
 	void World::SerialiseEntity(const EntityHandle& e, JsonSerialiser& target)
@@ -110,17 +180,21 @@ namespace Entities
 	}
 
 	std::vector<EntityHandle> World::SerialiseEntities(const JsonSerialiser& json, const std::vector<EntityHandle>& restoreHandles)
+	{
+		return LoadEntities(json, restoreHandles, nullptr);
+	}
+
+	std::vector<EntityHandle> World::LoadEntities(const JsonSerialiser& json, const std::vector<EntityHandle>& restoreHandles, const EntityRemapTable* componentRemap)
 	{
 		assert(restoreHandles.size() == 0 || restoreHandles.size() == json.GetJson().size());
 
 		// We first create entities for each one in the json, and store a mapping of old id in json -> new handle in world
 		// Then during serialisation, when any entity handle is encountered, we patch the old handle with this new one
-		std::unordered_map<uint32_t, EntityHandle> oldEntityToNewEntity;
+		EntityRemapTable oldEntityToNewEntity;
 		std::vector<EntityHandle> allCreatedHandles;
 		try
 		{
 			R3_PROF_EVENT();
-			oldEntityToNewEntity.reserve(json.GetJson().size());
 			allCreatedHandles.reserve(json.GetJson().size());
 			if (restoreHandles.size() > 0)
 			{
@@ -133,7 +207,7 @@ namespace Entities
 					{
 						LogError("Failed to restore entity handle {}/{}", restoreHandles[e].GetID(), restoreHandles[e].GetPrivateIndex());
 					}
-					oldEntityToNewEntity[id] = newEntity;
+					oldEntityToNewEntity.Set(id, newEntity);
 					allCreatedHandles.push_back(newEntity);
 				}
 			}
@@ -143,7 +217,7 @@ namespace Entities
 				{
 					uint32_t id = json.GetJson()[e]["ID"];
 					EntityHandle newEntity = AddEntity();
-					oldEntityToNewEntity[id] = newEntity;
+					oldEntityToNewEntity.Set(id, newEntity);
 					allCreatedHandles.push_back(newEntity);
 				}
 			}
@@ -154,45 +228,35 @@ namespace Entities
 			return allCreatedHandles;
 		}
 
-		auto RecreateHandle = [&](EntityHandle& e)
+		// Phase 1 (serial) - setup the hierarchy, names + create all components, recording where the data for each one lives
+		struct ComponentToLoad
 		{
-			if (e.GetID() != -1)
-			{
-				auto foundRemap = oldEntityToNewEntity.find(e.GetID());
-				if (foundRemap != oldEntityToNewEntity.end())
-				{
-					e = foundRemap->second;
-				}
-				else
-				{
-					LogError("Entity handle references ID ({}) that doesn't exist in the loaded world!", e.GetID());
-				}
-			}
+			EntityHandle m_owner;
+			uint32_t m_jsonIndex;	// index of the owner entity in the json array
 		};
-		EntityHandle::SetOnLoadFinishCallback(RecreateHandle);
+		std::vector<std::vector<ComponentToLoad>> componentsToLoad(ComponentTypeRegistry::GetInstance().AllTypes().size());
 		try
 		{
-			JsonSerialiser childSerialiser(JsonSerialiser::Read);
+			R3_PROF_EVENT("CreateComponents");
 			for (int e = 0; e < json.GetJson().size(); ++e)	// for each entity
 			{
 				// remap any per-entity IDs to their new values
-				const uint32_t oldID = json.GetJson()[e]["ID"];
-				const EntityHandle& actualHandle = oldEntityToNewEntity[oldID];
-				const uint32_t oldParent = json.GetJson()[e].value("Parent", (uint32_t)-1);
-				EntityHandle actualParent = oldParent != -1 ? oldEntityToNewEntity[oldParent] : EntityHandle();
+				const auto& entityJson = json.GetJson()[e];
+				const uint32_t oldID = entityJson["ID"];
+				const EntityHandle actualHandle = oldEntityToNewEntity.Find(oldID);
+				const uint32_t oldParent = entityJson.value("Parent", (uint32_t)-1);
+				EntityHandle actualParent = oldParent != -1 ? oldEntityToNewEntity.Find(oldParent) : EntityHandle();
 				SetParent(actualHandle, actualParent);
-				std::string newName = json.GetJson()[e].value("Name", "");
+				std::string newName = entityJson.value("Name", "");
 				SetEntityName(actualHandle, newName);
-				childSerialiser.GetJson() = std::move(json.GetJson()[e]);
-				for (auto childJson = childSerialiser.GetJson().begin(); childJson != childSerialiser.GetJson().end(); childJson++)
+				for (auto childJson = entityJson.begin(); childJson != entityJson.end(); childJson++)
 				{
 					if (childJson.key() != "ID" && childJson.key() != "Parent" && childJson.key() != "Name")
 					{
 						if (AddComponent(actualHandle, childJson.key()))
 						{
-							uint32_t cmpTypeIndex = ComponentTypeRegistry::GetInstance().GetTypeIndex(childJson.key());	// we need the type index to lookup the storage
-							const auto& ped = m_allEntities[actualHandle.GetPrivateIndex()];	// we need the new component index from the entity data
-							m_allComponents[cmpTypeIndex]->Serialise(actualHandle, ped.m_componentLookup.GetComponentIndex(cmpTypeIndex), childSerialiser);
+							const uint32_t cmpTypeIndex = ComponentTypeRegistry::GetInstance().GetTypeIndex(childJson.key());
+							componentsToLoad[cmpTypeIndex].push_back({ actualHandle, static_cast<uint32_t>(e) });
 						}
 					}
 				}
@@ -202,11 +266,65 @@ namespace Entities
 		{
 			LogError("Something went wrong while loading entities! - {}", e.what());
 		}
-		EntityHandle::SetOnLoadFinishCallback(nullptr);
+
+		// Phase 2 (parallel) - serialise the component data, one job per component type so each storage only has one writer
+		// Nothing is added or removed from the world during this phase, so the entity + component lookups are safe to read from any thread
+		const EntityRemapTable& componentRemapTable = componentRemap ? *componentRemap : oldEntityToNewEntity;
+		const JsonSerialiser::EntityRemapFn remapFn = [&componentRemapTable](EntityHandle& e) {
+			componentRemapTable.Remap(e);
+		};
+		std::vector<uint32_t> typesToLoad;
+		for (uint32_t t = 0; t < componentsToLoad.size(); ++t)
+		{
+			if (componentsToLoad[t].size() > 0)
+			{
+				typesToLoad.push_back(t);
+			}
+		}
+		std::sort(typesToLoad.begin(), typesToLoad.end(), [&componentsToLoad](uint32_t t0, uint32_t t1) {
+			return componentsToLoad[t0].size() > componentsToLoad[t1].size();	// start the biggest jobs first
+		});
+		auto loadComponents = [&](uint32_t i) {
+			R3_PROF_EVENT("LoadComponents");
+			const uint32_t typeIndex = typesToLoad[i];
+			const std::string& typeName = ComponentTypeRegistry::GetInstance().AllTypes()[typeIndex].m_name;
+			ComponentStorage* storage = m_allComponents[typeIndex].get();
+			for (const auto& toLoad : componentsToLoad[typeIndex])
+			{
+				try
+				{
+					JsonSerialiser componentJson(&json.GetJson()[toLoad.m_jsonIndex], &remapFn);	// read directly from the entity json
+					const auto& ped = m_allEntities[toLoad.m_owner.GetPrivateIndex()];	// we need the new component index from the entity data
+					storage->Serialise(toLoad.m_owner, ped.m_componentLookup.GetComponentIndex(typeIndex), componentJson);
+				}
+				catch (std::exception e)
+				{
+					LogError("Failed to load component {} - {}", typeName, e.what());
+				}
+			}
+		};
+		RunLoadJobs(static_cast<uint32_t>(typesToLoad.size()), loadComponents);
 
 		return allCreatedHandles;
 	}
 
+	void World::RunLoadJobs(uint32_t jobCount, const std::function<void(uint32_t)>& fn)
+	{
+		auto jobs = Systems::GetSystem<JobSystem>();
+		if (jobs && jobCount > 1)
+		{
+			const auto pool = m_loadJobsInBackground ? JobSystem::ThreadPool::SlowJobs : JobSystem::ThreadPool::FastJobs;
+			jobs->ForEachAsync(pool, 0, jobCount, 1, 1, fn);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < jobCount; ++i)
+			{
+				fn(i);
+			}
+		}
+	}
+
 	void World::SerialiseComponent(const EntityHandle& e, std::string_view componentType, JsonSerialiser& json)
 	{
 		if (IsHandleValid(e))
@@ -225,6 +343,18 @@ namespace Entities
 	std::vector<EntityHandle> World::Import(std::string_view path)
 	{
 		R3_PROF_EVENT();
+		if (IsBinaryWorldPath(path))
+		{
+			MappedFile loadedData;	// binary worlds are read in place, the file is never copied
+			if (!loadedData.Open(path))
+			{
+				LogError("Failed to load world file '{}'", path);
+				return {};
+			}
+			std::vector<EntityHandle> newEntities;
+			SerialiseEntitiesBinary(loadedData.GetData().data(), loadedData.GetData().size(), newEntities);
+			return newEntities;
+		}
 		std::vector<EntityHandle> newEntities;
 		JsonSerialiser loadedJson(JsonSerialiser::Read);
 		{
@@ -256,6 +386,17 @@ namespace Entities
 	bool World::Load(std::string_view path)
 	{
 		R3_PROF_EVENT();
+		if (IsBinaryWorldPath(path))
+		{
+			MappedFile loadedData;
+			if (!loadedData.Open(path))
+			{
+				LogError("Failed to load world file '{}'", path);
+				return false;
+			}
+			std::vector<EntityHandle> newEntities;
+			return SerialiseEntitiesBinary(loadedData.GetData().data(), loadedData.GetData().size(), newEntities, true);
+		}
 		JsonSerialiser loadedJson(JsonSerialiser::Read);
 		{
 			R3_PROF_EVENT("LoadFile");
@@ -289,6 +430,10 @@ namespace Entities
 	{
 		R3_PROF_EVENT();
 		CollectGarbage();	// ensure any entities pending delete are removed before saving
+		if (IsBinaryWorldPath(path))
+		{
+			return FileIO::SaveBinaryFile(path, SerialiseEntitiesBinary());
+		}
 		JsonSerialiser worldJson(JsonSerialiser::Write);
 		worldJson("WorldName", m_name);
 		JsonSerialiser entityJson = SerialiseEntities();
@@ -296,6 +441,46 @@ namespace Entities
 		return FileIO::SaveTextToFile(path, worldJson.GetJson().dump(1));
 	}
 
+	std::unique_ptr<World> World::CreateSnapshot(bool forBinarySave)
+	{
+		R3_PROF_EVENT();
+		CollectGarbage();	// the snapshot never contains pending entities
+		auto snapshot = std::make_unique<World>();
+		snapshot->m_name = m_name;
+		snapshot->m_entityIDCounter = m_entityIDCounter;
+		snapshot->m_hierarchyVersion = m_hierarchyVersion;
+		snapshot->m_componentVersions = m_componentVersions;
+		snapshot->m_loadJobsInBackground = true;
+		snapshot->m_allEntities = m_allEntities;
+		snapshot->m_allEntityLinks = m_allEntityLinks;
+		snapshot->m_reservedSlots = m_reservedSlots;
+		snapshot->m_freeEntityIndices = m_freeEntityIndices;
+		snapshot->m_allEntityNames = m_allEntityNames;
+		snapshot->m_allEntityNameLinks = m_allEntityNameLinks;
+		snapshot->m_nameIndex = m_nameIndex;
+		snapshot->m_publicIDToIndex = m_publicIDToIndex;
+
+		snapshot->m_allComponents.resize(m_allComponents.size());
+		for (uint32_t typeIndex = 0; typeIndex < m_allComponents.size(); ++typeIndex)
+		{
+			if (m_allComponents[typeIndex] == nullptr)
+			{
+				continue;
+			}
+			// raw data is copied, anything else may reference assets or scripts so it is serialised here, on the owning thread
+			ComponentStorage* storage = m_allComponents[typeIndex].get();
+			if (storage->IsRawSerialisable())
+			{
+				snapshot->m_allComponents[typeIndex] = storage->CreateSnapshot(snapshot.get());
+			}
+			else
+			{
+				snapshot->m_allComponents[typeIndex] = std::make_unique<SerialisedComponentStorage>(snapshot.get(), typeIndex, *storage, forBinarySave);
+			}
+		}
+		return snapshot;
+	}
+
 	size_t World::GetEntityDisplayName(const EntityHandle& h, char* nameBuffer, size_t maxLength) const
 	{
 		// annoyingly, good old printf is still way faster than std::format 
@@ -383,15 +568,20 @@ namespace Entities
 	EntityHandle World::AddEntity()
 	{
 		R3_PROF_EVENT();
-		auto newId = m_entityIDCounter++;	// note we are not checking for duplicates here!
-		auto toDelete = std::find_if(m_pendingDelete.begin(), m_pendingDelete.end(), [newId](const PendingDeleteEntity& pde) {
-			return pde.m_handle.GetID() == newId;
-		});
-		if (toDelete != m_pendingDelete.end())
+		auto newId = m_entityIDCounter++;
+		if (m_publicIDToIndex.contains(newId))	// ids are never reused, only possible if the id counter was restored incorrectly
 		{
-			LogError("Entity '{}' already existed and is being destroyed!", newId);
+			LogError("Entity '{}' already exists!", newId);
 			return {};	// the old entity didn't clean up fully yet
 		}
+		const uint32_t newIndex = AllocateEntitySlot();
+		m_allEntities[newIndex].m_publicID = newId;
+		m_publicIDToIndex[newId] = newIndex;
+		return EntityHandle(newId, newIndex);
+	}
+
+	uint32_t World::AllocateEntitySlot()
+	{
 		uint32_t newIndex = -1;
 		if (m_freeEntityIndices.size() > 0)		// pop from free list
 		{
@@ -399,30 +589,48 @@ namespace Entities
 			m_freeEntityIndices.pop_front();
 			assert(m_allEntities[newIndex].m_publicID == -1);
 			assert(m_allEntities[newIndex].m_componentLookup.IsEmpty());
-			m_allEntities[newIndex].m_publicID = newId;
-			m_allEntityNames[newIndex].clear();
+			assert(m_allEntityNames[newIndex].empty());
 		}
 		else
 		{
-			PerEntityData newEntityData;
-			newEntityData.m_publicID = newId;
-			m_allEntities.push_back(newEntityData);
+			m_allEntities.push_back({});
+			m_allEntityLinks.push_back({});
 			m_allEntityNames.push_back("");
+			m_allEntityNameLinks.push_back({});
 			newIndex = static_cast<uint32_t>(m_allEntities.size() - 1);
 			assert(m_allEntityNames.size() == m_allEntities.size());
 		}
+		return newIndex;
+	}
+
+	EntityHandle World::ReserveEntityHandle()
+	{
+		const uint32_t newId = m_entityIDCounter++;
+		const uint32_t newIndex = AllocateEntitySlot();
+		m_reservedSlots[newId] = newIndex;
 		return EntityHandle(newId, newIndex);
 	}
 
+	void World::ReleaseReservedHandle(const EntityHandle& reserved)
+	{
+		auto reservation = m_reservedSlots.find(reserved.GetID());
+		if (reservation != m_reservedSlots.end() && reservation->second == reserved.GetPrivateIndex())
+		{
+			m_freeEntityIndices.push_back(reservation->second);
+			m_reservedSlots.erase(reservation);
+		}
+	}
+
 	EntityHandle World::AddEntityFromHandle(const EntityHandle& handleToRestore)
 	{
-		auto toDelete = std::find_if(m_pendingDelete.begin(), m_pendingDelete.end(), [handleToRestore](const PendingDeleteEntity& pde) {
-			return pde.m_handle == handleToRestore;
-		});
-		if (toDelete != m_pendingDelete.end())
+		if (IsPendingDelete(handleToRestore))
 		{
-			LogError("Entity '{}' already existed and is being destroyed!", handleToRestore.GetID());
-			return {};	// the old entity didn't clean up fully yet
+			CollectGarbage();	// incremental gc may not have reached the old entity yet, it must be destroyed before we can restore it
+		}
+		if (m_publicIDToIndex.contains(handleToRestore.GetID()))
+		{
+			LogError("Entity '{}' already exists!", handleToRestore.GetID());
+			return {};
 		}
 
 		auto reservation = m_reservedSlots.find(handleToRestore.GetID());
@@ -435,8 +643,9 @@ namespace Entities
 			{
 				assert(m_allEntities[reservedIndex].m_publicID == -1);
 				assert(m_allEntities[reservedIndex].m_componentLookup.IsEmpty());
+				assert(m_allEntityNames[reservedIndex].empty());
 				m_allEntities[reservedIndex].m_publicID = handleToRestore.GetID();
-				m_allEntityNames[reservedIndex].clear();
+				m_publicIDToIndex[handleToRestore.GetID()] = reservedIndex;
 				m_reservedSlots.erase(reservation);
 				return handleToRestore;
 			}
@@ -468,24 +677,17 @@ namespace Entities
 
 	void World::GetChildren(const EntityHandle& parent, std::vector<EntityHandle>& results) const
 	{
-		if (IsHandleValid(parent))
-		{
-			auto& theEntity = m_allEntities[parent.GetPrivateIndex()];
-			results = theEntity.m_children;
-		}
+		results.clear();
+		ForEachChild(parent, [&results](const EntityHandle& child) {
+			results.push_back(child);
+		});
 	}
 
 	void World::GetAllChildren(const EntityHandle& parent, std::vector<EntityHandle>& results) const
 	{
-		if (IsHandleValid(parent))
-		{
-			auto& theEntity = m_allEntities[parent.GetPrivateIndex()];
-			for (const auto& child : theEntity.m_children)
-			{
-				GetAllChildren(child, results);
-			}
-			results.insert(results.end(), theEntity.m_children.begin(), theEntity.m_children.end());
-		}
+		ForEachChildRecursive(parent, [&results](const EntityHandle& child) {
+			results.push_back(child);
+		});
 	}
 
 	std::vector<EntityHandle> World::GetAllChildren(const EntityHandle& parent)
@@ -499,23 +701,52 @@ namespace Entities
 	{
 		if (IsHandleValid(child))
 		{
-			auto& theEntity = m_allEntities[child.GetPrivateIndex()];
-			if (parent == theEntity.m_parent)
+			const uint32_t childIndex = child.GetPrivateIndex();
+			auto& theEntity = m_allEntityLinks[childIndex];
+			const EntityHandle newParent = IsHandleValid(parent) ? parent : EntityHandle();
+			if (newParent == theEntity.m_parent)
 			{
 				return true;
 			}
-			if (IsHandleValid(theEntity.m_parent))		// remove child from the old parent
+			if (IsHandleValid(theEntity.m_parent))		// unlink child from the old parent
 			{
-				auto& theParent = m_allEntities[theEntity.m_parent.GetPrivateIndex()];
-				auto foundChild = std::find(theParent.m_children.begin(), theParent.m_children.end(), child);
-				assert(foundChild != theParent.m_children.end());
-				theParent.m_children.erase(foundChild);
+				auto& theParent = m_allEntityLinks[theEntity.m_parent.GetPrivateIndex()];
+				if (theEntity.m_previousSibling != -1)
+				{
+					m_allEntityLinks[theEntity.m_previousSibling].m_nextSibling = theEntity.m_nextSibling;
+				}
+				else
+				{
+					assert(theParent.m_firstChild == childIndex);
+					theParent.m_firstChild = theEntity.m_nextSibling;
+				}
+				if (theEntity.m_nextSibling != -1)
+				{
+					m_allEntityLinks[theEntity.m_nextSibling].m_previousSibling = theEntity.m_previousSibling;
+				}
+				else
+				{
+					assert(theParent.m_lastChild == childIndex);
+					theParent.m_lastChild = theEntity.m_previousSibling;
+				}
+				theEntity.m_previousSibling = -1;
+				theEntity.m_nextSibling = -1;
 			}
-			theEntity.m_parent = parent;
-			if (IsHandleValid(parent))		// add child to new parent
+			theEntity.m_parent = newParent;
+			++m_hierarchyVersion;
+			if (IsHandleValid(newParent))		// add child to the end of the new parents children
 			{
-				auto& theParent = m_allEntities[parent.GetPrivateIndex()];
-				theParent.m_children.push_back(child);
+				auto& theParent = m_allEntityLinks[newParent.GetPrivateIndex()];
+				if (theParent.m_lastChild != -1)
+				{
+					m_allEntityLinks[theParent.m_lastChild].m_nextSibling = childIndex;
+					theEntity.m_previousSibling = theParent.m_lastChild;
+				}
+				else
+				{
+					theParent.m_firstChild = childIndex;
+				}
+				theParent.m_lastChild = childIndex;
 			}
 			return true;
 		}
@@ -526,8 +757,7 @@ namespace Entities
 	{
 		if (IsHandleValid(child))
 		{
-			auto& theEntity = m_allEntities[child.GetPrivateIndex()];
-			return theEntity.m_parent;
+			return m_allEntityLinks[child.GetPrivateIndex()].m_parent;
 		}
 		return EntityHandle();
 	}
@@ -540,12 +770,37 @@ namespace Entities
 		assert(h.GetPrivateIndex() < m_allEntities.size());
 		if (IsHandleValid(h))
 		{
+			// unlink everything that can find the entity now, only the components + slot wait for the gc
+			SetParent(h, EntityHandle());
+			DetachChildren(h.GetPrivateIndex());
+			RemoveFromNameIndex(h.GetPrivateIndex());
+			m_allEntityNames[h.GetPrivateIndex()].clear();
+			m_publicIDToIndex.erase(h.GetID());
 			auto& theEntity = m_allEntities[h.GetPrivateIndex()];
+			for (uint32_t typeIndex = 0; typeIndex < m_allComponents.size(); ++typeIndex)
+			{
+				if (theEntity.m_componentLookup.ContainsComponent(typeIndex))
+				{
+					++m_componentVersions[typeIndex];
+				}
+			}
 			theEntity.m_componentLookup.Invalidate();
+			theEntity.m_publicID = -1;
+			theEntity.m_pendingDeleteID = h.GetID();
 			m_pendingDelete.push_back({ h, reserveHandle });
 		}
 	}
 
+	EntityHandle World::GetEntityFromID(uint32_t publicID) const
+	{
+		auto found = m_publicIDToIndex.find(publicID);
+		if (found != m_publicIDToIndex.end())
+		{
+			return EntityHandle(publicID, found->second);
+		}
+		return {};
+	}
+
 	bool World::IsHandleValid(const EntityHandle& h) const
 	{
 		if (h.GetID() != -1 && h.GetPrivateIndex() != -1 && h.GetPrivateIndex() < m_allEntities.size())
@@ -558,11 +813,8 @@ namespace Entities
 		}
 	}
 
-	void World::AddComponentInternal(const EntityHandle& e, uint32_t resolvedTypeIndex)
+	ComponentStorage* World::GetOrCreateStorage(uint32_t resolvedTypeIndex)
 	{
-		R3_PROF_EVENT();
-		assert(resolvedTypeIndex != -1);
-
 		// do we need to allocate storage for this component type?
 		if (m_allComponents.size() < resolvedTypeIndex + 1)
 		{
@@ -573,9 +825,17 @@ namespace Entities
 			const auto& allTypes = ComponentTypeRegistry::GetInstance().AllTypes();
 			m_allComponents[resolvedTypeIndex] = allTypes[resolvedTypeIndex].m_storageFactory(this);	// storage created from factory
 		}
+		return m_allComponents[resolvedTypeIndex].get();
+	}
 
-		uint32_t newCmpIndex = m_allComponents[resolvedTypeIndex]->Create(e);
+	void World::AddComponentInternal(const EntityHandle& e, uint32_t resolvedTypeIndex)
+	{
+		R3_PROF_EVENT();
+		assert(resolvedTypeIndex != -1);
+
+		uint32_t newCmpIndex = GetOrCreateStorage(resolvedTypeIndex)->Create(e);
 		m_allEntities[e.GetPrivateIndex()].m_componentLookup.AddComponent(resolvedTypeIndex, newCmpIndex);
+		++m_componentVersions[resolvedTypeIndex];
 	}
 
 	bool World::HasAnyComponents(const EntityHandle& e, uint64_t typeBits) const
@@ -634,6 +894,7 @@ namespace Entities
 			if (oldIndex != -1)
 			{
 				m_allComponents[typeIndex]->Destroy(e, oldIndex);
+				++m_componentVersions[typeIndex];
 			}
 		}
 	}
@@ -657,47 +918,100 @@ namespace Entities
 		return false;
 	}
 
-	void World::CollectGarbage()
+	bool World::IsPendingDelete(const EntityHandle& h) const
 	{
-		R3_PROF_EVENT();
-		for (const auto& toDelete : m_pendingDelete)
+		return h.GetID() != -1 && h.GetPrivateIndex() < m_allEntities.size() && m_allEntities[h.GetPrivateIndex()].m_pendingDeleteID == h.GetID();
+	}
+
+	void World::DestroyPendingEntity(const PendingDeleteEntity& toDelete)
+	{
+		if (IsPendingDelete(toDelete.m_handle))
 		{
-			if (IsHandleValid(toDelete.m_handle))
+			auto& theEntity = m_allEntities[toDelete.m_handle.GetPrivateIndex()];
+			for (int cmpType = 0; cmpType < ComponentTypeRegistry::c_maxTypes; ++cmpType)
 			{
-				EntityHandle nullParent;	// reset the parent entity (removes entity from children)
-				SetParent(toDelete.m_handle, nullParent);
-				auto& theEntity = m_allEntities[toDelete.m_handle.GetPrivateIndex()];
-				for (int cmpType = 0; cmpType < ComponentTypeRegistry::c_maxTypes; ++cmpType)
+				// note we get the invalidated component indices here
+				const uint32_t oldIndex = theEntity.m_componentLookup.GetInvalidatedIndex(cmpType);
+				if (oldIndex != -1)
 				{
-					// note we get the invalidated component indices here
-					const uint32_t oldIndex = theEntity.m_componentLookup.GetInvalidatedIndex(cmpType);
-					if (oldIndex != -1)
-					{
-						m_allComponents[cmpType]->Destroy(toDelete.m_handle, oldIndex);
-					}
-				}
-				// reset + push the entity to the free or reserved list
-				theEntity.m_componentLookup.Reset();
-				theEntity.m_publicID = -1;
-				theEntity.m_children.clear();
-				if (toDelete.m_reserveHandle)
-				{
-					assert(m_reservedSlots.find(toDelete.m_handle.GetID()) == m_reservedSlots.end());	// shouldnt be possible, but eh
-					m_reservedSlots[toDelete.m_handle.GetID()] = toDelete.m_handle.GetPrivateIndex();
-				}
-				else
-				{
-					m_freeEntityIndices.push_back(toDelete.m_handle.GetPrivateIndex());
+					m_allComponents[cmpType]->Destroy(toDelete.m_handle, oldIndex);
 				}
 			}
+			// reset + push the entity to the free or reserved list
+			theEntity.m_componentLookup.Reset();
+			theEntity.m_pendingDeleteID = -1;
+			if (toDelete.m_reserveHandle)
+			{
+				assert(m_reservedSlots.find(toDelete.m_handle.GetID()) == m_reservedSlots.end());	// shouldnt be possible, but eh
+				m_reservedSlots[toDelete.m_handle.GetID()] = toDelete.m_handle.GetPrivateIndex();
+			}
+			else
+			{
+				m_freeEntityIndices.push_back(toDelete.m_handle.GetPrivateIndex());
+			}
+		}
+	}
+
+	void World::CollectGarbage()
+	{
+		R3_PROF_EVENT();
+		for (const auto& toDelete : m_pendingDelete)
+		{
+			DestroyPendingEntity(toDelete);
 		}
 		m_pendingDelete.clear();
 	}
 
+	bool World::CollectGarbage(double maxMilliseconds, uint32_t maxEntities)
+	{
+		R3_PROF_EVENT();
+		if (m_pendingDelete.size() == 0)
+		{
+			return true;
+		}
+		// reading the timer is not free, only check it every few entities
+		constexpr uint32_t c_entitiesPerTimeCheck = 16;
+		const double ticksPerMs = Time::HighPerformanceCounterFrequency() / 1000.0;
+		const uint64_t endTicks = Time::HighPerformanceCounterTicks() + static_cast<uint64_t>(maxMilliseconds * ticksPerMs);
+		const size_t maxCount = std::min(m_pendingDelete.size(), static_cast<size_t>(std::max(maxEntities, 1u)));	// always make some progress
+		size_t collected = 0;
+		while (collected < maxCount)
+		{
+			DestroyPendingEntity(m_pendingDelete.front());
+			m_pendingDelete.pop_front();
+			if ((++collected % c_entitiesPerTimeCheck) == 0 && Time::HighPerformanceCounterTicks() >= endTicks)
+			{
+				break;
+			}
+		}
+		return m_pendingDelete.size() == 0;
+	}
+
+	void World::DetachChildren(uint32_t privateIndex)
+	{
+		// any remaining children no longer have a parent
+		auto& links = m_allEntityLinks[privateIndex];
+		uint32_t child = links.m_firstChild;
+		if (child != -1)
+		{
+			++m_hierarchyVersion;
+		}
+		while (child != -1)
+		{
+			auto& childLinks = m_allEntityLinks[child];
+			child = childLinks.m_nextSibling;
+			childLinks.m_parent = {};
+			childLinks.m_previousSibling = -1;
+			childLinks.m_nextSibling = -1;
+		}
+		links.m_firstChild = -1;
+		links.m_lastChild = -1;
+	}
+
 	void World::OnComponentMoved(const EntityHandle& owner, uint32_t typeIndex, uint32_t oldIndex, uint32_t newIndex)
 	{
 		R3_PROF_EVENT();
-		assert(IsHandleValid(owner));
+		assert(IsHandleValid(owner) || IsPendingDelete(owner));	// components of pending entities can still move until they are collected
 		auto& theEntity = m_allEntities[owner.GetPrivateIndex()];
 		theEntity.m_componentLookup.UpdateIndex(typeIndex, oldIndex, newIndex);
 	}
@@ -4,8 +4,12 @@
 #include "entity_component_lookup.h"
 #include <string_view>
 #include <vector>
+#include <array>
 #include <deque>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <functional>
 
 namespace R3
 {
@@ -14,8 +18,12 @@ namespace Entities
 {
 	class ComponentStorage;
 	template<class ComponentType> class LinearComponentStorage;
+	class WorldStreamingLoad;
+	class Prefab;
 	class World
 	{
+		friend class WorldStreamingLoad;	// merges entities from a staging world
+		friend class Prefab;				// copies components directly to/from storage
 	public:
 		World();
 		~World();
@@ -26,18 +34,26 @@ namespace Entities
 		// Entity stuff. EntityHandle is essentially an opaque-ish ID
 		EntityHandle AddEntity();
 		EntityHandle AddEntityFromHandle(const EntityHandle& handleToRestore);	// restore a previously deleted reserved entity handle. only for tools
+		EntityHandle ReserveEntityHandle();							// reserve a handle for an entity that will be created later via AddEntityFromHandle
+		void ReleaseReservedHandle(const EntityHandle& reserved);	// return an unused reservation to the free list
 		EntityHandle GetParent(const EntityHandle& child) const;				// entity parent is purely a logistical thing, nothing in the sim changes unless it specifically acts on children
 		bool SetParent(const EntityHandle& child, const EntityHandle& parent);	// returns false if failed (loops, etc)
 		bool HasParent(const EntityHandle& child, const EntityHandle& parent) const;
 		void GetChildren(const EntityHandle& parent, std::vector<EntityHandle>& results) const;	// immediate children
 		void GetAllChildren(const EntityHandle& parent, std::vector<EntityHandle>& results) const;	// all children (recursive)
 		std::vector<EntityHandle> GetAllChildren(const EntityHandle& parent);
+		template<class It>	// void(const EntityHandle& child)
+		void ForEachChild(const EntityHandle& parent, const It&) const;				// immediate children, no allocations
+		template<class It>	// void(const EntityHandle& child)
+		void ForEachChildRecursive(const EntityHandle& parent, const It&) const;	// all children (depth-first), no allocations
 
-		// RemoveEntity defers deletion until CollectGarbage() called.
+		// RemoveEntity defers deletion until CollectGarbage() called. The handle, name, id and hierarchy links of the entity are removed immediately,
+		// only the component storage + slot are reclaimed later
 		// reserveHandle = dont add this entity handle to the free list, this slot is reserved until the exact same handle is recreated
 		// only useful for editors to recreate deleted entities while preserving references
 		void RemoveEntity(const EntityHandle& h, bool reserveHandle = false);	
 		bool IsHandleValid(const EntityHandle& h) const;
+		EntityHandle GetEntityFromID(uint32_t publicID) const;		// returns an invalid handle if no entity exists with this ID
 		std::string GetEntityDisplayName(const EntityHandle& h) const;
 		size_t GetEntityDisplayName(const EntityHandle& h, char* nameBuffer, size_t maxLength) const;	// returns size of string written to nameBuffer
 
@@ -49,7 +65,7 @@ namespace Entities
 		// Entity names, try not to abuse this!
 		void SetEntityName(const EntityHandle& h, std::string_view name);
 		const std::string_view GetEntityName(const EntityHandle& h);
-		EntityHandle GetEntityByName(std::string_view name);		// slow!
+		EntityHandle GetEntityByName(std::string_view name);		// if multiple entities share a name, returns the one that was named first
 
 		// Components slow path
 		bool AddComponent(const EntityHandle& e, std::string_view componentTypeName);
@@ -70,10 +86,13 @@ namespace Entities
 		// Called from component storage if a component moves in memory
 		void OnComponentMoved(const EntityHandle& owner, uint32_t typeIndex, uint32_t oldIndex, uint32_t newIndex);
 
-		void CollectGarbage();		// destroy all entities pending deletion
+		void CollectGarbage();		// destroy all entities pending deletion (use before saving)
+		bool CollectGarbage(double maxMilliseconds, uint32_t maxEntities = -1);	// incremental, destroys pending entities in order until the budget is used. returns true if nothing is pending
+		bool IsPendingDelete(const EntityHandle& h) const;	// the slot + handle of pending entities are not reused until they are collected
 		size_t GetPendingDeleteCount() { return m_pendingDelete.size(); }
 		size_t GetReservedHandleCount() { return m_reservedSlots.size(); }
-		size_t GetActiveEntityCount() { return m_allEntities.size() - m_freeEntityIndices.size() - m_reservedSlots.size(); }
+		size_t GetActiveEntityCount() { return m_allEntities.size() - m_freeEntityIndices.size() - m_reservedSlots.size() - m_pendingDelete.size(); }
+		uint64_t GetStructureVersion(uint32_t typeIndex) const { return m_hierarchyVersion + m_componentVersions[typeIndex]; }	// changes whenever parents change or components of this type are added/removed
 
 		// Storage accessors
 		template<class ComponentType> LinearComponentStorage<ComponentType>* GetStorage();
@@ -87,40 +106,103 @@ namespace Entities
 		std::vector<EntityHandle> SerialiseEntities(const JsonSerialiser& json, const std::vector<EntityHandle>& restoreHandles = {});	
 		void SerialiseComponent(const EntityHandle& e, std::string_view componentType, JsonSerialiser& json);		// helper for serialising individual components
 		
+		// Binary world format (see world_binary_format.h)
+		std::vector<uint8_t> SerialiseEntitiesBinary();
+		// returns false if the data is invalid, data can be memory mapped
+		bool SerialiseEntitiesBinary(const uint8_t* data, size_t dataSize, std::vector<EntityHandle>& createdHandles, bool loadWorldName = false);
+
+		// Paths ending in .scnb use the binary format, anything else is json
+		static bool IsBinaryWorldPath(std::string_view path);
 		std::vector<EntityHandle> Import(std::string_view path);
 		bool Load(std::string_view path);
 		bool Save(std::string_view path);
+		static bool ConvertWorldFile(std::string_view srcPath, std::string_view dstPath);	// convert between json + binary formats via a temporary world
+
+		// Copies all entities + components into a new world, pending entities are collected first
+		// Components that are not raw serialisable are serialised now (forBinarySave picks the format), so the snapshot
+		// never touches assets or scripts. It can be saved on another thread while this world keeps changing, but only in that format
+		std::unique_ptr<World> CreateSnapshot(bool forBinarySave);
 		
 	private:
+		class EntityRemapTable		// flat table of entity IDs in serialised data -> new handles, used to remap handles while loading
+		{
+		public:
+			void Reserve(uint32_t maxID) { m_oldIDToNew.reserve(maxID + 1); }
+			void Set(uint32_t oldID, const EntityHandle& h);
+			EntityHandle Find(uint32_t oldID) const { return oldID < m_oldIDToNew.size() ? m_oldIDToNew[oldID] : EntityHandle(); }
+			void Remap(EntityHandle& e) const;		// patch a loaded handle with the new one, thread safe once the table is built
+		private:
+			std::vector<EntityHandle> m_oldIDToNew;
+		};
 		void SerialiseEntity(const EntityHandle& e, JsonSerialiser& target);	// warning, assumes valid handle
+		// componentRemap (optional) - remap handles inside components with this table instead of the newly created entities
+		std::vector<EntityHandle> LoadEntities(const JsonSerialiser& json, const std::vector<EntityHandle>& restoreHandles, const EntityRemapTable* componentRemap);
+		bool LoadEntitiesBinary(const uint8_t* data, size_t dataSize, std::vector<EntityHandle>& createdHandles, bool loadWorldName, const EntityRemapTable* componentRemap);
+		static bool ReadEntityIDsBinary(const uint8_t* data, size_t dataSize, std::vector<uint32_t>& entityIDs);	// returns the entity ID of each row
+		uint32_t AllocateEntitySlot();	// returns the private index of an unused slot
+		void RunLoadJobs(uint32_t jobCount, const std::function<void(uint32_t)>& fn);	// runs fn(0..jobCount) in parallel if possible
 		void AddComponentInternal(const EntityHandle& e, uint32_t resolvedTypeIndex);
+		ComponentStorage* GetOrCreateStorage(uint32_t resolvedTypeIndex);
 		struct PerEntityData
 		{
 			EntityComponentLookup m_componentLookup;		// move this to separate array
 			uint32_t m_publicID = -1;						// used to publicaly identify an entity in a world
-			EntityHandle m_parent;							// if a parent exists, it should have a EntityChildrenComponent!
-			std::vector<EntityHandle> m_children;
+			uint32_t m_pendingDeleteID = -1;				// public ID of the entity while it is in m_pendingDelete (m_publicID is -1)
+		};
+		struct EntityHierarchyLinks		// intrusive parent/child/sibling links, indices are private entity indices
+		{
+			EntityHandle m_parent;
+			uint32_t m_firstChild = -1;
+			uint32_t m_lastChild = -1;
+			uint32_t m_previousSibling = -1;
+			uint32_t m_nextSibling = -1;
 		};
 		struct PendingDeleteEntity 
 		{
 			EntityHandle m_handle;
 			bool m_reserveHandle;
 		};
+		void DestroyPendingEntity(const PendingDeleteEntity& toDelete);
+		struct EntityNameLinks	// links entities that share the same name (private indices)
+		{
+			uint32_t m_previous = -1;
+			uint32_t m_next = -1;
+		};
+		struct EntityNameIndex	// first + last entity with a particular name (private indices)
+		{
+			uint32_t m_first = -1;
+			uint32_t m_last = -1;
+		};
+		struct NameHash		// allows lookup via string_view without constructing a string
+		{
+			using is_transparent = void;
+			size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+		};
+		void DetachChildren(uint32_t privateIndex);		// clears parent of all children, used when deleting entities
+		void AddToNameIndex(uint32_t privateIndex);
+		void RemoveFromNameIndex(uint32_t privateIndex);
 
 		std::string m_name;
 		uint32_t m_entityIDCounter = 0;
+		uint64_t m_hierarchyVersion = 0;	// changes when any parent/child link changes
+		std::array<uint64_t, ComponentTypeRegistry::c_maxTypes> m_componentVersions = {};	// per type, changes when components are added/removed
+		bool m_loadJobsInBackground = false;	// load jobs run on the slow job pool so they never stall the main thread (staging worlds)
 		std::vector<PerEntityData> m_allEntities;
+		std::vector<EntityHierarchyLinks> m_allEntityLinks;	// matches m_allEntities, kept off hot data path
 		std::unordered_map<uint32_t, uint32_t> m_reservedSlots;	// public ID -> free slot index. stores all reserved slots with their public ID
 		std::deque<uint32_t> m_freeEntityIndices;			// free list of entity data
 		std::vector<std::unique_ptr<ComponentStorage>> m_allComponents;	// storage for all components
-		std::vector<PendingDeleteEntity> m_pendingDelete;	// all entities to be deleted (these handles should still all be valid)
+		std::deque<PendingDeleteEntity> m_pendingDelete;	// all entities to be deleted in order (these handles are no longer valid)
 		std::vector<std::string> m_allEntityNames;			// kept off hot data path (m_allEntities)
+		std::vector<EntityNameLinks> m_allEntityNameLinks;	// matches m_allEntityNames
+		std::unordered_map<std::string, EntityNameIndex, NameHash, std::equal_to<>> m_nameIndex;	// name -> entities with that name
+		std::unordered_map<uint32_t, uint32_t> m_publicIDToIndex;	// public ID -> private index for all active entities
 	};
 
 	template<class It>	// bool(const EntityHandle& e)
 	void World::ForEachActiveEntity(const It& it)
 	{
-		if (m_freeEntityIndices.size() == 0 && m_reservedSlots.size() == 0)	// fast path if all slots are allocated
+		if (m_freeEntityIndices.size() == 0 && m_reservedSlots.size() == 0 && m_pendingDelete.size() == 0)	// fast path if all slots are allocated
 		{
 			for (uint32_t i = 0; i < m_allEntities.size(); ++i)
 			{
@@ -146,6 +228,48 @@ namespace Entities
 		}
 	}
 
+	template<class It>	// void(const EntityHandle& child)
+	void World::ForEachChild(const EntityHandle& parent, const It& it) const
+	{
+		if (IsHandleValid(parent))
+		{
+			uint32_t child = m_allEntityLinks[parent.GetPrivateIndex()].m_firstChild;
+			while (child != -1)
+			{
+				const uint32_t next = m_allEntityLinks[child].m_nextSibling;	// in case the iterator modifies the hierarchy
+				it(EntityHandle(m_allEntities[child].m_publicID, child));
+				child = next;
+			}
+		}
+	}
+
+	template<class It>	// void(const EntityHandle& child)
+	void World::ForEachChildRecursive(const EntityHandle& parent, const It& it) const
+	{
+		if (!IsHandleValid(parent))
+		{
+			return;
+		}
+		// walk down to the first child, then across siblings, back up via parents when there are no more siblings
+		const uint32_t root = parent.GetPrivateIndex();
+		uint32_t current = m_allEntityLinks[root].m_firstChild;
+		while (current != -1)
+		{
+			it(EntityHandle(m_allEntities[current].m_publicID, current));
+			const auto& links = m_allEntityLinks[current];
+			if (links.m_firstChild != -1)
+			{
+				current = links.m_firstChild;
+				continue;
+			}
+			while (current != root && m_allEntityLinks[current].m_nextSibling == -1)
+			{
+				current = m_allEntityLinks[current].m_parent.GetPrivateIndex();
+			}
+			current = (current == root) ? -1 : m_allEntityLinks[current].m_nextSibling;
+		}
+	}
+
 	template<class ComponentType>
 	void World::AddComponent(const EntityHandle& e)
 	{
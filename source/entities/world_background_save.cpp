@@ -0,0 +1,75 @@
+#include "world_background_save.h"
+#include "world.h"
+#include "engine/systems/job_system.h"
+#include "core/profiler.h"
+#include "core/log.h"
+#include <atomic>
+#include <cassert>
+
+namespace R3
+{
+namespace Entities
+{
+	struct WorldBackgroundSave::SaveData
+	{
+		std::string m_path;
+		std::unique_ptr<World> m_snapshot;
+		std::atomic<bool> m_finished = false;
+		std::atomic<bool> m_succeeded = false;
+	};
+
+	WorldBackgroundSave::WorldBackgroundSave(World& source, std::string_view path)
+		: m_path(path)
+	{
+		R3_PROF_EVENT();
+		m_data = std::make_shared<SaveData>();
+		m_data->m_path = m_path;
+		m_data->m_snapshot = source.CreateSnapshot(World::IsBinaryWorldPath(path));
+		auto job = [data = m_data]() {
+			SaveSnapshot(*data);
+		};
+		auto jobs = Systems::GetSystem<JobSystem>();
+		if (jobs)
+		{
+			jobs->PushJob(JobSystem::ThreadPool::SlowJobs, std::move(job));
+		}
+		else
+		{
+			job();
+		}
+	}
+
+	WorldBackgroundSave::~WorldBackgroundSave()
+	{
+		// the snapshot is freed here rather than on the save job
+		assert(IsFinished());
+		if (IsFinished())
+		{
+			m_data->m_snapshot = nullptr;
+		}
+		else
+		{
+			LogWarn("Background save of '{}' destroyed while running, the save job will free the snapshot", m_path);
+		}
+	}
+
+	bool WorldBackgroundSave::IsFinished() const
+	{
+		return m_data->m_finished;
+	}
+
+	bool WorldBackgroundSave::Succeeded() const
+	{
+		return m_data->m_finished && m_data->m_succeeded;
+	}
+
+	void WorldBackgroundSave::SaveSnapshot(SaveData& data)
+	{
+		char debugName[1024] = { '\0' };
+		sprintf_s(debugName, "SaveSnapshot %s", data.m_path.c_str());
+		R3_PROF_EVENT_DYN(debugName);
+		data.m_succeeded = data.m_snapshot->Save(data.m_path);
+		data.m_finished = true;
+	}
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <memory>
+
+// Saves a world file on a background job
+// A snapshot of the world is taken on construction, serialisation + file writes then run on the slow job pool
+// The source world can keep changing (or be destroyed) while the save is running
+// Create + destroy saves on the thread that owns the world, the snapshot is freed when the save is destroyed
+namespace R3
+{
+namespace Entities
+{
+	class World;
+	class WorldBackgroundSave
+	{
+	public:
+		WorldBackgroundSave(World& source, std::string_view path);
+		~WorldBackgroundSave();		// frees the snapshot, only destroy saves once they have finished
+		WorldBackgroundSave(const WorldBackgroundSave&) = delete;
+		WorldBackgroundSave& operator=(const WorldBackgroundSave&) = delete;
+
+		bool IsFinished() const;
+		bool Succeeded() const;		// only valid once finished
+		std::string_view GetPath() const { return m_path; }
+
+	private:
+		struct SaveData;		// shared with the save job
+		static void SaveSnapshot(SaveData& data);
+		std::string m_path;
+		std::shared_ptr<SaveData> m_data;
+	};
+}
+}
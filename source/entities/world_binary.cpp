@@ -0,0 +1,404 @@
+#include "world.h"
+#include "world_binary_format.h"
+#include "component_storage.h"
+#include "component_type_registry.h"
+#include "core/profiler.h"
+#include "core/log.h"
+#include "engine/serialiser.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+namespace R3
+{
+namespace Entities
+{
+	using namespace BinaryWorldFormat;
+
+	// append data to the end of the buffer, aligned to c_sectionAlignment, returns the offset of the new data
+	static uint64_t AppendSection(std::vector<uint8_t>& buffer, const void* data, size_t dataSize)
+	{
+		const size_t offset = (buffer.size() + c_sectionAlignment - 1) & ~size_t(c_sectionAlignment - 1);
+		buffer.resize(offset + dataSize);
+		if (dataSize > 0)
+		{
+			memcpy(buffer.data() + offset, data, dataSize);
+		}
+		return offset;
+	}
+
+	template<class T>
+	static uint64_t AppendSection(std::vector<uint8_t>& buffer, const std::vector<T>& data)
+	{
+		return AppendSection(buffer, data.data(), data.size() * sizeof(T));
+	}
+
+	// validates the header + all the entity table sections
+	static bool ReadHeader(const uint8_t* data, size_t dataSize, FileHeader& header)
+	{
+		auto isInRange = [dataSize](uint64_t offset, uint64_t size) {
+			return offset <= dataSize && size <= dataSize - offset;
+		};
+		if (!isInRange(0, sizeof(header)))
+		{
+			LogError("Binary world data is too small");
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (header.m_magic != c_magic || header.m_version != c_version)
+		{
+			LogError("Binary world data has an unsupported version (expected {}, got {})", c_version, header.m_version);
+			return false;
+		}
+		const uint64_t entityCount = header.m_entityCount;
+		if (header.m_fileSize != dataSize ||
+			!isInRange(header.m_worldNameOffset, header.m_worldNameLength) ||
+			!isInRange(header.m_entityIDsOffset, entityCount * sizeof(uint32_t)) ||
+			!isInRange(header.m_parentRowsOffset, entityCount * sizeof(uint32_t)) ||
+			!isInRange(header.m_nameOffsetsOffset, (entityCount + 1) * sizeof(uint32_t)) ||
+			!isInRange(header.m_columnsOffset, header.m_columnCount * sizeof(ColumnHeader)))
+		{
+			LogError("Binary world data is corrupt");
+			return false;
+		}
+		const uint32_t* nameOffsets = reinterpret_cast<const uint32_t*>(data + header.m_nameOffsetsOffset);
+		if (!isInRange(header.m_nameDataOffset, nameOffsets[entityCount]))
+		{
+			LogError("Binary world data is corrupt");
+			return false;
+		}
+		return true;
+	}
+
+	void World::EntityRemapTable::Set(uint32_t oldID, const EntityHandle& h)
+	{
+		if (oldID == -1)
+		{
+			return;
+		}
+		if (oldID >= m_oldIDToNew.size())
+		{
+			m_oldIDToNew.resize(oldID + 1);
+		}
+		m_oldIDToNew[oldID] = h;
+	}
+
+	void World::EntityRemapTable::Remap(EntityHandle& e) const
+	{
+		if (e.GetID() != -1)
+		{
+			const EntityHandle foundRemap = Find(e.GetID());
+			if (foundRemap.GetID() != -1)
+			{
+				e = foundRemap;
+			}
+			else
+			{
+				LogError("Entity handle references ID ({}) that doesn't exist in the loaded world!", e.GetID());
+			}
+		}
+	}
+
+	std::vector<uint8_t> World::SerialiseEntitiesBinary()
+	{
+		R3_PROF_EVENT();
+		std::vector<uint8_t> result;
+		result.resize(sizeof(FileHeader));	// header is written last
+		FileHeader header;
+
+		// entity table, each active entity is assigned a row
+		std::vector<uint32_t> privateIndexToRow(m_allEntities.size(), -1);
+		std::vector<uint32_t> entityIDs, parentRows, nameOffsets;
+		std::vector<char> nameData;
+		for (uint32_t i = 0; i < m_allEntities.size(); ++i)
+		{
+			if (m_allEntities[i].m_publicID != -1)
+			{
+				privateIndexToRow[i] = static_cast<uint32_t>(entityIDs.size());
+				entityIDs.push_back(m_allEntities[i].m_publicID);
+			}
+		}
+		parentRows.reserve(entityIDs.size());
+		nameOffsets.reserve(entityIDs.size() + 1);
+		for (uint32_t i = 0; i < m_allEntities.size(); ++i)
+		{
+			if (m_allEntities[i].m_publicID != -1)
+			{
+				const EntityHandle& parent = m_allEntityLinks[i].m_parent;
+				parentRows.push_back(IsHandleValid(parent) ? privateIndexToRow[parent.GetPrivateIndex()] : -1);
+				nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+				nameData.insert(nameData.end(), m_allEntityNames[i].begin(), m_allEntityNames[i].end());
+			}
+		}
+		nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+		header.m_entityCount = static_cast<uint32_t>(entityIDs.size());
+		header.m_worldNameLength = m_name.size();
+		header.m_worldNameOffset = AppendSection(result, m_name.data(), m_name.size());
+		header.m_entityIDsOffset = AppendSection(result, entityIDs);
+		header.m_parentRowsOffset = AppendSection(result, parentRows);
+		header.m_nameOffsetsOffset = AppendSection(result, nameOffsets);
+		header.m_nameDataOffset = AppendSection(result, nameData);
+
+		// one column per component type
+		const auto& allTypes = ComponentTypeRegistry::GetInstance().AllTypes();
+		std::vector<ColumnHeader> columns;
+		std::vector<uint32_t> ownerRows;
+		std::vector<uint8_t> columnData;
+		for (uint32_t typeIndex = 0; typeIndex < m_allComponents.size(); ++typeIndex)
+		{
+			ComponentStorage* storage = m_allComponents[typeIndex].get();
+			if (storage == nullptr || storage->GetTotalCount() == 0)
+			{
+				continue;
+			}
+			const std::string& typeName = allTypes[typeIndex].m_name;
+			if (typeName.size() >= c_maxTypeNameLength)
+			{
+				LogError("Component type name '{}' is too long for the binary world format", typeName);
+				continue;
+			}
+			ColumnHeader column;
+			memcpy(column.m_typeName, typeName.data(), typeName.size());
+			column.m_count = storage->GetTotalCount();
+			ownerRows.resize(column.m_count);
+			for (uint32_t c = 0; c < column.m_count; ++c)
+			{
+				ownerRows[c] = privateIndexToRow[storage->GetOwnerAtIndex(c).GetPrivateIndex()];
+				assert(ownerRows[c] != -1);
+			}
+			if (storage->IsRawSerialisable())
+			{
+				column.m_encoding = ColumnEncoding::Raw;
+				column.m_elementSize = storage->GetRawSize();
+				columnData.resize(static_cast<size_t>(column.m_count) * column.m_elementSize);
+				storage->WriteRaw(0, column.m_count, columnData.data());
+			}
+			else
+			{
+				column.m_encoding = ColumnEncoding::BinaryArchive;
+				BinaryArchive archive;
+				for (uint32_t c = 0; c < column.m_count; ++c)
+				{
+					const size_t block = archive.BeginBlock();
+					JsonSerialiser componentArchive(JsonSerialiser::Write, &archive);
+					storage->Serialise(storage->GetOwnerAtIndex(c), c, componentArchive);
+					archive.EndBlock(block);
+				}
+				columnData = std::move(archive.GetData());
+			}
+			column.m_ownerRowsOffset = AppendSection(result, ownerRows);
+			column.m_dataOffset = AppendSection(result, columnData);
+			column.m_dataSize = columnData.size();
+			columns.push_back(column);
+		}
+		header.m_columnCount = static_cast<uint32_t>(columns.size());
+		header.m_columnsOffset = AppendSection(result, columns);
+		header.m_fileSize = result.size();
+		memcpy(result.data(), &header, sizeof(header));
+		return result;
+	}
+
+	bool World::SerialiseEntitiesBinary(const uint8_t* data, size_t dataSize, std::vector<EntityHandle>& createdHandles, bool loadWorldName)
+	{
+		return LoadEntitiesBinary(data, dataSize, createdHandles, loadWorldName, nullptr);
+	}
+
+	bool World::LoadEntitiesBinary(const uint8_t* data, size_t dataSize, std::vector<EntityHandle>& createdHandles, bool loadWorldName, const EntityRemapTable* componentRemap)
+	{
+		R3_PROF_EVENT();
+		auto isInRange = [dataSize](uint64_t offset, uint64_t size) {
+			return offset <= dataSize && size <= dataSize - offset;
+		};
+		FileHeader header;
+		if (!ReadHeader(data, dataSize, header))
+		{
+			return false;
+		}
+		const uint64_t entityCount = header.m_entityCount;
+		const uint32_t* entityIDs = reinterpret_cast<const uint32_t*>(data + header.m_entityIDsOffset);
+		const uint32_t* parentRows = reinterpret_cast<const uint32_t*>(data + header.m_parentRowsOffset);
+		const uint32_t* nameOffsets = reinterpret_cast<const uint32_t*>(data + header.m_nameOffsetsOffset);
+		const char* nameData = reinterpret_cast<const char*>(data + header.m_nameDataOffset);
+
+		if (loadWorldName)
+		{
+			m_name = std::string_view(reinterpret_cast<const char*>(data + header.m_worldNameOffset), header.m_worldNameLength);
+		}
+
+		// create all the entities first + build the remap table for any handles stored in components
+		EntityRemapTable oldEntityToNewEntity;
+		{
+			R3_PROF_EVENT("CreateEntities");
+			createdHandles.reserve(createdHandles.size() + entityCount);
+			const size_t firstHandle = createdHandles.size();
+			for (uint32_t row = 0; row < entityCount; ++row)
+			{
+				createdHandles.push_back(AddEntity());
+				oldEntityToNewEntity.Set(entityIDs[row], createdHandles.back());
+			}
+			for (uint32_t row = 0; row < entityCount; ++row)
+			{
+				const EntityHandle& e = createdHandles[firstHandle + row];
+				if (parentRows[row] < entityCount)
+				{
+					SetParent(e, createdHandles[firstHandle + parentRows[row]]);
+				}
+				if (nameOffsets[row] < nameOffsets[row + 1] && nameOffsets[row + 1] <= nameOffsets[entityCount])
+				{
+					SetEntityName(e, std::string_view(nameData + nameOffsets[row], nameOffsets[row + 1] - nameOffsets[row]));
+				}
+			}
+		}
+
+		const size_t firstHandle = createdHandles.size() - entityCount;
+		const ColumnHeader* columns = reinterpret_cast<const ColumnHeader*>(data + header.m_columnsOffset);
+		std::vector<bool> typeLoaded(ComponentTypeRegistry::GetInstance().AllTypes().size(), false);
+		struct ArchiveColumn
+		{
+			const ColumnHeader* m_column;
+			uint32_t m_typeIndex;
+		};
+		std::vector<ArchiveColumn> archiveColumns;	// deserialised in parallel once all components exist
+
+		// Phase 1 (serial) - create all components + copy any raw data
+		for (uint32_t col = 0; col < header.m_columnCount; ++col)
+		{
+			R3_PROF_EVENT("LoadColumn");
+			const ColumnHeader& column = columns[col];
+			const std::string_view typeName(column.m_typeName, strnlen(column.m_typeName, c_maxTypeNameLength));
+			const uint32_t typeIndex = ComponentTypeRegistry::GetInstance().GetTypeIndex(typeName);
+			if (typeIndex == -1)
+			{
+				LogError("Unknown component type '{}' in binary world data", typeName);
+				continue;
+			}
+			if (typeLoaded[typeIndex])
+			{
+				LogError("Component type '{}' has multiple columns in binary world data", typeName);
+				continue;
+			}
+			if (!isInRange(column.m_ownerRowsOffset, column.m_count * sizeof(uint32_t)) || !isInRange(column.m_dataOffset, column.m_dataSize))
+			{
+				LogError("Component column '{}' is corrupt", typeName);
+				continue;
+			}
+			const uint32_t* ownerRows = reinterpret_cast<const uint32_t*>(data + column.m_ownerRowsOffset);
+			const uint8_t* columnData = data + column.m_dataOffset;
+			if (std::any_of(ownerRows, ownerRows + column.m_count, [entityCount](uint32_t row) { return row >= entityCount; }))
+			{
+				LogError("Component column '{}' references entities that do not exist", typeName);
+				continue;
+			}
+			if (column.m_encoding != ColumnEncoding::Raw && column.m_encoding != ColumnEncoding::BinaryArchive)
+			{
+				LogError("Component column '{}' has an unknown encoding", typeName);
+				continue;
+			}
+			ComponentStorage* storage = GetOrCreateStorage(typeIndex);
+			typeLoaded[typeIndex] = true;
+			if (column.m_encoding == ColumnEncoding::Raw)
+			{
+				if (!storage->IsRawSerialisable() || storage->GetRawSize() != column.m_elementSize || column.m_dataSize != static_cast<uint64_t>(column.m_count) * column.m_elementSize)
+				{
+					LogError("Raw component column '{}' does not match the current component layout", typeName);
+					continue;
+				}
+
+				// components are appended to the end of the storage, so we can usually copy the whole column at once
+				const uint32_t firstIndex = storage->GetTotalCount();
+				bool isContiguous = true;
+				for (uint32_t c = 0; c < column.m_count; ++c)
+				{
+					const EntityHandle& owner = createdHandles[firstHandle + ownerRows[c]];
+					AddComponentInternal(owner, typeIndex);
+					isContiguous &= (m_allEntities[owner.GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex) == firstIndex + c);
+				}
+				if (isContiguous)
+				{
+					storage->ReadRaw(firstIndex, column.m_count, columnData);
+				}
+				else
+				{
+					for (uint32_t c = 0; c < column.m_count; ++c)
+					{
+						const EntityHandle& owner = createdHandles[firstHandle + ownerRows[c]];
+						const uint32_t index = m_allEntities[owner.GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex);
+						storage->ReadRaw(index, 1, columnData + static_cast<size_t>(c) * column.m_elementSize);
+					}
+				}
+			}
+			else
+			{
+				for (uint32_t c = 0; c < column.m_count; ++c)
+				{
+					AddComponentInternal(createdHandles[firstHandle + ownerRows[c]], typeIndex);
+				}
+				archiveColumns.push_back({ &column, typeIndex });
+			}
+		}
+
+		// Phase 2 (parallel) - unpack + serialise archived components, one job per column so each storage only has one writer
+		const EntityRemapTable& componentRemapTable = componentRemap ? *componentRemap : oldEntityToNewEntity;
+		const JsonSerialiser::EntityRemapFn remapFn = [&componentRemapTable](EntityHandle& e) {
+			componentRemapTable.Remap(e);
+		};
+		std::sort(archiveColumns.begin(), archiveColumns.end(), [](const ArchiveColumn& c0, const ArchiveColumn& c1) {
+			return c0.m_column->m_dataSize > c1.m_column->m_dataSize;	// start the biggest jobs first
+		});
+		auto loadArchiveColumn = [&](uint32_t i) {
+			R3_PROF_EVENT("LoadArchiveColumn");
+			const ColumnHeader& column = *archiveColumns[i].m_column;
+			const uint32_t typeIndex = archiveColumns[i].m_typeIndex;
+			const std::string& typeName = ComponentTypeRegistry::GetInstance().AllTypes()[typeIndex].m_name;
+			const uint32_t* ownerRows = reinterpret_cast<const uint32_t*>(data + column.m_ownerRowsOffset);
+			const uint8_t* columnData = data + column.m_dataOffset;
+			ComponentStorage* storage = m_allComponents[typeIndex].get();
+			try
+			{
+				BinaryArchive archive(columnData, column.m_dataSize);
+				size_t offset = 0;
+				for (uint32_t c = 0; c < column.m_count; ++c)
+				{
+					const BinaryArchive::Range component = archive.ReadBlock(offset, column.m_dataSize);
+					const EntityHandle& owner = createdHandles[firstHandle + ownerRows[c]];
+					JsonSerialiser componentArchive(&archive, component, &remapFn);
+					const uint32_t index = m_allEntities[owner.GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex);
+					storage->Serialise(owner, index, componentArchive);
+				}
+			}
+			catch (std::exception e)
+			{
+				LogError("Failed to load component column '{}' - {}", typeName, e.what());
+			}
+		};
+		RunLoadJobs(static_cast<uint32_t>(archiveColumns.size()), loadArchiveColumn);
+
+		return true;
+	}
+
+	bool World::ReadEntityIDsBinary(const uint8_t* data, size_t dataSize, std::vector<uint32_t>& entityIDs)
+	{
+		R3_PROF_EVENT();
+		FileHeader header;
+		if (!ReadHeader(data, dataSize, header))
+		{
+			return false;
+		}
+		const uint32_t* ids = reinterpret_cast<const uint32_t*>(data + header.m_entityIDsOffset);
+		entityIDs.assign(ids, ids + header.m_entityCount);
+		return true;
+	}
+
+	bool World::ConvertWorldFile(std::string_view srcPath, std::string_view dstPath)
+	{
+		R3_PROF_EVENT();
+		World tempWorld;
+		if (!tempWorld.Load(srcPath))
+		{
+			LogError("Failed to convert world file '{}'", srcPath);
+			return false;
+		}
+		return tempWorld.Save(dstPath);
+	}
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+
+// Binary world format (.scnb)
+// Stores the same data as the json world format, but laid out in columns per component type
+// All sections are referenced by offset from the start of the file, so it can be used directly from memory (or a memory mapped file)
+// Entities are referenced by 'row' (index into the entity table), this means parents + owners are remapped with a flat table on load
+// Raw columns contain components packed member by member (see raw_members.h), these are copied directly into storage
+// Anything else is stored as a sequence of BinaryArchive blocks, one per component (see engine/binary_archive.h)
+// Only the current version can be loaded, convert older files again from json
+namespace R3
+{
+namespace Entities
+{
+namespace BinaryWorldFormat
+{
+	constexpr uint32_t c_magic = 0x42573352;		// 'R3WB'
+	constexpr uint32_t c_version = 4;				// bump this if the format changes!
+	constexpr uint32_t c_sectionAlignment = 16;		// all sections are aligned to this from the start of the file
+	constexpr uint32_t c_maxTypeNameLength = 64;
+
+	enum class ColumnEncoding : uint32_t
+	{
+		Raw,			// packed plain data components (elementSize * count bytes)
+		BinaryArchive	// BinaryArchive blocks (varint size + fields), one per component
+	};
+
+	struct FileHeader
+	{
+		uint32_t m_magic = c_magic;
+		uint32_t m_version = c_version;
+		uint32_t m_entityCount = 0;
+		uint32_t m_columnCount = 0;
+		uint64_t m_fileSize = 0;
+		uint64_t m_worldNameOffset = 0;		// char[m_worldNameLength]
+		uint64_t m_worldNameLength = 0;
+		uint64_t m_entityIDsOffset = 0;		// uint32_t[m_entityCount], public ID of each entity when it was saved
+		uint64_t m_parentRowsOffset = 0;	// uint32_t[m_entityCount], row of the parent entity or -1
+		uint64_t m_nameOffsetsOffset = 0;	// uint32_t[m_entityCount + 1], offsets into name data
+		uint64_t m_nameDataOffset = 0;		// char data for all entity names
+		uint64_t m_columnsOffset = 0;		// ColumnHeader[m_columnCount]
+	};
+
+	struct ColumnHeader
+	{
+		char m_typeName[c_maxTypeNameLength] = { 0 };	// component type name (null terminated)
+		ColumnEncoding m_encoding = ColumnEncoding::BinaryArchive;
+		uint32_t m_elementSize = 0;		// packed size of one component for raw columns, used to validate the data on load
+		uint32_t m_count = 0;
+		uint32_t m_padding = 0;
+		uint64_t m_ownerRowsOffset = 0;	// uint32_t[m_count], entity row that owns each component
+		uint64_t m_dataOffset = 0;
+		uint64_t m_dataSize = 0;
+	};
+}
+}
+}
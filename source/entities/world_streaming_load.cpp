@@ -0,0 +1,330 @@
+#include "world_streaming_load.h"
+#include "world.h"
+#include "component_storage.h"
+#include "component_type_registry.h"
+#include "engine/serialiser.h"
+#include "engine/systems/job_system.h"
+#include "core/file_io.h"
+#include "core/mapped_file.h"
+#include "core/time.h"
+#include "core/profiler.h"
+#include "core/log.h"
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+
+namespace R3
+{
+namespace Entities
+{
+	struct WorldStreamingLoad::StagingData
+	{
+		std::string m_path;
+		std::atomic<bool> m_jobRunning = false;
+		bool m_failed = false;							// only written by jobs
+		MappedFile m_binaryData;						// binary files stay mapped until staging is complete
+		JsonSerialiser m_entityJson = JsonSerialiser(JsonSerialiser::Read);	// 'AllEntities' array for json files
+		std::vector<uint32_t> m_entityIDs;				// entity ID of each row in the file
+		World::EntityRemapTable m_idToTarget;			// entity ID in file -> reserved handle in the target world
+		World m_stagingWorld;
+		std::vector<EntityHandle> m_stagingHandles;		// staging world handle for each row
+		std::vector<uint32_t> m_parentRows;				// parent row for each row (or -1)
+		std::vector<uint32_t> m_mergeOrder;				// rows sorted so parents are always merged before their children
+	};
+
+	WorldStreamingLoad::WorldStreamingLoad(World& target, std::string_view path, const Budget& budget)
+		: m_target(target)
+		, m_path(path)
+		, m_budget(budget)
+	{
+		R3_PROF_EVENT();
+		m_staging = std::make_shared<StagingData>();
+		m_staging->m_path = m_path;
+		m_staging->m_stagingWorld.m_loadJobsInBackground = true;
+		StartJob(&ParseWorldFile);
+	}
+
+	WorldStreamingLoad::~WorldStreamingLoad()
+	{
+		if (!IsFinished())
+		{
+			ReleaseReservations();	// any running jobs keep the staging data alive until they finish
+		}
+	}
+
+	std::string_view WorldStreamingLoad::GetStateName(State s)
+	{
+		switch (s)
+		{
+		case State::Parsing:
+			return "Parsing";
+		case State::Reserving:
+			return "Reserving";
+		case State::Staging:
+			return "Staging";
+		case State::Merging:
+			return "Merging";
+		case State::Complete:
+			return "Complete";
+		case State::Failed:
+			return "Failed";
+		}
+		return "Unknown";
+	}
+
+	float WorldStreamingLoad::GetProgress() const
+	{
+		if (m_state == State::Complete)
+		{
+			return 1.0f;
+		}
+		if (m_state == State::Merging && m_reservedHandles.size() > 0)
+		{
+			return static_cast<float>(m_nextRow) / static_cast<float>(m_reservedHandles.size());
+		}
+		return 0.0f;
+	}
+
+	void WorldStreamingLoad::StartJob(void (*jobFn)(StagingData&))
+	{
+		assert(!m_staging->m_jobRunning);
+		m_staging->m_jobRunning = true;
+		auto job = [staging = m_staging, jobFn]() {
+			jobFn(*staging);
+			staging->m_jobRunning = false;
+		};
+		auto jobs = Systems::GetSystem<JobSystem>();
+		if (jobs)
+		{
+			jobs->PushJob(JobSystem::ThreadPool::SlowJobs, std::move(job));
+		}
+		else
+		{
+			job();
+		}
+	}
+
+	bool WorldStreamingLoad::IsJobComplete() const
+	{
+		return !m_staging->m_jobRunning;
+	}
+
+	void WorldStreamingLoad::ReleaseReservations()
+	{
+		R3_PROF_EVENT();
+		for (const auto& reserved : m_reservedHandles)
+		{
+			m_target.ReleaseReservedHandle(reserved);	// does nothing if the entity was already merged
+		}
+		m_reservedHandles.clear();
+	}
+
+	bool WorldStreamingLoad::Reserve(uint64_t endTicks, uint32_t& entityBudget)
+	{
+		R3_PROF_EVENT();
+		const uint32_t rowCount = static_cast<uint32_t>(m_staging->m_entityIDs.size());
+		while (m_nextRow < rowCount && entityBudget > 0)
+		{
+			const EntityHandle reserved = m_target.ReserveEntityHandle();
+			m_reservedHandles.push_back(reserved);
+			m_staging->m_idToTarget.Set(m_staging->m_entityIDs[m_nextRow++], reserved);
+			--entityBudget;
+			if (Time::HighPerformanceCounterTicks() >= endTicks)
+			{
+				break;
+			}
+		}
+		return m_nextRow == rowCount;
+	}
+
+	void WorldStreamingLoad::MergeEntity(uint32_t row)
+	{
+		World& stagingWorld = m_staging->m_stagingWorld;
+		const uint32_t stagingIndex = m_staging->m_stagingHandles[row].GetPrivateIndex();
+		const EntityHandle e = m_target.AddEntityFromHandle(m_reservedHandles[row]);
+		if (!m_target.IsHandleValid(e))
+		{
+			LogError("Failed to create streamed entity {} from '{}'", m_reservedHandles[row].GetID(), m_path);
+			return;
+		}
+		m_loadedEntities.push_back(e);
+		const uint32_t parentRow = m_staging->m_parentRows[row];
+		if (parentRow != -1)
+		{
+			m_target.SetParent(e, m_reservedHandles[parentRow]);	// parents are always merged first
+		}
+		m_target.SetEntityName(e, stagingWorld.m_allEntityNames[stagingIndex]);
+
+		// move the components into the target world, any handles they contain were already remapped during staging
+		const EntityComponentLookup& stagedComponents = stagingWorld.m_allEntities[stagingIndex].m_componentLookup;
+		for (uint32_t typeIndex = 0; typeIndex < stagingWorld.m_allComponents.size(); ++typeIndex)
+		{
+			const uint32_t stagedIndex = stagedComponents.GetComponentIndex(typeIndex);
+			if (stagedIndex != -1)
+			{
+				ComponentStorage* storage = m_target.GetOrCreateStorage(typeIndex);
+				m_target.AddComponentInternal(e, typeIndex);
+				const uint32_t targetIndex = m_target.m_allEntities[e.GetPrivateIndex()].m_componentLookup.GetComponentIndex(typeIndex);
+				stagingWorld.m_allComponents[typeIndex]->MoveTo(stagedIndex, *storage, targetIndex);
+			}
+		}
+	}
+
+	bool WorldStreamingLoad::Merge(uint64_t endTicks, uint32_t& entityBudget)
+	{
+		R3_PROF_EVENT();
+		const uint32_t rowCount = static_cast<uint32_t>(m_staging->m_mergeOrder.size());
+		while (m_nextRow < rowCount && entityBudget > 0)
+		{
+			MergeEntity(m_staging->m_mergeOrder[m_nextRow++]);
+			--entityBudget;
+			if (Time::HighPerformanceCounterTicks() >= endTicks)
+			{
+				break;
+			}
+		}
+		return m_nextRow == rowCount;
+	}
+
+	WorldStreamingLoad::State WorldStreamingLoad::Update()
+	{
+		R3_PROF_EVENT();
+		const double ticksPerMs = Time::HighPerformanceCounterFrequency() / 1000.0;
+		const uint64_t endTicks = Time::HighPerformanceCounterTicks() + static_cast<uint64_t>(m_budget.m_maxMilliseconds * ticksPerMs);
+		uint32_t entityBudget = std::max(m_budget.m_maxEntities, 1u);	// always make some progress
+		if (m_state == State::Parsing && IsJobComplete())
+		{
+			if (m_staging->m_failed)
+			{
+				LogError("Failed to parse world file '{}'", m_path);
+				m_staging = nullptr;
+				m_state = State::Failed;
+			}
+			else
+			{
+				m_reservedHandles.reserve(m_staging->m_entityIDs.size());
+				m_nextRow = 0;
+				m_state = State::Reserving;
+			}
+		}
+		if (m_state == State::Reserving && Reserve(endTicks, entityBudget))
+		{
+			StartJob(&StageEntities);
+			m_state = State::Staging;
+		}
+		if (m_state == State::Staging && IsJobComplete())
+		{
+			if (m_staging->m_failed)
+			{
+				LogError("Failed to stage entities from '{}'", m_path);
+				ReleaseReservations();
+				m_staging = nullptr;
+				m_state = State::Failed;
+			}
+			else
+			{
+				m_loadedEntities.reserve(m_reservedHandles.size());
+				m_nextRow = 0;
+				m_state = State::Merging;
+			}
+		}
+		if (m_state == State::Merging && Merge(endTicks, entityBudget))
+		{
+			LogInfo("Streamed {} entities from '{}'", m_loadedEntities.size(), m_path);
+			m_staging = nullptr;	// no jobs are running, this destroys the staging world
+			m_state = State::Complete;
+		}
+		return m_state;
+	}
+
+	void WorldStreamingLoad::ParseWorldFile(StagingData& staging)
+	{
+		char debugName[1024] = { '\0' };
+		sprintf_s(debugName, "ParseWorldFile %s", staging.m_path.c_str());
+		R3_PROF_EVENT_DYN(debugName);
+		if (World::IsBinaryWorldPath(staging.m_path))
+		{
+			staging.m_failed = !staging.m_binaryData.Open(staging.m_path) ||
+				!World::ReadEntityIDsBinary(staging.m_binaryData.GetData().data(), staging.m_binaryData.GetData().size(), staging.m_entityIDs);
+			return;
+		}
+		std::string loadedJsonData;
+		if (!FileIO::LoadTextFromFile(staging.m_path, loadedJsonData))
+		{
+			staging.m_failed = true;
+			return;
+		}
+		try
+		{
+			JsonSerialiser loadedJson(JsonSerialiser::Read);
+			loadedJson.LoadFromString(loadedJsonData);
+			staging.m_entityJson.GetJson() = std::move(loadedJson.GetJson()["AllEntities"]);
+			const auto& allEntities = staging.m_entityJson.GetJson();
+			staging.m_entityIDs.reserve(allEntities.size());
+			for (const auto& entityJson : allEntities)
+			{
+				uint32_t id = entityJson["ID"];
+				staging.m_entityIDs.push_back(id);
+			}
+		}
+		catch (std::exception e)
+		{
+			LogError("Failed to parse world file '{}' - {}", staging.m_path, e.what());
+			staging.m_failed = true;
+		}
+	}
+
+	void WorldStreamingLoad::StageEntities(StagingData& staging)
+	{
+		char debugName[1024] = { '\0' };
+		sprintf_s(debugName, "StageEntities %s", staging.m_path.c_str());
+		R3_PROF_EVENT_DYN(debugName);
+		World& stagingWorld = staging.m_stagingWorld;
+		if (staging.m_binaryData.IsOpen())
+		{
+			const std::span<const uint8_t> binaryData = staging.m_binaryData.GetData();
+			staging.m_failed = !stagingWorld.LoadEntitiesBinary(binaryData.data(), binaryData.size(), staging.m_stagingHandles, false, &staging.m_idToTarget);
+			staging.m_binaryData.Close();
+		}
+		else
+		{
+			staging.m_stagingHandles = stagingWorld.LoadEntities(staging.m_entityJson, {}, &staging.m_idToTarget);
+			staging.m_entityJson.GetJson() = {};
+		}
+		if (staging.m_failed || staging.m_stagingHandles.size() != staging.m_entityIDs.size())
+		{
+			staging.m_failed = true;
+			return;
+		}
+
+		// flatten the staged hierarchy so parents are always merged before children
+		const uint32_t rowCount = static_cast<uint32_t>(staging.m_stagingHandles.size());
+		std::vector<uint32_t> stagingIndexToRow(stagingWorld.m_allEntities.size(), -1);
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			stagingIndexToRow[staging.m_stagingHandles[row].GetPrivateIndex()] = row;
+		}
+		staging.m_parentRows.resize(rowCount, -1);
+		staging.m_mergeOrder.reserve(rowCount);
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			const EntityHandle parent = stagingWorld.GetParent(staging.m_stagingHandles[row]);
+			if (stagingWorld.IsHandleValid(parent))
+			{
+				staging.m_parentRows[row] = stagingIndexToRow[parent.GetPrivateIndex()];
+			}
+			else
+			{
+				staging.m_mergeOrder.push_back(row);
+			}
+		}
+		for (uint32_t i = 0; i < staging.m_mergeOrder.size(); ++i)
+		{
+			stagingWorld.ForEachChild(staging.m_stagingHandles[staging.m_mergeOrder[i]], [&](const EntityHandle& child) {
+				staging.m_mergeOrder.push_back(stagingIndexToRow[child.GetPrivateIndex()]);
+			});
+		}
+		assert(staging.m_mergeOrder.size() == rowCount);
+	}
+}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "entity_handle.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+// Streams a world file into an existing world over multiple frames
+// The file is parsed + all components are deserialised into a staging world on a background thread
+// Staged entities are then moved into the target world in slices, each call to Update does a bounded amount of work
+// Handles are reserved in the target world before staging, so any handles stored in components point directly at the final entities
+namespace R3
+{
+namespace Entities
+{
+	class World;
+	struct WorldStreamingBudget
+	{
+		double m_maxMilliseconds = 2.0;		// stop once this much time was spent in a single update
+		uint32_t m_maxEntities = -1;		// max entities to reserve or merge in a single update
+	};
+
+	class WorldStreamingLoad
+	{
+	public:
+		using Budget = WorldStreamingBudget;
+		enum class State
+		{
+			Parsing,		// loading + parsing the file (background)
+			Reserving,		// reserving handles in the target world
+			Staging,		// deserialising components into the staging world (background)
+			Merging,		// moving staged entities into the target world
+			Complete,
+			Failed
+		};
+
+		WorldStreamingLoad(World& target, std::string_view path, const Budget& budget = {});
+		~WorldStreamingLoad();	// any unused reserved handles are released, the target world must still exist
+		WorldStreamingLoad(const WorldStreamingLoad&) = delete;
+		WorldStreamingLoad& operator=(const WorldStreamingLoad&) = delete;
+
+		State Update();		// call once per frame from the main thread
+		State GetState() const { return m_state; }
+		bool IsFinished() const { return m_state == State::Complete || m_state == State::Failed; }
+		float GetProgress() const;		// 0-1, fraction of entities merged into the target world
+		std::string_view GetPath() const { return m_path; }
+		const std::vector<EntityHandle>& GetLoadedEntities() const { return m_loadedEntities; }	// entities merged so far
+		static std::string_view GetStateName(State s);
+
+	private:
+		struct StagingData;		// shared with background jobs
+		static void ParseWorldFile(StagingData& staging);	// load + parse the file, collect the entity IDs
+		static void StageEntities(StagingData& staging);	// deserialise everything into the staging world, remapping handles to the target world
+		void StartJob(void (*jobFn)(StagingData&));
+		bool IsJobComplete() const;
+		bool Reserve(uint64_t endTicks, uint32_t& entityBudget);
+		bool Merge(uint64_t endTicks, uint32_t& entityBudget);
+		void MergeEntity(uint32_t row);
+		void ReleaseReservations();
+
+		World& m_target;
+		std::string m_path;
+		Budget m_budget;
+		State m_state = State::Parsing;
+		std::shared_ptr<StagingData> m_staging;
+		std::vector<EntityHandle> m_reservedHandles;	// target world handle for each row in the file
+		std::vector<EntityHandle> m_loadedEntities;
+		uint32_t m_nextRow = 0;		// next row to reserve/merge (merging uses the staged hierarchy order)
+	};
+}
+}